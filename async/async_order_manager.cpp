@@ -0,0 +1,71 @@
+#include "async_order_manager.hpp"
+#include "clock.hpp"
+#include "jsonrpc.hpp"
+
+namespace asio = boost::asio;
+
+// payloads use the default memory resource: a thread's arena would be rewound under a suspended call
+asio::awaitable<std::string> AsyncOrderManager::place(std::string symbol, std::string side, double amount, double price, std::string orderType)
+{
+    std::pmr::string payload;
+    payload.reserve(256);
+    UtilityNamespace::encodePlaceOrder(payload, side, symbol, amount, price, orderType);
+    co_return co_await send("private/" + side, payload, ORDER_COST, true);
+}
+
+asio::awaitable<std::string> AsyncOrderManager::cancel(std::string orderId)
+{
+    std::pmr::string payload;
+    payload.reserve(128);
+    UtilityNamespace::encodeCancelOrder(payload, orderId);
+    co_return co_await send("private/cancel", payload, ORDER_COST, true);
+}
+
+asio::awaitable<std::string> AsyncOrderManager::modify(std::string orderId, double amount, double price)
+{
+    std::pmr::string payload;
+    payload.reserve(160);
+    UtilityNamespace::encodeModifyOrder(payload, orderId, amount, price);
+    co_return co_await send("private/edit", payload, ORDER_COST, true);
+}
+
+asio::awaitable<std::string> AsyncOrderManager::getOrderBook(std::string symbol)
+{
+    std::string payload = "{\"jsonrpc\":\"2.0\",\"id\":4,\"method\":\"public/get_order_book\",\"params\":{\"instrument_name\":";
+    UtilityNamespace::appendJsonString(payload, symbol);
+    payload += "}}";
+    co_return co_await send("public/get_order_book", payload, QUERY_COST, false);
+}
+
+asio::awaitable<std::string> AsyncOrderManager::getCurrentPositions(std::string currency)
+{
+    std::string payload = "{\"jsonrpc\":\"2.0\",\"id\":4,\"method\":\"private/get_positions\",\"params\":{\"currency\":";
+    UtilityNamespace::appendJsonString(payload, currency);
+    payload += ",\"kind\":\"future\"}}";
+    co_return co_await send("private/get_positions", payload, QUERY_COST, false);
+}
+
+asio::awaitable<std::string> AsyncOrderManager::getOpenOrders()
+{
+    co_return co_await send("private/get_open_orders", "{\"jsonrpc\":\"2.0\",\"id\":5,\"method\":\"private/get_open_orders\",\"params\":{}}", QUERY_COST, false);
+}
+
+// order requests are journaled like OrderManager's, the account queries are not
+asio::awaitable<std::string> AsyncOrderManager::send(std::string_view path, std::string_view payload, double cost, bool journaled)
+{
+    RequestMetrics &metrics = UtilityNamespace::requestMetrics(path);
+    OrderJournal *orderJournal = journaled ? journal : nullptr;
+    uint64_t sequence = orderJournal ? orderJournal->appendRequest(path, payload) : 0;
+    std::string response;
+    int64_t startNs = UtilityNamespace::steadyNowNs();
+    bool ok = co_await boundSession.post(path, payload, response, cost);
+    metrics.latency.record(UtilityNamespace::steadyNowNs() - startNs);
+    metrics.requests.add();
+    if (!ok)
+        metrics.failures.add();
+    if (orderJournal)
+        orderJournal->appendAck(sequence, ok, response);
+    if (!ok)
+        response.clear();
+    co_return response;
+}
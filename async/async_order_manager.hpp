@@ -0,0 +1,40 @@
+#pragma once
+
+#include "async_session.hpp"
+#include "order_journal.hpp"
+#include "order_manager.hpp"
+#include <string>
+#include <string_view>
+
+// Coroutine counterpart of OrderManager over an AsyncSession:
+//
+//     std::string reply = co_await orders.place("BTC-PERPETUAL", "buy", 10, 50000, "limit");
+//
+// Each call returns the exchange reply, empty on transport errors. Arguments are taken by value so a
+// call stays valid however long it waits. Requests count in the same per-method metrics as OrderManager.
+class AsyncOrderManager
+{
+public:
+    explicit AsyncOrderManager(AsyncSession &session) : boundSession(session) {}
+
+    boost::asio::awaitable<std::string> place(std::string symbol, std::string side, double amount, double price, std::string orderType);
+    boost::asio::awaitable<std::string> cancel(std::string orderId);
+    boost::asio::awaitable<std::string> modify(std::string orderId, double amount, double price);
+    boost::asio::awaitable<std::string> getOrderBook(std::string symbol);
+    boost::asio::awaitable<std::string> getCurrentPositions(std::string currency);
+    boost::asio::awaitable<std::string> getOpenOrders();
+
+    AsyncSession &session() const { return boundSession; }
+    // journals every order request and its reply from now on; null turns journaling off
+    void setJournal(OrderJournal *journal) { this->journal = journal; }
+
+private:
+    // rate-limit credits per request class, the same as OrderManager's
+    static constexpr double ORDER_COST = OrderManager::ORDER_COST;
+    static constexpr double QUERY_COST = OrderManager::QUERY_COST;
+
+    boost::asio::awaitable<std::string> send(std::string_view path, std::string_view payload, double cost, bool journaled);
+
+    AsyncSession &boundSession;
+    OrderJournal *journal = nullptr;
+};
@@ -0,0 +1,364 @@
+#include "async_session.hpp"
+#include "jsonrpc.hpp"
+#include "logger.hpp"
+#include <boost/asio/co_spawn.hpp>
+#include <boost/asio/detached.hpp>
+#include <boost/asio/redirect_error.hpp>
+#include <boost/asio/ssl/host_name_verification.hpp>
+#include <boost/asio/use_awaitable.hpp>
+#include <boost/beast/core/flat_buffer.hpp>
+#include <boost/beast/core/tcp_stream.hpp>
+#include <boost/beast/http.hpp>
+#include <boost/beast/ssl/ssl_stream.hpp>
+#include <optional>
+#include <simdjson.h>
+#include <stdexcept>
+
+namespace asio = boost::asio;
+namespace beast = boost::beast;
+namespace http = boost::beast::http;
+
+// one keep-alive connection; only one of plain and secure is used, depending on the base URL
+struct AsyncSession::Connection
+{
+    Connection(asio::io_context &io, asio::ssl::context &sslContext, bool tls)
+    {
+        if (tls)
+            secure.emplace(io, sslContext);
+        else
+            plain.emplace(io);
+    }
+
+    beast::tcp_stream &tcp() { return plain ? *plain : beast::get_lowest_layer(*secure); }
+
+    std::optional<beast::tcp_stream> plain;
+    std::optional<beast::ssl_stream<beast::tcp_stream>> secure;
+    beast::flat_buffer buffer;
+    bool connected = false;
+    bool reused = false; // has carried a request before
+};
+
+// a request parked until release() hands it a connection, or a free slot to open one
+struct AsyncSession::Waiter
+{
+    asio::steady_timer timer;
+    std::unique_ptr<Connection> handed;
+};
+
+namespace
+{
+    // splits scheme://host[:port]/path into its parts
+    void parseBaseUrl(const std::string &url, bool &tls, std::string &host, std::string &port, std::string &basePath)
+    {
+        size_t schemeEnd = url.find("://");
+        if (schemeEnd == std::string::npos)
+            throw std::runtime_error("Base URL without a scheme: " + url);
+        std::string scheme = url.substr(0, schemeEnd);
+        if (scheme != "https" && scheme != "http")
+            throw std::runtime_error("Unsupported scheme in base URL: " + url);
+        tls = scheme == "https";
+        size_t hostStart = schemeEnd + 3;
+        size_t pathStart = url.find('/', hostStart);
+        std::string authority = url.substr(hostStart, pathStart == std::string::npos ? std::string::npos : pathStart - hostStart);
+        basePath = pathStart == std::string::npos ? "/" : url.substr(pathStart);
+        if (basePath.back() != '/')
+            basePath += '/';
+        size_t colon = authority.rfind(':');
+        host = authority.substr(0, colon);
+        port = colon == std::string::npos ? (tls ? "443" : "80") : authority.substr(colon + 1);
+    }
+
+    // errors of a connection the server closed while it sat idle, before any reply bytes came back
+    bool closedBeforeReply(const boost::system::error_code &ec)
+    {
+        return ec == http::error::end_of_stream || ec == asio::error::eof || ec == asio::error::connection_reset || ec == asio::error::broken_pipe;
+    }
+}
+
+AsyncSession::AsyncSession(asio::io_context &io, std::string name, Credentials credentials, AsyncSessionOptions opts)
+    : io(io), sessionName(std::move(name)), credentials(std::move(credentials)), options(std::move(opts)),
+      limiter(options.creditsPerSecond, options.burstCredits), sslContext(asio::ssl::context::tls_client), refreshTimer(io),
+      throttledMetric(UtilityNamespace::metrics().counter("oems_throttled_total", "Requests that waited for rate-limit credits", {{"session", sessionName}})),
+      waitingMetric(UtilityNamespace::metrics().gauge("oems_transport_waiters", "Threads waiting for a free keep-alive transport", {{"session", sessionName}}))
+{
+    parseBaseUrl(options.baseUrl, tls, host, port, basePath);
+    if (tls)
+    {
+        sslContext.set_default_verify_paths();
+        sslContext.set_verify_mode(asio::ssl::verify_peer);
+    }
+}
+
+AsyncSession::~AsyncSession() = default;
+
+void AsyncSession::close()
+{
+    closed = true;
+    refreshTimer.cancel();
+    open -= idle.size();
+    idle.clear();
+}
+
+asio::awaitable<void> AsyncSession::authenticate()
+{
+    std::string payload = "{\"jsonrpc\":\"2.0\",\"id\":1,\"method\":\"public/auth\",\"params\":{\"grant_type\":\"client_credentials\",\"client_id\":";
+    UtilityNamespace::appendJsonString(payload, credentials.clientId);
+    payload += ",\"client_secret\":";
+    UtilityNamespace::appendJsonString(payload, credentials.clientSecret);
+    payload += "}}";
+    if (!co_await requestToken(payload))
+        throw std::runtime_error("Authentication failed for session " + sessionName);
+}
+
+// posts an auth request and on success stores the tokens and starts the refresh loop
+asio::awaitable<bool> AsyncSession::requestToken(const std::string &payload)
+{
+    std::string response;
+    if (!co_await post("public/auth", payload, response, 0.0))
+    {
+        OEMS_LOG_ERROR("Session {}: auth request failed", sessionName);
+        co_return false;
+    }
+
+    std::string accessToken, nextRefreshToken;
+    int64_t expiresIn = 0;
+    try
+    {
+        simdjson::ondemand::parser parser;
+        simdjson::padded_string body(response);
+        simdjson::ondemand::document doc = parser.iterate(body);
+        simdjson::ondemand::object result;
+        if (doc["result"].get_object().get(result) != simdjson::SUCCESS)
+        {
+            OEMS_LOG_ERROR("Session {}: authentication failed. Response: {}", sessionName, response);
+            co_return false;
+        }
+        for (auto field : result)
+        {
+            std::string_view key = field.unescaped_key();
+            if (key == "access_token")
+                accessToken = std::string(std::string_view(field.value().get_string()));
+            else if (key == "refresh_token")
+                nextRefreshToken = std::string(std::string_view(field.value().get_string()));
+            else if (key == "expires_in")
+                expiresIn = field.value().get_int64();
+        }
+    }
+    catch (const simdjson::simdjson_error &e)
+    {
+        OEMS_LOG_ERROR("Session {}: error parsing auth response: {}", sessionName, e.what());
+        co_return false;
+    }
+    if (accessToken.empty())
+        co_return false;
+
+    authHeader = "Bearer " + accessToken;
+    refreshToken = std::move(nextRefreshToken);
+    if (expiresIn > 0)
+        asio::co_spawn(io, refreshLoop(std::chrono::seconds(expiresIn)), asio::detached);
+    co_return true;
+}
+
+// refresh_token grant, falling back to the client credentials; retries in a few seconds if both fail
+asio::awaitable<void> AsyncSession::refreshLoop(std::chrono::seconds expiresIn)
+{
+    std::chrono::seconds delay = std::max(expiresIn - options.refreshMargin, std::chrono::seconds(1));
+    while (!closed)
+    {
+        refreshTimer.expires_after(delay);
+        boost::system::error_code ec;
+        co_await refreshTimer.async_wait(asio::redirect_error(asio::use_awaitable, ec));
+        if (ec || closed)
+            co_return;
+        if (!refreshToken.empty())
+        {
+            std::string payload = "{\"jsonrpc\":\"2.0\",\"id\":1,\"method\":\"public/auth\",\"params\":{\"grant_type\":\"refresh_token\",\"refresh_token\":";
+            UtilityNamespace::appendJsonString(payload, refreshToken);
+            payload += "}}";
+            if (co_await requestToken(payload))
+                co_return; // the new token started its own loop
+        }
+        try
+        {
+            co_await authenticate();
+            co_return;
+        }
+        catch (const std::exception &e)
+        {
+            OEMS_LOG_WARN("{}, retrying", e.what());
+        }
+        delay = options.refreshMargin + std::chrono::seconds(5);
+    }
+}
+
+asio::awaitable<bool> AsyncSession::post(std::string_view path, std::string_view payload, std::string &response, double cost)
+{
+    if (cost > 0)
+    {
+        std::chrono::nanoseconds wait = limiter.tryAcquire(cost);
+        if (wait.count() != 0)
+        {
+            ++throttledCount;
+            throttledMetric.add();
+            asio::steady_timer timer(io);
+            for (; wait.count() != 0; wait = limiter.tryAcquire(cost))
+            {
+                timer.expires_after(wait);
+                co_await timer.async_wait(asio::use_awaitable);
+            }
+        }
+    }
+
+    std::string target = basePath;
+    target += path;
+    std::unique_ptr<Connection> connection = co_await acquire();
+    bool keepAlive = false, written = false;
+    boost::system::error_code ec = co_await roundTrip(*connection, target, payload, response, keepAlive, written);
+    // resend on a stale keep-alive connection only if the request never left or is a public one:
+    // a private request that was written may already have reached the matching engine
+    if (ec && connection->reused && closedBeforeReply(ec) && (!written || path.starts_with("public/")))
+    {
+        OEMS_LOG_WARN("Session {}: idle connection to {} was closed, resending", sessionName, host);
+        ec = co_await roundTrip(*connection, target, payload, response, keepAlive, written);
+    }
+    connectionStats.requests.fetch_add(1, std::memory_order_relaxed);
+    if (ec)
+    {
+        connectionStats.failures.fetch_add(1, std::memory_order_relaxed);
+        OEMS_LOG_ERROR("Session {}: request to {} failed: {}", sessionName, host, ec.message());
+    }
+    connection->reused = true;
+    release(std::move(connection), !ec && keepAlive && !closed);
+    co_return !ec;
+}
+
+// an idle connection, a new one while under maxConnections, or the next one released
+asio::awaitable<std::unique_ptr<AsyncSession::Connection>> AsyncSession::acquire()
+{
+    if (!idle.empty())
+    {
+        std::unique_ptr<Connection> connection = std::move(idle.back());
+        idle.pop_back();
+        co_return connection;
+    }
+    if (open < std::max<size_t>(options.maxConnections, 1))
+    {
+        ++open;
+        co_return std::make_unique<Connection>(io, sslContext, tls);
+    }
+
+    Waiter waiter{asio::steady_timer(io, asio::steady_timer::time_point::max()), nullptr};
+    waiters.push_back(&waiter);
+    waitingMetric.add(1);
+    boost::system::error_code ec;
+    co_await waiter.timer.async_wait(asio::redirect_error(asio::use_awaitable, ec)); // cancelled by release()
+    waitingMetric.add(-1);
+    if (waiter.handed)
+        co_return std::move(waiter.handed);
+    // a connection was dropped and its slot, still counted in open, is ours
+    co_return std::make_unique<Connection>(io, sslContext, tls);
+}
+
+// hands the connection, or the slot of a dropped one, to the oldest waiter; a slot changes hands
+// without leaving open, so a request arriving meanwhile cannot open one more than maxConnections
+void AsyncSession::release(std::unique_ptr<Connection> connection, bool reusable)
+{
+    if (!reusable)
+        connection.reset();
+    if (!waiters.empty())
+    {
+        Waiter *waiter = waiters.front();
+        waiters.pop_front();
+        waiter->handed = std::move(connection);
+        waiter->timer.cancel();
+        return;
+    }
+    if (connection)
+        idle.push_back(std::move(connection));
+    else
+        --open;
+}
+
+asio::awaitable<boost::system::error_code> AsyncSession::connect(Connection &connection)
+{
+    boost::system::error_code ec;
+    if (endpoints.empty())
+    {
+        asio::ip::tcp::resolver resolver(io);
+        endpoints = co_await resolver.async_resolve(host, port, asio::redirect_error(asio::use_awaitable, ec));
+        if (ec)
+            co_return ec;
+    }
+
+    if (connection.secure)
+        connection.secure.emplace(io, sslContext); // TLS state does not survive a reconnect
+    else
+        connection.plain->close();
+    connection.buffer.clear();
+    beast::tcp_stream &tcp = connection.tcp();
+    tcp.expires_after(options.requestTimeout);
+    co_await tcp.async_connect(endpoints, asio::redirect_error(asio::use_awaitable, ec));
+    if (ec)
+        co_return ec;
+    connectionStats.socketsOpened.fetch_add(1, std::memory_order_relaxed);
+    UtilityNamespace::applySocketOptions(tcp.socket().native_handle(), options.socket, &connectionStats);
+
+    if (connection.secure)
+    {
+        SSL_set_tlsext_host_name(connection.secure->native_handle(), host.c_str());
+        connection.secure->set_verify_callback(asio::ssl::host_name_verification(host));
+        co_await connection.secure->async_handshake(asio::ssl::stream_base::client, asio::redirect_error(asio::use_awaitable, ec));
+        if (ec)
+            co_return ec;
+    }
+    connection.connected = true;
+    co_return ec;
+}
+
+asio::awaitable<boost::system::error_code> AsyncSession::roundTrip(Connection &connection, std::string_view target, std::string_view payload, std::string &response, bool &keepAlive, bool &written)
+{
+    boost::system::error_code ec;
+    written = false;
+    if (!connection.connected)
+    {
+        ec = co_await connect(connection);
+        if (ec)
+            co_return ec;
+    }
+
+    http::request<http::string_body> request(http::verb::post, beast::string_view(target.data(), target.size()), 11);
+    request.set(http::field::host, host);
+    request.set(http::field::content_type, "application/json");
+    if (!authHeader.empty())
+        request.set(http::field::authorization, authHeader);
+    request.body().assign(payload.data(), payload.size());
+    request.prepare_payload();
+
+    http::response<http::string_body> reply;
+    connection.tcp().expires_after(options.requestTimeout);
+    size_t sent = 0, received = 0;
+    if (connection.secure)
+    {
+        sent = co_await http::async_write(*connection.secure, request, asio::redirect_error(asio::use_awaitable, ec));
+        written = !ec;
+        if (!ec)
+            received = co_await http::async_read(*connection.secure, connection.buffer, reply, asio::redirect_error(asio::use_awaitable, ec));
+    }
+    else
+    {
+        sent = co_await http::async_write(*connection.plain, request, asio::redirect_error(asio::use_awaitable, ec));
+        written = !ec;
+        if (!ec)
+            received = co_await http::async_read(*connection.plain, connection.buffer, reply, asio::redirect_error(asio::use_awaitable, ec));
+    }
+    if (ec)
+    {
+        connection.connected = false;
+        co_return ec;
+    }
+    connectionStats.bytesSent.fetch_add(sent, std::memory_order_relaxed);
+    connectionStats.bytesReceived.fetch_add(received, std::memory_order_relaxed);
+    response.append(reply.body());
+    keepAlive = reply.keep_alive();
+    co_return ec;
+}
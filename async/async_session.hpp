@@ -0,0 +1,97 @@
+#pragma once
+
+// before any asio header: Boost 1.74's awaitable.hpp uses std::exchange without including <utility>
+#include <utility>
+#include <boost/asio/awaitable.hpp>
+#include <boost/asio/io_context.hpp>
+#include <boost/asio/ip/tcp.hpp>
+#include <boost/asio/ssl/context.hpp>
+#include <boost/asio/steady_timer.hpp>
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "metrics.hpp"
+#include "session.hpp"
+#include "socket_tuning.hpp"
+
+struct AsyncSessionOptions
+{
+    size_t maxConnections = 64; // keep-alive connections, opened on demand; further requests wait for one
+    SocketOptions socket = UtilityNamespace::defaultSocketOptions();
+    double creditsPerSecond = 20.0;
+    double burstCredits = 50.0;
+    std::chrono::seconds refreshMargin{60}; // refresh this long before the token expires
+    std::chrono::milliseconds requestTimeout{10000};
+    std::string baseUrl = "https://test.deribit.com/api/v2/"; // http:// works too, e.g. for local mocks
+};
+
+// Coroutine counterpart of Session: one exchange account whose requests are awaited instead of
+// blocking a thread. Requests go over HTTP/1.1 keep-alive connections (Beast) driven by the context,
+// so thousands of order workflows can be in flight on one thread. Not thread safe: run the context on
+// a single thread. Destroy the session only once no request is in flight.
+class AsyncSession
+{
+public:
+    AsyncSession(boost::asio::io_context &io, std::string name, Credentials credentials, AsyncSessionOptions options = AsyncSessionOptions());
+    ~AsyncSession();
+    AsyncSession(const AsyncSession &) = delete;
+    AsyncSession &operator=(const AsyncSession &) = delete;
+
+    // client_credentials grant; keeps the token refreshed on the context. Throws std::runtime_error on failure
+    boost::asio::awaitable<void> authenticate();
+
+    // path is relative to baseUrl (e.g. "private/buy"); waits for rate budget and a connection without
+    // blocking the thread, then appends the reply to response. Returns false on transport errors; a private request
+    // that was written before the connection failed is not resent, as it may have been executed.
+    // path and payload must stay valid until the call completes
+    boost::asio::awaitable<bool> post(std::string_view path, std::string_view payload, std::string &response, double cost = 1.0);
+
+    // stops the token refresh and closes idle connections; requests in flight still complete
+    void close();
+
+    const std::string &name() const { return sessionName; }
+    size_t openConnections() const { return open; }
+    uint64_t throttled() const { return throttledCount; }
+    const ConnectionStats &stats() const { return connectionStats; }
+
+private:
+    struct Connection;
+    struct Waiter;
+
+    boost::asio::awaitable<std::unique_ptr<Connection>> acquire();
+    void release(std::unique_ptr<Connection> connection, bool reusable);
+    boost::asio::awaitable<boost::system::error_code> connect(Connection &connection);
+    boost::asio::awaitable<boost::system::error_code> roundTrip(Connection &connection, std::string_view target, std::string_view payload, std::string &response, bool &keepAlive, bool &written);
+    boost::asio::awaitable<bool> requestToken(const std::string &payload);
+    boost::asio::awaitable<void> refreshLoop(std::chrono::seconds expiresIn);
+
+    boost::asio::io_context &io;
+    std::string sessionName;
+    Credentials credentials;
+    AsyncSessionOptions options;
+    RateLimiter limiter;
+    bool tls = true;
+    std::string host;
+    std::string port;
+    std::string basePath; // e.g. /api/v2/
+    boost::asio::ssl::context sslContext;
+    boost::asio::ip::tcp::resolver::results_type endpoints; // resolved on the first connect
+
+    std::string authHeader; // "Bearer <token>"
+    std::string refreshToken;
+    boost::asio::steady_timer refreshTimer;
+    bool closed = false;
+
+    std::vector<std::unique_ptr<Connection>> idle;
+    std::deque<Waiter *> waiters;
+    size_t open = 0; // connections that exist, idle or lent out
+
+    uint64_t throttledCount = 0;
+    ConnectionStats connectionStats;
+    Counter &throttledMetric; // the same series as a Session of this name
+    Gauge &waitingMetric;     // requests waiting for a free connection
+};
@@ -0,0 +1,157 @@
+// Compares two Google Benchmark JSON results (--benchmark_out_format=json) case by case.
+// usage: bench_compare [--skip-missing-baseline] <baseline.json> <current.json> [tolerancePercent] [real_time|cpu_time]
+// Cases run with repetitions are compared by their median. Exits 1 when a case is slower than the
+// baseline by more than the tolerance (default 10%), failed in the current run or is missing from it,
+// 2 on unreadable input. With --skip-missing-baseline, a baseline file that does not exist yet is
+// reported and the comparison skipped with exit 0, so a check can run before one is recorded.
+#include <nlohmann/json.hpp>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <string>
+
+namespace
+{
+    struct CaseResult
+    {
+        double ns = 0.0;
+        bool failed = false;
+    };
+
+    double toNs(double value, const std::string &unit)
+    {
+        if (unit == "us")
+            return value * 1e3;
+        if (unit == "ms")
+            return value * 1e6;
+        if (unit == "s")
+            return value * 1e9;
+        return value;
+    }
+
+    // median aggregates when the run had repetitions, else the mean of the plain iterations
+    bool load(const std::string &path, const std::string &metric, std::map<std::string, CaseResult> &cases)
+    {
+        std::ifstream in(path);
+        if (!in)
+        {
+            std::cerr << "Cannot read " << path << "\n";
+            return false;
+        }
+        nlohmann::json results;
+        try
+        {
+            results = nlohmann::json::parse(in);
+        }
+        catch (const nlohmann::json::exception &e)
+        {
+            std::cerr << path << ": " << e.what() << "\n";
+            return false;
+        }
+
+        std::map<std::string, CaseResult> medians;
+        std::map<std::string, std::pair<double, int>> sums;
+        for (const auto &entry : results.value("benchmarks", nlohmann::json::array()))
+        {
+            std::string name = entry.value("run_name", entry.value("name", ""));
+            if (entry.value("error_occurred", false))
+            {
+                cases[name].failed = true;
+                continue;
+            }
+            double ns = toNs(entry.value(metric, 0.0), entry.value("time_unit", "ns"));
+            if (entry.value("run_type", "iteration") == "aggregate")
+            {
+                if (entry.value("aggregate_name", "") == "median")
+                    medians[name].ns = ns;
+            }
+            else
+            {
+                sums[name].first += ns;
+                ++sums[name].second;
+            }
+        }
+        for (const auto &[name, sum] : sums)
+            cases[name].ns = sum.first / sum.second;
+        for (const auto &[name, median] : medians)
+            cases[name].ns = median.ns;
+        return true;
+    }
+
+    std::string formatNs(double ns)
+    {
+        char text[32];
+        if (ns >= 1e6)
+            std::snprintf(text, sizeof(text), "%.2f ms", ns / 1e6);
+        else if (ns >= 1e3)
+            std::snprintf(text, sizeof(text), "%.2f us", ns / 1e3);
+        else
+            std::snprintf(text, sizeof(text), "%.1f ns", ns);
+        return text;
+    }
+}
+
+int main(int argc, char **argv)
+{
+    bool skipMissingBaseline = argc > 1 && std::strcmp(argv[1], "--skip-missing-baseline") == 0;
+    if (skipMissingBaseline)
+    {
+        --argc;
+        ++argv;
+    }
+    if (argc < 3)
+    {
+        std::cerr << "Usage: bench_compare [--skip-missing-baseline] <baseline.json> <current.json> [tolerancePercent] [real_time|cpu_time]\n";
+        return 2;
+    }
+    double tolerance = argc > 3 ? std::atof(argv[3]) : 10.0;
+    std::string metric = argc > 4 ? argv[4] : "real_time";
+
+    if (skipMissingBaseline && !std::filesystem::exists(argv[1]))
+    {
+        std::printf("No baseline at %s, skipping the comparison (record one with bench-baseline)\n", argv[1]);
+        return 0;
+    }
+    std::map<std::string, CaseResult> baseline, current;
+    if (!load(argv[1], metric, baseline) || !load(argv[2], metric, current))
+        return 2;
+
+    int regressions = 0;
+    std::printf("%-48s %12s %12s %9s\n", "case", "baseline", "current", "change");
+    for (const auto &[name, now] : current)
+    {
+        auto it = baseline.find(name);
+        if (now.failed)
+        {
+            std::printf("%-48s %12s %12s %9s  FAILED\n", name.c_str(), it == baseline.end() ? "-" : formatNs(it->second.ns).c_str(), "-", "-");
+            ++regressions;
+            continue;
+        }
+        if (it == baseline.end() || it->second.failed || it->second.ns <= 0.0)
+        {
+            std::printf("%-48s %12s %12s %9s  new\n", name.c_str(), "-", formatNs(now.ns).c_str(), "-");
+            continue;
+        }
+        double change = (now.ns / it->second.ns - 1.0) * 100.0;
+        bool regressed = change > tolerance;
+        regressions += regressed;
+        std::printf("%-48s %12s %12s %+8.1f%%%s\n", name.c_str(), formatNs(it->second.ns).c_str(), formatNs(now.ns).c_str(), change,
+                    regressed ? "  REGRESSED" : "");
+    }
+    // a case that stopped running, was renamed or was filtered out is not checked, so it fails too
+    for (const auto &[name, before] : baseline)
+    {
+        if (current.count(name))
+            continue;
+        std::printf("%-48s %12s %12s %9s  MISSING\n", name.c_str(), formatNs(before.ns).c_str(), "-", "-");
+        ++regressions;
+    }
+
+    if (regressions)
+        std::printf("%d case(s) slower than the baseline by more than %.1f%%, failed or missing\n", regressions, tolerance);
+    return regressions ? 1 : 0;
+}
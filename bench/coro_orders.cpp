@@ -0,0 +1,272 @@
+// Concurrency scaling of the two async order APIs against a local mock exchange that answers every
+// request after a fixed delay: OrderManager::placeOrderAsync on a SessionLoop (a blocking request per
+// loop thread) and AsyncOrderManager on one coroutine thread. Each of N workflows places its orders
+// one after another, so N is the number of requests in flight.
+// usage: coro_orders [delay_us] [orders_per_workflow] [concurrency...]
+#include "async_order_manager.hpp"
+#include "order_manager.hpp"
+#include "session.hpp"
+#include <boost/asio/co_spawn.hpp>
+#include <boost/asio/detached.hpp>
+#include <boost/asio/redirect_error.hpp>
+#include <boost/asio/use_awaitable.hpp>
+#include <boost/beast/core.hpp>
+#include <boost/beast/http.hpp>
+#include <atomic>
+#include <condition_variable>
+#include <cstdio>
+#include <cstdlib>
+#include <ctime>
+#include <functional>
+#include <iostream>
+#include <mutex>
+#include <pthread.h>
+#include <string>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+namespace asio = boost::asio;
+namespace beast = boost::beast;
+namespace http = boost::beast::http;
+using asio::ip::tcp;
+
+namespace
+{
+    const char ORDER_REPLY[] = "{\"jsonrpc\":\"2.0\",\"id\":1,\"result\":{\"order\":{\"order_id\":\"ETH-1\",\"order_state\":\"open\"},\"trades\":[]}}";
+
+    // HTTP/1.1 keep-alive server on 127.0.0.1 with its own thread; replies after delay
+    class MockExchange
+    {
+    public:
+        explicit MockExchange(std::chrono::microseconds delay)
+            : delay(delay), acceptor(io, tcp::endpoint(asio::ip::make_address("127.0.0.1"), 0))
+        {
+            acceptor.listen(4096);
+            asio::co_spawn(io, accept(), asio::detached);
+            thread = std::thread([this]()
+                                 { io.run(); });
+        }
+        ~MockExchange()
+        {
+            io.stop();
+            thread.join();
+        }
+
+        uint16_t port() const { return acceptor.local_endpoint().port(); }
+        // CPU time of the mock's thread, to leave it out of the client's share
+        double cpuSeconds()
+        {
+            clockid_t clock;
+            timespec ts{};
+            if (pthread_getcpuclockid(thread.native_handle(), &clock) != 0 || clock_gettime(clock, &ts) != 0)
+                return 0.0;
+            return ts.tv_sec + ts.tv_nsec / 1e9;
+        }
+
+    private:
+        asio::awaitable<void> accept()
+        {
+            while (true)
+            {
+                boost::system::error_code ec;
+                tcp::socket socket = co_await acceptor.async_accept(asio::redirect_error(asio::use_awaitable, ec));
+                if (ec)
+                    co_return;
+                socket.set_option(tcp::no_delay(true));
+                asio::co_spawn(io, serve(std::move(socket)), asio::detached);
+            }
+        }
+
+        asio::awaitable<void> serve(tcp::socket socket)
+        {
+            beast::tcp_stream stream(std::move(socket));
+            beast::flat_buffer buffer;
+            asio::steady_timer timer(io);
+            boost::system::error_code ec;
+            while (true)
+            {
+                http::request<http::string_body> request;
+                co_await http::async_read(stream, buffer, request, asio::redirect_error(asio::use_awaitable, ec));
+                if (ec)
+                    co_return;
+                timer.expires_after(delay);
+                co_await timer.async_wait(asio::redirect_error(asio::use_awaitable, ec));
+                http::response<http::string_body> reply(http::status::ok, 11);
+                reply.set(http::field::content_type, "application/json");
+                reply.keep_alive(request.keep_alive());
+                reply.body() = ORDER_REPLY;
+                reply.prepare_payload();
+                co_await http::async_write(stream, reply, asio::redirect_error(asio::use_awaitable, ec));
+                if (ec)
+                    co_return;
+            }
+        }
+
+        std::chrono::microseconds delay;
+        asio::io_context io;
+        tcp::acceptor acceptor;
+        std::thread thread;
+    };
+
+    struct RunResult
+    {
+        double seconds = 0.0;
+        double cpuSeconds = 0.0; // process CPU minus the mock's
+        size_t threads = 0;      // threads carrying requests
+        long rssDeltaKb = 0;     // resident memory added while the workflows run
+        uint64_t failures = 0;
+    };
+
+    double processCpuSeconds()
+    {
+        timespec ts{};
+        clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &ts);
+        return ts.tv_sec + ts.tv_nsec / 1e9;
+    }
+
+    long residentKb()
+    {
+        long pages = 0, resident = 0;
+        std::FILE *statm = std::fopen("/proc/self/statm", "r");
+        if (statm)
+        {
+            if (std::fscanf(statm, "%ld %ld", &pages, &resident) != 2)
+                resident = 0;
+            std::fclose(statm);
+        }
+        return resident * (sysconf(_SC_PAGESIZE) / 1024);
+    }
+
+    std::string baseUrl(MockExchange &mock)
+    {
+        return "http://127.0.0.1:" + std::to_string(mock.port()) + "/api/v2/";
+    }
+
+    // one loop thread and one keep-alive transport per workflow, as SessionLoop asks for
+    RunResult runThreadPool(MockExchange &mock, size_t workflows, size_t orders)
+    {
+        RunResult result;
+        long rssBefore = residentKb();
+        SessionLoop loop(workflows);
+        SessionOptions options;
+        options.poolSize = workflows;
+        options.creditsPerSecond = 1e9;
+        options.burstCredits = 1e9;
+        options.baseUrl = baseUrl(mock);
+        Session session(loop, "pool", Credentials(), options);
+        OrderManager manager(session);
+
+        std::mutex mutex;
+        std::condition_variable finished;
+        size_t running = workflows;
+        std::atomic<uint64_t> failures{0};
+        // each completion places the workflow's next order
+        std::function<void(size_t)> next = [&](size_t remaining)
+        {
+            if (remaining == 0)
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                if (--running == 0)
+                    finished.notify_one();
+                return;
+            }
+            manager.placeOrderAsync("ETH-PERPETUAL", "buy", 1, 2000, "limit", [&, remaining](bool ok, const std::string &)
+                                    {
+                                        if (!ok)
+                                            failures.fetch_add(1, std::memory_order_relaxed);
+                                        next(remaining - 1); });
+        };
+
+        double mockCpu = mock.cpuSeconds();
+        double cpu = processCpuSeconds();
+        auto start = std::chrono::steady_clock::now();
+        for (size_t i = 0; i < workflows; ++i)
+            next(orders);
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            finished.wait(lock, [&]()
+                          { return running == 0; });
+        }
+        result.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        result.cpuSeconds = processCpuSeconds() - cpu - (mock.cpuSeconds() - mockCpu);
+        result.rssDeltaKb = residentKb() - rssBefore;
+        result.threads = workflows;
+        result.failures = failures.load();
+        loop.stop();
+        return result;
+    }
+
+    // every workflow is a coroutine on the calling thread, each with a connection of its own
+    RunResult runCoroutines(MockExchange &mock, size_t workflows, size_t orders)
+    {
+        RunResult result;
+        long rssBefore = residentKb();
+        asio::io_context io;
+        AsyncSessionOptions options;
+        options.maxConnections = workflows;
+        options.creditsPerSecond = 1e9;
+        options.burstCredits = 1e9;
+        options.baseUrl = baseUrl(mock);
+        AsyncSession session(io, "coro", Credentials(), options);
+        AsyncOrderManager manager(session);
+        uint64_t failures = 0;
+        long rssPeak = 0;
+
+        for (size_t i = 0; i < workflows; ++i)
+        {
+            asio::co_spawn(io, [&, i]() -> asio::awaitable<void>
+                           {
+                               for (size_t n = 0; n < orders; ++n)
+                               {
+                                   std::string reply = co_await manager.place("ETH-PERPETUAL", "buy", 1, 2000, "limit");
+                                   if (reply.empty())
+                                       ++failures;
+                                   if (i == 0 && n == orders / 2)
+                                       rssPeak = residentKb(); // every workflow is in flight by now
+                               } },
+                           asio::detached);
+        }
+
+        double mockCpu = mock.cpuSeconds();
+        double cpu = processCpuSeconds();
+        auto start = std::chrono::steady_clock::now();
+        io.run();
+        result.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        result.cpuSeconds = processCpuSeconds() - cpu - (mock.cpuSeconds() - mockCpu);
+        result.rssDeltaKb = std::max(rssPeak, residentKb()) - rssBefore;
+        result.threads = 1;
+        result.failures = failures;
+        session.close();
+        return result;
+    }
+
+    void print(const char *mode, size_t workflows, size_t orders, const RunResult &result)
+    {
+        double total = double(workflows) * orders;
+        std::printf("%-12s %8zu %8zu %12.0f %14.1f %10.1f %9llu\n", mode, workflows, result.threads, total / result.seconds,
+                    result.cpuSeconds * 1e6 / total, result.rssDeltaKb / 1024.0, static_cast<unsigned long long>(result.failures));
+        std::fflush(stdout);
+    }
+}
+
+int main(int argc, char **argv)
+{
+    std::chrono::microseconds delay(argc > 1 ? std::atol(argv[1]) : 2000);
+    size_t orders = argc > 2 ? std::strtoul(argv[2], nullptr, 10) : 20;
+    std::vector<size_t> concurrency;
+    for (int i = 3; i < argc; ++i)
+        concurrency.push_back(std::strtoul(argv[i], nullptr, 10));
+    if (concurrency.empty())
+        concurrency = {1, 10, 100, 1000};
+
+    MockExchange mock(delay);
+    std::printf("mock exchange replies after %lld us, %zu orders per workflow\n", static_cast<long long>(delay.count()), orders);
+    std::printf("%-12s %8s %8s %12s %14s %10s %9s\n", "mode", "inflight", "threads", "orders/s", "cpu us/order", "rss MB", "failures");
+    for (size_t workflows : concurrency)
+    {
+        print("threadpool", workflows, orders, runThreadPool(mock, workflows, orders));
+        print("coroutine", workflows, orders, runCoroutines(mock, workflows, orders));
+    }
+    return 0;
+}
@@ -0,0 +1,190 @@
+// Load test for the market data path, offline or live, through the same MarketDataSource interface
+// the server uses.
+// usage: md_fanout generate <path> <records> [symbols] [levels]
+//        md_fanout source <rest|stream|file:path> [seconds] [symbols...]
+//        md_fanout server <ws-url> <clients> <seconds> <symbols...>
+// generate writes synthetic get_order_book replies for the file source; source counts the books a
+// source produces on its own; server connects clients to a running deribit_md_server (start it with
+// --source file:<path> for an offline run) and reports what comes out of the fan-out.
+#include "clock.hpp"
+#include "feed_subscriber.hpp"
+#include "latency_histogram.hpp"
+#include "market_data_source.hpp"
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace
+{
+    // a random walk around a mid per symbol, so consecutive books of a symbol differ in a few levels
+    int generate(const std::string &path, size_t records, size_t symbols, size_t levels)
+    {
+        std::FILE *out = std::fopen(path.c_str(), "w");
+        if (!out)
+        {
+            std::cerr << "Cannot open " << path << "\n";
+            return 1;
+        }
+        std::mt19937_64 rng(42);
+        std::uniform_int_distribution<int> step(-2, 2);
+        std::uniform_int_distribution<int> size(1, 500);
+        std::vector<double> mids(symbols);
+        for (size_t s = 0; s < symbols; ++s)
+            mids[s] = 1000.0 + 250.0 * s;
+        int64_t timestamp = 1700000000000;
+        std::string line;
+        for (size_t r = 0; r < records; ++r)
+        {
+            size_t s = r % symbols;
+            mids[s] += 0.5 * step(rng);
+            timestamp += 1;
+            line = "{\"jsonrpc\":\"2.0\",\"result\":{\"timestamp\":";
+            line += std::to_string(timestamp);
+            line += ",\"instrument_name\":\"SYM" + std::to_string(s) + "-PERPETUAL\",\"bids\":[";
+            for (size_t l = 0; l < levels; ++l)
+            {
+                line += l ? ",[" : "[";
+                line += std::to_string(mids[s] - 0.5 * (l + 1)) + "," + std::to_string(size(rng)) + "]";
+            }
+            line += "],\"asks\":[";
+            for (size_t l = 0; l < levels; ++l)
+            {
+                line += l ? ",[" : "[";
+                line += std::to_string(mids[s] + 0.5 * (l + 1)) + "," + std::to_string(size(rng)) + "]";
+            }
+            line += "]}}\n";
+            std::fwrite(line.data(), 1, line.size(), out);
+        }
+        std::fclose(out);
+        std::cout << "wrote " << records << " books for " << symbols << " symbols to " << path << "\n";
+        return 0;
+    }
+
+    // pull sources are fetched in a loop, push sources counted as they deliver
+    int runSource(const std::string &spec, int seconds, const std::vector<std::string> &symbols)
+    {
+        std::unique_ptr<MarketDataSource> source = MarketDataSource::create(spec);
+        LatencyHistogram delivery; // source timestamp to handler
+        for (const std::string &symbol : symbols)
+            source->watch(symbol);
+        auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(seconds);
+        auto start = std::chrono::steady_clock::now();
+        if (source->pushes())
+        {
+            source->start([&delivery](const MarketDataSource::SnapshotPtr &snapshot)
+                          { delivery.record(UtilityNamespace::steadyNowNs() - snapshot->receivedNs); });
+            std::this_thread::sleep_until(deadline);
+            source->stop();
+        }
+        else
+        {
+            for (size_t i = 0; std::chrono::steady_clock::now() < deadline && !symbols.empty(); ++i)
+            {
+                int64_t startNs = UtilityNamespace::steadyNowNs();
+                if (source->fetch(symbols[i % symbols.size()]))
+                    delivery.record(UtilityNamespace::steadyNowNs() - startNs);
+            }
+        }
+        double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        std::cout << source->name() << ": " << source->snapshots() << " books in " << elapsed << "s, "
+                  << source->snapshots() / elapsed << " books/s\n";
+        delivery.print(std::cout, source->pushes() ? "delivery" : "fetch");
+        return 0;
+    }
+
+    // clients subscribe raw to every symbol; wire latency is send_ns to socket on the same host
+    int runServer(const std::string &url, size_t clients, int seconds, const std::vector<std::string> &symbols)
+    {
+        std::atomic<uint64_t> frames{0};
+        LatencyHistogram wire;
+        LatencyHistogram endToEnd; // source delivery (recv_ns) to the client
+        std::vector<std::unique_ptr<FeedSubscriber>> subscribers;
+        StreamOptions raw;
+        raw.interval = "raw";
+        for (size_t c = 0; c < clients; ++c)
+        {
+            FeedSubscriberOptions options;
+            options.endpoints = {url};
+            auto subscriber = std::make_unique<FeedSubscriber>(options);
+            for (const std::string &symbol : symbols)
+            {
+                subscriber->subscribe(symbol, [&](const BookEvent &event)
+                                      {
+                                          frames.fetch_add(1, std::memory_order_relaxed);
+                                          if (event.frame.sentNs)
+                                              wire.record(event.receivedNs - event.frame.sentNs);
+                                          if (event.frame.upstreamNs)
+                                              endToEnd.record(event.receivedNs - event.frame.upstreamNs); }, raw);
+            }
+            subscriber->start();
+            subscribers.push_back(std::move(subscriber));
+        }
+
+        std::this_thread::sleep_for(std::chrono::seconds(1)); // connect and take the snapshots
+        uint64_t startFrames = frames.load();
+        wire.reset();
+        endToEnd.reset();
+        auto start = std::chrono::steady_clock::now();
+        std::this_thread::sleep_for(std::chrono::seconds(seconds));
+        uint64_t received = frames.load() - startFrames;
+        double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+        uint64_t gaps = 0, reconnects = 0;
+        for (auto &subscriber : subscribers)
+        {
+            subscriber->stop();
+            gaps += subscriber->gaps();
+            reconnects += subscriber->reconnects();
+        }
+        std::cout << clients << " clients x " << symbols.size() << " symbols: " << received << " frames in " << elapsed
+                  << "s, " << received / elapsed << " frames/s, gaps " << gaps << ", reconnects " << reconnects << "\n";
+        wire.print(std::cout, "wire");
+        endToEnd.print(std::cout, "source to client");
+        return 0;
+    }
+
+    int usage(const char *name)
+    {
+        std::cerr << "usage: " << name << " generate <path> <records> [symbols] [levels]\n"
+                  << "       " << name << " source <rest|stream|file:path> [seconds] [symbols...]\n"
+                  << "       " << name << " server <ws-url> <clients> <seconds> <symbols...>\n";
+        return 1;
+    }
+}
+
+int main(int argc, char **argv)
+{
+    if (argc < 3)
+        return usage(argv[0]);
+    std::string mode = argv[1];
+    try
+    {
+        if (mode == "generate" && argc >= 4)
+        {
+            size_t symbols = argc > 4 ? std::strtoull(argv[4], nullptr, 10) : 8;
+            size_t levels = argc > 5 ? std::strtoull(argv[5], nullptr, 10) : 20;
+            return generate(argv[2], std::strtoull(argv[3], nullptr, 10), std::max<size_t>(symbols, 1), levels);
+        }
+        if (mode == "source")
+        {
+            int seconds = argc > 3 ? std::atoi(argv[3]) : 5;
+            return runSource(argv[2], seconds, std::vector<std::string>(argv + std::min(argc, 4), argv + argc));
+        }
+        if (mode == "server" && argc >= 6)
+            return runServer(argv[2], std::strtoull(argv[3], nullptr, 10), std::atoi(argv[4]), std::vector<std::string>(argv + 5, argv + argc));
+    }
+    catch (const std::exception &e)
+    {
+        std::cerr << e.what() << "\n";
+        return 1;
+    }
+    return usage(argv[0]);
+}
@@ -0,0 +1,120 @@
+// Tick-to-order latency through the whole MarketDataPipeline: a feed thread submits update frames
+// as the server writes them, the book thread decodes and applies them, the strategy answers every
+// fire-th book with an order and the order thread places it on a SimulatedVenue through OrderManager.
+// usage: md_pipeline [frames] [interval_ns] [fire] [bookCpu] [strategyCpu] [orderCpu]
+#include "clock.hpp"
+#include "md_pipeline.hpp"
+#include "order_manager.hpp"
+#include "simulated_venue.hpp"
+#include <algorithm>
+#include <cstdlib>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace
+{
+    void printPercentiles(const std::string &name, std::vector<int64_t> &samples)
+    {
+        if (samples.empty())
+        {
+            std::cout << name << ": no samples\n";
+            return;
+        }
+        // skip the first 10% as warm-up
+        samples.erase(samples.begin(), samples.begin() + samples.size() / 10);
+        std::sort(samples.begin(), samples.end());
+        auto percentile = [&](double p)
+        { return samples[std::min(samples.size() - 1, static_cast<size_t>(p * samples.size()))]; };
+        std::cout << name << ": p50=" << percentile(0.50) << "ns p99=" << percentile(0.99)
+                  << "ns p99.9=" << percentile(0.999) << "ns max=" << samples.back() << "ns\n";
+    }
+
+    std::string levelsJson(const std::vector<BookLevel> &levels)
+    {
+        std::string out = "[";
+        for (const BookLevel &level : levels)
+        {
+            if (out.size() > 1)
+                out += ',';
+            out += "[" + std::to_string(level.price) + "," + std::to_string(level.amount) + "]";
+        }
+        return out + "]";
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    size_t frames = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 200000;
+    int64_t intervalNs = argc > 2 ? std::atoll(argv[2]) : 20000;
+    size_t fire = argc > 3 ? std::strtoull(argv[3], nullptr, 10) : 10;
+    int bookCpu = argc > 4 ? std::atoi(argv[4]) : -1;
+    int strategyCpu = argc > 5 ? std::atoi(argv[5]) : -1;
+    int orderCpu = argc > 6 ? std::atoi(argv[6]) : -1;
+    if (frames == 0 || fire == 0)
+    {
+        std::cerr << "usage: md_pipeline [frames] [interval_ns] [fire] [bookCpu] [strategyCpu] [orderCpu]\n";
+        return 1;
+    }
+
+    SimulatedVenue venue;
+    OrderManager manager(venue);
+    std::vector<int64_t> bookNs, orderNs;
+    bookNs.reserve(frames);
+    orderNs.reserve(frames / fire + 1);
+
+    // alternating buys and sells at the mid cross each other, so the venue's book stays small
+    size_t books = 0;
+    bool buy = true;
+    MarketDataPipeline pipeline(manager, [&](const BookUpdate &book, OrderIntent &intent)
+                                {
+                                    bookNs.push_back(book.builtNs - book.receivedNs);
+                                    if (++books % fire != 0 || book.bids.empty() || book.asks.empty())
+                                        return false;
+                                    intent.symbol = book.symbol;
+                                    intent.side = buy ? "buy" : "sell";
+                                    intent.orderType = "limit";
+                                    intent.amount = 1.0;
+                                    intent.price = (book.bids.front().price + book.asks.front().price) / 2;
+                                    buy = !buy;
+                                    return true; });
+    pipeline.setOrderCallback([&](const OrderIntent &, const std::string &, int64_t tickToOrderNs)
+                              { orderNs.push_back(tickToOrderNs); });
+    pipeline.start(bookCpu, strategyCpu, orderCpu);
+
+    // a 20 level snapshot, then one changed level per side per update around a bounded random walk mid
+    std::mt19937_64 rng(42);
+    std::uniform_int_distribution<int> step(-1, 1), level(0, 19), size(1, 50);
+    double mid = 64000.0;
+    std::vector<BookLevel> bids, asks;
+    for (int l = 0; l < 20; ++l)
+    {
+        bids.push_back({mid - 0.5 * (l + 1), double(size(rng))});
+        asks.push_back({mid + 0.5 * (l + 1), double(size(rng))});
+    }
+    pipeline.submit("{\"type\":\"snapshot\",\"symbol\":\"BTC-PERPETUAL\",\"seq\":0,\"bids\":" + levelsJson(bids) + ",\"asks\":" + levelsJson(asks) + "}");
+
+    int64_t next = UtilityNamespace::steadyNowNs();
+    for (size_t seq = 1; seq <= frames; ++seq)
+    {
+        mid = std::clamp(mid + 0.5 * step(rng), 63990.0, 64010.0);
+        int l = level(rng);
+        std::vector<BookLevel> bid{{mid - 0.5 * (l + 1), double(size(rng))}};
+        std::vector<BookLevel> ask{{mid + 0.5 * (l + 1), double(size(rng))}};
+        std::string frame = "{\"type\":\"update\",\"symbol\":\"BTC-PERPETUAL\",\"seq\":" + std::to_string(seq) +
+                            ",\"bids\":" + levelsJson(bid) + ",\"asks\":" + levelsJson(ask) + "}";
+        next += intervalNs;
+        while (UtilityNamespace::steadyNowNs() < next)
+        {
+        }
+        pipeline.submit(std::move(frame));
+    }
+    pipeline.stop();
+
+    std::cout << "frames: " << frames << ", every " << intervalNs << " ns, an order every " << fire << " books\n";
+    std::cout << "dropped: " << pipeline.droppedMessages() << ", orders: " << venue.orders() << ", trades: " << venue.trades() << "\n";
+    printPercentiles("frame -> book built ", bookNs);
+    printPercentiles("frame -> order acked", orderNs);
+    return 0;
+}
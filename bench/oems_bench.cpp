@@ -0,0 +1,212 @@
+// Offline benchmark scenarios, also used as the PGO training run.
+#include "arena.hpp"
+#include "http_transport.hpp"
+#include "instrument.hpp"
+#include "jsonrpc.hpp"
+#include "ring_buffer.hpp"
+#include "utils.hpp"
+#include <benchmark/benchmark.h>
+#include <arpa/inet.h>
+#include <cstdlib>
+#include <netinet/in.h>
+#include <string>
+#include <sys/socket.h>
+#include <thread>
+#include <unistd.h>
+
+namespace
+{
+    // a get_order_book reply shaped like Deribit's, 20 levels per side
+    std::string sampleOrderbook()
+    {
+        std::string bids, asks;
+        for (int i = 0; i < 20; ++i)
+        {
+            bids += (i ? "," : "") + std::string("[") + std::to_string(64000.5 - i * 0.5) + "," + std::to_string(1000 + i * 10) + "]";
+            asks += (i ? "," : "") + std::string("[") + std::to_string(64001.0 + i * 0.5) + "," + std::to_string(900 + i * 10) + "]";
+        }
+        return "{\"jsonrpc\":\"2.0\",\"result\":{\"timestamp\":1733900000000,\"instrument_name\":\"BTC-PERPETUAL\","
+               "\"best_bid_price\":64000.5,\"best_ask_price\":64001.0,\"bids\":[" +
+               bids + "],\"asks\":[" + asks + "]},\"usIn\":1,\"usOut\":2,\"usDiff\":1,\"testnet\":true}";
+    }
+
+    // keep-alive HTTP/1.1 mock on loopback answering every request with an order reply
+    class LoopbackExchange
+    {
+    public:
+        LoopbackExchange()
+        {
+            listenFd = socket(AF_INET, SOCK_STREAM, 0);
+            sockaddr_in addr{};
+            addr.sin_family = AF_INET;
+            addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+            bind(listenFd, reinterpret_cast<sockaddr *>(&addr), sizeof(addr));
+            listen(listenFd, 4);
+            socklen_t len = sizeof(addr);
+            getsockname(listenFd, reinterpret_cast<sockaddr *>(&addr), &len);
+            url = "http://127.0.0.1:" + std::to_string(ntohs(addr.sin_port)) + "/api/v2/private/buy";
+            worker = std::thread([this]()
+                                 { serve(); });
+        }
+        ~LoopbackExchange()
+        {
+            shutdown(listenFd, SHUT_RDWR);
+            close(listenFd);
+            worker.join();
+        }
+
+        std::string url;
+
+    private:
+        void serve()
+        {
+            const std::string body = "{\"jsonrpc\":\"2.0\",\"id\":2,\"result\":{\"order\":{\"order_id\":\"BTC-1\",\"order_state\":\"open\"},\"trades\":[]}}";
+            const std::string reply = "HTTP/1.1 200 OK\r\nContent-Type: application/json\r\nContent-Length: " + std::to_string(body.size()) + "\r\n\r\n" + body;
+            int fd;
+            while ((fd = accept(listenFd, nullptr, nullptr)) >= 0)
+            {
+                std::string buffer;
+                char chunk[4096];
+                while (true)
+                {
+                    size_t headerEnd = buffer.find("\r\n\r\n");
+                    size_t length = headerEnd == std::string::npos ? 0 : headerEnd + 4;
+                    size_t pos = buffer.find("Content-Length:");
+                    if (headerEnd != std::string::npos && pos != std::string::npos && pos < headerEnd)
+                        length += std::strtoul(buffer.c_str() + pos + 15, nullptr, 10);
+                    if (headerEnd != std::string::npos && buffer.size() >= length)
+                    {
+                        buffer.erase(0, length);
+                        if (send(fd, reply.data(), reply.size(), MSG_NOSIGNAL) < 0)
+                            break;
+                        continue;
+                    }
+                    long received = recv(fd, chunk, sizeof(chunk), 0);
+                    if (received <= 0)
+                        break;
+                    buffer.append(chunk, received);
+                }
+                close(fd);
+            }
+        }
+
+        int listenFd;
+        std::thread worker;
+    };
+}
+
+static void BM_EncodePlaceOrder(benchmark::State &state)
+{
+    for (auto _ : state)
+    {
+        ArenaScope scope;
+        std::pmr::string payload(&scope.resource());
+        UtilityNamespace::encodePlaceOrder(payload, "buy", "BTC-PERPETUAL", 10.0, 64000.5, "limit");
+        benchmark::DoNotOptimize(payload.data());
+    }
+}
+BENCHMARK(BM_EncodePlaceOrder);
+
+static void BM_EncodePlaceOrderFixed(benchmark::State &state)
+{
+    InstrumentSpec instrument;
+    UtilityNamespace::makeInstrumentSpec("BTC-PERPETUAL", "0.5", "10", {}, instrument);
+    for (auto _ : state)
+    {
+        ArenaScope scope;
+        std::pmr::string payload(&scope.resource());
+        UtilityNamespace::encodePlaceOrder(payload, "buy", instrument, Quantity(10), Price(640005), "limit");
+        benchmark::DoNotOptimize(payload.data());
+    }
+}
+BENCHMARK(BM_EncodePlaceOrderFixed);
+
+static void BM_EncodePlaceOrderNlohmann(benchmark::State &state)
+{
+    for (auto _ : state)
+    {
+        nlohmann::json payload = {
+            {"jsonrpc", "2.0"},
+            {"id", 2},
+            {"method", "private/buy"},
+            {"params", {{"instrument_name", "BTC-PERPETUAL"}, {"amount", 10.0}, {"type", "limit"}, {"price", 64000.5}}}};
+        std::string dumped = payload.dump();
+        benchmark::DoNotOptimize(dumped.data());
+    }
+}
+BENCHMARK(BM_EncodePlaceOrderNlohmann);
+
+static void BM_ParseOrderbookSimdjson(benchmark::State &state)
+{
+    std::string response = sampleOrderbook();
+    simdjson::padded_string padded(response);
+    simdjson::ondemand::parser parser;
+    for (auto _ : state)
+    {
+        simdjson::ondemand::document doc = parser.iterate(padded);
+        double bestBid = doc["result"]["best_bid_price"].get_double();
+        benchmark::DoNotOptimize(bestBid);
+    }
+    state.SetBytesProcessed(state.iterations() * response.size());
+}
+BENCHMARK(BM_ParseOrderbookSimdjson);
+
+static void BM_BeautifyJSON(benchmark::State &state)
+{
+    std::string response = sampleOrderbook();
+    for (auto _ : state)
+    {
+        std::string pretty = UtilityNamespace::beautifyJSON(response);
+        benchmark::DoNotOptimize(pretty.data());
+    }
+    state.SetBytesProcessed(state.iterations() * response.size());
+}
+BENCHMARK(BM_BeautifyJSON);
+
+static void BM_SpscPushPop(benchmark::State &state)
+{
+    SpscRingBuffer<int64_t> queue(1024);
+    int64_t value = 0;
+    for (auto _ : state)
+    {
+        queue.tryPush(value);
+        queue.tryPop(value);
+        benchmark::DoNotOptimize(value);
+    }
+}
+BENCHMARK(BM_SpscPushPop);
+
+static void BM_MpscPushPop(benchmark::State &state)
+{
+    MpscRingBuffer<int64_t> queue(1024);
+    int64_t value = 0;
+    for (auto _ : state)
+    {
+        queue.tryPush(value);
+        queue.tryPop(value);
+        benchmark::DoNotOptimize(value);
+    }
+}
+BENCHMARK(BM_MpscPushPop);
+
+// order request and reply over a keep-alive loopback connection, the transport's share of an order
+static void BM_HttpRoundTrip(benchmark::State &state)
+{
+    LoopbackExchange exchange;
+    HttpTransport transport;
+    std::string payload = "{\"jsonrpc\":\"2.0\",\"id\":2,\"method\":\"private/buy\",\"params\":{\"instrument_name\":\"BTC-PERPETUAL\",\"amount\":10,\"type\":\"limit\",\"price\":64000.5}}";
+    for (auto _ : state)
+    {
+        ArenaScope scope;
+        std::pmr::string response(&scope.resource());
+        if (!transport.post(exchange.url.c_str(), payload, "Authorization: Bearer bench", response))
+        {
+            state.SkipWithError("loopback request failed");
+            break;
+        }
+        benchmark::DoNotOptimize(response.data());
+    }
+}
+BENCHMARK(BM_HttpRoundTrip)->UseRealTime()->Unit(benchmark::kMicrosecond);
+
+BENCHMARK_MAIN();
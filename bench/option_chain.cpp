@@ -0,0 +1,209 @@
+// Implied volatility and Greeks of a whole synthetic option chain: a scalar per-option Newton solve
+// with std::erfc (one option at a time, the way each option used to be priced after its own REST
+// reply) against the SIMD kernel on one thread and ChainCalculator on every thread.
+// usage: option_chain [expiries] [strikesPerExpiry] [threads] [rounds]
+// Quotes come from a smile of known volatilities, so the solved ones are checked against it.
+#include "clock.hpp"
+#include "option_chain.hpp"
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <limits>
+#include <string>
+#include <vector>
+
+namespace
+{
+    constexpr double SPOT = 2500.0;
+    constexpr double MS_PER_DAY = 86400.0 * 1000.0;
+    constexpr double MS_PER_YEAR = 365.0 * MS_PER_DAY;
+    constexpr int64_t NOW_MS = 1750000000000; // June 2025
+    const char *const MONTHS[] = {"JAN", "FEB", "MAR", "APR", "MAY", "JUN", "JUL", "AUG", "SEP", "OCT", "NOV", "DEC"};
+
+    double normCdf(double z)
+    {
+        return 0.5 * std::erfc(-z / std::sqrt(2.0));
+    }
+
+    double blackPrice(double forward, double strike, double sigma, double years, double cp)
+    {
+        double sd = sigma * std::sqrt(years);
+        double d1 = std::log(forward / strike) / sd + 0.5 * sd;
+        return cp * (forward * normCdf(cp * d1) - strike * normCdf(cp * (d1 - sd)));
+    }
+
+    // 60% at the money, higher in the wings and at the front
+    double smile(double strike, double years)
+    {
+        double m = std::log(strike / SPOT);
+        return 0.6 + 0.05 / std::sqrt(years * 12.0) + 0.8 * m * m - 0.1 * m;
+    }
+
+    std::string optionName(int64_t expiryMs, double strike, bool call)
+    {
+        int64_t days = expiryMs / static_cast<int64_t>(MS_PER_DAY);
+        // civil date from days since the epoch (Hinnant)
+        days += 719468;
+        int64_t era = (days >= 0 ? days : days - 146096) / 146097;
+        unsigned dayOfEra = static_cast<unsigned>(days - era * 146097);
+        unsigned yearOfEra = (dayOfEra - dayOfEra / 1460 + dayOfEra / 36524 - dayOfEra / 146096) / 365;
+        unsigned dayOfYear = dayOfEra - (365 * yearOfEra + yearOfEra / 4 - yearOfEra / 100);
+        unsigned mp = (5 * dayOfYear + 2) / 153;
+        unsigned day = dayOfYear - (153 * mp + 2) / 5 + 1;
+        unsigned month = mp < 10 ? mp + 3 : mp - 9;
+        int year = static_cast<int>(yearOfEra + era * 400) + (month <= 2);
+        char name[64];
+        std::snprintf(name, sizeof(name), "ETH-%u%s%02d-%.0f-%c", day, MONTHS[month - 1], year % 100, strike, call ? 'C' : 'P');
+        return name;
+    }
+
+    // weekly expiries at 08:00 UTC, strikes spread around the spot; quotes a tenth of a percent
+    // either side of the smile's price, in ETH like the exchange
+    OptionChain buildChain(size_t expiries, size_t strikes)
+    {
+        OptionChain chain;
+        int64_t firstDay = NOW_MS / static_cast<int64_t>(MS_PER_DAY) + 1;
+        for (size_t e = 0; e < expiries; ++e)
+        {
+            int64_t expiryMs = (firstDay + 7 * static_cast<int64_t>(e)) * static_cast<int64_t>(MS_PER_DAY) + 8 * 3600 * 1000;
+            double years = (expiryMs - NOW_MS) / MS_PER_YEAR;
+            for (size_t s = 0; s < strikes; ++s)
+            {
+                double strike = std::round(SPOT * std::exp((static_cast<double>(s) / (strikes - 1) - 0.5) * (0.4 + years)) / 25.0) * 25.0;
+                for (bool call : {true, false})
+                {
+                    OptionContract contract;
+                    std::string name = optionName(expiryMs, strike, call);
+                    if (!UtilityNamespace::parseOptionName(name, contract))
+                        continue;
+                    chain.add(contract);
+                    double price = blackPrice(SPOT, strike, smile(strike, years), years, call ? 1.0 : -1.0) / SPOT;
+                    chain.setQuote(name, price * 0.999, price * 1.001);
+                }
+            }
+        }
+        chain.sort();
+        return chain;
+    }
+
+    // plain Newton per option with a bisection fallback, then the Greeks; rate 0 like the kernel run
+    void scalarGreeks(OptionChain &chain, double spot, int64_t nowMs)
+    {
+        const double nan = std::numeric_limits<double>::quiet_NaN();
+        for (size_t row = 0; row < chain.size(); ++row)
+        {
+            double years = (chain.expiryMs[row] - nowMs) / MS_PER_YEAR;
+            double cp = chain.callPut[row], strike = chain.strikes[row];
+            double target = 0.5 * (chain.bids[row] + chain.asks[row]) * spot;
+            double intrinsic = std::max(cp * (spot - strike), 0.0);
+            chain.iv[row] = chain.delta[row] = chain.gamma[row] = chain.vega[row] = chain.theta[row] = nan;
+            if (chain.bids[row] <= 0.0 || years <= 0.0 || target <= intrinsic || target >= (cp > 0 ? spot : strike))
+                continue;
+            double sigma = 0.5, low = 1e-4, high = 10.0;
+            for (int iteration = 0; iteration < 100; ++iteration)
+            {
+                double diff = blackPrice(spot, strike, sigma, years, cp) - target;
+                double sd = sigma * std::sqrt(years);
+                double d1 = std::log(spot / strike) / sd + 0.5 * sd;
+                double vega = spot * std::exp(-0.5 * d1 * d1) / std::sqrt(2.0 * M_PI) * std::sqrt(years);
+                (diff > 0 ? high : low) = sigma;
+                double next = sigma - diff / vega;
+                if (!(next > low && next < high))
+                    next = 0.5 * (low + high);
+                bool converged = std::fabs(next - sigma) < 1e-9;
+                sigma = next;
+                if (converged)
+                    break;
+            }
+            double sqrtT = std::sqrt(years), sd = sigma * sqrtT;
+            double d1 = std::log(spot / strike) / sd + 0.5 * sd;
+            double pdf = std::exp(-0.5 * d1 * d1) / std::sqrt(2.0 * M_PI);
+            chain.iv[row] = sigma;
+            chain.delta[row] = cp * normCdf(cp * d1);
+            chain.gamma[row] = pdf / (spot * sd);
+            chain.vega[row] = spot * pdf * sqrtT * 0.01;
+            chain.theta[row] = -spot * pdf * sigma / (2.0 * sqrtT) / 365.0;
+        }
+    }
+
+    // worst absolute difference of iv from the smile it was quoted at, over the solved rows
+    double smileError(const OptionChain &chain, size_t &solved)
+    {
+        double worst = 0.0;
+        solved = 0;
+        for (size_t row = 0; row < chain.size(); ++row)
+        {
+            if (std::isnan(chain.iv[row]))
+                continue;
+            ++solved;
+            double years = (chain.expiryMs[row] - NOW_MS) / MS_PER_YEAR;
+            // the mid is the smile's price exactly, the quotes being symmetric around it
+            worst = std::max(worst, std::fabs(chain.iv[row] - smile(chain.strikes[row], years)));
+        }
+        return worst;
+    }
+
+    double maxDifference(const OptionChain::Column &a, const OptionChain::Column &b)
+    {
+        double worst = 0.0;
+        for (size_t i = 0; i < a.size(); ++i)
+        {
+            if (std::isnan(a[i]) != std::isnan(b[i]))
+                return std::numeric_limits<double>::infinity();
+            if (!std::isnan(a[i]))
+                worst = std::max(worst, std::fabs(a[i] - b[i]));
+        }
+        return worst;
+    }
+
+    template <class Compute>
+    double timePerChain(size_t rounds, Compute compute)
+    {
+        compute(); // first touch and worker start-up out of the measurement
+        int64_t startNs = UtilityNamespace::steadyNowNs();
+        for (size_t i = 0; i < rounds; ++i)
+            compute();
+        return static_cast<double>(UtilityNamespace::steadyNowNs() - startNs) / rounds;
+    }
+}
+
+int main(int argc, char **argv)
+{
+    size_t expiries = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 10;
+    size_t strikes = argc > 2 ? std::strtoul(argv[2], nullptr, 10) : 50;
+    size_t threads = argc > 3 ? std::strtoul(argv[3], nullptr, 10) : 0;
+    size_t rounds = argc > 4 ? std::strtoul(argv[4], nullptr, 10) : 200;
+    if (expiries == 0 || strikes < 2 || rounds == 0)
+    {
+        std::fprintf(stderr, "Usage: %s [expiries] [strikesPerExpiry >= 2] [threads] [rounds]\n", argv[0]);
+        return 1;
+    }
+
+    OptionChain scalar = buildChain(expiries, strikes);
+    OptionChain simd = scalar, parallel = scalar;
+    ChainCalculator calculator(threads);
+    double scalarNs = timePerChain(rounds, [&]()
+                                   { scalarGreeks(scalar, SPOT, NOW_MS); });
+    double simdNs = timePerChain(rounds, [&]()
+                                 { UtilityNamespace::computeOptionGreeks(simd, 0, simd.size(), SPOT, NOW_MS); });
+    double parallelNs = timePerChain(rounds, [&]()
+                                     { calculator.compute(parallel, SPOT, NOW_MS); });
+
+    size_t solved = 0;
+    double error = smileError(simd, solved);
+    std::printf("%zu options (%zu expiries x %zu strikes x call/put), %zu solved, %zu rounds\n", simd.size(), expiries, strikes, solved, rounds);
+    std::printf("%-28s %12s %12s %9s\n", "", "us/chain", "ns/option", "speedup");
+    auto report = [&](const char *name, double ns)
+    {
+        std::printf("%-28s %12.1f %12.1f %8.1fx\n", name, ns / 1e3, ns / simd.size(), scalarNs / ns);
+    };
+    report("scalar Newton, erfc", scalarNs);
+    report("SIMD kernel, 1 thread", simdNs);
+    std::string threaded = "ChainCalculator, " + std::to_string(calculator.threads()) + " thread(s)";
+    report(threaded.c_str(), parallelNs);
+    std::printf("max |iv - smile| %.2e, SIMD vs scalar: iv %.2e delta %.2e vega %.2e theta %.2e, threads vs 1: iv %.2e\n",
+                error, maxDifference(simd.iv, scalar.iv), maxDifference(simd.delta, scalar.delta),
+                maxDifference(simd.vega, scalar.vega), maxDifference(simd.theta, scalar.theta), maxDifference(parallel.iv, simd.iv));
+    return 0;
+}
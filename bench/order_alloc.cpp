@@ -0,0 +1,149 @@
+// Steady-state heap allocations per order, first on the request encoding path alone and then through
+// OrderManager::placeOrder, the Session and its HttpTransport against a loopback exchange.
+// Built with OEMS_COUNT_ALLOCATIONS so every operator new is counted; only the ordering thread's are.
+#include "arena.hpp"
+#include "jsonrpc.hpp"
+#include "order_manager.hpp"
+#include "session.hpp"
+#include <arpa/inet.h>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <netinet/in.h>
+#include <string>
+#include <sys/socket.h>
+#include <thread>
+#include <unistd.h>
+
+namespace
+{
+    const int WARMUP = 1000;
+
+    // keep-alive HTTP/1.1 mock on loopback answering every request with an order reply
+    class LoopbackExchange
+    {
+    public:
+        LoopbackExchange()
+        {
+            listenFd = socket(AF_INET, SOCK_STREAM, 0);
+            sockaddr_in addr{};
+            addr.sin_family = AF_INET;
+            addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+            bind(listenFd, reinterpret_cast<sockaddr *>(&addr), sizeof(addr));
+            listen(listenFd, 4);
+            socklen_t len = sizeof(addr);
+            getsockname(listenFd, reinterpret_cast<sockaddr *>(&addr), &len);
+            baseUrl = "http://127.0.0.1:" + std::to_string(ntohs(addr.sin_port)) + "/api/v2/";
+            worker = std::thread([this]()
+                                 { serve(); });
+        }
+        ~LoopbackExchange()
+        {
+            shutdown(listenFd, SHUT_RDWR);
+            close(listenFd);
+            worker.join();
+        }
+
+        std::string baseUrl;
+
+    private:
+        void serve()
+        {
+            const std::string body = "{\"jsonrpc\":\"2.0\",\"id\":2,\"result\":{\"order\":{\"order_id\":\"BTC-1\",\"order_state\":\"open\"},\"trades\":[]}}";
+            const std::string reply = "HTTP/1.1 200 OK\r\nContent-Type: application/json\r\nContent-Length: " + std::to_string(body.size()) + "\r\n\r\n" + body;
+            int fd;
+            while ((fd = accept(listenFd, nullptr, nullptr)) >= 0)
+            {
+                std::string buffer;
+                char chunk[4096];
+                while (true)
+                {
+                    size_t headerEnd = buffer.find("\r\n\r\n");
+                    size_t length = headerEnd == std::string::npos ? 0 : headerEnd + 4;
+                    size_t pos = buffer.find("Content-Length:");
+                    if (headerEnd != std::string::npos && pos != std::string::npos && pos < headerEnd)
+                        length += std::strtoul(buffer.c_str() + pos + 15, nullptr, 10);
+                    if (headerEnd != std::string::npos && buffer.size() >= length)
+                    {
+                        buffer.erase(0, length);
+                        if (send(fd, reply.data(), reply.size(), MSG_NOSIGNAL) < 0)
+                            break;
+                        continue;
+                    }
+                    long received = recv(fd, chunk, sizeof(chunk), 0);
+                    if (received <= 0)
+                        break;
+                    buffer.append(chunk, received);
+                }
+                close(fd);
+            }
+        }
+
+        int listenFd;
+        std::thread worker;
+    };
+
+    // allocations per order after the warm-up, or -1 when an order failed
+    template <class Order>
+    double allocationsPerOrder(const char *name, int orders, Order order)
+    {
+        uint64_t before = 0;
+        auto start = std::chrono::steady_clock::now();
+        for (int i = 0; i < WARMUP + orders; ++i)
+        {
+            if (i == WARMUP)
+            {
+                before = UtilityNamespace::threadHeapAllocations();
+                start = std::chrono::steady_clock::now();
+            }
+            if (!order(i))
+            {
+                std::cerr << name << ": order " << i << " failed\n";
+                return -1.0;
+            }
+        }
+        auto elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+        double perOrder = static_cast<double>(UtilityNamespace::threadHeapAllocations() - before) / orders;
+        std::cout << name << ": " << orders << " orders, heap allocations per order: " << perOrder
+                  << ", time per order: " << elapsed / orders << " ns\n";
+        return perOrder;
+    }
+}
+
+int main()
+{
+    std::string symbol = "BTC-PERPETUAL", side = "buy", orderType = "limit", accessToken(600, 'x');
+
+    double encoded = allocationsPerOrder("encode", 1000000, [&](int i)
+                                         {
+                                             ArenaScope scope;
+                                             std::pmr::string url("https://test.deribit.com/api/v2/private/", &scope.resource());
+                                             url += side;
+                                             std::pmr::string payload(&scope.resource());
+                                             UtilityNamespace::encodePlaceOrder(payload, side, symbol, 10.0 + i % 7, 350.5 + i % 13, orderType);
+                                             std::pmr::string authHeader("Authorization: Bearer ", &scope.resource());
+                                             authHeader += accessToken;
+                                             return true; });
+
+    LoopbackExchange exchange;
+    SessionLoop loop;
+    SessionOptions options;
+    options.poolSize = 1;
+    options.creditsPerSecond = 1e9; // the limiter's bookkeeping without its waits
+    options.burstCredits = 1e9;
+    options.baseUrl = exchange.baseUrl;
+    double placed = 0.0;
+    {
+        Session session(loop, "order_alloc", Credentials(), options);
+        OrderManager manager(session);
+        placed = allocationsPerOrder("placeOrder", 20000, [&](int i)
+                                     {
+                                         ArenaScope scope;
+                                         std::pmr::string response(&scope.resource());
+                                         return manager.placeOrder(symbol, side, 10.0 + i % 7, 350.5 + i % 13, orderType, response); });
+        loop.stop();
+    }
+
+    std::cout << "arena upstream allocations: " << threadArena().upstreamAllocations() << "\n";
+    return encoded == 0.0 && placed == 0.0 ? 0 : 1;
+}
@@ -0,0 +1,241 @@
+// Heap against placed memory (huge pages, pre-faulted, on this thread's node) for a large random
+// access working set and for a book under level updates.
+// usage: page_placement [workingSetMiB] [accesses] [levels]
+// First touch reports the page faults taken and the latency spread of touching each 4 KiB page, the
+// jitter a hot path sees when it is the first to use memory. Steady state reports dTLB load misses
+// per 1000 accesses and ns per access. Counters come from perf_event_open (user space only, so
+// perf_event_paranoid 2 is enough) and print n/a where the kernel or the VM does not provide them.
+#include "clock.hpp"
+#include "local_book.hpp"
+#include "memory_placement.hpp"
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <linux/perf_event.h>
+#include <memory>
+#include <memory_resource>
+#include <string>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <vector>
+
+namespace
+{
+    class PerfCounter
+    {
+    public:
+        PerfCounter(uint32_t type, uint64_t config)
+        {
+            perf_event_attr attr;
+            std::memset(&attr, 0, sizeof(attr));
+            attr.size = sizeof(attr);
+            attr.type = type;
+            attr.config = config;
+            attr.disabled = 1;
+            attr.exclude_kernel = 1;
+            attr.exclude_hv = 1;
+            fd = static_cast<int>(syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0));
+        }
+        ~PerfCounter()
+        {
+            if (fd >= 0)
+                close(fd);
+        }
+        PerfCounter(const PerfCounter &) = delete;
+        PerfCounter &operator=(const PerfCounter &) = delete;
+
+        bool available() const { return fd >= 0; }
+        void start()
+        {
+            if (fd < 0)
+                return;
+            ioctl(fd, PERF_EVENT_IOC_RESET, 0);
+            ioctl(fd, PERF_EVENT_IOC_ENABLE, 0);
+        }
+        // -1 when unavailable
+        int64_t stop()
+        {
+            if (fd < 0)
+                return -1;
+            ioctl(fd, PERF_EVENT_IOC_DISABLE, 0);
+            uint64_t value = 0;
+            if (read(fd, &value, sizeof(value)) != sizeof(value))
+                return -1;
+            return static_cast<int64_t>(value);
+        }
+
+    private:
+        int fd = -1;
+    };
+
+    PerfCounter pageFaults()
+    {
+        return PerfCounter(PERF_TYPE_SOFTWARE, PERF_COUNT_SW_PAGE_FAULTS);
+    }
+    PerfCounter tlbMisses()
+    {
+        return PerfCounter(PERF_TYPE_HW_CACHE, PERF_COUNT_HW_CACHE_DTLB | (PERF_COUNT_HW_CACHE_OP_READ << 8) |
+                                                   (PERF_COUNT_HW_CACHE_RESULT_MISS << 16));
+    }
+
+    std::string counted(int64_t value)
+    {
+        return value < 0 ? "n/a" : std::to_string(value);
+    }
+    std::string perThousand(int64_t misses, size_t accesses)
+    {
+        if (misses < 0)
+            return "n/a";
+        std::string text = std::to_string(misses * 1000.0 / accesses);
+        return text.substr(0, text.find('.') + 3);
+    }
+
+    const char *describe(const PlacedBuffer &buffer)
+    {
+        switch (buffer.pageKind())
+        {
+        case PageKind::Heap:
+            return "heap";
+        case PageKind::Normal:
+            return "4k pages";
+        case PageKind::TransparentHuge:
+            return "transparent huge pages";
+        case PageKind::Huge:
+            return "hugetlb pages";
+        }
+        return "";
+    }
+
+    void printSpread(std::vector<int64_t> &samples)
+    {
+        std::sort(samples.begin(), samples.end());
+        auto percentile = [&](double p)
+        { return samples[std::min(samples.size() - 1, static_cast<size_t>(p * samples.size()))]; };
+        std::cout << " p50=" << percentile(0.50) << "ns p99=" << percentile(0.99) << "ns p99.9=" << percentile(0.999)
+                  << "ns max=" << samples.back() << "ns";
+    }
+
+    uint64_t nextRandom(uint64_t &state)
+    {
+        state ^= state << 13;
+        state ^= state >> 7;
+        state ^= state << 17;
+        return state;
+    }
+
+    void runWorkingSet(const std::string &name, const MemoryPlacement &placement, size_t bytes, size_t accesses)
+    {
+        PerfCounter faults = pageFaults();
+        faults.start();
+        int64_t allocateStart = UtilityNamespace::steadyNowNs();
+        PlacedBuffer buffer(bytes, placement);
+        int64_t allocateNs = UtilityNamespace::steadyNowNs() - allocateStart;
+        int64_t allocateFaults = faults.stop();
+
+        // first touch, one write per page in address order, the way a queue or arena fills up
+        std::vector<int64_t> touches(bytes / 4096);
+        volatile std::byte *memory = buffer.data();
+        faults.start();
+        for (size_t page = 0; page < touches.size(); ++page)
+        {
+            int64_t start = UtilityNamespace::steadyNowNs();
+            memory[page * 4096] = std::byte{1};
+            touches[page] = UtilityNamespace::steadyNowNs() - start;
+        }
+        int64_t touchFaults = faults.stop();
+
+        // steady state, random 8-byte reads across the whole set
+        const uint64_t *words = reinterpret_cast<const uint64_t *>(buffer.data());
+        size_t wordMask = 1;
+        while (wordMask * 2 <= bytes / sizeof(uint64_t))
+            wordMask *= 2;
+        --wordMask;
+        uint64_t state = 88172645463325252ull, sum = 0;
+        PerfCounter misses = tlbMisses();
+        misses.start();
+        int64_t start = UtilityNamespace::steadyNowNs();
+        for (size_t i = 0; i < accesses; ++i)
+            sum += words[nextRandom(state) & wordMask];
+        int64_t elapsed = UtilityNamespace::steadyNowNs() - start;
+        int64_t tlb = misses.stop();
+
+        std::cout << name << " (" << describe(buffer) << ", node " << buffer.node() << ")\n";
+        std::cout << "  allocate: " << allocateNs / 1000 << "us, " << counted(allocateFaults) << " faults\n";
+        std::cout << "  first touch: " << counted(touchFaults) << " faults,";
+        printSpread(touches);
+        std::cout << "\n  steady: " << std::fixed << std::setprecision(2) << static_cast<double>(elapsed) / accesses
+                  << " ns/access, " << perThousand(tlb, accesses) << " dTLB misses/1k (checksum " << (sum & 0xff) << ")\n";
+        std::cout.unsetf(std::ios::fixed);
+    }
+
+    // a full book of levels, then updates at random prices: inserts, amount changes and removals
+    void runBook(const std::string &name, std::pmr::memory_resource *resource, size_t levels, size_t updates)
+    {
+        LocalOrderBook book(resource);
+        uint64_t state = 2463534242ull;
+        PerfCounter faults = pageFaults();
+        faults.start();
+        int64_t start = UtilityNamespace::steadyNowNs();
+        for (size_t i = 0; i < levels; ++i)
+        {
+            book.apply(true, 50000.0 - 0.5 * i, 1.0 + i % 7);
+            book.apply(false, 50000.5 + 0.5 * i, 1.0 + i % 5);
+        }
+        int64_t fillNs = UtilityNamespace::steadyNowNs() - start;
+        int64_t fillFaults = faults.stop();
+
+        std::vector<int64_t> samples(updates); // touched now so its own faults stay out of the count
+        PerfCounter misses = tlbMisses();
+        faults.start();
+        misses.start();
+        for (size_t i = 0; i < updates; ++i)
+        {
+            uint64_t random = nextRandom(state);
+            bool bid = random & 1;
+            double offset = 0.5 * ((random >> 1) % (levels + levels / 4));
+            double amount = (random >> 40) % 4 == 0 ? 0.0 : 1.0 + (random >> 44) % 9;
+            int64_t before = UtilityNamespace::steadyNowNs();
+            book.apply(bid, bid ? 50000.0 - offset : 50000.5 + offset, amount);
+            samples[i] = UtilityNamespace::steadyNowNs() - before;
+        }
+        int64_t tlb = misses.stop();
+        int64_t updateFaults = faults.stop();
+
+        std::cout << name << "\n  fill " << 2 * levels << " levels: " << fillNs / 1000 << "us, " << counted(fillFaults) << " faults\n";
+        std::cout << "  updates: " << counted(updateFaults) << " faults, " << perThousand(tlb, updates) << " dTLB misses/1k,";
+        printSpread(samples);
+        std::cout << "\n";
+    }
+}
+
+int main(int argc, char **argv)
+{
+    size_t workingSetMiB = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 512;
+    size_t accesses = argc > 2 ? std::strtoull(argv[2], nullptr, 10) : 20000000;
+    size_t levels = argc > 3 ? std::strtoull(argv[3], nullptr, 10) : 200000;
+
+    MemoryPlacement placed;
+    placed.hugePages = true;
+    placed.numaNode = MemoryPlacement::CALLER_NODE;
+    placed.prefault = true;
+
+    if (!pageFaults().available())
+        std::cout << "perf_event_open unavailable (see /proc/sys/kernel/perf_event_paranoid), counters show n/a\n";
+    else if (!tlbMisses().available())
+        std::cout << "no dTLB miss counter on this machine, TLB columns show n/a\n";
+    std::cout << "Working set " << workingSetMiB << " MiB, " << accesses << " random reads, node " << UtilityNamespace::currentNumaNode() << "\n";
+    runWorkingSet("heap", MemoryPlacement(), workingSetMiB << 20, accesses);
+    runWorkingSet("placed", placed, workingSetMiB << 20, accesses);
+
+    std::cout << "\nBook, " << levels << " levels per side, " << accesses / 10 << " updates\n";
+    runBook("heap", std::pmr::new_delete_resource(), levels, accesses / 10);
+    {
+        PlacedArena arena(placed, 64 << 20);
+        std::pmr::unsynchronized_pool_resource pool(&arena);
+        runBook("placed", &pool, levels, accesses / 10);
+    }
+    return 0;
+}
@@ -0,0 +1,66 @@
+// Hop latency between two pinned threads over the ring buffers.
+// usage: ring_latency [pingCpu] [pongCpu] [iterations]
+// A ping thread sends a timestamp, the pong thread echoes it back on a second queue;
+// one hop is half of the measured round trip.
+#include "ring_buffer.hpp"
+#include "clock.hpp"
+#include "thread_affinity.hpp"
+#include <algorithm>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+template <class Queue>
+void runPingPong(const std::string &name, int pingCpu, int pongCpu, size_t iterations)
+{
+    Queue ping(1024), pong(1024);
+    std::vector<int64_t> hops;
+    hops.reserve(iterations);
+
+    std::thread echo([&]()
+                     {
+                         UtilityNamespace::pinCurrentThread(pongCpu);
+                         int64_t value = 0;
+                         for (size_t i = 0; i < iterations; ++i)
+                         {
+                             ping.pop(value);
+                             pong.push(value);
+                         } });
+
+    UtilityNamespace::pinCurrentThread(pingCpu);
+    for (size_t i = 0; i < iterations; ++i)
+    {
+        int64_t sent = UtilityNamespace::steadyNowNs();
+        ping.push(sent);
+        int64_t echoed = 0;
+        pong.pop(echoed);
+        hops.push_back((UtilityNamespace::steadyNowNs() - echoed) / 2);
+    }
+    echo.join();
+
+    // skip the first 10% as warm-up
+    hops.erase(hops.begin(), hops.begin() + hops.size() / 10);
+    std::sort(hops.begin(), hops.end());
+    auto percentile = [&](double p)
+    { return hops[std::min(hops.size() - 1, static_cast<size_t>(p * hops.size()))]; };
+
+    std::cout << name << ": p50=" << percentile(0.50) << "ns p99=" << percentile(0.99)
+              << "ns p99.9=" << percentile(0.999) << "ns max=" << hops.back() << "ns\n";
+}
+
+int main(int argc, char **argv)
+{
+    int pingCpu = argc > 1 ? std::atoi(argv[1]) : 0;
+    int pongCpu = argc > 2 ? std::atoi(argv[2]) : 1;
+    size_t iterations = argc > 3 ? std::strtoull(argv[3], nullptr, 10) : 1000000;
+
+    std::cout << "Hop latency, cpu " << pingCpu << " <-> cpu " << pongCpu << ", " << iterations << " round trips\n";
+    runPingPong<SpscRingBuffer<int64_t, BusySpinWait>>("spsc busy-spin", pingCpu, pongCpu, iterations);
+    runPingPong<SpscRingBuffer<int64_t, YieldingWait>>("spsc yielding ", pingCpu, pongCpu, iterations);
+    runPingPong<SpscRingBuffer<int64_t, BlockingWait>>("spsc blocking ", pingCpu, pongCpu, iterations);
+    runPingPong<MpscRingBuffer<int64_t, BusySpinWait>>("mpsc busy-spin", pingCpu, pongCpu, iterations);
+    runPingPong<MpscRingBuffer<int64_t, BlockingWait>>("mpsc blocking ", pingCpu, pongCpu, iterations);
+    return 0;
+}
@@ -0,0 +1,171 @@
+// Server-side benchmark scenarios against local mocks: ThreadPool task hand-off and WebSocketServer
+// fan-out of one book change to N loopback FeedSubscriber clients.
+// usage: server_bench [google benchmark flags], e.g. --benchmark_format=json
+#include "clock.hpp"
+#include "feed_subscriber.hpp"
+#include "market_data_source.hpp"
+#include "threadpool.hpp"
+#include "websocket_server.hpp"
+#include <benchmark/benchmark.h>
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace
+{
+    constexpr uint16_t BENCH_PORT = 19502;
+    const std::string BENCH_SYMBOL = "BENCH-PERPETUAL";
+
+    // push source the benchmark drives by hand
+    class ManualSource : public MarketDataSource
+    {
+    public:
+        const char *name() const override { return "bench"; }
+        SnapshotPtr fetch(const std::string &) override
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            return latest;
+        }
+        void start(SnapshotHandler handler) override { this->handler = std::move(handler); }
+        bool pushes() const override { return true; }
+
+        // a 20 level book whose best bid amount is version, so every push changes one level
+        void push(uint64_t version)
+        {
+            auto snapshot = std::make_shared<OrderbookSnapshot>();
+            snapshot->symbol = BENCH_SYMBOL;
+            for (int i = 0; i < 20; ++i)
+            {
+                snapshot->bids.push_back({64000.0 - 0.5 * i, i == 0 ? 1.0 + version : 100.0 + i});
+                snapshot->asks.push_back({64000.5 + 0.5 * i, 100.0 + i});
+            }
+            snapshot->fetchedAt = std::chrono::steady_clock::now();
+            snapshot->receivedNs = UtilityNamespace::steadyNowNs();
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                latest = snapshot;
+            }
+            snapshotCount.fetch_add(1, std::memory_order_relaxed);
+            if (handler)
+                handler(snapshot);
+        }
+
+    private:
+        std::mutex mutex;
+        SnapshotPtr latest;
+        SnapshotHandler handler;
+    };
+
+    // waits up to a few seconds for condition, so a lost frame fails the run instead of hanging it
+    template <class Condition>
+    bool waitFor(Condition condition)
+    {
+        auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+        while (!condition())
+        {
+            if (std::chrono::steady_clock::now() > deadline)
+                return false;
+            std::this_thread::yield();
+        }
+        return true;
+    }
+}
+
+// one task through the queue and back: enqueue, wake a worker, run
+static void BM_ThreadPoolRoundTrip(benchmark::State &state)
+{
+    ThreadPool pool(4);
+    std::atomic<uint64_t> done{0};
+    uint64_t sent = 0;
+    for (auto _ : state)
+    {
+        pool.enqueue([&done]()
+                     { done.fetch_add(1, std::memory_order_release); });
+        ++sent;
+        while (done.load(std::memory_order_acquire) != sent)
+            std::this_thread::yield();
+    }
+}
+BENCHMARK(BM_ThreadPoolRoundTrip)->UseRealTime();
+
+// a burst of tasks queued at once, timed until the last has run
+static void BM_ThreadPoolBurst(benchmark::State &state)
+{
+    ThreadPool pool(4);
+    std::atomic<uint64_t> done{0};
+    const uint64_t burst = static_cast<uint64_t>(state.range(0));
+    uint64_t sent = 0;
+    for (auto _ : state)
+    {
+        for (uint64_t i = 0; i < burst; ++i)
+            pool.enqueue([&done]()
+                         { done.fetch_add(1, std::memory_order_relaxed); });
+        sent += burst;
+        while (done.load(std::memory_order_acquire) != sent)
+            std::this_thread::yield();
+    }
+    state.SetItemsProcessed(static_cast<int64_t>(sent));
+}
+BENCHMARK(BM_ThreadPoolBurst)->Arg(1000)->UseRealTime();
+
+// one book change from the source until every client has applied the update frame
+static void BM_Broadcast(benchmark::State &state)
+{
+    const size_t clientCount = static_cast<size_t>(state.range(0));
+    auto source = std::make_unique<ManualSource>();
+    ManualSource &books = *source;
+    uint64_t version = 0;
+    books.push(version);
+    WebSocketServer server(std::move(source));
+    server.startServer(BENCH_PORT);
+
+    std::atomic<uint64_t> snapshots{0}, updates{0};
+    std::vector<std::unique_ptr<FeedSubscriber>> clients;
+    FeedSubscriberOptions options;
+    options.endpoints = {"ws://127.0.0.1:" + std::to_string(BENCH_PORT)};
+    StreamOptions raw;
+    raw.interval = "raw";
+    for (size_t i = 0; i < clientCount; ++i)
+    {
+        clients.push_back(std::make_unique<FeedSubscriber>(options));
+        clients.back()->subscribe(BENCH_SYMBOL, [&](const BookEvent &event)
+                                  {
+                                      if (event.frame.type == FrameType::Snapshot)
+                                          snapshots.fetch_add(1, std::memory_order_release);
+                                      else
+                                          updates.fetch_add(1, std::memory_order_release); },
+                                  raw);
+        clients.back()->start();
+    }
+    if (!waitFor([&]()
+                 { return snapshots.load(std::memory_order_acquire) >= clientCount; }))
+    {
+        state.SkipWithError("clients did not get their first snapshot");
+        return;
+    }
+
+    uint64_t expected = 0;
+    for (auto _ : state)
+    {
+        books.push(++version);
+        expected += clientCount;
+        if (!waitFor([&]()
+                     { return updates.load(std::memory_order_acquire) >= expected; }))
+        {
+            state.SkipWithError("an update frame did not reach every client");
+            break;
+        }
+    }
+    state.SetItemsProcessed(static_cast<int64_t>(expected)); // frames delivered
+
+    for (auto &client : clients)
+        client->stop();
+    server.stopServer(std::chrono::milliseconds(0));
+}
+BENCHMARK(BM_Broadcast)->Arg(1)->Arg(16)->Arg(64)->UseRealTime()->Unit(benchmark::kMicrosecond);
+
+BENCHMARK_MAIN();
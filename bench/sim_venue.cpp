@@ -0,0 +1,125 @@
+// Orders per second through OrderManager into a SimulatedVenue, and a determinism check: the same
+// seeded run of books, orders and cancels is played twice and must give byte-identical replies.
+// usage: sim_venue [orders] [symbols] [seed]
+#include "arena.hpp"
+#include "order_manager.hpp"
+#include "simulated_venue.hpp"
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <random>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace
+{
+    struct RunResult
+    {
+        uint64_t hash = 0; // over every reply
+        uint64_t trades = 0;
+        double seconds = 0.0;
+    };
+
+    // std::hash of the bytes is order-sensitive enough when chained, and cheap next to the venue
+    void mix(uint64_t &hash, std::string_view bytes)
+    {
+        hash = (hash ^ std::hash<std::string_view>()(bytes)) * 1099511628211ull;
+    }
+
+    // one book per symbol every 16 orders, random walk mids; a third of the orders cancel an earlier one
+    RunResult run(size_t orders, size_t symbols, uint64_t seed)
+    {
+        SimulatedVenue venue;
+        OrderManager manager(venue);
+        std::mt19937_64 rng(seed);
+        std::uniform_int_distribution<int> step(-2, 2);
+        std::uniform_int_distribution<int> offset(-6, 6);
+        std::uniform_int_distribution<int> size(1, 50);
+        std::uniform_int_distribution<int> action(0, 2);
+
+        std::vector<std::string> names;
+        std::vector<double> mids;
+        for (size_t s = 0; s < symbols; ++s)
+        {
+            names.push_back("SYM" + std::to_string(s) + "-PERPETUAL");
+            mids.push_back(1000.0 + 250.0 * s);
+        }
+        std::vector<std::string> placed; // order ids that may still be open
+        std::vector<BookLevel> bids(10), asks(10);
+        int64_t timestamp = 1700000000000;
+        std::string buy = "buy", sell = "sell", limit = "limit";
+        RunResult result;
+
+        auto start = std::chrono::steady_clock::now();
+        for (size_t i = 0; i < orders; ++i)
+        {
+            size_t s = i % symbols;
+            if (i % 16 == 0)
+            {
+                mids[s] += 0.5 * step(rng);
+                for (size_t l = 0; l < bids.size(); ++l)
+                {
+                    bids[l] = {mids[s] - 0.5 * (l + 1), double(size(rng))};
+                    asks[l] = {mids[s] + 0.5 * (l + 1), double(size(rng))};
+                }
+                venue.onBook(names[s], bids, asks, ++timestamp);
+            }
+
+            ArenaScope scope;
+            std::pmr::string response(&scope.resource());
+            if (action(rng) == 0 && !placed.empty())
+            {
+                // any earlier order, so orders left behind by the mid do not pile up
+                size_t pick = rng() % placed.size();
+                std::string id = std::move(placed[pick]);
+                placed[pick] = std::move(placed.back());
+                placed.pop_back();
+                manager.cancelOrder(id, response);
+            }
+            else
+            {
+                bool isBuy = rng() & 1;
+                double price = mids[s] + 0.5 * offset(rng);
+                manager.placeOrder(names[s], isBuy ? buy : sell, double(size(rng)), price, limit, response);
+                size_t at = response.find("\"order_id\":\"");
+                if (at != std::string::npos && response.find("\"order_state\":\"open\"") != std::string::npos)
+                {
+                    at += 12;
+                    placed.emplace_back(response.data() + at, response.find('"', at) - at);
+                }
+            }
+            mix(result.hash, response);
+        }
+        result.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        result.trades = venue.trades();
+        return result;
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    size_t orders = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 2000000;
+    size_t symbols = argc > 2 ? std::strtoull(argv[2], nullptr, 10) : 4;
+    uint64_t seed = argc > 3 ? std::strtoull(argv[3], nullptr, 10) : 42;
+    if (orders == 0 || symbols == 0)
+    {
+        std::cerr << "usage: sim_venue [orders] [symbols] [seed]\n";
+        return 1;
+    }
+
+    RunResult first = run(orders, symbols, seed);
+    RunResult second = run(orders, symbols, seed);
+
+    std::cout << "orders: " << orders << "\n";
+    std::cout << "trades: " << first.trades << "\n";
+    std::cout << "orders/s: " << static_cast<uint64_t>(orders / first.seconds) << ", "
+              << static_cast<uint64_t>(orders / second.seconds) << "\n";
+    std::cout << "reply hash: " << std::hex << first.hash << ", " << second.hash << std::dec << "\n";
+    if (first.hash != second.hash || first.trades != second.trades)
+    {
+        std::cerr << "Runs with the same seed gave different replies\n";
+        return 1;
+    }
+    return 0;
+}
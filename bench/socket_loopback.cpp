@@ -0,0 +1,176 @@
+// Verifies the socket tuning layer against a loopback mock HTTP server and reports round trips.
+// usage: socket_loopback [requests]
+// Exits non-zero if an option did not stick on the client socket.
+#include "arena.hpp"
+#include "http_transport.hpp"
+#include <algorithm>
+#include <arpa/inet.h>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <string>
+#include <sys/socket.h>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+namespace
+{
+    const std::string responseBody = "{\"jsonrpc\":\"2.0\",\"id\":2,\"result\":{\"order\":{\"order_id\":\"ETH-1\"}}}";
+
+    // minimal keep-alive HTTP/1.1 server: reads headers and Content-Length body, answers 200
+    class MockHttpServer
+    {
+    public:
+        MockHttpServer()
+        {
+            listenFd = socket(AF_INET, SOCK_STREAM, 0);
+            int one = 1;
+            setsockopt(listenFd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+            sockaddr_in addr{};
+            addr.sin_family = AF_INET;
+            addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+            addr.sin_port = 0;
+            bind(listenFd, reinterpret_cast<sockaddr *>(&addr), sizeof(addr));
+            listen(listenFd, 16);
+            socklen_t len = sizeof(addr);
+            getsockname(listenFd, reinterpret_cast<sockaddr *>(&addr), &len);
+            port = ntohs(addr.sin_port);
+            worker = std::thread([this]()
+                                 { serve(); });
+        }
+
+        ~MockHttpServer()
+        {
+            shutdown(listenFd, SHUT_RDWR);
+            close(listenFd);
+            worker.join();
+        }
+
+        int port = 0;
+        std::atomic<uint64_t> timestampedReads{0};
+
+    private:
+        void serve()
+        {
+            while (true)
+            {
+                int fd = accept(listenFd, nullptr, nullptr);
+                if (fd < 0)
+                    return;
+                UtilityNamespace::enableRxTimestamping(fd, RxTimestamping::Software);
+                handle(fd);
+                close(fd);
+            }
+        }
+
+        void handle(int fd)
+        {
+            std::string buffer;
+            char chunk[4096];
+            while (true)
+            {
+                size_t headerEnd;
+                while ((headerEnd = buffer.find("\r\n\r\n")) == std::string::npos)
+                {
+                    int64_t stamp = 0;
+                    long received = UtilityNamespace::receiveWithTimestamp(fd, chunk, sizeof(chunk), stamp);
+                    if (received <= 0)
+                        return;
+                    if (stamp)
+                        timestampedReads.fetch_add(1, std::memory_order_relaxed);
+                    buffer.append(chunk, received);
+                }
+
+                size_t contentLength = 0;
+                size_t pos = buffer.find("Content-Length:");
+                if (pos != std::string::npos && pos < headerEnd)
+                    contentLength = std::strtoul(buffer.c_str() + pos + 15, nullptr, 10);
+                while (buffer.size() < headerEnd + 4 + contentLength)
+                {
+                    long received = recv(fd, chunk, sizeof(chunk), 0);
+                    if (received <= 0)
+                        return;
+                    buffer.append(chunk, received);
+                }
+                buffer.erase(0, headerEnd + 4 + contentLength);
+
+                std::string reply = "HTTP/1.1 200 OK\r\nContent-Type: application/json\r\nContent-Length: " +
+                                    std::to_string(responseBody.size()) + "\r\n\r\n" + responseBody;
+                if (send(fd, reply.data(), reply.size(), MSG_NOSIGNAL) < 0)
+                    return;
+            }
+        }
+
+        int listenFd;
+        std::thread worker;
+    };
+
+    int getIntOption(int fd, int level, int name)
+    {
+        int value = 0;
+        socklen_t len = sizeof(value);
+        getsockopt(fd, level, name, &value, &len);
+        return value;
+    }
+}
+
+int main(int argc, char **argv)
+{
+    size_t requests = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 10000;
+    MockHttpServer server;
+    std::string url = "http://127.0.0.1:" + std::to_string(server.port) + "/api/v2/private/buy";
+    std::string payload = "{\"jsonrpc\":\"2.0\",\"id\":2,\"method\":\"private/buy\",\"params\":{\"instrument_name\":\"BTC-PERPETUAL\",\"amount\":10,\"type\":\"limit\",\"price\":350}}";
+
+    SocketOptions options;
+    options.tcpNoDelay = true;
+    options.quickAck = true;
+    options.receiveBufferBytes = 1 << 20;
+    options.sendBufferBytes = 1 << 20;
+    options.busyPollMicros = 50; // may fail without CAP_NET_ADMIN, which shows up in optionFailures
+    HttpTransport transport(options);
+
+    std::vector<int64_t> roundTrips;
+    roundTrips.reserve(requests);
+    for (size_t i = 0; i < requests; ++i)
+    {
+        ArenaScope scope;
+        std::pmr::string response(&scope.resource());
+        auto start = std::chrono::steady_clock::now();
+        if (!transport.post(url.c_str(), payload, "Authorization: Bearer test", response) || std::string_view(response) != responseBody)
+        {
+            std::cerr << "request " << i << " failed\n";
+            return 1;
+        }
+        roundTrips.push_back(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count());
+    }
+
+    int fd = transport.activeSocket();
+    bool ok = fd >= 0;
+    if (ok)
+    {
+        bool noDelay = getIntOption(fd, IPPROTO_TCP, TCP_NODELAY) == 1;
+        // the kernel doubles the requested size for bookkeeping
+        bool rcvBuf = getIntOption(fd, SOL_SOCKET, SO_RCVBUF) >= options.receiveBufferBytes;
+        bool sndBuf = getIntOption(fd, SOL_SOCKET, SO_SNDBUF) >= options.sendBufferBytes;
+        std::cout << "TCP_NODELAY: " << (noDelay ? "ok" : "missing") << "\n";
+        std::cout << "SO_RCVBUF: " << (rcvBuf ? "ok" : "capped by net.core.rmem_max") << "\n";
+        std::cout << "SO_SNDBUF: " << (sndBuf ? "ok" : "capped by net.core.wmem_max") << "\n";
+        ok = noDelay;
+    }
+
+    const ConnectionStats &stats = transport.stats();
+    std::cout << "sockets opened: " << stats.socketsOpened << ", option failures: " << stats.optionFailures
+              << ", requests: " << stats.requests << ", failures: " << stats.failures << "\n";
+    std::cout << "bytes sent: " << stats.bytesSent << ", bytes received: " << stats.bytesReceived << "\n";
+    std::cout << "server reads with rx timestamps: " << server.timestampedReads << "\n";
+
+    std::sort(roundTrips.begin(), roundTrips.end());
+    std::cout << "round trip p50=" << roundTrips[roundTrips.size() / 2] << "ns p99=" << roundTrips[roundTrips.size() * 99 / 100]
+              << "ns max=" << roundTrips.back() << "ns\n";
+    return ok && stats.socketsOpened == 1 ? 0 : 1;
+}
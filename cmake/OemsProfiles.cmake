@@ -0,0 +1,54 @@
+# Opt-in optimization profiles shared by every target in the project.
+#
+#   -DOEMS_ENABLE_LTO=ON     link-time optimization (interprocedural, checked for support)
+#   -DOEMS_NATIVE=ON         -march=native, binaries only run on CPUs like the build machine
+#   -DOEMS_PGO=GENERATE      instrumented build, then `cmake --build . --target pgo-train`
+#   -DOEMS_PGO=USE           rebuild with the collected profiles from OEMS_PGO_DIR
+
+option(OEMS_ENABLE_LTO "Enable link-time optimization" OFF)
+option(OEMS_NATIVE "Compile with -march=native" OFF)
+set(OEMS_PGO "OFF" CACHE STRING "Profile guided optimization stage: OFF, GENERATE or USE")
+set_property(CACHE OEMS_PGO PROPERTY STRINGS OFF GENERATE USE)
+set(OEMS_PGO_DIR "${CMAKE_BINARY_DIR}/pgo-profiles" CACHE PATH "Where PGO profiles are written and read")
+
+if(OEMS_ENABLE_LTO)
+    include(CheckIPOSupported)
+    check_ipo_supported(RESULT OEMS_LTO_SUPPORTED OUTPUT OEMS_LTO_ERROR)
+    if(NOT OEMS_LTO_SUPPORTED)
+        message(WARNING "LTO requested but not supported: ${OEMS_LTO_ERROR}")
+    endif()
+endif()
+
+if(NOT OEMS_PGO STREQUAL "OFF" AND NOT OEMS_PGO STREQUAL "GENERATE" AND NOT OEMS_PGO STREQUAL "USE")
+    message(FATAL_ERROR "OEMS_PGO must be OFF, GENERATE or USE (got '${OEMS_PGO}')")
+endif()
+
+function(oems_apply_profile target)
+    if(CMAKE_COMPILER_IS_GNUCXX OR CMAKE_CXX_COMPILER_ID MATCHES "Clang")
+        target_compile_options(${target} PRIVATE -Wall -Wextra -pedantic)
+    endif()
+
+    if(OEMS_ENABLE_LTO AND OEMS_LTO_SUPPORTED)
+        set_property(TARGET ${target} PROPERTY INTERPROCEDURAL_OPTIMIZATION TRUE)
+    endif()
+
+    if(OEMS_NATIVE)
+        target_compile_options(${target} PRIVATE -march=native)
+    endif()
+
+    if(OEMS_PGO STREQUAL "GENERATE")
+        if(CMAKE_CXX_COMPILER_ID MATCHES "Clang")
+            target_compile_options(${target} PRIVATE -fprofile-instr-generate=${OEMS_PGO_DIR}/%m.profraw)
+            target_link_options(${target} PRIVATE -fprofile-instr-generate)
+        else()
+            target_compile_options(${target} PRIVATE -fprofile-generate=${OEMS_PGO_DIR} -fprofile-update=atomic)
+            target_link_options(${target} PRIVATE -fprofile-generate=${OEMS_PGO_DIR})
+        endif()
+    elseif(OEMS_PGO STREQUAL "USE")
+        if(CMAKE_CXX_COMPILER_ID MATCHES "Clang")
+            target_compile_options(${target} PRIVATE -fprofile-instr-use=${OEMS_PGO_DIR}/merged.profdata -Wno-profile-instr-unprofiled)
+        else()
+            target_compile_options(${target} PRIVATE -fprofile-use=${OEMS_PGO_DIR} -fprofile-correction -Wno-missing-profile)
+        endif()
+    endif()
+endfunction()
@@ -0,0 +1,124 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <memory_resource>
+#include <string>
+#include <vector>
+#include "memory_placement.hpp"
+
+// Bump allocator for everything that lives for one request/response. Nothing is freed individually,
+// reset() at the message boundary rewinds it. If a message overflows the block the extra memory comes
+// from the heap and the block is grown on the next reset, so steady state stays off the heap.
+class MessageArena : public std::pmr::memory_resource
+{
+public:
+    // placement applies to the block, and to its replacements when it grows; overflow stays on the heap
+    explicit MessageArena(size_t capacity = 64 * 1024, const MemoryPlacement &placement = MemoryPlacement())
+        : placement(placement), block(capacity, placement), blockSize(block.size())
+    {
+    }
+    MessageArena(const MessageArena &) = delete;
+    MessageArena &operator=(const MessageArena &) = delete;
+
+    void reset()
+    {
+        if (!overflow.empty())
+        {
+            // grow so the next message of this size fits in the block
+            size_t needed = demand > blockSize * 2 ? demand : blockSize * 2;
+            overflow.clear();
+            block = PlacedBuffer(needed, placement);
+            blockSize = block.size();
+        }
+        offset = 0;
+        demand = 0;
+        ++resets;
+    }
+
+    // writes the free part of the block so its pages are faulted in now; allocates nothing, so an enclosing
+    // message keeps the whole remainder. Returns the bytes touched
+    size_t prefault()
+    {
+        std::memset(block.data() + offset, 0, blockSize - offset);
+        return blockSize - offset;
+    }
+
+    size_t used() const { return offset; }
+    size_t capacity() const { return blockSize; }
+    uint64_t upstreamAllocations() const { return upstreamCount; }
+    uint64_t resetCount() const { return resets; }
+
+private:
+    void *do_allocate(size_t bytes, size_t alignment) override
+    {
+        demand += bytes + alignment;
+        // aligned by address, the block itself is only aligned for max_align_t
+        uintptr_t base = reinterpret_cast<uintptr_t>(block.data());
+        size_t start = ((base + offset + alignment - 1) & ~(alignment - 1)) - base;
+        if (start + bytes <= blockSize)
+        {
+            offset = start + bytes;
+            return block.data() + start;
+        }
+        ++upstreamCount;
+        overflow.emplace_back(new std::byte[bytes + alignment]);
+        void *raw = overflow.back().get();
+        size_t space = bytes + alignment;
+        return std::align(alignment, bytes, raw, space);
+    }
+
+    void do_deallocate(void *, size_t, size_t) override {}
+
+    bool do_is_equal(const std::pmr::memory_resource &other) const noexcept override
+    {
+        return this == &other;
+    }
+
+    MemoryPlacement placement;
+    PlacedBuffer block;
+    size_t blockSize;
+    size_t offset = 0;
+    size_t demand = 0; // bytes requested since the last reset
+    uint64_t upstreamCount = 0;
+    uint64_t resets = 0;
+    std::vector<std::unique_ptr<std::byte[]>> overflow;
+    int scopeDepth = 0;
+
+    friend class ArenaScope;
+};
+
+// one arena per thread, request/response buffers on the order and feed paths are carved from it;
+// created on first use by its thread, so CALLER_NODE places it on that thread's node
+inline MessageArena &threadArena()
+{
+    thread_local MessageArena arena(64 * 1024, UtilityNamespace::memoryPlacement());
+    return arena;
+}
+
+// rewinds the arena when the message that used it is done; nested scopes leave it to the outermost one
+class ArenaScope
+{
+public:
+    explicit ArenaScope(MessageArena &arena = threadArena()) : arena(arena) { ++arena.scopeDepth; }
+    ~ArenaScope()
+    {
+        if (--arena.scopeDepth == 0)
+            arena.reset();
+    }
+    ArenaScope(const ArenaScope &) = delete;
+    ArenaScope &operator=(const ArenaScope &) = delete;
+
+    MessageArena &resource() { return arena; }
+
+private:
+    MessageArena &arena;
+};
+
+namespace UtilityNamespace
+{
+    // heap allocations made by the calling thread, only counted when built with OEMS_COUNT_ALLOCATIONS
+    uint64_t threadHeapAllocations();
+}
@@ -0,0 +1,87 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <vector>
+#include "local_book.hpp"
+
+// Both sides of a book as separate price and size arrays, best level first, so the analytics
+// kernels run over contiguous doubles.
+struct SoaBook
+{
+    std::vector<double> bidPrices;
+    std::vector<double> bidSizes;
+    std::vector<double> askPrices;
+    std::vector<double> askSizes;
+
+    void assign(const std::vector<BookLevel> &bids, const std::vector<BookLevel> &asks);
+    void assign(const LocalOrderBook &book);
+};
+
+struct AnalyticsConfig
+{
+    size_t imbalanceLevels = 5; // levels per side in the imbalance
+    double fillSize = 1.0;      // size the VWAPs are computed for
+    double depthBandBps = 10.0; // depth counts levels within this distance of mid
+};
+
+struct BookAnalytics
+{
+    double bestBid = 0.0;
+    double bestAsk = 0.0;
+    double mid = 0.0;
+    double spread = 0.0;
+    double spreadBps = 0.0;
+    double microprice = 0.0; // mid weighted towards the side with less size at the touch
+    double imbalance = 0.0;  // (bid - ask) / (bid + ask) size over the top imbalanceLevels, in [-1, 1]
+    double bidDepth = 0.0;   // size within depthBandBps of mid
+    double askDepth = 0.0;
+    double vwapBuy = 0.0;  // average price to buy fillSize from the asks, 0 when the book is too thin
+    double vwapSell = 0.0; // average price to sell fillSize into the bids
+    double spreadMeanBps = 0.0;   // across updates, filled in from a SpreadStats by its owner
+    double spreadStddevBps = 0.0;
+};
+
+// running spread statistics across updates (Welford)
+class SpreadStats
+{
+public:
+    void add(double spreadBps)
+    {
+        ++n;
+        double delta = spreadBps - meanValue;
+        meanValue += delta / n;
+        m2 += delta * (spreadBps - meanValue);
+        minValue = std::min(minValue, spreadBps);
+        maxValue = std::max(maxValue, spreadBps);
+    }
+
+    uint64_t count() const { return n; }
+    double mean() const { return meanValue; }
+    double stddev() const { return n > 1 ? std::sqrt(m2 / (n - 1)) : 0.0; }
+    double min() const { return n ? minValue : 0.0; }
+    double max() const { return n ? maxValue : 0.0; }
+
+private:
+    uint64_t n = 0;
+    double meanValue = 0.0;
+    double m2 = 0.0;
+    double minValue = std::numeric_limits<double>::max();
+    double maxValue = std::numeric_limits<double>::lowest();
+};
+
+namespace UtilityNamespace
+{
+    BookAnalytics computeAnalytics(const SoaBook &book, const AnalyticsConfig &config = AnalyticsConfig());
+
+    // SIMD kernels (AVX2 when built with OEMS_NATIVE or -mavx2, SSE2 otherwise)
+    double sumSizes(const double *sizes, size_t count);
+    double sumWithinBand(const double *prices, const double *sizes, size_t count, double low, double high);
+    // average price filling target walking from the best level, 0 if the levels do not hold enough
+    double vwapToFill(const double *prices, const double *sizes, size_t count, double target);
+    // out[i] = sizes[0] + ... + sizes[i]
+    void cumulativeDepth(const double *sizes, size_t count, double *out);
+}
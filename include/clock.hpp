@@ -0,0 +1,19 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+
+namespace UtilityNamespace
+{
+    // monotonic nanoseconds, only comparable within one host
+    inline int64_t steadyNowNs()
+    {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+
+    // wall clock nanoseconds, for anything persisted or compared across restarts
+    inline int64_t wallNowNs()
+    {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+    }
+}
@@ -0,0 +1,50 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+
+// Estimates the offset between a peer's monotonic clock and ours from ping/pong exchanges
+// (NTP style). The sample with the smallest round trip in the recent window wins, since queueing
+// delay only ever inflates the error.
+class ClockSync
+{
+public:
+    // t0 ping sent (ours), t1 ping received (peer), t2 pong sent (peer), t3 pong received (ours)
+    void onPong(int64_t t0, int64_t t1, int64_t t2, int64_t t3)
+    {
+        Sample &sample = samples[count++ % samples.size()];
+        sample.roundTrip = (t3 - t0) - (t2 - t1);
+        sample.offset = ((t1 - t0) + (t2 - t3)) / 2;
+
+        size_t filled = count < samples.size() ? count : samples.size();
+        int64_t bestRoundTrip = std::numeric_limits<int64_t>::max();
+        for (size_t i = 0; i < filled; ++i)
+        {
+            if (samples[i].roundTrip < bestRoundTrip)
+            {
+                bestRoundTrip = samples[i].roundTrip;
+                bestOffset = samples[i].offset;
+            }
+        }
+        lastRoundTrip = sample.roundTrip;
+    }
+
+    bool valid() const { return count > 0; }
+    // peer clock minus our clock, add it to our timestamps to compare them with the peer's
+    int64_t offsetNs() const { return bestOffset; }
+    int64_t roundTripNs() const { return lastRoundTrip; }
+
+private:
+    struct Sample
+    {
+        int64_t offset = 0;
+        int64_t roundTrip = 0;
+    };
+
+    std::array<Sample, 16> samples;
+    size_t count = 0;
+    int64_t bestOffset = 0;
+    int64_t lastRoundTrip = 0;
+};
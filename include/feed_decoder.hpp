@@ -0,0 +1,62 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <nlohmann/json_fwd.hpp>
+#include <simdjson.h>
+#include "book_analytics.hpp"
+#include "local_book.hpp"
+#include "option_chain.hpp"
+
+enum class FrameType
+{
+    Snapshot,
+    Update,
+    Pong,
+    Analytics,
+    Chain,
+    Error,
+    Unknown
+};
+
+// one decoded frame of the local feed protocol (see local_book.hpp)
+struct FeedFrame
+{
+    FrameType type = FrameType::Snapshot;
+    std::string symbol;
+    uint64_t seq = 0;
+    std::vector<BookLevel> bids; // whole side for snapshots, changed levels for updates
+    std::vector<BookLevel> asks;
+    int64_t upstreamNs = 0; // recv_ns, server clock
+    int64_t sentNs = 0;     // send_ns, server clock
+    BookAnalytics analytics; // analytics frames only
+    OptionChain chain;       // chain frames only, symbol is the currency; rows kept while the listing is unchanged
+    std::string error;       // error frames only
+};
+
+// optional subscribe parameters, see local_book.hpp
+struct StreamOptions
+{
+    size_t depth = 0;     // top levels per side, 0 for the whole book
+    std::string interval; // "raw", "100ms", "1s"...; empty for the server default
+};
+
+namespace UtilityNamespace
+{
+    // decodes payload into frame, reusing frame's buffers; frames without a type are snapshots.
+    // throws simdjson::simdjson_error on malformed input
+    void decodeFeedFrame(simdjson::ondemand::parser &parser, std::string &payload, FeedFrame &frame);
+    // {"action":"subscribe","symbol":...} with the depth and interval when they are set
+    std::string encodeSubscribe(const std::string &symbol, const StreamOptions &options = StreamOptions());
+    // recv_ns and send_ns of a raw frame without decoding it, for frames handed on undecoded; searches
+    // from the end, where the server writes them. False when either is missing
+    bool findLatencyStamps(std::string_view payload, int64_t &upstreamNs, int64_t &sentNs);
+
+    // ping/pong clock sync (see clock_sync.hpp): the client sends {"action":"ping","t0":<its clock>} and
+    // the server answers {"type":"pong","t0":..,"t1":<received>,"t2":<sent>}, all in steady clock ns.
+    // The t0 of a ping request, false unless it is an integer
+    bool readPingTimestamp(const nlohmann::json &request, int64_t &t0);
+    std::string encodePong(int64_t t0, int64_t t1, int64_t t2);
+}
@@ -0,0 +1,122 @@
+#pragma once
+
+#include <websocketpp/config/asio_no_tls_client.hpp>
+#include <websocketpp/client.hpp>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include <simdjson.h>
+#include "feed_decoder.hpp"
+#include "heartbeat.hpp"
+#include "local_book.hpp"
+#include "reconnecting_client.hpp"
+#include "socket_tuning.hpp"
+
+// what a symbol handler sees for every frame that changed its book
+struct BookEvent
+{
+    const FeedFrame &frame;     // decoded frame: the whole book for snapshots, changed levels for updates
+    const LocalOrderBook &book; // local book after applying the frame
+    int64_t receivedNs;         // steady clock, when the frame came off the socket
+};
+
+struct FeedSubscriberOptions
+{
+    std::vector<std::string> endpoints{"ws://localhost:9002"}; // tried in order, wrapping around
+    ReconnectOptions reconnect;
+    HeartbeatOptions heartbeat; // WebSocket pings; a silent connection is dropped and the next endpoint tried
+    SocketOptions socket;
+};
+
+// Headless market data client for embedding in other processes: per-symbol handlers, typed books,
+// heartbeats, automatic reconnect with resubscribe across several endpoints, and no console I/O.
+// Handlers run on the subscriber's I/O thread and must not block.
+class FeedSubscriber
+{
+public:
+    using BookHandler = std::function<void(const BookEvent &)>;
+    using AnalyticsHandler = std::function<void(const std::string &symbol, const BookAnalytics &)>;
+    using ChainHandler = std::function<void(const OptionChain &chain)>;
+    using StatusHandler = std::function<void(const std::string &endpoint, bool connected)>;
+    using ErrorHandler = std::function<void(const std::string &message)>;
+
+    explicit FeedSubscriber(FeedSubscriberOptions options = FeedSubscriberOptions());
+    ~FeedSubscriber();
+
+    FeedSubscriber(const FeedSubscriber &) = delete;
+    FeedSubscriber &operator=(const FeedSubscriber &) = delete;
+
+    // connects and runs the I/O thread; subscriptions made before start() are sent on connect
+    void start();
+    void stop();
+
+    // resubscribing replaces the handler and options and starts again from a fresh snapshot;
+    // the server shares one stream among all clients asking for the same depth and interval
+    void subscribe(const std::string &symbol, BookHandler handler, StreamOptions streamOptions = StreamOptions());
+    void unsubscribe(const std::string &symbol);
+
+    // derived values only (book_analytics.hpp), computed by the server once per book change;
+    // independent of subscribe() for the same symbol
+    void subscribeAnalytics(const std::string &symbol, AnalyticsHandler handler);
+    void unsubscribeAnalytics(const std::string &symbol);
+
+    // every option of a currency ("ETH") with its implied volatility and Greeks, recomputed by the
+    // server when the underlying moves; needs a server started with --chain for that currency
+    void subscribeChain(const std::string &currency, ChainHandler handler);
+    void unsubscribeChain(const std::string &currency);
+
+    // set before start()
+    void setStatusHandler(StatusHandler handler);
+    void setErrorHandler(ErrorHandler handler);
+
+    bool connected() const { return stream.connected(); }
+    const std::string &endpoint() const { return stream.endpoint(); }
+    uint64_t reconnects() const { return reconnectCount.load(std::memory_order_relaxed); }
+    uint64_t gaps() const { return gapCount.load(std::memory_order_relaxed); }
+    uint64_t heartbeatTimeouts() const { return heartbeatTimeoutCount.load(std::memory_order_relaxed); }
+    const ConnectionStats &stats() const { return connectionStats; }
+
+private:
+    using Stream = ReconnectingClient<websocketpp::config::asio_client>;
+
+    struct Subscription
+    {
+        BookHandler handler;
+        StreamOptions options;
+        SymbolFeed feed; // I/O thread only
+    };
+
+    bool onOpen(websocketpp::connection_hdl hdl);
+    void onClose(websocketpp::connection_hdl hdl, bool wasConnected);
+    void onMessage(websocketpp::connection_hdl hdl, Stream::MessagePtr msg, int64_t receivedNs);
+    void onSocketInit(websocketpp::connection_hdl hdl, boost::asio::ip::tcp::socket &socket);
+    void onAnalytics();
+    void onChain();
+    void post(std::string message);
+    void send(const std::string &message);
+    void reportError(const std::string &message);
+
+    FeedSubscriberOptions options;
+    Stream stream;
+    std::atomic<uint64_t> reconnectCount{0};
+    std::atomic<uint64_t> gapCount{0};
+    std::atomic<uint64_t> heartbeatTimeoutCount{0};
+
+    std::mutex subscriptionsMutex;
+    std::unordered_map<std::string, std::shared_ptr<Subscription>> subscriptions;
+    std::unordered_map<std::string, std::shared_ptr<AnalyticsHandler>> analyticsSubscriptions;
+    std::unordered_map<std::string, std::shared_ptr<ChainHandler>> chainSubscriptions;
+    StatusHandler statusHandler;
+    ErrorHandler errorHandler;
+
+    simdjson::ondemand::parser parser; // I/O thread only
+    FeedFrame frame;                   // I/O thread only
+    ConnectionStats connectionStats;
+    std::atomic<int> socketFd{-1};
+};
@@ -0,0 +1,87 @@
+#pragma once
+
+#include <cstdint>
+#include <string_view>
+
+// Decimal value held as an integer count of 10^-decimals units. The scale is not stored: it belongs to
+// the instrument (InstrumentSpec in instrument.hpp), so only compare or add values of one instrument.
+template <class Tag>
+class FixedPoint
+{
+public:
+    constexpr FixedPoint() = default;
+    constexpr explicit FixedPoint(int64_t units) : value(units) {}
+
+    constexpr int64_t units() const { return value; }
+
+    constexpr FixedPoint &operator+=(FixedPoint other)
+    {
+        value += other.value;
+        return *this;
+    }
+    constexpr FixedPoint &operator-=(FixedPoint other)
+    {
+        value -= other.value;
+        return *this;
+    }
+
+    friend constexpr FixedPoint operator+(FixedPoint a, FixedPoint b) { return FixedPoint(a.value + b.value); }
+    friend constexpr FixedPoint operator-(FixedPoint a, FixedPoint b) { return FixedPoint(a.value - b.value); }
+    friend constexpr bool operator==(FixedPoint a, FixedPoint b) { return a.value == b.value; }
+    friend constexpr bool operator!=(FixedPoint a, FixedPoint b) { return a.value != b.value; }
+    friend constexpr bool operator<(FixedPoint a, FixedPoint b) { return a.value < b.value; }
+    friend constexpr bool operator<=(FixedPoint a, FixedPoint b) { return a.value <= b.value; }
+    friend constexpr bool operator>(FixedPoint a, FixedPoint b) { return a.value > b.value; }
+    friend constexpr bool operator>=(FixedPoint a, FixedPoint b) { return a.value >= b.value; }
+
+private:
+    int64_t value = 0;
+};
+
+struct PriceTag;
+struct QuantityTag;
+using Price = FixedPoint<PriceTag>;
+using Quantity = FixedPoint<QuantityTag>;
+
+enum class Rounding
+{
+    Nearest, // halves round up
+    Down,
+    Up
+};
+
+namespace UtilityNamespace
+{
+    constexpr int MAX_DECIMALS = 18;
+    constexpr size_t DECIMAL_TEXT_MAX = 48; // formatDecimal never writes more
+
+    // exact decimal text ("64000.5", "-0.0005", "5e-4") to units of 10^-decimals. False when the text is
+    // not a number, has digits below the scale or does not fit, so nothing is ever rounded silently
+    bool parseDecimal(std::string_view text, int decimals, int64_t &units);
+    // fewest decimals that hold text exactly, e.g. 2 for "0.05"
+    bool decimalPlaces(std::string_view text, int &decimals);
+    // shortest exact text: no exponent, no trailing zeros, no point for whole numbers. Returns the end
+    char *formatDecimal(char *out, int64_t units, int decimals);
+
+    // instantiated for std::string and std::pmr::string
+    template <class String>
+    void appendDecimal(String &out, int64_t units, int decimals);
+
+    // value rounded to a multiple of step (> 0), negative values included; the result must fit in int64_t
+    constexpr int64_t roundToStep(int64_t value, int64_t step, Rounding rounding)
+    {
+        int64_t quotient = value / step;
+        int64_t remainder = value % step;
+        if (remainder < 0)
+        {
+            remainder += step;
+            --quotient;
+        }
+        int64_t floor = quotient * step;
+        if (remainder == 0 || rounding == Rounding::Down)
+            return floor;
+        if (rounding == Rounding::Up || remainder >= step - remainder)
+            return floor + step;
+        return floor;
+    }
+}
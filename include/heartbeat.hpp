@@ -0,0 +1,66 @@
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <random>
+
+// Dead-connection detection and reconnect pacing shared by the WebSocket clients. A half-open TCP
+// connection delivers nothing and reports no error, so silence is the only sign of it.
+struct HeartbeatOptions
+{
+    std::chrono::milliseconds interval{1000}; // ping this often; 0 turns heartbeats off
+    std::chrono::milliseconds timeout{5000};  // no frame at all for this long: the connection is dead
+};
+
+struct ReconnectOptions
+{
+    std::chrono::milliseconds initialDelay{100};
+    std::chrono::milliseconds maxDelay{5000};
+    double jitter = 0.5; // fraction of each delay drawn at random, so clients dropped together come back spread out
+};
+
+// when nothing has arrived for too long; I/O thread only
+class HeartbeatMonitor
+{
+public:
+    explicit HeartbeatMonitor(HeartbeatOptions options = HeartbeatOptions()) : options(options) {}
+
+    bool enabled() const { return options.interval.count() > 0; }
+    std::chrono::milliseconds interval() const { return options.interval; }
+
+    // on open and on every frame, pongs included
+    void onReceive(int64_t nowNs) { lastReceivedNs = nowNs; }
+    bool expired(int64_t nowNs) const
+    {
+        return enabled() && options.timeout.count() > 0 &&
+               nowNs - lastReceivedNs > std::chrono::duration_cast<std::chrono::nanoseconds>(options.timeout).count();
+    }
+
+private:
+    HeartbeatOptions options;
+    int64_t lastReceivedNs = 0;
+};
+
+// exponential backoff with jitter, reset by a successful open; I/O thread only
+class ReconnectBackoff
+{
+public:
+    explicit ReconnectBackoff(ReconnectOptions options = ReconnectOptions())
+        : options(options), current(options.initialDelay), random(std::random_device{}()) {}
+
+    std::chrono::milliseconds next()
+    {
+        double jitter = std::clamp(options.jitter, 0.0, 1.0);
+        double fraction = 1.0 - jitter * std::uniform_real_distribution<double>(0.0, 1.0)(random);
+        auto delay = std::chrono::milliseconds(static_cast<int64_t>(current.count() * fraction));
+        current = std::min(current * 2, options.maxDelay);
+        return delay;
+    }
+    void reset() { current = options.initialDelay; }
+
+private:
+    ReconnectOptions options;
+    std::chrono::milliseconds current;
+    std::minstd_rand random;
+};
@@ -0,0 +1,53 @@
+#pragma once
+
+#include <curl/curl.h>
+#include <atomic>
+#include <memory_resource>
+#include <string>
+#include <string_view>
+#include "socket_tuning.hpp"
+
+// One reusable curl easy handle: keeps its connection alive between requests, applies SocketOptions
+// to every socket it opens and keeps per-connection stats. Not thread safe, use one per thread.
+class HttpTransport
+{
+public:
+    explicit HttpTransport(const SocketOptions &options = SocketOptions());
+    ~HttpTransport();
+    HttpTransport(const HttpTransport &) = delete;
+    HttpTransport &operator=(const HttpTransport &) = delete;
+
+    // authHeader may be null; the reply is appended to response
+    bool post(const char *url, std::string_view payload, const char *authHeader, std::pmr::string &response);
+    bool get(const char *url, std::pmr::string &response);
+    // while set, requests fail fast and a transfer in flight is aborted within a second once *flag
+    // turns true; pass null to clear. The flag must outlive its use by this transport
+    void setAbortFlag(const std::atomic<bool> *flag);
+
+    const ConnectionStats &stats() const { return connectionStats; }
+    const SocketOptions &options() const { return socketOptions; }
+    // socket of the live connection, -1 when none is open
+    int activeSocket() const;
+
+private:
+    static int onSocketOpened(void *clientp, curl_socket_t fd, curlsocktype purpose);
+    static int onProgress(void *clientp, curl_off_t, curl_off_t, curl_off_t, curl_off_t);
+    bool perform(std::pmr::string &response);
+
+    CURL *curl;
+    curl_slist *headers = nullptr;
+    std::string cachedAuthHeader;
+    bool headersHaveAuth = false;
+    const std::atomic<bool> *abortFlag = nullptr;
+    SocketOptions socketOptions;
+    ConnectionStats connectionStats;
+};
+
+namespace UtilityNamespace
+{
+    // options used for transports created after the call (threadTransport() and sessions)
+    void setDefaultSocketOptions(const SocketOptions &options);
+    SocketOptions defaultSocketOptions();
+    // lazily created transport for the calling thread
+    HttpTransport &threadTransport();
+}
@@ -0,0 +1,132 @@
+#pragma once
+
+#include <cmath>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "fixed_point.hpp"
+
+// a larger tick from abovePrice up, as in get_instruments' tick_size_steps (options)
+struct TickStep
+{
+    Price abovePrice;
+    int64_t tickUnits;
+};
+
+// Price and amount scale of one instrument and its tick and lot rules, from public/get_instruments.
+// Prices are counted in 10^-priceDecimals units, amounts in 10^-amountDecimals units, with decimals
+// just fine enough for the tick and lot sizes: BTC-PERPETUAL (tick 0.5, lot 10) has priceDecimals 1,
+// tickUnits 5, amountDecimals 0 and lotUnits 10.
+struct InstrumentSpec
+{
+    std::string name;
+    int priceDecimals = 0;
+    int64_t tickUnits = 1;
+    std::vector<TickStep> tickSteps; // ascending abovePrice
+    int amountDecimals = 0;
+    int64_t lotUnits = 1; // min_trade_amount; amounts are multiples of it
+
+    int64_t tickAt(Price price) const
+    {
+        int64_t tick = tickUnits;
+        for (const TickStep &step : tickSteps)
+        {
+            if (price <= step.abovePrice)
+                break;
+            tick = step.tickUnits;
+        }
+        return tick;
+    }
+    Price roundPrice(Price price, Rounding rounding) const
+    {
+        return Price(UtilityNamespace::roundToStep(price.units(), tickAt(price), rounding));
+    }
+    bool onTick(Price price) const { return price.units() % tickAt(price) == 0; }
+    // position on the ladder of the base tick, so books can be arrays indexed by price
+    int64_t tickIndex(Price price) const { return UtilityNamespace::roundToStep(price.units(), tickUnits, Rounding::Down) / tickUnits; }
+    Price tickPrice(int64_t index) const { return Price(index * tickUnits); }
+
+    Quantity roundAmount(Quantity amount, Rounding rounding) const
+    {
+        return Quantity(UtilityNamespace::roundToStep(amount.units(), lotUnits, rounding));
+    }
+    bool validAmount(Quantity amount) const { return amount.units() > 0 && amount.units() % lotUnits == 0; }
+
+    // nearest unit of the scale, not yet on tick or lot; false for NaN, infinities and out of range values
+    bool toPrice(double value, Price &price) const
+    {
+        int64_t units;
+        if (!toUnits(value, priceDecimals, units))
+            return false;
+        price = Price(units);
+        return true;
+    }
+    bool toAmount(double value, Quantity &amount) const
+    {
+        int64_t units;
+        if (!toUnits(value, amountDecimals, units))
+            return false;
+        amount = Quantity(units);
+        return true;
+    }
+    double toDouble(Price price) const { return static_cast<double>(price.units()) / std::pow(10.0, priceDecimals); }
+    double toDouble(Quantity amount) const { return static_cast<double>(amount.units()) / std::pow(10.0, amountDecimals); }
+
+    // exact text conversion; parsing fails for digits finer than the scale rather than rounding them
+    bool parsePrice(std::string_view text, Price &price) const
+    {
+        int64_t units;
+        if (!UtilityNamespace::parseDecimal(text, priceDecimals, units))
+            return false;
+        price = Price(units);
+        return true;
+    }
+    bool parseAmount(std::string_view text, Quantity &amount) const
+    {
+        int64_t units;
+        if (!UtilityNamespace::parseDecimal(text, amountDecimals, units))
+            return false;
+        amount = Quantity(units);
+        return true;
+    }
+    template <class String>
+    void appendPrice(String &out, Price price) const { UtilityNamespace::appendDecimal(out, price.units(), priceDecimals); }
+    template <class String>
+    void appendAmount(String &out, Quantity amount) const { UtilityNamespace::appendDecimal(out, amount.units(), amountDecimals); }
+
+private:
+    static bool toUnits(double value, int decimals, int64_t &units)
+    {
+        double scaled = std::round(value * std::pow(10.0, decimals));
+        if (!(std::fabs(scaled) < 9.2e18))
+            return false;
+        units = static_cast<int64_t>(scaled);
+        return true;
+    }
+};
+
+// Instrument specs by name. Fill it before trading starts; lookups are read-only and thread safe.
+class InstrumentTable
+{
+public:
+    void add(InstrumentSpec spec);
+    // adds every instrument of a public/get_instruments reply and returns how many it added
+    size_t load(std::string_view reply);
+
+    const InstrumentSpec *find(std::string_view name) const;
+    size_t size() const { return specs.size(); }
+
+private:
+    std::map<std::string, InstrumentSpec, std::less<>> specs;
+};
+
+namespace UtilityNamespace
+{
+    // spec from get_instruments' number fields as the exchange wrote them; false if one is not a
+    // positive decimal. steps holds (above_price, tick_size) pairs
+    bool makeInstrumentSpec(std::string name, std::string_view tickSize, std::string_view minTradeAmount,
+                            const std::vector<std::pair<std::string_view, std::string_view>> &steps, InstrumentSpec &spec);
+}
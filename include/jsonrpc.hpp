@@ -0,0 +1,27 @@
+#pragma once
+
+#include <memory_resource>
+#include <string>
+#include <string_view>
+#include "instrument.hpp"
+
+// Direct JSON-RPC request writers for the order path. They append into a caller-owned (usually
+// arena-backed) buffer instead of building an nlohmann::json tree per request.
+namespace UtilityNamespace
+{
+    // instantiated for std::string and std::pmr::string
+    template <class String>
+    void appendJsonString(String &out, std::string_view value);
+    template <class String>
+    void appendJsonNumber(String &out, double value);
+
+    // private/buy or private/sell depending on side
+    void encodePlaceOrder(std::pmr::string &out, std::string_view side, std::string_view symbol, double amount, double price, std::string_view orderType);
+    void encodeCancelOrder(std::pmr::string &out, std::string_view orderId);
+    void encodeModifyOrder(std::pmr::string &out, std::string_view orderId, double amount, double price);
+
+    // fixed-point versions: the numbers are written exactly in the instrument's scale, without a
+    // double-to-shortest conversion
+    void encodePlaceOrder(std::pmr::string &out, std::string_view side, const InstrumentSpec &instrument, Quantity amount, Price price, std::string_view orderType);
+    void encodeModifyOrder(std::pmr::string &out, std::string_view orderId, const InstrumentSpec &instrument, Quantity amount, Price price);
+}
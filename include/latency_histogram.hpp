@@ -0,0 +1,117 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <ostream>
+#include <string>
+
+// Log-linear histogram (16 sub-buckets per power of two, ~6% resolution) over non-negative
+// nanosecond values. record() is a few relaxed atomic adds, so any thread may record.
+class LatencyHistogram
+{
+public:
+    static constexpr int SUB_BITS = 4;
+    static constexpr int SUB_BUCKETS = 1 << SUB_BITS;
+    static constexpr int BUCKETS = (64 - SUB_BITS + 1) * SUB_BUCKETS;
+
+    LatencyHistogram() { reset(); }
+
+    void record(int64_t value)
+    {
+        uint64_t v = value < 0 ? 0 : static_cast<uint64_t>(value);
+        counts[indexOf(v)].fetch_add(1, std::memory_order_relaxed);
+        total.fetch_add(1, std::memory_order_relaxed);
+        sum.fetch_add(v, std::memory_order_relaxed);
+        uint64_t currentMax = maxValue.load(std::memory_order_relaxed);
+        while (v > currentMax && !maxValue.compare_exchange_weak(currentMax, v, std::memory_order_relaxed))
+        {
+        }
+    }
+
+    void reset()
+    {
+        for (auto &count : counts)
+            count.store(0, std::memory_order_relaxed);
+        total.store(0, std::memory_order_relaxed);
+        sum.store(0, std::memory_order_relaxed);
+        maxValue.store(0, std::memory_order_relaxed);
+    }
+
+    // adds other's samples, e.g. to fold per-thread histograms into one for reading
+    void merge(const LatencyHistogram &other)
+    {
+        for (int i = 0; i < BUCKETS; ++i)
+        {
+            uint64_t n = other.counts[i].load(std::memory_order_relaxed);
+            if (n)
+                counts[i].fetch_add(n, std::memory_order_relaxed);
+        }
+        total.fetch_add(other.total.load(std::memory_order_relaxed), std::memory_order_relaxed);
+        sum.fetch_add(other.sum.load(std::memory_order_relaxed), std::memory_order_relaxed);
+        uint64_t otherMax = other.max();
+        uint64_t currentMax = maxValue.load(std::memory_order_relaxed);
+        while (otherMax > currentMax && !maxValue.compare_exchange_weak(currentMax, otherMax, std::memory_order_relaxed))
+        {
+        }
+    }
+
+    uint64_t count() const { return total.load(std::memory_order_relaxed); }
+    uint64_t max() const { return maxValue.load(std::memory_order_relaxed); }
+    double mean() const
+    {
+        uint64_t n = count();
+        return n ? static_cast<double>(sum.load(std::memory_order_relaxed)) / n : 0.0;
+    }
+
+    // upper bound of the bucket holding the p-th fraction (0..1) of samples
+    uint64_t percentile(double p) const
+    {
+        uint64_t n = count();
+        if (n == 0)
+            return 0;
+        uint64_t rank = static_cast<uint64_t>(p * n);
+        rank = std::min(std::max<uint64_t>(rank, 1), n);
+        uint64_t seen = 0;
+        for (int i = 0; i < BUCKETS; ++i)
+        {
+            seen += counts[i].load(std::memory_order_relaxed);
+            if (seen >= rank)
+                return std::min(upperBound(i), max());
+        }
+        return max();
+    }
+
+    // one line summary in microseconds
+    void print(std::ostream &out, const std::string &name) const
+    {
+        out << name << ": n=" << count() << " mean=" << mean() / 1000.0 << "us p50=" << percentile(0.50) / 1000.0
+            << "us p99=" << percentile(0.99) / 1000.0 << "us p99.9=" << percentile(0.999) / 1000.0
+            << "us max=" << max() / 1000.0 << "us\n";
+    }
+
+    static int indexOf(uint64_t v)
+    {
+        if (v < SUB_BUCKETS)
+            return static_cast<int>(v);
+        int msb = 63 - __builtin_clzll(v);
+        int shift = msb - SUB_BITS;
+        return (shift + 1) * SUB_BUCKETS + static_cast<int>((v >> shift) & (SUB_BUCKETS - 1));
+    }
+
+    static uint64_t upperBound(int index)
+    {
+        if (index < SUB_BUCKETS)
+            return static_cast<uint64_t>(index);
+        int shift = index / SUB_BUCKETS - 1;
+        uint64_t sub = index % SUB_BUCKETS;
+        return ((SUB_BUCKETS + sub + 1) << shift) - 1;
+    }
+
+private:
+    std::array<std::atomic<uint64_t>, BUCKETS> counts;
+    std::atomic<uint64_t> total;
+    std::atomic<uint64_t> sum;
+    std::atomic<uint64_t> maxValue;
+};
@@ -0,0 +1,188 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <memory_resource>
+#include <vector>
+
+// Local feed protocol. Clients subscribe with
+//   {"action":"subscribe","symbol":S,"depth":N,"interval":"raw"|"100ms"|"1s"|ms}
+// where depth (top N levels per side, default 0 for the whole book) and interval (least time between
+// updates, default 10s; raw is every change the server sees) are optional. Intervals round up to the
+// server's 100ms poll tick. All clients asking for the same (symbol, depth, interval) share one stream,
+// and a client reads one stream per symbol, so subscribing again switches it. Server -> client, one
+// JSON object per frame:
+//   {"type":"snapshot","symbol":S,"seq":N,"depth":D,"interval_ms":I,"data":<get_order_book reply>,"recv_ns":R,"send_ns":T,"timestamp":ms}
+//   {"type":"update","symbol":S,"seq":N,"bids":[[price,amount],...],"asks":[...],"recv_ns":R,"send_ns":T,"timestamp":ms}
+// Depth-limited snapshots, and snapshots from server sources without a get_order_book reply (the
+// exchange stream, file replays), carry "bids" and "asks" like updates instead of "data".
+// seq increases by one per update and per stream; a snapshot carries the seq of the state it shows.
+// In updates an amount of 0 removes the level. Clients recover from a gap by sending
+//   {"action":"replay","symbol":S,"from_seq":N}   (answered from the server's replay ring, or a snapshot)
+//   {"action":"snapshot","symbol":S}                (when a replay has not closed the gap, see FeedSequencer)
+// Rejected and malformed requests are answered with {"type":"error","message":M}, as is a replay before
+// the stream's first book.
+// recv_ns (upstream reply received) and send_ns (frame published) are server steady clock ns. Clients
+// estimate the offset to their own clock with
+//   {"action":"ping","t0":ns}  ->  {"type":"pong","t0":ns,"t1":server receive ns,"t2":server send ns}
+// Clients that only need derived values send {"action":"subscribe_analytics","symbol":S} (and
+// unsubscribe_analytics) to get, once per book change and without the levels,
+//   {"type":"analytics","symbol":S,"seq":N,"best_bid","best_ask","mid","spread","spread_bps",
+//    "spread_mean_bps","spread_stddev_bps","microprice","imbalance","bid_depth","ask_depth",
+//    "vwap_buy","vwap_sell","fill_size","recv_ns","send_ns","timestamp"}
+// (fields as in BookAnalytics, book_analytics.hpp).
+
+struct BookLevel
+{
+    double price = 0.0;
+    double amount = 0.0;
+};
+
+class LocalOrderBook
+{
+public:
+    LocalOrderBook() = default;
+    // level nodes from resource, e.g. a pool over huge pages (MarketDataPipeline)
+    explicit LocalOrderBook(std::pmr::memory_resource *resource) : bids(resource), asks(resource) {}
+
+    void clear()
+    {
+        bids.clear();
+        asks.clear();
+    }
+
+    // amount 0 removes the level
+    void apply(bool bid, double price, double amount)
+    {
+        if (bid)
+            applyTo(bids, price, amount);
+        else
+            applyTo(asks, price, amount);
+    }
+
+    void copyLevels(std::vector<BookLevel> &bidLevels, std::vector<BookLevel> &askLevels) const
+    {
+        bidLevels.clear();
+        askLevels.clear();
+        for (const auto &level : bids)
+            bidLevels.push_back({level.first, level.second});
+        for (const auto &level : asks)
+            askLevels.push_back({level.first, level.second});
+    }
+
+    std::pmr::map<double, double, std::greater<double>> bids; // best first
+    std::pmr::map<double, double> asks;                       // best first
+
+private:
+    template <class Side>
+    static void applyTo(Side &side, double price, double amount)
+    {
+        if (amount == 0.0)
+            side.erase(price);
+        else
+            side[price] = amount;
+    }
+};
+
+enum class FrameAction
+{
+    Apply,   // next in sequence
+    Ignore,  // duplicate, stale, or waiting for recovery
+    Recover, // first frame after a gap, request a replay from expected()
+    Resync   // the replay never closed the gap, request a snapshot
+};
+
+// Tracks the per-symbol sequence of one feed and decides what to do with each update. A replay that
+// is lost or refused would leave the feed recovering forever, so after recoveryLimit further frames
+// past the gap the sequencer gives up on it and asks for a snapshot, and again every recoveryLimit frames.
+class FeedSequencer
+{
+public:
+    static constexpr uint64_t DEFAULT_RECOVERY_LIMIT = 64;
+
+    explicit FeedSequencer(uint64_t recoveryLimit = DEFAULT_RECOVERY_LIMIT) : recoveryLimit(recoveryLimit) {}
+
+    void onSnapshot(uint64_t seq)
+    {
+        next = seq + 1;
+        hasSnapshot = true;
+        recovering = false;
+    }
+
+    FrameAction onUpdate(uint64_t seq)
+    {
+        if (!hasSnapshot || seq < next)
+            return FrameAction::Ignore;
+        if (seq == next)
+        {
+            ++next;
+            recovering = false;
+            return FrameAction::Apply;
+        }
+        if (recovering)
+        {
+            if (++framesWhileRecovering < recoveryLimit)
+                return FrameAction::Ignore;
+            framesWhileRecovering = 0;
+            ++resyncCount;
+            return FrameAction::Resync;
+        }
+        recovering = true;
+        framesWhileRecovering = 0;
+        ++gapCount;
+        return FrameAction::Recover;
+    }
+
+    void reset()
+    {
+        hasSnapshot = false;
+        recovering = false;
+    }
+
+    uint64_t expected() const { return next; }
+    bool synced() const { return hasSnapshot && !recovering; }
+    uint64_t gaps() const { return gapCount; }
+    uint64_t resyncs() const { return resyncCount; }
+
+private:
+    uint64_t recoveryLimit;
+    uint64_t next = 0;
+    bool hasSnapshot = false;
+    bool recovering = false;
+    uint64_t framesWhileRecovering = 0;
+    uint64_t gapCount = 0;
+    uint64_t resyncCount = 0;
+};
+
+// book plus sequence state for one subscribed symbol
+struct SymbolFeed
+{
+    SymbolFeed() = default;
+    explicit SymbolFeed(std::pmr::memory_resource *resource) : book(resource) {}
+
+    // a snapshot replaces the book; update levels are applied only when the sequencer says Apply
+    FrameAction onFrame(bool snapshot, uint64_t seq, const std::vector<BookLevel> &bids, const std::vector<BookLevel> &asks)
+    {
+        FrameAction action = FrameAction::Apply;
+        if (snapshot)
+        {
+            book.clear();
+            sequencer.onSnapshot(seq);
+        }
+        else
+        {
+            action = sequencer.onUpdate(seq);
+            if (action != FrameAction::Apply)
+                return action;
+        }
+        for (const BookLevel &level : bids)
+            book.apply(true, level.price, level.amount);
+        for (const BookLevel &level : asks)
+            book.apply(false, level.price, level.amount);
+        return action;
+    }
+
+    LocalOrderBook book;
+    FeedSequencer sequencer;
+};
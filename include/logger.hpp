@@ -0,0 +1,313 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <type_traits>
+#include <vector>
+#include "clock.hpp"
+
+// Asynchronous logger for the I/O and order paths. A call copies the address of its format string (the
+// string's id, so only literals may be passed), a timestamp and the raw arguments into the calling
+// thread's ring; a background thread formats and writes them. The calling side never locks, allocates
+// or makes a system call, and a record that does not fit in a full ring is dropped and counted.
+//
+// Each {} in the format string takes the next argument: OEMS_LOG_INFO("Subscribed to: {}", symbol).
+// Arguments are numbers, chars and anything convertible to std::string_view. Levels below
+// OEMS_LOG_LEVEL compile to nothing, arguments included. Debug and info go to stdout, warn and error
+// to stderr, each line prefixed with the local time and level.
+
+#define OEMS_LOG_LEVEL_DEBUG 0
+#define OEMS_LOG_LEVEL_INFO 1
+#define OEMS_LOG_LEVEL_WARN 2
+#define OEMS_LOG_LEVEL_ERROR 3
+#define OEMS_LOG_LEVEL_OFF 4
+
+#ifndef OEMS_LOG_LEVEL
+#define OEMS_LOG_LEVEL OEMS_LOG_LEVEL_INFO
+#endif
+
+enum class LogLevel : uint8_t
+{
+    Debug,
+    Info,
+    Warn,
+    Error
+};
+
+// start of every record in a LogRing, followed by the encoded arguments
+struct LogRecordHeader
+{
+    uint32_t size;    // whole record, a multiple of 8
+    uint8_t level;    // a LogLevel, or PADDING for the filler in front of a wrap
+    uint8_t argCount;
+    uint16_t unused;
+    const char *format;
+    int64_t timestampNs; // steady clock
+    static constexpr uint8_t PADDING = 0xff;
+};
+
+// Byte ring between one thread that logs and the logger thread. Records are variable length and never
+// wrap: one that would is preceded by a padding record filling the rest of the ring.
+class LogRing
+{
+public:
+    explicit LogRing(size_t capacity)
+        : capacity(roundUp(capacity)), mask(this->capacity - 1), data(new std::byte[this->capacity])
+    {
+    }
+    LogRing(const LogRing &) = delete;
+    LogRing &operator=(const LogRing &) = delete;
+
+    // contiguous space for size bytes (a multiple of 8), nullptr when the ring is full
+    std::byte *reserve(size_t size)
+    {
+        const size_t pos = tail.load(std::memory_order_relaxed);
+        const size_t offset = pos & mask;
+        const size_t pad = offset + size > capacity ? capacity - offset : 0;
+        if (pos + pad + size - cachedHead > capacity)
+        {
+            cachedHead = head.load(std::memory_order_acquire);
+            if (pos + pad + size - cachedHead > capacity)
+                return nullptr;
+        }
+        if (pad == 0)
+            return data.get() + offset;
+        const uint32_t padSize = static_cast<uint32_t>(pad);
+        std::memcpy(data.get() + offset, &padSize, sizeof(padSize));
+        data[offset + offsetof(LogRecordHeader, level)] = std::byte{LogRecordHeader::PADDING};
+        tail.store(pos + pad, std::memory_order_release);
+        return data.get();
+    }
+
+    // publishes the record written into the last reserve()
+    void commit(size_t size) { tail.store(tail.load(std::memory_order_relaxed) + size, std::memory_order_release); }
+
+    // logger thread only: calls onRecord for every published record and frees them, returns how many
+    template <class F>
+    size_t drain(F &&onRecord)
+    {
+        size_t pos = head.load(std::memory_order_relaxed);
+        const size_t end = tail.load(std::memory_order_acquire);
+        size_t records = 0;
+        while (pos != end)
+        {
+            const std::byte *record = data.get() + (pos & mask);
+            uint32_t size;
+            std::memcpy(&size, record, sizeof(size));
+            if (record[offsetof(LogRecordHeader, level)] != std::byte{LogRecordHeader::PADDING})
+            {
+                onRecord(record);
+                ++records;
+            }
+            pos += size;
+        }
+        head.store(pos, std::memory_order_release);
+        return records;
+    }
+
+    bool empty() const { return head.load(std::memory_order_acquire) == tail.load(std::memory_order_acquire); }
+
+    std::atomic<uint64_t> dropped{0}; // written by the producer only
+    uint64_t reportedDrops = 0;       // logger thread only
+    std::atomic<bool> retired{false}; // the producer thread has exited
+
+private:
+    static size_t roundUp(size_t value)
+    {
+        size_t result = 64;
+        while (result < value)
+            result <<= 1;
+        return result;
+    }
+
+    alignas(64) std::atomic<size_t> tail{0};
+    size_t cachedHead = 0;
+    alignas(64) std::atomic<size_t> head{0};
+    alignas(64) const size_t capacity;
+    const size_t mask;
+    std::unique_ptr<std::byte[]> data;
+};
+
+// how log arguments are laid out in a record: a tag byte, then the value
+namespace LogArgs
+{
+    enum Tag : uint8_t
+    {
+        Int,
+        Unsigned,
+        Double,
+        Bool,
+        Char,
+        String,
+        TruncatedString
+    };
+
+    constexpr size_t MAX_STRING = 1024; // longer strings, e.g. whole replies, are cut here
+
+    template <class T>
+    size_t encodedSize(const T &value)
+    {
+        using U = std::decay_t<T>;
+        if constexpr (std::is_same_v<U, bool> || std::is_same_v<U, char>)
+            return 2;
+        else if constexpr (std::is_arithmetic_v<U> || std::is_enum_v<U>)
+            return 1 + 8;
+        else
+        {
+            static_assert(std::is_convertible_v<const T &, std::string_view>, "log arguments are numbers, chars and strings");
+            return 1 + 4 + std::min(std::string_view(value).size(), MAX_STRING);
+        }
+    }
+
+    template <class T>
+    void encode(std::byte *&out, const T &value)
+    {
+        using U = std::decay_t<T>;
+        if constexpr (std::is_same_v<U, bool> || std::is_same_v<U, char>)
+        {
+            out[0] = std::byte{std::is_same_v<U, bool> ? Bool : Char};
+            out[1] = static_cast<std::byte>(value);
+            out += 2;
+        }
+        else if constexpr (std::is_arithmetic_v<U> || std::is_enum_v<U>)
+        {
+            if constexpr (std::is_floating_point_v<U>)
+            {
+                const double v = static_cast<double>(value);
+                out[0] = std::byte{Double};
+                std::memcpy(out + 1, &v, 8);
+            }
+            else if constexpr (std::is_enum_v<U> || std::is_signed_v<U>)
+            {
+                const int64_t v = static_cast<int64_t>(value);
+                out[0] = std::byte{Int};
+                std::memcpy(out + 1, &v, 8);
+            }
+            else
+            {
+                const uint64_t v = static_cast<uint64_t>(value);
+                out[0] = std::byte{Unsigned};
+                std::memcpy(out + 1, &v, 8);
+            }
+            out += 1 + 8;
+        }
+        else
+        {
+            const std::string_view text(value);
+            const uint32_t length = static_cast<uint32_t>(std::min(text.size(), MAX_STRING));
+            out[0] = std::byte{text.size() > MAX_STRING ? TruncatedString : String};
+            std::memcpy(out + 1, &length, 4);
+            std::memcpy(out + 5, text.data(), length);
+            out += 5 + length;
+        }
+    }
+}
+
+// receives each batch of formatted lines: debug and info in out, warnings, errors and drop notices in err
+using LogSink = std::function<void(const std::string &out, const std::string &err)>;
+
+class Logger
+{
+public:
+    static constexpr size_t RING_BYTES = 64 * 1024; // per logging thread
+
+    // writes to stdout and stderr from a background thread
+    Logger();
+    // writes to sink only on flush() and destruction, e.g. in tests. A thread's ring belongs to the
+    // first logger it writes to, so log to this one from threads that log nowhere else
+    explicit Logger(LogSink sink, size_t ringBytes = RING_BYTES);
+    // stops the background thread and writes what is left
+    ~Logger();
+    Logger(const Logger &) = delete;
+    Logger &operator=(const Logger &) = delete;
+
+    template <class... Args>
+    void write(LogLevel level, const char *format, const Args &...args)
+    {
+        size_t size = sizeof(LogRecordHeader) + (size_t{0} + ... + LogArgs::encodedSize(args));
+        size = (size + 7) & ~size_t{7};
+        LogRing &ring = threadRing();
+        std::byte *out = ring.reserve(size);
+        if (!out)
+        {
+            ring.dropped.store(ring.dropped.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+            return;
+        }
+        const LogRecordHeader header{static_cast<uint32_t>(size), static_cast<uint8_t>(level), static_cast<uint8_t>(sizeof...(Args)), 0, format, UtilityNamespace::steadyNowNs()};
+        std::memcpy(out, &header, sizeof(header));
+        [[maybe_unused]] std::byte *cursor = out + sizeof(header);
+        (LogArgs::encode(cursor, args), ...);
+        ring.commit(size);
+    }
+
+    // formats and writes everything logged so far from the calling thread, e.g. before exiting
+    void flush();
+
+private:
+    struct RingHandle
+    {
+        std::shared_ptr<LogRing> ring;
+        ~RingHandle();
+    };
+
+    LogRing &threadRing()
+    {
+        thread_local RingHandle handle; // registered on first use, retired when the thread exits
+        if (!handle.ring)
+            handle.ring = addRing();
+        return *handle.ring;
+    }
+
+    std::shared_ptr<LogRing> addRing();
+    void run();
+    size_t drainAll();
+
+    std::mutex ringsMutex; // guards rings
+    std::vector<std::shared_ptr<LogRing>> rings;
+    std::mutex drainMutex; // one consumer at a time: the logger thread or flush()
+    int64_t wallOffsetNs;  // wall clock minus steady clock at start
+    LogSink sink;
+    const size_t ringBytes;
+    std::atomic<bool> stopping{false};
+    std::thread thread;
+};
+
+namespace UtilityNamespace
+{
+    // the process-wide logger, never destroyed so threads may log during exit; flushed at exit
+    inline Logger &logger()
+    {
+        static Logger *instance = new Logger();
+        return *instance;
+    }
+}
+
+#if OEMS_LOG_LEVEL <= OEMS_LOG_LEVEL_DEBUG
+#define OEMS_LOG_DEBUG(...) UtilityNamespace::logger().write(LogLevel::Debug, __VA_ARGS__)
+#else
+#define OEMS_LOG_DEBUG(...) ((void)0)
+#endif
+#if OEMS_LOG_LEVEL <= OEMS_LOG_LEVEL_INFO
+#define OEMS_LOG_INFO(...) UtilityNamespace::logger().write(LogLevel::Info, __VA_ARGS__)
+#else
+#define OEMS_LOG_INFO(...) ((void)0)
+#endif
+#if OEMS_LOG_LEVEL <= OEMS_LOG_LEVEL_WARN
+#define OEMS_LOG_WARN(...) UtilityNamespace::logger().write(LogLevel::Warn, __VA_ARGS__)
+#else
+#define OEMS_LOG_WARN(...) ((void)0)
+#endif
+#if OEMS_LOG_LEVEL <= OEMS_LOG_LEVEL_ERROR
+#define OEMS_LOG_ERROR(...) UtilityNamespace::logger().write(LogLevel::Error, __VA_ARGS__)
+#else
+#define OEMS_LOG_ERROR(...) ((void)0)
+#endif
@@ -0,0 +1,107 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <memory_resource>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+#include <simdjson.h>
+#include "feed_decoder.hpp"
+#include "local_book.hpp"
+#include "memory_placement.hpp"
+#include "order_manager.hpp"
+#include "ring_buffer.hpp"
+
+class SimulatedVenue;
+
+struct RawMarketMessage
+{
+    std::string payload;
+    int64_t receivedNs = 0;
+};
+
+struct BookUpdate
+{
+    std::string symbol;
+    std::vector<BookLevel> bids;
+    std::vector<BookLevel> asks;
+    int64_t receivedNs = 0;
+    int64_t builtNs = 0;
+};
+
+struct OrderIntent
+{
+    std::string symbol;
+    std::string side; // buy or sell
+    std::string orderType;
+    double amount = 0.0;
+    double price = 0.0;
+    int64_t receivedNs = 0; // when the market data that triggered it arrived
+};
+
+// Market data -> book building -> strategy -> order submission, one thread per stage connected by
+// bounded lock-free queues. Any number of feed threads may call submit().
+class MarketDataPipeline
+{
+public:
+    // fills the intent and returns true when the book should trigger an order
+    using Strategy = std::function<bool(const BookUpdate &, OrderIntent &)>;
+    using OrderCallback = std::function<void(const OrderIntent &, const std::string &response, int64_t tickToOrderNs)>;
+    // called from the book thread when a sequence gap is found, should ask the feed for a replay from
+    // fromSeq, or for a snapshot when fromSeq is 0 because an earlier replay did not close the gap
+    using RecoveryHandler = std::function<void(const std::string &symbol, uint64_t fromSeq)>;
+
+    // placement covers the queues and, when set, the book nodes, which then come from a pool on the book thread
+    MarketDataPipeline(OrderManager &orderManager, Strategy strategy, size_t queueCapacity = 1024,
+                       const MemoryPlacement &placement = UtilityNamespace::memoryPlacement());
+    ~MarketDataPipeline();
+
+    void setOrderCallback(OrderCallback callback);
+    void setRecoveryHandler(RecoveryHandler handler);
+    // cpu ids for the book, strategy and order threads, -1 leaves a thread unpinned
+    void start(int bookCpu = -1, int strategyCpu = -1, int orderCpu = -1);
+    void stop();
+    // returns false when the intake queue is full or the pipeline stopped, and the message was dropped
+    bool submit(std::string payload);
+
+    uint64_t droppedMessages() const { return dropped.load(std::memory_order_relaxed); }
+
+private:
+    void bookLoop();
+    void strategyLoop();
+    void orderLoop();
+    bool buildBook(RawMarketMessage &message, BookUpdate &book);
+
+    OrderManager &orderManager;
+    Strategy strategy;
+    OrderCallback orderCallback;
+    RecoveryHandler recoveryHandler;
+    MemoryPlacement placement;
+
+    MpscRingBuffer<RawMarketMessage, BlockingWait> rawQueue;
+    SpscRingBuffer<BookUpdate, BlockingWait> bookQueue;
+    SpscRingBuffer<OrderIntent, BlockingWait> orderQueue;
+
+    simdjson::ondemand::parser parser; // owned by the book thread
+    FeedFrame frame;                   // owned by the book thread
+    std::unique_ptr<PlacedArena> bookMemory;                          // owned by the book thread
+    std::unique_ptr<std::pmr::unsynchronized_pool_resource> bookPool; // over bookMemory, recycles level nodes
+    std::unordered_map<std::string, SymbolFeed> feeds; // owned by the book thread
+    std::vector<std::thread> threads;
+    std::atomic<bool> running;
+    std::atomic<uint64_t> dropped;
+};
+
+namespace UtilityNamespace
+{
+    // One-shot trigger for the pipeline: a limit order for amount at limitPrice once the opposite best
+    // price on symbol reaches it (best ask <= limit for a buy, best bid >= limit for a sell)
+    MarketDataPipeline::Strategy triggerStrategy(std::string symbol, std::string side, double amount, double limitPrice);
+    // hands every book to venue.onBook(), stamped with the wall clock, then asks next (if any) for an
+    // order, so paper orders match against the same books the strategy sees
+    MarketDataPipeline::Strategy simulatedVenueFeed(SimulatedVenue &venue, MarketDataPipeline::Strategy next = nullptr);
+}
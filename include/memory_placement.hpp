@@ -0,0 +1,114 @@
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <memory_resource>
+#include <vector>
+
+// Where the hot data structures (ring buffers, message arenas, book nodes) get their memory. The
+// default is the plain heap. Huge pages cut TLB misses on large books and queues. Binding to the
+// owner's NUMA node keeps them off the interconnect. Pre-faulting moves the page faults to startup.
+struct MemoryPlacement
+{
+    static constexpr int ANY_NODE = -1;    // wherever the kernel puts the first touch
+    static constexpr int CALLER_NODE = -2; // the node of the thread that allocates, i.e. the owner
+
+    bool hugePages = false; // MAP_HUGETLB from the reserved pool, else transparent huge pages (madvise)
+    int numaNode = ANY_NODE;
+    bool prefault = false; // touch every page when allocating
+
+    bool placed() const { return hugePages || numaNode != ANY_NODE || prefault; }
+};
+
+enum class PageKind
+{
+    Heap,            // operator new, no placement asked for
+    Normal,          // mmap with base pages
+    TransparentHuge, // madvise(MADV_HUGEPAGE) accepted; the kernel backs it with huge pages when it can
+    Huge             // MAP_HUGETLB
+};
+
+// Owning buffer of at least the bytes asked for, rounded up to whole (huge) pages when placed.
+// Throws std::bad_alloc when it cannot be mapped.
+class PlacedBuffer
+{
+public:
+    PlacedBuffer() = default;
+    PlacedBuffer(size_t bytes, const MemoryPlacement &placement, size_t alignment = alignof(std::max_align_t));
+    ~PlacedBuffer();
+    PlacedBuffer(PlacedBuffer &&other) noexcept;
+    PlacedBuffer &operator=(PlacedBuffer &&other) noexcept;
+    PlacedBuffer(const PlacedBuffer &) = delete;
+    PlacedBuffer &operator=(const PlacedBuffer &) = delete;
+
+    std::byte *data() const { return memory; }
+    size_t size() const { return length; }
+    PageKind pageKind() const { return kind; }
+    int node() const { return boundNode; } // ANY_NODE when not bound
+
+private:
+    void release();
+
+    std::byte *memory = nullptr;
+    size_t length = 0;
+    size_t alignment = alignof(std::max_align_t);
+    PageKind kind = PageKind::Heap;
+    int boundNode = MemoryPlacement::ANY_NODE;
+};
+
+// Fixed array of default-initialized T in a PlacedBuffer, for ring buffer slots
+template <class T>
+class PlacedArray
+{
+public:
+    PlacedArray(size_t count, const MemoryPlacement &placement)
+        : buffer(count * sizeof(T), placement, alignof(T)), count(count)
+    {
+        std::uninitialized_default_construct_n(data(), count);
+    }
+    ~PlacedArray() { std::destroy_n(data(), count); }
+    PlacedArray(const PlacedArray &) = delete;
+    PlacedArray &operator=(const PlacedArray &) = delete;
+
+    T &operator[](size_t index) const { return data()[index]; }
+    T *data() const { return reinterpret_cast<T *>(buffer.data()); }
+    size_t size() const { return count; }
+    const PlacedBuffer &memory() const { return buffer; }
+
+private:
+    PlacedBuffer buffer;
+    size_t count;
+};
+
+// Bump allocator over placed chunks for node-based containers, used through a pool resource that
+// recycles freed nodes (see MarketDataPipeline's books). The first chunk is mapped, and pre-faulted
+// if asked, in the constructor, so construct it on the owning thread at startup. Memory is returned
+// only on destruction. Single-threaded.
+class PlacedArena : public std::pmr::memory_resource
+{
+public:
+    explicit PlacedArena(const MemoryPlacement &placement, size_t chunkBytes = 2 * 1024 * 1024);
+
+    size_t reserved() const;
+    const std::vector<PlacedBuffer> &chunks() const { return mapped; }
+
+private:
+    void *do_allocate(size_t bytes, size_t alignment) override;
+    void do_deallocate(void *, size_t, size_t) override {}
+    bool do_is_equal(const std::pmr::memory_resource &other) const noexcept override { return this == &other; }
+
+    MemoryPlacement placement;
+    size_t chunkBytes;
+    std::vector<PlacedBuffer> mapped;
+    size_t offset = 0; // into mapped.back()
+};
+
+namespace UtilityNamespace
+{
+    // node of the CPU the calling thread runs on, 0 when unknown
+    int currentNumaNode();
+
+    // process-wide placement for thread arenas and pipelines; set at startup before they are created
+    void setMemoryPlacement(const MemoryPlacement &placement);
+    const MemoryPlacement &memoryPlacement();
+}
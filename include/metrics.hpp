@@ -0,0 +1,149 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+#include "latency_histogram.hpp"
+
+// Counters, gauges and latency histograms in the Prometheus text format. Metrics are registered once
+// (under a lock) and the returned references are updated from any thread without locks: every update
+// goes to the calling thread's shard, a cache line of its own, and a scrape sums the shards.
+
+static constexpr size_t METRIC_SHARDS = 16; // threads beyond this share shards, still lock-free
+
+// shard of the calling thread, handed out round robin
+inline size_t metricShard()
+{
+    static std::atomic<size_t> next{0};
+    thread_local size_t shard = next.fetch_add(1, std::memory_order_relaxed) % METRIC_SHARDS;
+    return shard;
+}
+
+// label name and value pairs, e.g. {{"method", "private/buy"}}
+using MetricLabels = std::vector<std::pair<std::string, std::string>>;
+
+class Counter
+{
+public:
+    void add(uint64_t n = 1) { shards[metricShard()].value.fetch_add(n, std::memory_order_relaxed); }
+    uint64_t value() const;
+
+private:
+    struct alignas(64) Shard
+    {
+        std::atomic<uint64_t> value{0};
+    };
+    std::array<Shard, METRIC_SHARDS> shards;
+};
+
+// a level that goes up and down; last write wins
+class Gauge
+{
+public:
+    void set(double v) { current.store(v, std::memory_order_relaxed); }
+    void add(double delta);
+    double value() const { return current.load(std::memory_order_relaxed); }
+
+private:
+    std::atomic<double> current{0.0};
+};
+
+// nanosecond values, exported as a summary with quantiles
+class Histogram
+{
+public:
+    void record(int64_t valueNs) { shards[metricShard()].record(valueNs); }
+    // the shards folded into out
+    void collect(LatencyHistogram &out) const;
+
+private:
+    std::array<LatencyHistogram, METRIC_SHARDS> shards;
+};
+
+class MetricsRegistry
+{
+public:
+    // the same name and labels always give the same metric; references stay valid for the registry's life
+    Counter &counter(const std::string &name, const std::string &help, const MetricLabels &labels = {});
+    Gauge &gauge(const std::string &name, const std::string &help, const MetricLabels &labels = {});
+    Histogram &histogram(const std::string &name, const std::string &help, const MetricLabels &labels = {});
+    // gauge read by calling sample at each scrape, for sizes owned by other objects; replaces an earlier
+    // sampled gauge with the same name and labels. The owner must removeSampled() before it goes away
+    void sampled(const std::string &name, const std::string &help, const MetricLabels &labels, std::function<double()> sample);
+    // the same for a total that only grows and is kept elsewhere, such as CPU time; exported as a counter
+    void sampledCounter(const std::string &name, const std::string &help, const MetricLabels &labels, std::function<double()> sample);
+    void removeSampled(const std::string &name, const MetricLabels &labels = {});
+
+    // every metric in the Prometheus text exposition format (version 0.0.4)
+    std::string render() const;
+
+private:
+    enum class Type
+    {
+        Counter,
+        Gauge,
+        Histogram
+    };
+
+    struct Entry
+    {
+        std::string labels; // rendered, e.g. method="private/buy"
+        Counter *counter = nullptr;
+        Gauge *gauge = nullptr;
+        Histogram *histogram = nullptr;
+        std::function<double()> sample;
+    };
+
+    struct Family
+    {
+        Type type;
+        std::string help;
+        std::vector<Entry> entries;
+    };
+
+    Entry &entry(const std::string &name, const std::string &help, Type type, const MetricLabels &labels);
+
+    mutable std::mutex mutex;
+    std::map<std::string, Family> families;
+    std::deque<Counter> counters; // deques never move their elements
+    std::deque<Gauge> gauges;
+    std::deque<Histogram> histograms;
+};
+
+// Serves GET /metrics from registry on address:port on its own thread, one request per connection.
+// Meant for a local scraper, so it binds loopback by default.
+class MetricsServer
+{
+public:
+    MetricsServer(MetricsRegistry &registry, uint16_t port, const std::string &address = "127.0.0.1");
+    ~MetricsServer();
+    MetricsServer(const MetricsServer &) = delete;
+    MetricsServer &operator=(const MetricsServer &) = delete;
+
+    // false when the port could not be bound; the reason was logged
+    bool listening() const { return listenFd >= 0; }
+
+private:
+    void serve();
+    void answer(int fd);
+
+    MetricsRegistry &registry;
+    int listenFd = -1;
+    std::atomic<bool> stopping{false};
+    std::thread thread;
+};
+
+namespace UtilityNamespace
+{
+    // the process-wide registry, created with process_cpu_seconds_total and process_resident_memory_bytes
+    MetricsRegistry &metrics();
+}
@@ -0,0 +1,137 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <new>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+// one option as named by the exchange, e.g. ETH-26SEP25-1900-C
+struct OptionContract
+{
+    std::string name;
+    std::string currency; // "ETH", "BTC", "XRP_USDC"
+    int64_t expiryMs = 0; // expiry date at 08:00 UTC, when the exchange settles
+    double strike = 0.0;
+    bool call = true;
+};
+
+// 64 byte aligned storage, so the first row of a column starts a cache line
+template <class T>
+struct CacheAlignedAllocator
+{
+    using value_type = T;
+    static constexpr std::size_t ALIGNMENT = 64;
+
+    CacheAlignedAllocator() = default;
+    template <class U>
+    CacheAlignedAllocator(const CacheAlignedAllocator<U> &) {}
+
+    T *allocate(std::size_t count) { return static_cast<T *>(::operator new(count * sizeof(T), std::align_val_t(ALIGNMENT))); }
+    void deallocate(T *memory, std::size_t) { ::operator delete(memory, std::align_val_t(ALIGNMENT)); }
+
+    template <class U>
+    bool operator==(const CacheAlignedAllocator<U> &) const { return true; }
+    template <class U>
+    bool operator!=(const CacheAlignedAllocator<U> &) const { return false; }
+};
+
+// Every option of one currency as columns, one row per option, sorted by expiry, strike, call before
+// put, so the Greeks kernels run over contiguous doubles. Quotes are in the currency, the way the
+// exchange quotes options (0.05 on ETH-26SEP25-1900-C is 0.05 ETH); computed values are in USD at
+// underlyingPrice. A row has NaN computed values when it has no two-sided quote, has expired or its
+// mid is outside the no-arbitrage bounds.
+struct OptionChain
+{
+    using Column = std::vector<double, CacheAlignedAllocator<double>>;
+
+    std::string currency;
+    std::vector<std::string> names;
+    Column expiryMs;   // ms since the epoch, exact in a double
+    Column strikes;
+    Column logStrikes; // ln(strike), kept with the strike so the kernels take no log
+    Column callPut;    // +1 call, -1 put
+    Column bids;       // best bid, 0 when there is none
+    Column asks;       // best ask, 0 when there is none
+
+    Column iv;    // of the mid, 0.65 for 65%
+    Column delta; // per unit of the underlying
+    Column gamma; // delta change per USD
+    Column vega;  // USD per volatility point
+    Column theta; // USD per calendar day
+    double underlyingPrice = 0.0; // the computed values are at this price and time
+    int64_t computedMs = 0;
+
+    size_t size() const { return names.size(); }
+    void clear();
+    // appends the contract or returns its row if it is there already; call sort() after adding
+    size_t add(const OptionContract &contract);
+    void sort();
+    // row of name, npos if it is not in the chain
+    size_t find(std::string_view name) const;
+    // false when name is not in the chain
+    bool setQuote(std::string_view name, double bid, double ask);
+
+    static constexpr size_t npos = static_cast<size_t>(-1);
+
+private:
+    std::map<std::string, size_t, std::less<>> rows;
+};
+
+// Splits a chain into blocks of rows and computes them on a fixed set of threads, the caller
+// included, so a chain of a few thousand options is repriced within one market data tick.
+class ChainCalculator
+{
+public:
+    // threads counts the caller; 0 uses every CPU
+    explicit ChainCalculator(size_t threads = 0, double rate = 0.0);
+    ~ChainCalculator();
+
+    ChainCalculator(const ChainCalculator &) = delete;
+    ChainCalculator &operator=(const ChainCalculator &) = delete;
+
+    // implied volatility and Greeks of every row; returns when all blocks are done
+    void compute(OptionChain &chain, double underlyingPrice, int64_t nowMs);
+    size_t threads() const { return workers.size() + 1; }
+
+    // below this many rows per thread the extra threads cost more than they save
+    static constexpr size_t MIN_ROWS_PER_THREAD = 64;
+
+private:
+    void workerLoop(size_t index);
+
+    double rate;
+    std::vector<std::thread> workers;
+    std::mutex mutex;
+    std::condition_variable wake;
+    std::condition_variable finished;
+    uint64_t generation = 0; // guarded by mutex
+    size_t blocks = 0;       // guarded by mutex, workers with a higher index sit the round out
+    size_t pending = 0;      // guarded by mutex
+    bool stopping = false;   // guarded by mutex
+    const std::function<void(size_t)> *job = nullptr; // runs block i, lives in compute()'s frame
+};
+
+namespace UtilityNamespace
+{
+    // CURRENCY-DMMMYY-STRIKE-C|P, strikes may use d as the decimal point (XRP_USDC-30MAY25-2d2-C)
+    bool parseOptionName(std::string_view name, OptionContract &contract);
+
+    // public/get_instruments?currency=..&kind=option reply; adds every option and returns how many
+    size_t loadOptionInstruments(OptionChain &chain, std::string_view reply);
+    // public/get_book_summary_by_currency?currency=..&kind=option reply: the bid and ask of every option
+    // of the chain in one request; returns how many rows it quoted, underlyingPrice gets the first
+    // underlying_price when non-null
+    size_t loadOptionQuotes(OptionChain &chain, std::string_view reply, double *underlyingPrice = nullptr);
+
+    // Black-76 implied volatility of the mid and Greeks for rows [begin, end), the forward being the
+    // underlying grown at rate to each expiry. SIMD (AVX2 when built with OEMS_NATIVE or -mavx2,
+    // SSE2 otherwise), every lane solved by safeguarded Newton from the inflection point at once.
+    void computeOptionGreeks(OptionChain &chain, size_t begin, size_t end, double underlyingPrice, int64_t nowMs, double rate = 0.0);
+}
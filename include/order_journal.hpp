@@ -0,0 +1,173 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+// Journal file layout: a sequence of records, each a fixed header followed by method bytes and body
+// bytes. The file is grown in segments and zero filled, so a zero sequence marks the end; a checksum
+// mismatch marks a torn write from a crash and everything from there on is discarded.
+enum class JournalRecordType : uint8_t
+{
+    Request = 1, // method (e.g. "private/buy") and JSON-RPC payload as sent
+    Ack = 2      // exchange reply for requestSequence, status 0 means the transport failed
+};
+
+struct JournalRecordHeader
+{
+    uint32_t length;          // method plus body bytes
+    uint32_t checksum;        // FNV-1a over sequence and the bytes after the header
+    uint64_t sequence;        // starts at 1, increases by one per record
+    uint64_t requestSequence; // acks: the request answered, requests: 0
+    int64_t timestampNs;      // wall clock
+    uint8_t type;
+    uint8_t status;
+    uint16_t methodLength;
+    uint32_t reserved;
+};
+static_assert(sizeof(JournalRecordHeader) == 40, "journal header layout is part of the file format");
+
+struct JournalRecord
+{
+    JournalRecordType type;
+    uint64_t sequence;
+    uint64_t requestSequence;
+    int64_t timestampNs;
+    bool ok;
+    std::string_view method;
+    std::string_view body;
+};
+
+enum class FsyncPolicy
+{
+    None,        // leave write back to the kernel, survives a process crash but not a power loss
+    EveryCommit, // msync each group before the next one is taken
+    Interval     // msync at most every syncInterval
+};
+
+struct JournalOptions
+{
+    FsyncPolicy fsync = FsyncPolicy::Interval;
+    std::chrono::milliseconds commitInterval{1};  // how long records may wait for their group
+    std::chrono::milliseconds syncInterval{50};   // FsyncPolicy::Interval
+    size_t groupBytes = 64 * 1024;                // wake the commit thread early past this much
+    size_t segmentBytes = 16 * 1024 * 1024;       // file growth step
+};
+
+// Append-only, memory-mapped journal of order requests and acknowledgements. Appends copy the record
+// into a pending buffer under a short lock and return; a background thread commits pending records
+// to the mapping in groups and syncs them according to the fsync policy.
+class OrderJournal
+{
+public:
+    // opens or creates the file and finds the end of the valid records
+    explicit OrderJournal(std::string path, JournalOptions options = JournalOptions());
+    // commits and syncs everything, then trims the preallocated tail
+    ~OrderJournal();
+    OrderJournal(const OrderJournal &) = delete;
+    OrderJournal &operator=(const OrderJournal &) = delete;
+
+    // returns the record's sequence, which the matching ack refers to. Throws std::runtime_error when the
+    // method is longer than 65535 bytes or the record longer than 4 GiB, which the header cannot hold
+    uint64_t appendRequest(std::string_view method, std::string_view payload);
+    void appendAck(uint64_t requestSequence, bool ok, std::string_view response);
+    // blocks until everything appended so far is committed and synced
+    void flush();
+
+    // visits committed records in order
+    void replay(const std::function<void(const JournalRecord &)> &visit) const;
+    // Rewrites the file with only the records keep() accepts, renumbered from 1, acks pointing at their
+    // request's new sequence (0 when it was dropped); returns how many were dropped. The records go to
+    // a temporary file that is synced and renamed over the journal, so a crash leaves the old or the new
+    // one. Nothing may be appended meanwhile
+    uint64_t compact(const std::function<bool(const JournalRecord &)> &keep);
+
+    const std::string &path() const { return filePath; }
+    uint64_t records() const { return recordCount.load(std::memory_order_relaxed); }
+    uint64_t commits() const { return commitCount.load(std::memory_order_relaxed); }
+    uint64_t syncs() const { return syncCount.load(std::memory_order_relaxed); }
+
+private:
+    uint64_t append(JournalRecordType type, uint64_t requestSequence, bool ok, std::string_view method, std::string_view body);
+    void recover();
+    void commitLoop();
+    void write(const std::vector<char> &group);
+    void ensureCapacity(size_t bytes);
+    void sync();
+
+    std::string filePath;
+    JournalOptions options;
+    int fd = -1;
+
+    mutable std::mutex mapMutex; // commit thread vs replay
+    char *map = nullptr;
+    size_t mappedBytes = 0;
+    size_t writeOffset = 0;
+    size_t syncedOffset = 0;
+    std::chrono::steady_clock::time_point lastSync;
+
+    std::mutex pendingMutex;
+    std::condition_variable commitReady;
+    std::condition_variable flushDone;
+    std::vector<char> pending;
+    std::vector<char> writing; // commit thread only, swapped with pending so both keep their capacity
+    uint64_t nextSequence = 1;
+    uint64_t flushRequested = 0;
+    uint64_t flushCompleted = 0;
+    bool running = true;
+    std::thread commitThread;
+
+    std::atomic<uint64_t> recordCount{0};
+    std::atomic<uint64_t> commitCount{0};
+    std::atomic<uint64_t> syncCount{0};
+};
+
+struct JournaledOrder
+{
+    std::string orderId;
+    std::string instrument;
+    std::string direction;
+    std::string state; // order_state from the latest reply
+    double price = 0.0;
+    double amount = 0.0;
+    double filledAmount = 0.0;
+    uint64_t lastSequence = 0;
+};
+
+struct JournaledRequest
+{
+    uint64_t sequence = 0;
+    int64_t timestampNs = 0;
+    std::string method;
+    std::string payload;
+};
+
+// outcome of matching the journal against the exchange's open orders after a restart
+struct ReconcileReport
+{
+    std::vector<JournaledOrder> open;      // open in the journal and at the exchange (exchange state wins)
+    std::vector<JournaledOrder> closed;    // open in the journal, gone from the exchange: filled or cancelled while down
+    std::vector<JournaledRequest> inDoubt; // requests without a reply, may or may not have reached the exchange
+    std::vector<JournaledOrder> unknown;   // open at the exchange but never journaled
+    bool exchangeRead = false;             // the open orders reply parsed; without it every open order looks closed
+    uint64_t records = 0;
+    int64_t elapsedNs = 0;
+};
+
+namespace UtilityNamespace
+{
+    // replays the journal into per-order state and matches it with a private/get_open_orders reply
+    ReconcileReport reconcileOrders(const OrderJournal &journal, const std::string &openOrdersResponse);
+    // Retention: the journal only grows while the process runs. After a reconciliation this keeps what
+    // the next one still needs, the requests in doubt and the latest reply (with its request) of every
+    // order still open, and returns how many records went. Nothing is dropped when the exchange's reply
+    // could not be read
+    uint64_t compactJournal(OrderJournal &journal, const ReconcileReport &report);
+}
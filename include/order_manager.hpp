@@ -1,11 +1,31 @@
 #pragma once
 
+#include <functional>
+#include <memory_resource>
 #include <string>
+#include <string_view>
 #include <vector>
 #include <nlohmann/json.hpp>
+#include "fixed_point.hpp"
+#include "instrument.hpp"
+#include "metrics.hpp"
+#include "order_journal.hpp"
+#include "order_venue.hpp"
+#include "session.hpp"
+
+// Order and account requests for one Session, or for any other OrderVenue such as a SimulatedVenue;
+// any number of managers may share a session or venue.
 class OrderManager
 {
 public:
+    using ResponseHandler = std::function<void(bool ok, const std::string &response)>;
+
+    static constexpr double ORDER_COST = 1.0; // rate-limit credits per order request
+    static constexpr double QUERY_COST = 1.0; // rate-limit credits per account or market data query
+
+    explicit OrderManager(Session &session);
+    explicit OrderManager(OrderVenue &venue);
+
     std::string placeOrder(const std::string &symbol, const std::string &type, double amount, double price, const std::string &orderType);
     std::string cancelOrder(const std::string &order_id);
     std::string modifyOrder(const std::string &order_id, double new_amount, double new_price);
@@ -13,4 +33,61 @@ public:
     std::string getCurrentPositions(const std::string &currency);
     std::string getOpenOrders();
     std::string getTradeHistory(const std::string &currency);
-};
\ No newline at end of file
+    // public/get_instruments for a currency ("any" for all), the input of InstrumentTable::load
+    std::string getInstruments(const std::string &currency);
+
+    // Allocation-free order path: request buffers come from threadArena() and the reply is appended to
+    // response, so callers wrap each order in an ArenaScope. Return false on transport errors.
+    bool placeOrder(const std::string &symbol, const std::string &type, double amount, double price, const std::string &orderType, std::pmr::string &response);
+    bool cancelOrder(const std::string &order_id, std::pmr::string &response);
+    bool modifyOrder(const std::string &order_id, double new_amount, double new_price, std::pmr::string &response);
+
+    // Fixed-point order path in the instrument's scale, on the same arena rules. Returns false without
+    // sending when the price is off tick or the amount is not a positive multiple of the lot.
+    bool placeOrder(const InstrumentSpec &instrument, const std::string &type, Quantity amount, Price price, const std::string &orderType, std::pmr::string &response);
+    bool modifyOrder(const InstrumentSpec &instrument, const std::string &order_id, Quantity new_amount, Price new_price, std::pmr::string &response);
+
+    // queued on the session's shared loop behind its rate limit; done runs on a loop thread
+    // (a SimulatedVenue runs them inline)
+    void placeOrderAsync(const std::string &symbol, const std::string &type, double amount, double price, const std::string &orderType, ResponseHandler done);
+    void cancelOrderAsync(const std::string &order_id, ResponseHandler done);
+    void modifyOrderAsync(const std::string &order_id, double new_amount, double new_price, ResponseHandler done);
+
+    // throws std::runtime_error when the manager sends to a venue other than a Session
+    Session &session() const;
+    OrderVenue &venue() const { return boundVenue; }
+    // journals every order request and its reply from now on; null turns journaling off
+    void setJournal(OrderJournal *journal) { this->journal = journal; }
+    // With a table, the double placeOrder calls snap the price and amount of its instruments to tick and
+    // lot: buy prices round down, sell prices up and amounts down, and an amount under one lot is not
+    // sent. Edits carry no instrument name and go out as given. Null turns it off
+    void setInstruments(const InstrumentTable *instruments) { this->instruments = instruments; }
+    const InstrumentTable *instrumentTable() const { return instruments; }
+
+private:
+    bool sendPlaceOrder(const std::string &symbol, const std::string &type, double amount, double price, const std::string &orderType, std::pmr::string &response, double cost);
+    bool sendPlaceOrder(const InstrumentSpec &instrument, const std::string &type, Quantity amount, Price price, const std::string &orderType, std::pmr::string &response, double cost);
+    bool sendCancelOrder(const std::string &order_id, std::pmr::string &response, double cost);
+    bool sendModifyOrder(const std::string &order_id, double new_amount, double new_price, std::pmr::string &response, double cost);
+    bool send(std::string_view path, std::string_view payload, std::pmr::string &response, double cost);
+    std::string request(std::string_view path, const std::string &payload);
+
+    OrderVenue &boundVenue;
+    Session *boundSession = nullptr;
+    OrderJournal *journal = nullptr;
+    const InstrumentTable *instruments = nullptr;
+};
+
+// per-method request metrics shared by every order API
+struct RequestMetrics
+{
+    Counter &requests;
+    Counter &failures;
+    Histogram &latency;
+};
+
+namespace UtilityNamespace
+{
+    // metrics labelled with the JSON-RPC method, or "other" for methods outside the order and account set
+    RequestMetrics &requestMetrics(std::string_view path);
+}
\ No newline at end of file
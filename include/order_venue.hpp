@@ -0,0 +1,19 @@
+#pragma once
+
+#include <functional>
+#include <memory_resource>
+#include <string_view>
+
+// Where an OrderManager sends its JSON-RPC requests: a Session for the exchange, or a SimulatedVenue
+// (simulated_venue.hpp) for paper trading. Replies have the exchange's shape either way.
+class OrderVenue
+{
+public:
+    virtual ~OrderVenue() = default;
+
+    // path is the method (e.g. "private/buy"), payload the whole JSON-RPC request; the reply is
+    // appended to response. Returns false on transport errors
+    virtual bool post(std::string_view path, std::string_view payload, std::pmr::string &response, double cost = 1.0) = 0;
+    // runs task once cost credits are available
+    virtual void submit(std::function<void()> task, double cost = 1.0) = 0;
+};
@@ -0,0 +1,280 @@
+#pragma once
+
+#include <websocketpp/client.hpp>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <future>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+#include "clock.hpp"
+#include "heartbeat.hpp"
+#include "logger.hpp"
+
+// The connection lifecycle every WebSocket client here shares: endpoints tried in turn with jittered
+// backoff, pings that drop a connection gone silent, and a stop() that lets the close handshake run
+// but never waits on a peer for longer than STOP_TIMEOUT. What goes over the connection is up to the
+// owner's handlers, which run on the I/O thread. Config is the websocketpp client config, whose
+// header comes first.
+template <class Config>
+class ReconnectingClient
+{
+public:
+    using Client = websocketpp::client<Config>;
+    using MessagePtr = typename Client::message_ptr;
+
+    static constexpr std::chrono::milliseconds STOP_TIMEOUT{2000}; // for the close handshake before the I/O is cut off
+
+    struct Handlers
+    {
+        // on every open; false when it closed the connection again, which keeps the backoff growing
+        std::function<bool(websocketpp::connection_hdl)> open;
+        // on every close and failed attempt, before the reconnect is scheduled
+        std::function<void(websocketpp::connection_hdl, bool wasConnected)> close;
+        std::function<void(websocketpp::connection_hdl, MessagePtr, int64_t receivedNs)> message;
+        std::function<void()> ping;                     // a WebSocket ping when not set
+        std::function<void()> silent;                   // the heartbeat timed out, the connection is dropped next
+        std::function<void(const std::string &)> error; // a warning in the log when not set
+    };
+
+    // name only goes into the messages
+    ReconnectingClient(std::string name, std::vector<std::string> endpoints, ReconnectOptions reconnect = ReconnectOptions(),
+                       HeartbeatOptions heartbeatOptions = HeartbeatOptions())
+        : name(std::move(name)), endpoints(std::move(endpoints)), backoff(reconnect), heartbeat(heartbeatOptions),
+          ioDone(ioFinished.get_future())
+    {
+        if (this->endpoints.empty())
+            throw std::runtime_error(this->name + " needs at least one endpoint");
+        // websocketpp logs to stdout by default
+        wsClient.clear_access_channels(websocketpp::log::alevel::all);
+        wsClient.clear_error_channels(websocketpp::log::elevel::all);
+        wsClient.init_asio();
+        wsClient.start_perpetual(); // keep run() alive between connections
+        wsClient.set_open_handler([this](websocketpp::connection_hdl hdl)
+                                { onOpen(hdl); });
+        wsClient.set_close_handler([this](websocketpp::connection_hdl hdl)
+                                 { onClose(hdl); });
+        wsClient.set_fail_handler([this](websocketpp::connection_hdl hdl)
+                                { onClose(hdl); });
+        wsClient.set_message_handler([this](websocketpp::connection_hdl hdl, MessagePtr msg)
+                                   {
+                                       int64_t receivedNs = UtilityNamespace::steadyNowNs();
+                                       heartbeat.onReceive(receivedNs);
+                                       if (handlers.message)
+                                           handlers.message(hdl, std::move(msg), receivedNs); });
+        wsClient.set_pong_handler([this](websocketpp::connection_hdl, std::string)
+                                { heartbeat.onReceive(UtilityNamespace::steadyNowNs()); });
+    }
+
+    ~ReconnectingClient()
+    {
+        stop();
+    }
+
+    ReconnectingClient(const ReconnectingClient &) = delete;
+    ReconnectingClient &operator=(const ReconnectingClient &) = delete;
+
+    // set before start(); the TLS and socket init handlers go on client() directly
+    void setHandlers(Handlers newHandlers) { handlers = std::move(newHandlers); }
+    // a server closing with going_away is draining and its successor listens on the same endpoint,
+    // so reconnect there at once instead of moving on; for our own server, not the exchange
+    void setFollowGoingAway(bool follow) { followGoingAway = follow; }
+
+    // runs the I/O on a thread of its own; first runs on it before the first connect
+    void start(std::function<void()> first = nullptr)
+    {
+        if (ioThread.joinable())
+            return;
+        ioThread = std::thread([this, first = std::move(first)]()
+                               { run(first); });
+    }
+
+    // runs the I/O on the calling thread until stop(); once per client
+    void run(const std::function<void()> &first = nullptr)
+    {
+        if (started.exchange(true))
+            return;
+        if (!stopped)
+        {
+            if (first)
+                first();
+            connect();
+            try
+            {
+                wsClient.run();
+            }
+            catch (const std::exception &e)
+            {
+                report(name + " I/O error: " + e.what());
+            }
+        }
+        ioFinished.set_value();
+    }
+
+    // from any thread but the I/O thread; closes the connection and waits for run() to return. A
+    // connection still opening is closed by onOpen, but a peer that never answers would keep run()
+    // going, so after STOP_TIMEOUT the I/O is stopped where it is
+    void stop()
+    {
+        if (stopped.exchange(true))
+            return;
+        wsClient.get_io_service().post([this]()
+                                     {
+                                         wsClient.stop_perpetual();
+                                         if (reconnectTimer)
+                                             reconnectTimer->cancel();
+                                         if (heartbeatTimer)
+                                             heartbeatTimer->cancel();
+                                         if (isConnected)
+                                         {
+                                             websocketpp::lib::error_code ec;
+                                             wsClient.close(hdl, websocketpp::close::status::going_away, "Stopping", ec);
+                                         } });
+        if (!started)
+        {
+            wsClient.stop(); // run() sees stopped, or returns at once
+        }
+        else if (ioDone.wait_for(STOP_TIMEOUT) != std::future_status::ready)
+        {
+            report(name + " did not close within " + std::to_string(STOP_TIMEOUT.count()) + " ms, stopping it");
+            wsClient.stop();
+        }
+        if (ioThread.joinable())
+            ioThread.join();
+        else if (started)
+            ioDone.wait();
+    }
+
+    Client &client() { return wsClient; }
+    // the open connection; I/O thread only
+    websocketpp::connection_hdl connection() const { return hdl; }
+    bool connected() const { return isConnected.load(std::memory_order_acquire); }
+    // true until stop(), also before start()
+    bool running() const { return !stopped.load(std::memory_order_acquire); }
+    const std::string &endpoint() const { return endpoints[endpointIndex]; }
+
+private:
+    void connect()
+    {
+        const std::string &uri = endpoint();
+        websocketpp::lib::error_code ec;
+        typename Client::connection_ptr con = wsClient.get_connection(uri, ec);
+        if (ec)
+        {
+            report("Cannot connect to " + uri + ": " + ec.message());
+            endpointIndex = (endpointIndex + 1) % endpoints.size();
+            scheduleReconnect();
+            return;
+        }
+        wsClient.connect(con);
+    }
+
+    // jittered exponential backoff, reset by a successful open
+    void scheduleReconnect()
+    {
+        reconnectTimer = wsClient.set_timer(backoff.next().count(), [this](const websocketpp::lib::error_code &ec)
+                                            {
+                                                if (!ec && running())
+                                                    connect(); });
+    }
+
+    // pings while connected; silence past the timeout means a dead peer or a half-open connection,
+    // which TCP alone would take minutes to report, so the connection is closed and onClose moves on
+    void scheduleHeartbeat()
+    {
+        if (!heartbeat.enabled())
+            return;
+        heartbeatTimer = wsClient.set_timer(heartbeat.interval().count(), [this](const websocketpp::lib::error_code &ec)
+                                            {
+                                                if (ec || !running() || !isConnected)
+                                                    return;
+                                                websocketpp::lib::error_code pingEc;
+                                                if (heartbeat.expired(UtilityNamespace::steadyNowNs()))
+                                                {
+                                                    if (handlers.silent)
+                                                        handlers.silent();
+                                                    report(name + " " + endpoint() + " went silent, reconnecting");
+                                                    // a dead peer never answers the close, so do not wait long for it
+                                                    typename Client::connection_ptr con = wsClient.get_con_from_hdl(hdl, pingEc);
+                                                    if (!pingEc)
+                                                    {
+                                                        con->set_close_handshake_timeout(heartbeat.interval().count());
+                                                        con->close(websocketpp::close::status::normal, "Heartbeat timeout", pingEc);
+                                                    }
+                                                    return;
+                                                }
+                                                if (handlers.ping)
+                                                    handlers.ping();
+                                                else
+                                                    wsClient.ping(hdl, "", pingEc);
+                                                scheduleHeartbeat(); });
+    }
+
+    void onOpen(websocketpp::connection_hdl opened)
+    {
+        if (!running())
+        {
+            // opened after stop(), which only closes a connection it saw
+            websocketpp::lib::error_code ec;
+            wsClient.close(opened, websocketpp::close::status::going_away, "Stopping", ec);
+            return;
+        }
+        hdl = opened;
+        isConnected = true;
+        heartbeat.onReceive(UtilityNamespace::steadyNowNs());
+        scheduleHeartbeat();
+        if (!handlers.open || handlers.open(opened))
+            backoff.reset();
+    }
+
+    // also the fail handler: a lost connection and a failed attempt both move on to the next endpoint
+    void onClose(websocketpp::connection_hdl closed)
+    {
+        if (heartbeatTimer)
+            heartbeatTimer->cancel();
+        bool wasConnected = isConnected.exchange(false);
+        if (handlers.close)
+            handlers.close(closed, wasConnected);
+        if (!running())
+            return;
+        websocketpp::lib::error_code ec;
+        typename Client::connection_ptr con = wsClient.get_con_from_hdl(closed, ec);
+        if (followGoingAway && !ec && con->get_remote_close_code() == websocketpp::close::status::going_away)
+        {
+            connect();
+            return;
+        }
+        endpointIndex = (endpointIndex + 1) % endpoints.size();
+        scheduleReconnect();
+    }
+
+    void report(const std::string &message)
+    {
+        if (handlers.error)
+            handlers.error(message);
+        else
+            OEMS_LOG_WARN("{}", message);
+    }
+
+    std::string name;
+    std::vector<std::string> endpoints;
+    Client wsClient;
+    Handlers handlers;
+    bool followGoingAway = false;
+    websocketpp::connection_hdl hdl;   // I/O thread only
+    ReconnectBackoff backoff;          // I/O thread only
+    HeartbeatMonitor heartbeat;        // I/O thread only
+    typename Client::timer_ptr reconnectTimer; // I/O thread only
+    typename Client::timer_ptr heartbeatTimer; // I/O thread only
+    std::atomic<size_t> endpointIndex{0};
+    std::atomic<bool> isConnected{false};
+    std::atomic<bool> started{false};
+    std::atomic<bool> stopped{false};
+    std::promise<void> ioFinished;
+    std::future<void> ioDone; // ready once run() returned
+    std::thread ioThread;
+};
@@ -0,0 +1,351 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include "memory_placement.hpp"
+
+constexpr size_t CACHE_LINE_SIZE = 64;
+
+inline void cpuRelax()
+{
+#if defined(__x86_64__) || defined(__i386__)
+    __builtin_ia32_pause();
+#elif defined(__aarch64__)
+    asm volatile("yield");
+#endif
+}
+
+inline size_t roundUpToPowerOfTwo(size_t value)
+{
+    size_t result = 1;
+    while (result < value)
+        result <<= 1;
+    return result;
+}
+
+// Wait strategies decide what a producer does on a full queue and what a consumer does on an
+// empty one. notify() is called after every publish so it has to be cheap when nobody waits.
+
+// lowest latency, burns a whole core per waiting thread
+struct BusySpinWait
+{
+    template <class Predicate>
+    void waitUntil(Predicate ready)
+    {
+        while (!ready())
+            cpuRelax();
+    }
+    void notify() {}
+};
+
+// spins for a while, then gives the core back to the scheduler
+struct YieldingWait
+{
+    template <class Predicate>
+    void waitUntil(Predicate ready)
+    {
+        for (int spins = 0; !ready(); ++spins)
+        {
+            if (spins < 1000)
+                cpuRelax();
+            else
+                std::this_thread::yield();
+        }
+    }
+    void notify() {}
+};
+
+// spins briefly, then sleeps on a condition variable; notify() only takes the lock when a waiter exists
+struct BlockingWait
+{
+    template <class Predicate>
+    void waitUntil(Predicate ready)
+    {
+        for (int spins = 0; spins < 200; ++spins)
+        {
+            if (ready())
+                return;
+            cpuRelax();
+        }
+        waiters.fetch_add(1, std::memory_order_seq_cst);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            condition.wait(lock, ready);
+        }
+        waiters.fetch_sub(1, std::memory_order_relaxed);
+    }
+
+    void notify()
+    {
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (waiters.load(std::memory_order_relaxed) == 0)
+            return;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+        }
+        condition.notify_all();
+    }
+
+private:
+    std::atomic<int> waiters{0};
+    std::mutex mutex;
+    std::condition_variable condition;
+};
+
+// Bounded single-producer/single-consumer queue. Each side caches the other side's index so the
+// shared cache lines are only touched when the cached view says the queue is full/empty.
+template <typename T, typename WaitStrategy = BusySpinWait>
+class SpscRingBuffer
+{
+public:
+    // placement of the slots, e.g. huge pages on the consumer's node; the heap by default
+    explicit SpscRingBuffer(size_t capacity, const MemoryPlacement &placement = MemoryPlacement())
+        : mask(roundUpToPowerOfTwo(capacity < 2 ? 2 : capacity) - 1), slots(mask + 1, placement)
+    {
+    }
+    SpscRingBuffer(const SpscRingBuffer &) = delete;
+    SpscRingBuffer &operator=(const SpscRingBuffer &) = delete;
+
+    template <class U>
+    bool tryPush(U &&value)
+    {
+        const size_t tail = producer.tail.load(std::memory_order_relaxed);
+        if (tail - producer.cachedHead > mask)
+        {
+            producer.cachedHead = consumer.head.load(std::memory_order_acquire);
+            if (tail - producer.cachedHead > mask)
+                return false;
+        }
+        slots[tail & mask] = std::forward<U>(value);
+        producer.tail.store(tail + 1, std::memory_order_release);
+        notEmpty.notify();
+        return true;
+    }
+
+    // waits for space, returns false once the queue is closed
+    template <class U>
+    bool push(U &&value)
+    {
+        if (closed.load(std::memory_order_acquire))
+            return false;
+        while (!tryPush(std::forward<U>(value)))
+        {
+            if (closed.load(std::memory_order_acquire))
+                return false;
+            notFull.waitUntil([this]()
+                              { return !full() || closed.load(std::memory_order_acquire); });
+        }
+        return true;
+    }
+
+    bool tryPop(T &out)
+    {
+        const size_t head = consumer.head.load(std::memory_order_relaxed);
+        if (head == consumer.cachedTail)
+        {
+            consumer.cachedTail = producer.tail.load(std::memory_order_acquire);
+            if (head == consumer.cachedTail)
+                return false;
+        }
+        out = std::move(slots[head & mask]);
+        consumer.head.store(head + 1, std::memory_order_release);
+        notFull.notify();
+        return true;
+    }
+
+    // waits for an element, returns false once the queue is closed and drained
+    bool pop(T &out)
+    {
+        while (!tryPop(out))
+        {
+            if (closed.load(std::memory_order_acquire) && empty())
+                return false;
+            notEmpty.waitUntil([this]()
+                               { return !empty() || closed.load(std::memory_order_acquire); });
+        }
+        return true;
+    }
+
+    // wakes every waiter; later pushes fail and pops drain what is left
+    void close()
+    {
+        closed.store(true, std::memory_order_release);
+        notEmpty.notify();
+        notFull.notify();
+    }
+
+    bool empty() const
+    {
+        return producer.tail.load(std::memory_order_acquire) == consumer.head.load(std::memory_order_acquire);
+    }
+    bool full() const
+    {
+        return producer.tail.load(std::memory_order_acquire) - consumer.head.load(std::memory_order_acquire) > mask;
+    }
+    size_t size() const
+    {
+        return producer.tail.load(std::memory_order_acquire) - consumer.head.load(std::memory_order_acquire);
+    }
+    size_t capacity() const { return mask + 1; }
+
+private:
+    struct alignas(CACHE_LINE_SIZE) ProducerSide
+    {
+        std::atomic<size_t> tail{0};
+        size_t cachedHead = 0;
+    };
+    struct alignas(CACHE_LINE_SIZE) ConsumerSide
+    {
+        std::atomic<size_t> head{0};
+        size_t cachedTail = 0;
+    };
+
+    ProducerSide producer;
+    ConsumerSide consumer;
+    alignas(CACHE_LINE_SIZE) const size_t mask;
+    PlacedArray<T> slots;
+    std::atomic<bool> closed{false};
+    WaitStrategy notEmpty;
+    WaitStrategy notFull;
+};
+
+// Bounded multi-producer/single-consumer queue (Vyukov style). Every slot carries a sequence number
+// so producers only contend on the tail counter and never on each other's slots.
+template <typename T, typename WaitStrategy = BusySpinWait>
+class MpscRingBuffer
+{
+public:
+    explicit MpscRingBuffer(size_t capacity, const MemoryPlacement &placement = MemoryPlacement())
+        : mask(roundUpToPowerOfTwo(capacity < 2 ? 2 : capacity) - 1), slots(mask + 1, placement)
+    {
+        for (size_t i = 0; i <= mask; ++i)
+            slots[i].sequence.store(i, std::memory_order_relaxed);
+    }
+    MpscRingBuffer(const MpscRingBuffer &) = delete;
+    MpscRingBuffer &operator=(const MpscRingBuffer &) = delete;
+
+    // fails when full and once the queue is closed; a push that got in before close() is still
+    // popped, the consumer waits for it
+    template <class U>
+    bool tryPush(U &&value)
+    {
+        pushing.fetch_add(1);
+        if (closed.load())
+        {
+            pushing.fetch_sub(1, std::memory_order_release);
+            return false;
+        }
+        size_t pos = tail.load(std::memory_order_relaxed);
+        Slot *slot;
+        while (true)
+        {
+            slot = &slots[pos & mask];
+            const size_t sequence = slot->sequence.load(std::memory_order_acquire);
+            const intptr_t diff = static_cast<intptr_t>(sequence) - static_cast<intptr_t>(pos);
+            if (diff == 0)
+            {
+                if (tail.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+                    break;
+            }
+            else if (diff < 0)
+            {
+                pushing.fetch_sub(1, std::memory_order_release);
+                return false; // full
+            }
+            else
+            {
+                pos = tail.load(std::memory_order_relaxed);
+            }
+        }
+        slot->value = std::forward<U>(value);
+        slot->sequence.store(pos + 1, std::memory_order_release);
+        pushing.fetch_sub(1, std::memory_order_release);
+        notEmpty.notify();
+        return true;
+    }
+
+    template <class U>
+    bool push(U &&value)
+    {
+        if (closed.load(std::memory_order_acquire))
+            return false;
+        while (!tryPush(std::forward<U>(value)))
+        {
+            if (closed.load(std::memory_order_acquire))
+                return false;
+            notFull.waitUntil([this]()
+                              { return !full() || closed.load(std::memory_order_acquire); });
+        }
+        return true;
+    }
+
+    // consumer side, must only be called from one thread
+    bool tryPop(T &out)
+    {
+        Slot &slot = slots[head & mask];
+        if (slot.sequence.load(std::memory_order_acquire) != head + 1)
+            return false;
+        out = std::move(slot.value);
+        slot.sequence.store(head + mask + 1, std::memory_order_release);
+        ++head;
+        consumerHead.store(head, std::memory_order_release);
+        notFull.notify();
+        return true;
+    }
+
+    // waits for an element, returns false once the queue is closed, drained and no push is in flight
+    bool pop(T &out)
+    {
+        while (!tryPop(out))
+        {
+            if (closed.load() && pushing.load() == 0 && empty())
+                return false;
+            notEmpty.waitUntil([this]()
+                               { return !empty() || closed.load(std::memory_order_acquire); });
+        }
+        return true;
+    }
+
+    // wakes every waiter; later pushes fail and pops drain what is left
+    void close()
+    {
+        closed.store(true);
+        notEmpty.notify();
+        notFull.notify();
+    }
+
+    bool empty() const
+    {
+        const size_t current = consumerHead.load(std::memory_order_acquire);
+        return slots[current & mask].sequence.load(std::memory_order_acquire) != current + 1;
+    }
+    bool full() const
+    {
+        return tail.load(std::memory_order_acquire) - consumerHead.load(std::memory_order_acquire) > mask;
+    }
+    size_t capacity() const { return mask + 1; }
+
+private:
+    struct alignas(CACHE_LINE_SIZE) Slot
+    {
+        std::atomic<size_t> sequence;
+        T value;
+    };
+
+    alignas(CACHE_LINE_SIZE) std::atomic<size_t> tail{0};
+    std::atomic<size_t> pushing{0}; // tryPush calls in progress, on the producers' line
+    alignas(CACHE_LINE_SIZE) size_t head = 0;
+    std::atomic<size_t> consumerHead{0}; // published copy of head for producers and observers
+    alignas(CACHE_LINE_SIZE) const size_t mask;
+    PlacedArray<Slot> slots;
+    std::atomic<bool> closed{false};
+    WaitStrategy notEmpty;
+    WaitStrategy notFull;
+};
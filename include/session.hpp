@@ -0,0 +1,164 @@
+#pragma once
+
+#include <boost/asio/executor_work_guard.hpp>
+#include <boost/asio/io_context.hpp>
+#include <boost/asio/steady_timer.hpp>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <memory_resource>
+#include <mutex>
+#include <shared_mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+#include "clock.hpp"
+#include "http_transport.hpp"
+#include "metrics.hpp"
+#include "order_venue.hpp"
+
+struct Credentials
+{
+    std::string clientId;
+    std::string clientSecret;
+};
+
+// Where a RateLimiter reads the time and how it waits, steady clock nanoseconds and a real sleep by
+// default; tests swap in a simulated clock
+struct LimiterClock
+{
+    std::function<int64_t()> now = UtilityNamespace::steadyNowNs;
+    std::function<void(std::chrono::nanoseconds)> sleep = [](std::chrono::nanoseconds wait)
+    { std::this_thread::sleep_for(wait); };
+};
+
+// Token bucket over request credits, refilled continuously up to the burst size.
+class RateLimiter
+{
+public:
+    RateLimiter(double creditsPerSecond, double burstCredits, LimiterClock clock = LimiterClock());
+
+    // takes cost credits and returns zero, or takes nothing and returns the wait until they are available
+    std::chrono::nanoseconds tryAcquire(double cost);
+    // sleeps until cost credits are available
+    void acquire(double cost);
+
+private:
+    std::mutex mutex;
+    LimiterClock clock;
+    double rate;
+    double capacity;
+    double credits;
+    int64_t lastNs;
+};
+
+// Event loop shared by any number of sessions: token refresh timers and submitted requests run on
+// its threads. Requests block a loop thread for their round trip, so size it to the expected concurrency.
+class SessionLoop
+{
+public:
+    explicit SessionLoop(size_t threads = 1);
+    ~SessionLoop();
+    SessionLoop(const SessionLoop &) = delete;
+    SessionLoop &operator=(const SessionLoop &) = delete;
+
+    boost::asio::io_context &context() { return io; }
+    // joins the threads, dropping pending timers and queued tasks
+    void stop();
+
+private:
+    boost::asio::io_context io;
+    boost::asio::executor_work_guard<boost::asio::io_context::executor_type> work;
+    std::vector<std::thread> threads;
+};
+
+struct SessionOptions
+{
+    size_t poolSize = 2; // keep-alive transports, the most requests the session has in flight
+    SocketOptions socket = UtilityNamespace::defaultSocketOptions();
+    double creditsPerSecond = 20.0;
+    double burstCredits = 50.0;
+    std::chrono::seconds refreshMargin{60}; // refresh this long before the token expires
+    std::string baseUrl = "https://test.deribit.com/api/v2/";
+    LimiterClock clock; // of the rate limit
+};
+
+// One exchange account: credentials, the access token and its refresh, a pool of keep-alive
+// transports and a rate-limit budget. Any number of threads may send through one session.
+// Stop the loop before destroying its sessions.
+class Session : public OrderVenue
+{
+public:
+    Session(SessionLoop &loop, std::string name, Credentials credentials, SessionOptions options = SessionOptions());
+    ~Session() override;
+    Session(const Session &) = delete;
+    Session &operator=(const Session &) = delete;
+
+    // client_credentials grant; schedules refreshes on the loop. Throws std::runtime_error on failure
+    void authenticate();
+
+    // path is relative to baseUrl (e.g. "private/buy"); waits for rate budget and a free transport,
+    // then appends the reply to response. Returns false on transport errors
+    bool post(std::string_view path, std::string_view payload, std::pmr::string &response, double cost = 1.0) override;
+    bool get(std::string_view pathAndQuery, std::pmr::string &response, double cost = 1.0);
+    // GETs pathAndQuery on every pooled transport, holding them all so none is skipped, which opens and
+    // TLS-handshakes each keep-alive connection ahead of the first order. Returns how many replied with
+    // a result; call it while the session is otherwise idle
+    size_t warmTransports(std::string_view pathAndQuery);
+
+    // runs task on the shared loop once cost credits are available, without blocking a loop thread meanwhile
+    void submit(std::function<void()> task, double cost = 1.0) override;
+
+    const std::string &name() const { return sessionName; }
+    const std::string &baseUrl() const { return options.baseUrl; }
+    size_t poolSize() const { return transports.size(); }
+    std::string accessToken() const;
+    uint64_t throttled() const { return throttledCount.load(std::memory_order_relaxed); }
+    uint64_t refreshes() const { return refreshCount.load(std::memory_order_relaxed); }
+
+private:
+    // returns the borrowed transport to the pool on scope exit
+    class TransportLease
+    {
+    public:
+        explicit TransportLease(Session &session);
+        ~TransportLease();
+        HttpTransport &operator*() const { return *transport; }
+        HttpTransport *operator->() const { return transport; }
+
+    private:
+        Session &session;
+        HttpTransport *transport;
+    };
+
+    bool requestToken(const std::string &payload);
+    void scheduleRefresh(std::chrono::seconds expiresIn);
+    void deferSubmit(std::function<void()> task, double cost, std::chrono::nanoseconds wait);
+    void refresh();
+    void appendUrl(std::pmr::string &url, std::string_view path) const;
+
+    SessionLoop &loop;
+    std::string sessionName;
+    Credentials credentials;
+    SessionOptions options;
+    RateLimiter limiter;
+
+    mutable std::shared_mutex tokenMutex;
+    std::string token;
+    std::string refreshToken;
+
+    std::mutex poolMutex;
+    std::condition_variable poolReady;
+    std::vector<std::unique_ptr<HttpTransport>> transports;
+    std::vector<HttpTransport *> idle;
+
+    boost::asio::steady_timer refreshTimer;
+    std::atomic<uint64_t> throttledCount{0};
+    std::atomic<uint64_t> refreshCount{0};
+    Counter &throttledMetric; // labelled with the session name
+    Gauge &waitingMetric;     // threads waiting for a free transport
+};
@@ -0,0 +1,165 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <map>
+#include <memory_resource>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+#include <simdjson.h>
+#include "local_book.hpp"
+#include "order_venue.hpp"
+
+// how a resting order moves up when the displayed amount at its price shrinks
+enum class QueueModel
+{
+    Optimistic,  // every decrease was ahead of us
+    Proportional // a decrease is spread over the queue, the part ahead of us in proportion to it
+};
+
+struct SimulatedVenueOptions
+{
+    std::chrono::nanoseconds latency{0}; // wall-clock wait before every reply, 0 for throughput runs
+    QueueModel queueModel = QueueModel::Proportional;
+};
+
+// In-process matching venue for paper trading and throughput tests behind an OrderManager. It answers
+// private/buy, sell, cancel, edit, get_open_orders, get_positions and public/get_order_book with
+// replies shaped like the exchange's.
+//
+// Market data from onBook() is the rest of the market. Incoming orders match in price-time priority
+// against that book and against other resting simulated orders, with the book's displayed amount
+// ahead of simulated orders at the same price. Liquidity taken stays gone until the next onBook() for
+// the symbol. A resting order joins the queue behind the amount displayed at its price. That queue
+// shrinks as the level does (QueueModel), and the order fills when the other side of a later book
+// reaches its price: amounts at exactly its price go to the queue ahead first, amounts through it
+// fill it directly.
+//
+// Everything runs under one lock on the calling thread, and timestamps come from the books, never
+// from the clock, so the same sequence of calls always gives the same replies.
+class SimulatedVenue : public OrderVenue
+{
+public:
+    explicit SimulatedVenue(SimulatedVenueOptions options = SimulatedVenueOptions());
+
+    bool post(std::string_view path, std::string_view payload, std::pmr::string &response, double cost = 1.0) override;
+    // runs task inline, there is no rate limit
+    void submit(std::function<void()> task, double cost = 1.0) override;
+
+    // replaces the market's book for symbol (levels best first) and fills resting orders it reaches;
+    // timestampMs becomes the venue time for the symbol
+    void onBook(const std::string &symbol, const std::vector<BookLevel> &bids, const std::vector<BookLevel> &asks, int64_t timestampMs);
+
+    uint64_t orders() const { return orderCount.load(std::memory_order_relaxed); }
+    uint64_t trades() const { return tradeCount.load(std::memory_order_relaxed); }
+    // signed filled amount of every simulated order in symbol, buys positive
+    double position(const std::string &symbol) const;
+
+private:
+    enum class OrderState
+    {
+        Open,
+        Filled,
+        Cancelled
+    };
+
+    struct Instrument;
+
+    struct Order
+    {
+        uint64_t id = 0;
+        const std::string *symbol = nullptr; // key of its instrument, which never moves
+        Instrument *instrument = nullptr;
+        bool buy = true;
+        bool market = false;
+        double price = 0.0;
+        double amount = 0.0;
+        double filled = 0.0;
+        double filledValue = 0.0; // sum of price * amount over fills
+        double queueAhead = 0.0;  // displayed amount in front of it at its price
+        OrderState state = OrderState::Open;
+        int64_t createdMs = 0;
+        int64_t updatedMs = 0;
+    };
+
+    struct Fill
+    {
+        uint64_t tradeId;
+        uint64_t orderId;
+        double price;
+        double amount;
+        bool maker;
+    };
+
+    using BidLevels = std::map<double, double, std::greater<double>>;
+    using AskLevels = std::map<double, double>;
+    using BidQueue = std::map<double, std::deque<uint64_t>, std::greater<double>>;
+    using AskQueue = std::map<double, std::deque<uint64_t>>;
+
+    struct Instrument
+    {
+        BidLevels bids; // the market's displayed book, less what simulated orders took from it
+        AskLevels asks;
+        BidQueue restingBids; // simulated orders in time order per price
+        AskQueue restingAsks;
+        int64_t timestampMs = 0;
+        double position = 0.0;
+    };
+
+    // the params of a request this venue understands
+    struct Request
+    {
+        uint64_t id = 0;
+        std::string_view instrument;
+        std::string_view orderId;
+        std::string_view type;
+        std::string_view currency;
+        double amount = 0.0;
+        double price = 0.0;
+        bool hasPrice = false;
+        size_t depth = 0;
+    };
+
+    void placeOrder(const Request &request, bool buy, std::pmr::string &response);
+    void cancelOrder(const Request &request, std::pmr::string &response);
+    void editOrder(const Request &request, std::pmr::string &response);
+    void listOpenOrders(const Request &request, std::pmr::string &response);
+    void listPositions(const Request &request, std::pmr::string &response);
+    void orderBook(const Request &request, std::pmr::string &response);
+
+    void match(Order &taker, Instrument &instrument);
+    template <class Levels, class Queue>
+    void take(Order &taker, Instrument &instrument, Levels &levels, Queue &resting);
+    template <class Levels, class Queue>
+    void fillResting(Instrument &instrument, Levels &opposite, Queue &resting);
+    template <class Levels, class Queue>
+    void updateQueues(const Levels &before, const Levels &after, Queue &resting);
+    void rest(Order &order, Instrument &instrument);
+    void unrest(const Order &order, Instrument &instrument);
+    void fill(Order &order, Instrument &instrument, double price, double amount, bool maker);
+    Order *findOrder(std::string_view orderId);
+
+    void appendOrder(std::pmr::string &out, const Order &order) const;
+    void appendFills(std::pmr::string &out, const Order &order) const;
+    static void beginResult(std::pmr::string &out, uint64_t requestId);
+    static void endResult(std::pmr::string &out);
+    static void appendError(std::pmr::string &out, uint64_t requestId, int code, std::string_view message);
+
+    SimulatedVenueOptions options;
+    mutable std::mutex mutex;
+    std::unordered_map<std::string, Instrument> instruments;
+    std::unordered_map<uint64_t, Order> openOrders; // closed orders are dropped once replied to
+    std::vector<Fill> fills;                        // of the request being answered
+    simdjson::ondemand::parser parser;
+    std::string scratch; // padded copy of the request
+    uint64_t nextOrderId = 1;
+    uint64_t nextTradeId = 1;
+    std::atomic<uint64_t> orderCount{0};
+    std::atomic<uint64_t> tradeCount{0};
+};
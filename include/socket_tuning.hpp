@@ -0,0 +1,51 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+enum class RxTimestamping
+{
+    None,
+    Software, // kernel stamps when the packet reaches the stack
+    Hardware  // NIC stamps, needs a NIC and driver with SO_TIMESTAMPING support
+};
+
+// Per-connection socket settings for exchange and feed connections. Zero means kernel default.
+struct SocketOptions
+{
+    bool tcpNoDelay = true;
+    bool quickAck = false;   // re-armed after every exchange since the kernel clears it
+    int busyPollMicros = 0;  // SO_BUSY_POLL, values above net.core.busy_read need CAP_NET_ADMIN
+    int sendBufferBytes = 0;
+    int receiveBufferBytes = 0;
+    // pins the WebSocket clients' I/O thread; HttpTransport runs on its caller's thread and leaves it
+    // where it is, pin that thread yourself
+    int ioCpu = -1;
+};
+
+// counters are atomics so they can be read from another thread while the connection is busy
+struct ConnectionStats
+{
+    std::atomic<uint64_t> socketsOpened{0};
+    std::atomic<uint64_t> optionFailures{0};
+    std::atomic<uint64_t> requests{0};
+    std::atomic<uint64_t> messagesReceived{0}; // WebSocket frames
+    std::atomic<uint64_t> failures{0};
+    std::atomic<uint64_t> bytesSent{0};
+    std::atomic<uint64_t> bytesReceived{0};
+    std::atomic<uint64_t> totalMicros{0}; // summed request round trips
+};
+
+namespace UtilityNamespace
+{
+    // applies every option to a freshly created socket; failures are counted in stats, not fatal
+    bool applySocketOptions(int fd, const SocketOptions &options, ConnectionStats *stats = nullptr);
+    // TCP_QUICKACK is not sticky, call after reads when quickAck is enabled
+    void rearmQuickAck(int fd);
+    // SO_TIMESTAMPING receive stamps, for code that does its own reads with receiveWithTimestamp();
+    // curl and websocketpp read their sockets themselves, so it is not a SocketOptions setting
+    bool enableRxTimestamping(int fd, RxTimestamping mode);
+    // recv() that also returns the SO_TIMESTAMPING receive stamp (0 if none was attached)
+    long receiveWithTimestamp(int fd, void *buffer, size_t length, int64_t &timestampNs);
+}
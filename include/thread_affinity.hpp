@@ -0,0 +1,29 @@
+#pragma once
+
+#include <pthread.h>
+#include <sched.h>
+#include <thread>
+
+namespace UtilityNamespace
+{
+    // pin the calling thread to a single CPU, a negative cpu leaves the affinity untouched
+    inline bool pinCurrentThread(int cpu)
+    {
+        if (cpu < 0)
+            return true;
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        CPU_SET(cpu, &set);
+        return pthread_setaffinity_np(pthread_self(), sizeof(set), &set) == 0;
+    }
+
+    inline bool pinThread(std::thread &thread, int cpu)
+    {
+        if (cpu < 0)
+            return true;
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        CPU_SET(cpu, &set);
+        return pthread_setaffinity_np(thread.native_handle(), sizeof(set), &set) == 0;
+    }
+}
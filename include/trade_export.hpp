@@ -0,0 +1,122 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "session.hpp"
+
+// one fill as decoded from a get_user_trades_by_currency_and_time page; views are only valid
+// while the page is being parsed
+struct TradeRow
+{
+    int64_t timestamp = 0; // ms
+    uint64_t tradeSeq = 0;
+    double price = 0.0;
+    double amount = 0.0;
+    double fee = 0.0;
+    double indexPrice = 0.0;
+    std::string_view tradeId;
+    std::string_view orderId;
+    std::string_view instrument;
+    std::string_view direction;
+    std::string_view feeCurrency;
+    std::string_view liquidity;
+};
+
+enum class TradeExportFormat
+{
+    Csv,
+    Columnar
+};
+
+// Sparse timestamp index written next to each export as <file>.idx: fixed 24 byte entries in
+// timestamp order, one per indexStride CSV rows or per columnar block.
+struct TradeIndexEntry
+{
+    int64_t timestamp;
+    uint64_t row;
+    uint64_t offset; // byte offset of the row or block in the export file
+};
+
+// Streams rows to disk as they are parsed; only one block (columnar) or nothing (CSV) is held in memory.
+//
+// Columnar layout: "OEMSTRD1" then blocks of up to blockRows rows. Each block is
+//   uint32 rows, int64 firstTimestamp, int64 lastTimestamp,
+//   int64 timestamp[rows], uint64 tradeSeq[rows], double price, amount, fee, indexPrice [rows each],
+//   uint8 direction[rows] (0 buy, 1 sell), uint8 liquidity[rows] ('M' or 'T'),
+//   then tradeId, orderId, instrument, feeCurrency each as uint32 offsets[rows + 1] and the bytes.
+class TradeWriter
+{
+public:
+    virtual ~TradeWriter();
+    virtual void write(const TradeRow &row) = 0;
+    // flushes the last block and closes both files; throws std::runtime_error if either could not be written
+    virtual void finish() = 0;
+
+    uint64_t rows() const { return rowCount; }
+    uint64_t bytes() const { return byteCount; }
+
+    static std::unique_ptr<TradeWriter> create(TradeExportFormat format, const std::string &path, size_t indexStride);
+
+protected:
+    TradeWriter(const std::string &path, const char *mode);
+    void writeBytes(const void *data, size_t size);
+    void addIndex(int64_t timestamp, uint64_t row, uint64_t offset);
+    // false when buffered bytes could not be flushed to either file
+    bool close();
+
+    std::FILE *file = nullptr;
+    std::FILE *index = nullptr;
+    uint64_t rowCount = 0;
+    uint64_t byteCount = 0;
+};
+
+struct TradeExportOptions
+{
+    std::vector<std::string> currencies{"BTC", "ETH"}; // fetched in parallel, one file each
+    int64_t startTimestamp = 0;                        // ms, inclusive
+    int64_t endTimestamp = 0;                          // ms, inclusive, 0 means now
+    static constexpr size_t MAX_PAGE_SIZE = 1000;      // exchange maximum
+    size_t pageSize = MAX_PAGE_SIZE;
+    TradeExportFormat format = TradeExportFormat::Csv;
+    std::string directory = ".";
+    size_t indexStride = 1024; // CSV rows per index entry, and rows per columnar block
+    int maxRetries = 3;                        // for transport failures and rate limit errors alike
+    std::chrono::milliseconds retryDelay{100}; // doubled on each retry
+};
+
+struct TradeExportResult
+{
+    std::string currency;
+    std::string path;
+    uint64_t rows = 0;
+    uint64_t pages = 0;
+    uint64_t bytes = 0;
+    int64_t elapsedNs = 0;
+    std::string error; // empty on success
+};
+
+// Walks the whole history for each currency with timestamp continuation, one worker per currency
+// sharing the session's transport pool and rate limit.
+class TradeExporter
+{
+public:
+    TradeExporter(Session &session, TradeExportOptions options);
+    std::vector<TradeExportResult> run();
+
+private:
+    TradeExportResult exportCurrency(const std::string &currency);
+
+    Session &session;
+    TradeExportOptions options;
+};
+
+namespace UtilityNamespace
+{
+    // first index entry at or before timestamp, so a reader can seek close to it; false if the index is empty
+    bool findTradeIndex(const std::string &indexPath, int64_t timestamp, TradeIndexEntry &entry);
+}
@@ -15,17 +15,18 @@
 #include "sys/times.h"
 #include <simdjson.h>
 #include <simdjson/ondemand.h>
-
-extern std::string API_KEY, SECRET_KEY, access_token; // global variables
+#include <memory_resource>
+#include <string_view>
 
 namespace UtilityNamespace
 {
 
-    // Function declarations
+    // Function declarations; account credentials live in Session (session.hpp)
     std::string sendPostRequest(const std::string &url, const std::string &postFields);
     std::string sendPostRequestWithAuth(const std::string &url, const std::string &postFields, const std::string &token);
+    // hot-path variant over threadTransport(), appends the body to response
+    bool sendPostRequestWithAuth(const char *url, std::string_view payload, const char *authHeader, std::pmr::string &response);
     std::string sendGetRequest(const std::string &url);
-    std::string authenticate();
     std::string getOrderBook(const std::string &symbol);
     std::string getInstruments();
     std::string getInstrumentOrderbook(const std::string &instrumentName);
@@ -0,0 +1,49 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "order_manager.hpp"
+
+// The first order after authenticate() used to pay for the connection and TLS handshake, curl's and
+// simdjson's lazy setup, first-touch page faults in the arena and cold caches. warmUp() moves all of
+// that to startup: run it after the instruments are loaded and before the CLI or a strategy trades.
+struct WarmupOptions
+{
+    bool connect = true;  // open every pooled transport of a Session with a public/test request
+    bool validate = true; // check the authenticated request path with a read-only private request
+    size_t passes = 2000; // encode and parse passes per codec
+    std::string instrument = "BTC-PERPETUAL"; // used in the dummy requests; fixed point too when in the table
+};
+
+struct WarmupStep
+{
+    std::string name;
+    bool ok = true;
+    int64_t elapsedNs = 0;
+    std::string detail;
+};
+
+struct WarmupReport
+{
+    std::vector<WarmupStep> steps;
+    int64_t elapsedNs = 0;
+
+    bool ready() const
+    {
+        for (const WarmupStep &step : steps)
+        {
+            if (!step.ok)
+                return false;
+        }
+        return true;
+    }
+};
+
+namespace UtilityNamespace
+{
+    // Warms the calling thread, the one that will send orders, and the manager's venue. Nothing is
+    // ordered: requests are encoded and parsed back locally, and only public/test and
+    // private/get_open_orders go out. Sets the oems_ready gauge to 1 when every step passed.
+    WarmupReport warmUp(OrderManager &orderManager, const WarmupOptions &options = WarmupOptions());
+}
@@ -11,27 +11,95 @@
 #include <chrono>
 #include <iostream>
 #include <algorithm>
-#include <unordered_set>
+#include <unordered_map>
+#include <thread>
+#include <memory>
+#include <memory_resource>
+#include "clock_sync.hpp"
+#include "feed_decoder.hpp"
+#include "heartbeat.hpp"
+#include "latency_histogram.hpp"
+#include "local_book.hpp"
+#include "memory_placement.hpp"
+#include "reconnecting_client.hpp"
+#include "ring_buffer.hpp"
+#include "socket_tuning.hpp"
 
+class MarketDataPipeline;
+
+struct WebSocketClientOptions
+{
+    std::vector<std::string> endpoints{"ws://localhost:9002"}; // tried in order, wrapping around
+    SocketOptions socket;
+    HeartbeatOptions heartbeat; // the pings also drive the clock offset estimate
+    ReconnectOptions reconnect;
+};
+
+// Console client of the market data server. A dropped or silent connection is retried on the next
+// endpoint with jittered backoff until disconnect(); every subscription is restored on reconnect and
+// its book rebuilt from the snapshot that answers it.
 class WebSocketClient {
 public:
-    WebSocketClient();
+    explicit WebSocketClient(WebSocketClientOptions options = WebSocketClientOptions());
     ~WebSocketClient();
+    // runs the I/O loop on the calling thread until disconnect()
     void start();
-    void subscribe(const std::string &symbol);
+    void subscribe(const std::string &symbol, const StreamOptions &options = StreamOptions());
     void unsubscribe(const std::string &symbol);
+    // asks the server to resend updates from fromSeq, or a snapshot if they are gone
+    void requestReplay(const std::string &symbol, uint64_t fromSeq);
+    // asks the server for a fresh snapshot, when a replay has not closed a gap
+    void requestSnapshot(const std::string &symbol);
     void disconnect();
     void manageWebSocket();
+    // hand every received frame to the pipeline instead of printing it
+    void setPipeline(MarketDataPipeline *pipeline);
+    const ConnectionStats &stats() const { return connectionStats; }
+    // latency percentiles and the current clock offset estimate
+    void printLatency(std::ostream &out) const;
+
+    LatencyHistogram serverLatency;   // upstream receive -> server publish
+    LatencyHistogram wireLatency;     // server publish -> client receive, offset corrected
+    LatencyHistogram endToEndLatency; // upstream receive -> client receive, offset corrected
+    LatencyHistogram roundTripLatency;
 
 private:
-    void onMessage(websocketpp::connection_hdl, websocketpp::config::asio::message_type::ptr msg);
-    void onOpen(websocketpp::connection_hdl hdl);
+    using Stream = ReconnectingClient<websocketpp::config::asio>;
+
+    void onMessage(websocketpp::connection_hdl, Stream::MessagePtr msg, int64_t receivedNs);
+    bool onOpen(websocketpp::connection_hdl hdl);
+    void onClose(websocketpp::connection_hdl hdl, bool wasConnected);
+    void onSocketInit(websocketpp::connection_hdl hdl, boost::asio::ip::tcp::socket &socket);
+    void sendPing();
+    void onPong(const std::string &payload, int64_t receivedNs);
+    void recordLatency(int64_t upstreamNs, int64_t sentNs, int64_t receivedNs);
+    SymbolFeed &feedFor(const std::string &symbol); // symbolMutex held
+    void display(std::string text, nlohmann::json body = nullptr);
+    void displayLoop();
+
+    // console output is formatted and written by the display thread, never on the receive thread
+    struct DisplayEvent
+    {
+        std::string text;
+        nlohmann::json body; // pretty printed after text when not null
+    };
 
-    websocketpp::client<websocketpp::config::asio> client;
-    websocketpp::connection_hdl globalHdl;
-    std::unordered_set<std::string> subscribedSymbols;
-    std::atomic<bool> running;
+    std::unordered_map<std::string, StreamOptions> subscribedSymbols; // guarded by symbolMutex, resent on reconnect
+    std::unique_ptr<PlacedArena> bookMemory;                          // guarded by symbolMutex, mapped by the io thread
+    std::unique_ptr<std::pmr::unsynchronized_pool_resource> bookPool; // over bookMemory, recycles level nodes
+    std::unordered_map<std::string, SymbolFeed> feeds;                // guarded by symbolMutex
     std::mutex symbolMutex;
+    MarketDataPipeline *pipeline = nullptr;
+    WebSocketClientOptions clientOptions;
+    Stream stream;
+    ConnectionStats connectionStats;
+    std::atomic<int> socketFd{-1};
+    ClockSync clockSync; // io thread only
+    std::atomic<int64_t> clockOffsetNs{0};
+    std::atomic<bool> clockSynced{false};
+    SpscRingBuffer<DisplayEvent, BlockingWait> displayQueue; // io thread -> display thread
+    std::atomic<uint64_t> droppedDisplays{0};
+    std::thread displayThread;
 };
 
 #endif // WEBSOCKET_HPP
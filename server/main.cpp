@@ -0,0 +1,109 @@
+#include "websocket_server.hpp"
+#include "metrics.hpp"
+#include <atomic>
+#include <csignal>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+static std::atomic<bool> stopRequested{false};
+
+static void onStopSignal(int)
+{
+    stopRequested = true; // lock-free, so safe in a signal handler
+}
+
+// deribit_md_server [--source rest|stream|file:<path>] [--stream-url url]... [--heartbeat-ms n] [--speed x] [--once] [--record <path>] [--port n] [--drain-ms n] [--metrics-port n] [--chain <currency>]... [--chain-threads n]
+// SIGTERM or SIGINT drain and exit; for a rolling restart start the new instance on the same port first.
+// Repeated --stream-url give the stream source failover endpoints, tried in order; --heartbeat-ms is
+// how long the stream may stay silent before it reconnects. Each --chain streams that currency's
+// options with implied volatility and Greeks to subscribe_chain clients, computed on --chain-threads
+// threads (default every CPU)
+int main(int argc, char **argv)
+{
+    std::string spec = "rest";
+    uint16_t port = 9002;
+    uint16_t metricsPort = 9101; // GET /metrics on loopback, 0 turns it off
+    std::chrono::milliseconds drainTimeout = WebSocketServer::DRAIN_TIMEOUT;
+    MarketDataSourceOptions options;
+    std::vector<std::string> streamUrls;
+    std::vector<std::string> chains;
+    size_t chainThreads = 0;
+    for (int i = 1; i < argc; ++i)
+    {
+        bool hasValue = i + 1 < argc;
+        if (std::strcmp(argv[i], "--source") == 0 && hasValue)
+            spec = argv[++i];
+        else if (std::strcmp(argv[i], "--stream-url") == 0 && hasValue)
+            streamUrls.push_back(argv[++i]);
+        else if (std::strcmp(argv[i], "--heartbeat-ms") == 0 && hasValue)
+            options.heartbeat.timeout = std::chrono::milliseconds(std::atoll(argv[++i]));
+        else if (std::strcmp(argv[i], "--speed") == 0 && hasValue)
+            options.replaySpeed = std::atof(argv[++i]);
+        else if (std::strcmp(argv[i], "--once") == 0)
+            options.replayLoop = false;
+        else if (std::strcmp(argv[i], "--record") == 0 && hasValue)
+            options.recordPath = argv[++i];
+        else if (std::strcmp(argv[i], "--port") == 0 && hasValue)
+            port = static_cast<uint16_t>(std::atoi(argv[++i]));
+        else if (std::strcmp(argv[i], "--drain-ms") == 0 && hasValue)
+            drainTimeout = std::chrono::milliseconds(std::atoll(argv[++i]));
+        else if (std::strcmp(argv[i], "--metrics-port") == 0 && hasValue)
+            metricsPort = static_cast<uint16_t>(std::atoi(argv[++i]));
+        else if (std::strcmp(argv[i], "--chain") == 0 && hasValue)
+            chains.push_back(argv[++i]);
+        else if (std::strcmp(argv[i], "--chain-threads") == 0 && hasValue)
+            chainThreads = static_cast<size_t>(std::atoll(argv[++i]));
+        else
+        {
+            std::cerr << "Usage: " << argv[0] << " [--source rest|stream|file:<path>] [--stream-url url]... [--heartbeat-ms n] [--speed x] [--once] [--record <path>] [--port n] [--drain-ms n] [--metrics-port n] [--chain <currency>]... [--chain-threads n]" << std::endl;
+            return 1;
+        }
+    }
+    if (!streamUrls.empty())
+        options.streamUrls = std::move(streamUrls);
+
+    std::unique_ptr<MarketDataSource> source;
+    try
+    {
+        source = MarketDataSource::create(spec, options);
+    }
+    catch (const std::exception &e)
+    {
+        std::cerr << e.what() << std::endl;
+        return 1;
+    }
+    std::signal(SIGINT, onStopSignal);
+    std::signal(SIGTERM, onStopSignal);
+    WebSocketServer wsServer(std::move(source));
+    for (const std::string &currency : chains)
+    {
+        OptionChainOptions chainOptions;
+        chainOptions.currency = currency;
+        chainOptions.threads = chainThreads;
+        wsServer.addOptionChain(std::make_unique<OptionChainSource>(chainOptions, options));
+    }
+    std::unique_ptr<MetricsServer> metricsServer;
+    if (metricsPort)
+        metricsServer = std::make_unique<MetricsServer>(UtilityNamespace::metrics(), metricsPort);
+    try
+    {
+        wsServer.startServer(port);
+        while (!stopRequested)
+        {
+            wsServer.sendOrderbookUpdate();
+            std::this_thread::sleep_for(WebSocketServer::POLL_TICK);
+        }
+    }
+    catch (const std::exception &e)
+    {
+        std::cerr << "Exception: " << e.what() << std::endl;
+    }
+    wsServer.stopServer(drainTimeout);
+
+    return 0;
+}
\ No newline at end of file
@@ -0,0 +1,472 @@
+#include "market_data_source.hpp"
+#include "arena.hpp"
+#include "clock.hpp"
+#include "http_transport.hpp"
+#include "jsonrpc.hpp"
+#include "logger.hpp"
+#include <algorithm>
+#include <fstream>
+#include <stdexcept>
+
+std::shared_ptr<OrderbookSnapshot> UtilityNamespace::parseOrderbookReply(const std::string &symbol, std::string_view reply, bool keepRaw)
+{
+    auto snapshot = std::make_shared<OrderbookSnapshot>();
+    snapshot->symbol = symbol;
+    thread_local std::string scratch;
+    std::string &buffer = keepRaw ? snapshot->raw : scratch;
+    // keep simdjson's padding in the same allocation so the parse needs no copy
+    buffer.reserve(reply.size() + simdjson::SIMDJSON_PADDING);
+    buffer.assign(reply.data(), reply.size());
+
+    try
+    {
+        thread_local simdjson::ondemand::parser parser;
+        simdjson::padded_string_view view(buffer.data(), buffer.size(), buffer.capacity());
+        simdjson::ondemand::document doc = parser.iterate(view);
+        simdjson::ondemand::object result;
+        if (doc["result"].get_object().get(result) != simdjson::SUCCESS)
+        {
+            OEMS_LOG_ERROR("Order book reply for {} has no result: {}", symbol, reply);
+            return nullptr;
+        }
+        for (auto field : result)
+        {
+            std::string_view key = field.unescaped_key();
+            if (key == "timestamp")
+            {
+                int64_t timestamp = 0;
+                if (field.value().get_int64().get(timestamp) == simdjson::SUCCESS)
+                    snapshot->exchangeTimestamp = timestamp;
+            }
+            else if (key == "instrument_name")
+            {
+                std::string_view name = field.value().get_string();
+                snapshot->symbol.assign(name.data(), name.size());
+            }
+            else if (key == "bids" || key == "asks")
+            {
+                std::vector<BookLevel> &side = key == "bids" ? snapshot->bids : snapshot->asks;
+                for (auto level : field.value().get_array())
+                {
+                    BookLevel parsed;
+                    size_t index = 0;
+                    for (auto number : level.get_array())
+                    {
+                        double value = number.get_double();
+                        if (index == 0)
+                            parsed.price = value;
+                        else if (index == 1)
+                            parsed.amount = value;
+                        ++index;
+                    }
+                    side.push_back(parsed);
+                }
+            }
+        }
+    }
+    catch (const simdjson::simdjson_error &e)
+    {
+        OEMS_LOG_ERROR("Order book for {} is not valid JSON: {}", symbol, e.what());
+        return nullptr;
+    }
+    return snapshot;
+}
+
+std::unique_ptr<MarketDataSource> MarketDataSource::create(const std::string &spec, const MarketDataSourceOptions &options)
+{
+    if (spec == "rest")
+        return std::make_unique<RestSource>(options);
+    if (spec == "stream")
+        return std::make_unique<DeribitStreamSource>(options);
+    if (spec.compare(0, 5, "file:") == 0)
+        return std::make_unique<FileReplaySource>(spec.substr(5), options);
+    throw std::runtime_error("Unknown market data source: " + spec + " (expected rest, stream or file:<path>)");
+}
+
+RestSource::RestSource(MarketDataSourceOptions opts) : options(std::move(opts))
+{
+    if (!options.recordPath.empty())
+    {
+        record = std::fopen(options.recordPath.c_str(), "a");
+        if (!record)
+            throw std::runtime_error("Cannot open " + options.recordPath + " for recording");
+    }
+}
+
+RestSource::~RestSource()
+{
+    if (record)
+        std::fclose(record);
+}
+
+RestSource::SnapshotPtr RestSource::fetch(const std::string &symbol)
+{
+    if (stopping)
+        return nullptr;
+    ArenaScope scope;
+    std::pmr::string url(options.restUrl.c_str(), &scope.resource());
+    url += symbol;
+    std::pmr::string response(&scope.resource());
+    response.reserve(16 * 1024);
+    HttpTransport &transport = UtilityNamespace::threadTransport();
+    transport.setAbortFlag(&stopping);
+    bool fetched = transport.get(url.c_str(), response);
+    transport.setAbortFlag(nullptr);
+    if (!fetched || response.empty())
+        return nullptr;
+    int64_t receivedNs = UtilityNamespace::steadyNowNs();
+
+    std::shared_ptr<OrderbookSnapshot> snapshot = UtilityNamespace::parseOrderbookReply(symbol, response, true);
+    if (!snapshot)
+        return nullptr;
+    snapshot->fetchedAt = std::chrono::steady_clock::now();
+    snapshot->receivedNs = receivedNs;
+    if (record)
+    {
+        std::lock_guard<std::mutex> lock(recordMutex);
+        std::fwrite(response.data(), 1, response.size(), record);
+        std::fputc('\n', record);
+    }
+    snapshotCount.fetch_add(1, std::memory_order_relaxed);
+    return snapshot;
+}
+
+DeribitStreamSource::DeribitStreamSource(MarketDataSourceOptions opts)
+    : options(std::move(opts)), stream("Market data stream", options.streamUrls, options.reconnect, options.heartbeat),
+      reconnects(UtilityNamespace::metrics().counter("md_upstream_reconnects_total", "Reconnects of the upstream market data stream")),
+      heartbeatTimeouts(UtilityNamespace::metrics().counter("md_upstream_heartbeat_timeouts_total", "Upstream stream connections dropped for silence")),
+      connectedMetric(UtilityNamespace::metrics().gauge("md_upstream_connected", "1 while the upstream market data stream is connected"))
+{
+    Stream::Handlers handlers;
+    handlers.open = [this](websocketpp::connection_hdl hdl)
+    { return onOpen(hdl); };
+    handlers.close = [this](websocketpp::connection_hdl hdl, bool wasConnected)
+    { onClose(hdl, wasConnected); };
+    handlers.message = [this](websocketpp::connection_hdl hdl, Stream::MessagePtr msg, int64_t receivedNs)
+    { onMessage(hdl, std::move(msg), receivedNs); };
+    handlers.silent = [this]()
+    { heartbeatTimeouts.add(); };
+    stream.setHandlers(std::move(handlers));
+    stream.client().set_tls_init_handler([](websocketpp::connection_hdl)
+                                         {
+                                             auto context = websocketpp::lib::make_shared<boost::asio::ssl::context>(boost::asio::ssl::context::tlsv12_client);
+                                             context->set_default_verify_paths();
+                                             context->set_verify_mode(boost::asio::ssl::verify_peer);
+                                             return context; });
+}
+
+DeribitStreamSource::~DeribitStreamSource()
+{
+    stop();
+}
+
+DeribitStreamSource::SnapshotPtr DeribitStreamSource::fetch(const std::string &symbol)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    auto it = latest.find(symbol);
+    return it == latest.end() ? nullptr : it->second;
+}
+
+void DeribitStreamSource::watch(const std::string &symbol)
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (!watched.insert(symbol).second)
+            return;
+    }
+    stream.client().get_io_service().post([this, symbol]()
+                                          { sendSubscription("public/subscribe", symbol); });
+}
+
+void DeribitStreamSource::unwatch(const std::string &symbol)
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (watched.erase(symbol) == 0)
+            return;
+        latest.erase(symbol);
+    }
+    stream.client().get_io_service().post([this, symbol]()
+                                          {
+                                              instruments.erase(symbol);
+                                              sendSubscription("public/unsubscribe", symbol); });
+}
+
+void DeribitStreamSource::start(SnapshotHandler snapshotHandler)
+{
+    handler = std::move(snapshotHandler);
+    stream.start();
+}
+
+void DeribitStreamSource::stop()
+{
+    stream.stop();
+}
+
+std::string DeribitStreamSource::channel(const std::string &symbol) const
+{
+    return "book." + symbol + "." + options.streamInterval;
+}
+
+// params is the JSON object's inside; dropped while disconnected
+void DeribitStreamSource::sendRequest(const char *method, const std::string &params)
+{
+    if (!stream.connected())
+        return;
+    std::string message = "{\"jsonrpc\":\"2.0\",\"id\":";
+    message += std::to_string(++requestId);
+    message += ",\"method\":\"";
+    message += method;
+    message += "\",\"params\":{";
+    message += params;
+    message += "}}";
+    websocketpp::lib::error_code ec;
+    stream.client().send(stream.connection(), message, websocketpp::frame::opcode::text, ec);
+    if (ec)
+        OEMS_LOG_ERROR("Market data stream send failed: {}", ec.message());
+}
+
+// dropped while disconnected, onOpen subscribes every watched symbol
+void DeribitStreamSource::sendSubscription(const char *method, const std::string &symbol)
+{
+    if (!stream.connected())
+        return;
+    if (std::string_view(method) == "public/subscribe")
+        instruments[symbol].synced = false; // the subscribe answers with a snapshot
+    std::string params = "\"channels\":[";
+    UtilityNamespace::appendJsonString(params, channel(symbol));
+    params += ']';
+    sendRequest(method, params);
+}
+
+bool DeribitStreamSource::onOpen(websocketpp::connection_hdl)
+{
+    connectedMetric.set(1.0);
+    OEMS_LOG_INFO("Market data stream connected to {}", stream.endpoint());
+    if (options.streamHeartbeat.count() > 0)
+        sendRequest("public/set_heartbeat", "\"interval\":" + std::to_string(std::max<int64_t>(options.streamHeartbeat.count(), 10)));
+    std::vector<std::string> symbols;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        symbols.assign(watched.begin(), watched.end());
+    }
+    for (const std::string &symbol : symbols)
+        sendSubscription("public/subscribe", symbol);
+    return true;
+}
+
+// also for a failed attempt: the stream tries the next URL after a backoff; the books are rebuilt
+// from the snapshots that answer the resubscribes
+void DeribitStreamSource::onClose(websocketpp::connection_hdl, bool wasConnected)
+{
+    connectedMetric.set(0.0);
+    if (!stream.running())
+        return;
+    reconnects.add();
+    if (wasConnected)
+        OEMS_LOG_WARN("Market data stream {} lost", stream.endpoint());
+}
+
+// book notifications: {"method":"subscription","params":{"channel":..,"data":{"type":"snapshot"|"change",
+// "timestamp","prev_change_id","change_id","instrument_name","bids":[["new"|"change"|"delete",price,amount],..],"asks"}}}
+void DeribitStreamSource::onMessage(websocketpp::connection_hdl, Stream::MessagePtr msg, int64_t receivedNs)
+{
+    std::string &payload = msg->get_raw_payload();
+    thread_local std::vector<BookLevel> bidChanges, askChanges;
+    bidChanges.clear();
+    askChanges.clear();
+    std::string symbol;
+    bool snapshot = false;
+    int64_t timestamp = 0, changeId = 0, prevChangeId = 0;
+
+    try
+    {
+        simdjson::ondemand::document doc = parser.iterate(payload);
+        std::string_view method;
+        if (doc["method"].get_string().get(method) != simdjson::SUCCESS)
+            return; // request acknowledgements and errors
+        if (method == "heartbeat")
+        {
+            // the exchange closes the connection unless a test request gets an answer
+            std::string_view type;
+            if (doc["params"]["type"].get_string().get(type) == simdjson::SUCCESS && type == "test_request")
+                sendRequest("public/test", "");
+            return;
+        }
+        if (method != "subscription")
+            return;
+        simdjson::ondemand::object data = doc["params"]["data"].get_object();
+        for (auto field : data)
+        {
+            std::string_view key = field.unescaped_key();
+            if (key == "type")
+            {
+                snapshot = std::string_view(field.value().get_string()) == "snapshot";
+            }
+            else if (key == "instrument_name")
+            {
+                std::string_view name = field.value().get_string();
+                symbol.assign(name.data(), name.size());
+            }
+            else if (key == "timestamp")
+            {
+                timestamp = field.value().get_int64();
+            }
+            else if (key == "change_id")
+            {
+                changeId = field.value().get_int64();
+            }
+            else if (key == "prev_change_id")
+            {
+                prevChangeId = field.value().get_int64();
+            }
+            else if (key == "bids" || key == "asks")
+            {
+                std::vector<BookLevel> &side = key == "bids" ? bidChanges : askChanges;
+                for (auto entry : field.value().get_array())
+                {
+                    auto it = entry.get_array().begin();
+                    bool remove = std::string_view((*it).get_string()) == "delete";
+                    ++it;
+                    BookLevel level;
+                    level.price = (*it).get_double();
+                    ++it;
+                    level.amount = remove ? 0.0 : double((*it).get_double());
+                    side.push_back(level);
+                }
+            }
+        }
+    }
+    catch (const simdjson::simdjson_error &e)
+    {
+        OEMS_LOG_WARN("Malformed market data notification: {}", e.what());
+        return;
+    }
+
+    auto it = instruments.find(symbol);
+    if (it == instruments.end())
+        return; // unwatched while the notification was in flight
+    Instrument &instrument = it->second;
+    if (snapshot)
+    {
+        instrument.book.clear();
+        instrument.synced = true;
+    }
+    else if (!instrument.synced)
+    {
+        return; // waiting for the snapshot of a resubscribe
+    }
+    else if (prevChangeId != instrument.changeId)
+    {
+        // missed a change: start over from a fresh snapshot
+        sendSubscription("public/unsubscribe", symbol);
+        sendSubscription("public/subscribe", symbol);
+        return;
+    }
+    for (const BookLevel &level : bidChanges)
+        instrument.book.apply(true, level.price, level.amount);
+    for (const BookLevel &level : askChanges)
+        instrument.book.apply(false, level.price, level.amount);
+    instrument.changeId = changeId;
+
+    auto book = std::make_shared<OrderbookSnapshot>();
+    book->symbol = symbol;
+    book->exchangeTimestamp = timestamp;
+    instrument.book.copyLevels(book->bids, book->asks);
+    book->fetchedAt = std::chrono::steady_clock::now();
+    book->receivedNs = receivedNs;
+    SnapshotPtr published = std::move(book);
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        latest[symbol] = published;
+    }
+    snapshotCount.fetch_add(1, std::memory_order_relaxed);
+    if (handler)
+        handler(published);
+}
+
+FileReplaySource::FileReplaySource(const std::string &path, MarketDataSourceOptions opts) : options(std::move(opts))
+{
+    std::ifstream in(path);
+    if (!in)
+        throw std::runtime_error("Cannot open market data recording " + path);
+    std::string line;
+    size_t rejected = 0;
+    while (std::getline(in, line))
+    {
+        if (line.empty())
+            continue;
+        std::shared_ptr<OrderbookSnapshot> snapshot = UtilityNamespace::parseOrderbookReply("", line, false);
+        if (!snapshot || snapshot->symbol.empty())
+        {
+            ++rejected;
+            continue;
+        }
+        recorded.push_back(std::move(snapshot));
+    }
+    if (recorded.empty())
+        throw std::runtime_error("No order books in " + path);
+    if (rejected)
+        OEMS_LOG_WARN("Skipped {} unreadable lines in {}", rejected, path);
+}
+
+FileReplaySource::~FileReplaySource()
+{
+    stop();
+}
+
+FileReplaySource::SnapshotPtr FileReplaySource::fetch(const std::string &symbol)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    auto it = latest.find(symbol);
+    return it == latest.end() ? nullptr : it->second;
+}
+
+void FileReplaySource::start(SnapshotHandler snapshotHandler)
+{
+    if (running.exchange(true))
+        return;
+    handler = std::move(snapshotHandler);
+    replayThread = std::thread([this]()
+                               { replay(); });
+}
+
+void FileReplaySource::stop()
+{
+    if (!running.exchange(false))
+        return;
+    replayThread.join();
+}
+
+// every record goes out as a fresh snapshot stamped now, so downstream latency is measured from the replay
+void FileReplaySource::replay()
+{
+    do
+    {
+        int64_t startNs = UtilityNamespace::steadyNowNs();
+        int64_t firstTimestamp = recorded.front()->exchangeTimestamp;
+        for (const SnapshotPtr &record : recorded)
+        {
+            if (!running)
+                return;
+            if (options.replaySpeed > 0.0)
+            {
+                int64_t dueNs = startNs + static_cast<int64_t>((record->exchangeTimestamp - firstTimestamp) * 1e6 / options.replaySpeed);
+                int64_t waitNs = dueNs - UtilityNamespace::steadyNowNs();
+                if (waitNs > 0)
+                    std::this_thread::sleep_for(std::chrono::nanoseconds(waitNs));
+            }
+            auto snapshot = std::make_shared<OrderbookSnapshot>(*record);
+            snapshot->fetchedAt = std::chrono::steady_clock::now();
+            snapshot->receivedNs = UtilityNamespace::steadyNowNs();
+            SnapshotPtr published = std::move(snapshot);
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                latest[published->symbol] = published;
+            }
+            snapshotCount.fetch_add(1, std::memory_order_relaxed);
+            if (handler)
+                handler(published);
+        }
+    } while (running && options.replayLoop);
+}
@@ -0,0 +1,172 @@
+#pragma once
+
+#include <websocketpp/config/asio_client.hpp>
+#include <websocketpp/client.hpp>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+#include <simdjson.h>
+#include "heartbeat.hpp"
+#include "metrics.hpp"
+#include "reconnecting_client.hpp"
+#include "snapshot_cache.hpp"
+
+struct MarketDataSourceOptions
+{
+    std::string restUrl = "https://test.deribit.com/api/v2/public/get_order_book?instrument_name=";
+    std::vector<std::string> streamUrls{"wss://test.deribit.com/ws/api/v2"}; // tried in order, wrapping around
+    std::string streamInterval = "100ms";   // book.<instrument>.<interval>; "raw" needs an authorized connection
+    std::chrono::seconds streamHeartbeat{10}; // public/set_heartbeat interval (10 s at least), 0 leaves it off
+    HeartbeatOptions heartbeat;               // stream: WebSocket pings and the silence that drops the connection
+    ReconnectOptions reconnect;
+    std::string recordPath;               // rest: append every reply here, one per line, for the file source
+    double replaySpeed = 0.0;             // file: 0 replays as fast as possible, 1 at the recorded pace
+    bool replayLoop = true;               // file: start over at the end
+};
+
+// Where the server's books come from. Pull sources fetch a book when asked. Push sources deliver
+// every book as it arrives through the handler given to start() and answer fetch() with the latest
+// one they have, so the server's polled (interval) streams work the same over both.
+class MarketDataSource
+{
+public:
+    using SnapshotPtr = SnapshotCache::SnapshotPtr;
+    using SnapshotHandler = std::function<void(const SnapshotPtr &)>;
+
+    virtual ~MarketDataSource() = default;
+
+    virtual const char *name() const = 0;
+    // latest book for symbol; null if there is none (yet)
+    virtual SnapshotPtr fetch(const std::string &symbol) = 0;
+    // symbols somebody subscribed to, push sources subscribe upstream
+    virtual void watch(const std::string &) {}
+    virtual void unwatch(const std::string &) {}
+    // push sources deliver on their own thread until stop(); pull sources ignore start(), and stop()
+    // cancels their fetches in flight and fails later ones
+    virtual void start(SnapshotHandler) {}
+    virtual void stop() {}
+    virtual bool pushes() const { return false; }
+
+    uint64_t snapshots() const { return snapshotCount.load(std::memory_order_relaxed); }
+
+    // "rest", "stream" or "file:<path>"; throws std::runtime_error for anything else
+    static std::unique_ptr<MarketDataSource> create(const std::string &spec, const MarketDataSourceOptions &options = MarketDataSourceOptions());
+
+protected:
+    std::atomic<uint64_t> snapshotCount{0};
+};
+
+// public/get_order_book over the calling thread's keep-alive HttpTransport
+class RestSource : public MarketDataSource
+{
+public:
+    explicit RestSource(MarketDataSourceOptions options = MarketDataSourceOptions());
+    ~RestSource() override;
+
+    const char *name() const override { return "rest"; }
+    SnapshotPtr fetch(const std::string &symbol) override;
+    void stop() override { stopping = true; }
+
+private:
+    MarketDataSourceOptions options;
+    std::atomic<bool> stopping{false}; // aborts the transfers of every fetching thread
+    std::mutex recordMutex;
+    std::FILE *record = nullptr;
+};
+
+// book.<instrument>.<interval> notifications over the exchange WebSocket API, applied to a local
+// book per instrument; resubscribes on a change_id gap. The connection is watched with WebSocket
+// pings and the exchange's own heartbeat (public/set_heartbeat, answering its test requests). After
+// a drop or a silent connection it reconnects to the next URL with jittered backoff, resubscribes and
+// rebuilds every book from a fresh snapshot.
+class DeribitStreamSource : public MarketDataSource
+{
+public:
+    explicit DeribitStreamSource(MarketDataSourceOptions options = MarketDataSourceOptions());
+    ~DeribitStreamSource() override;
+
+    const char *name() const override { return "stream"; }
+    SnapshotPtr fetch(const std::string &symbol) override;
+    void watch(const std::string &symbol) override;
+    void unwatch(const std::string &symbol) override;
+    void start(SnapshotHandler handler) override;
+    void stop() override;
+    bool pushes() const override { return true; }
+
+private:
+    using Stream = ReconnectingClient<websocketpp::config::asio_tls_client>;
+
+    struct Instrument
+    {
+        LocalOrderBook book;
+        int64_t changeId = 0;
+        bool synced = false; // a snapshot arrived since the last (re)subscribe
+    };
+
+    bool onOpen(websocketpp::connection_hdl hdl);
+    void onClose(websocketpp::connection_hdl hdl, bool wasConnected);
+    void onMessage(websocketpp::connection_hdl hdl, Stream::MessagePtr msg, int64_t receivedNs);
+    void sendRequest(const char *method, const std::string &params);
+    void sendSubscription(const char *method, const std::string &symbol);
+    std::string channel(const std::string &symbol) const;
+
+    MarketDataSourceOptions options;
+    Stream stream;
+    SnapshotHandler handler;
+    uint64_t requestId = 0;                                  // I/O thread only
+    std::unordered_map<std::string, Instrument> instruments; // I/O thread only
+    simdjson::ondemand::parser parser;                       // I/O thread only
+
+    std::mutex mutex;
+    std::set<std::string> watched;
+    std::unordered_map<std::string, SnapshotPtr> latest;
+
+    Counter &reconnects;
+    Counter &heartbeatTimeouts;
+    Gauge &connectedMetric;
+};
+
+// Replays recorded get_order_book replies (one JSON reply per line, as written by RestSource's
+// recordPath) from memory. Every reply is parsed once up front so the replay itself only copies
+// levels, which makes it a network-free load generator for the server's fan-out.
+class FileReplaySource : public MarketDataSource
+{
+public:
+    FileReplaySource(const std::string &path, MarketDataSourceOptions options = MarketDataSourceOptions());
+    ~FileReplaySource() override;
+
+    const char *name() const override { return "file"; }
+    SnapshotPtr fetch(const std::string &symbol) override;
+    void start(SnapshotHandler handler) override;
+    void stop() override;
+    bool pushes() const override { return true; }
+
+    size_t records() const { return recorded.size(); }
+
+private:
+    void replay();
+
+    MarketDataSourceOptions options;
+    std::vector<SnapshotPtr> recorded;
+    SnapshotHandler handler;
+    std::thread replayThread;
+    std::atomic<bool> running{false};
+    std::mutex mutex;
+    std::unordered_map<std::string, SnapshotPtr> latest;
+};
+
+namespace UtilityNamespace
+{
+    // decodes a get_order_book reply; the symbol comes from result.instrument_name when present.
+    // keepRaw stores the reply for verbatim splicing; null (with an error logged) on a bad reply
+    std::shared_ptr<OrderbookSnapshot> parseOrderbookReply(const std::string &symbol, std::string_view reply, bool keepRaw);
+}
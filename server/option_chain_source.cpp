@@ -0,0 +1,298 @@
+#include "option_chain_source.hpp"
+#include "arena.hpp"
+#include "clock.hpp"
+#include "http_transport.hpp"
+#include "jsonrpc.hpp"
+#include "logger.hpp"
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+#include <stdexcept>
+
+OptionChainSource::OptionChainSource(OptionChainOptions opts, MarketDataSourceOptions streamOptions)
+    : options(std::move(opts)), stream(std::move(streamOptions)), websocket("Option chain stream", stream.streamUrls, stream.reconnect, stream.heartbeat),
+      calculator(options.threads, options.rate),
+      computeLatency(UtilityNamespace::metrics().histogram("md_option_chain_compute_ns", "Implied volatility and Greeks of a whole option chain", {{"currency", options.currency}})),
+      recomputes(UtilityNamespace::metrics().counter("md_option_chain_recomputes_total", "Option chain recomputes", {{"currency", options.currency}})),
+      reconnects(UtilityNamespace::metrics().counter("md_option_chain_reconnects_total", "Reconnects of the option chain stream", {{"currency", options.currency}})),
+      connectedMetric(UtilityNamespace::metrics().gauge("md_option_chain_connected", "1 while the option chain stream is connected", {{"currency", options.currency}}))
+{
+    if (options.currency.empty())
+        throw std::runtime_error("The option chain source needs a currency");
+    std::string index = options.indexName;
+    if (index.empty())
+    {
+        for (char c : options.currency)
+            index += static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
+        index += "_usd";
+    }
+    indexChannel = "deribit_price_index." + index;
+    options.channelsPerRequest = std::max<size_t>(options.channelsPerRequest, 1);
+    chain.currency = options.currency;
+
+    Stream::Handlers handlers;
+    handlers.open = [this](websocketpp::connection_hdl hdl)
+    { return onOpen(hdl); };
+    handlers.close = [this](websocketpp::connection_hdl hdl, bool wasConnected)
+    { onClose(hdl, wasConnected); };
+    handlers.message = [this](websocketpp::connection_hdl hdl, Stream::MessagePtr msg, int64_t receivedNs)
+    { onMessage(hdl, std::move(msg), receivedNs); };
+    websocket.setHandlers(std::move(handlers));
+    websocket.client().set_tls_init_handler([](websocketpp::connection_hdl)
+                                            {
+                                                auto context = websocketpp::lib::make_shared<boost::asio::ssl::context>(boost::asio::ssl::context::tlsv12_client);
+                                                context->set_default_verify_paths();
+                                                context->set_verify_mode(boost::asio::ssl::verify_peer);
+                                                return context; });
+}
+
+OptionChainSource::~OptionChainSource()
+{
+    stop();
+}
+
+OptionChainSource::ChainPtr OptionChainSource::latest() const
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    return published;
+}
+
+void OptionChainSource::start(ChainHandler chainHandler)
+{
+    stopping = false;
+    handler = std::move(chainHandler);
+    websocket.start([this]()
+                    { scheduleTick(); });
+}
+
+void OptionChainSource::stop()
+{
+    stopping = true;
+    websocket.client().get_io_service().post([this]()
+                                             {
+                                                 if (tickTimer)
+                                                     tickTimer->cancel(); });
+    websocket.stop();
+}
+
+// picks up the moves that came too soon after a recompute, quote changes every refresh and the
+// hourly relisting; runs whether connected or not
+void OptionChainSource::scheduleTick()
+{
+    tickTimer = websocket.client().set_timer(options.minInterval.count(), [this](const websocketpp::lib::error_code &ec)
+                                             {
+                                                 if (ec || !websocket.running())
+                                                     return;
+                                                 int64_t now = UtilityNamespace::steadyNowNs();
+                                                 if (websocket.connected() && now - listedNs >= std::chrono::nanoseconds(options.relist).count())
+                                                 {
+                                                     listedNs = now; // a failed relist waits for the next one
+                                                     if (loadChain())
+                                                     {
+                                                         sendRequest("public/unsubscribe_all", "");
+                                                         subscribeChain();
+                                                         moved = true;
+                                                     }
+                                                 }
+                                                 int64_t sinceCompute = now - lastComputeNs;
+                                                 if (moved || (quotesChanged && sinceCompute >= std::chrono::nanoseconds(options.refresh).count()))
+                                                     recompute();
+                                                 scheduleTick(); });
+}
+
+// the listing and the quotes of every option in two requests; blocks the I/O thread for their round
+// trips, which only happens on (re)connect and relist
+bool OptionChainSource::loadChain()
+{
+    ArenaScope scope;
+    HttpTransport &transport = UtilityNamespace::threadTransport();
+    transport.setAbortFlag(&stopping);
+    std::pmr::string url(&scope.resource());
+    std::pmr::string instruments(&scope.resource()), summaries(&scope.resource());
+    url = options.restUrl.c_str();
+    url += "get_instruments?kind=option&expired=false&currency=";
+    url += options.currency.c_str();
+    bool fetched = transport.get(url.c_str(), instruments);
+    url = options.restUrl.c_str();
+    url += "get_book_summary_by_currency?kind=option&currency=";
+    url += options.currency.c_str();
+    fetched = fetched && transport.get(url.c_str(), summaries);
+    transport.setAbortFlag(nullptr);
+    if (!fetched)
+    {
+        OEMS_LOG_ERROR("Cannot load the {} option chain from {}", options.currency, options.restUrl);
+        return false;
+    }
+
+    OptionChain listed;
+    listed.currency = options.currency;
+    if (UtilityNamespace::loadOptionInstruments(listed, instruments) == 0)
+    {
+        OEMS_LOG_ERROR("No {} options listed", options.currency);
+        return false;
+    }
+    double price = 0.0;
+    size_t quoted = UtilityNamespace::loadOptionQuotes(listed, summaries, &price);
+    chain = std::move(listed);
+    if (underlying <= 0.0)
+        underlying = price; // until the index arrives; the summary's is an expiry's future
+    listedNs = UtilityNamespace::steadyNowNs();
+    quotesChanged = true;
+    OEMS_LOG_INFO("Listed {} {} options, {} quoted", chain.size(), options.currency, quoted);
+    return true;
+}
+
+// the subscribes answer with the current quote of every option
+void OptionChainSource::subscribeChain()
+{
+    std::string params;
+    for (size_t first = 0; first < chain.size() || first == 0; first += options.channelsPerRequest)
+    {
+        params = "\"channels\":[";
+        if (first == 0)
+            UtilityNamespace::appendJsonString(params, indexChannel);
+        size_t last = std::min(chain.size(), first + options.channelsPerRequest);
+        for (size_t row = first; row < last; ++row)
+        {
+            if (params.back() != '[')
+                params += ',';
+            UtilityNamespace::appendJsonString(params, "quote." + chain.names[row]);
+        }
+        params += ']';
+        sendRequest("public/subscribe", params);
+    }
+}
+
+void OptionChainSource::recompute()
+{
+    moved = false;
+    if (underlying <= 0.0 || chain.size() == 0)
+        return;
+    int64_t startNs = UtilityNamespace::steadyNowNs();
+    calculator.compute(chain, underlying, UtilityNamespace::wallNowNs() / 1000000);
+    lastComputeNs = UtilityNamespace::steadyNowNs();
+    computeLatency.record(lastComputeNs - startNs);
+    recomputes.add();
+    computedAt = underlying;
+    quotesChanged = false;
+
+    ChainPtr computed = std::make_shared<const OptionChain>(chain);
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        published = computed;
+    }
+    if (handler)
+        handler(computed);
+}
+
+// params is the JSON object's inside; dropped while disconnected
+void OptionChainSource::sendRequest(const char *method, const std::string &params)
+{
+    if (!websocket.connected())
+        return;
+    std::string message = "{\"jsonrpc\":\"2.0\",\"id\":";
+    message += std::to_string(++requestId);
+    message += ",\"method\":\"";
+    message += method;
+    message += "\",\"params\":{";
+    message += params;
+    message += "}}";
+    websocketpp::lib::error_code ec;
+    websocket.client().send(websocket.connection(), message, websocketpp::frame::opcode::text, ec);
+    if (ec)
+        OEMS_LOG_ERROR("Option chain stream send failed: {}", ec.message());
+}
+
+// false when there is no chain to stream, which closes the connection and keeps backing off
+bool OptionChainSource::onOpen(websocketpp::connection_hdl hdl)
+{
+    connectedMetric.set(1.0);
+    OEMS_LOG_INFO("Option chain stream connected to {}", websocket.endpoint());
+    // relisting on every connect picks up what was listed or expired while disconnected
+    if (!loadChain() && chain.size() == 0)
+    {
+        websocketpp::lib::error_code ec;
+        websocket.client().close(hdl, websocketpp::close::status::normal, "No option chain", ec);
+        return false;
+    }
+    if (stream.streamHeartbeat.count() > 0)
+        sendRequest("public/set_heartbeat", "\"interval\":" + std::to_string(std::max<int64_t>(stream.streamHeartbeat.count(), 10)));
+    subscribeChain();
+    moved = true;
+    return true;
+}
+
+void OptionChainSource::onClose(websocketpp::connection_hdl, bool wasConnected)
+{
+    connectedMetric.set(0.0);
+    if (!websocket.running())
+        return;
+    reconnects.add();
+    if (wasConnected)
+        OEMS_LOG_WARN("Option chain stream {} lost", websocket.endpoint());
+}
+
+// {"method":"subscription","params":{"channel":"quote.<instrument>","data":{"instrument_name",
+// "best_bid_price","best_ask_price",..}}} and {"channel":"deribit_price_index.<index>","data":{"price",..}}
+void OptionChainSource::onMessage(websocketpp::connection_hdl, Stream::MessagePtr msg, int64_t)
+{
+    std::string &payload = msg->get_raw_payload();
+    std::string_view name;
+    double bid = 0.0, ask = 0.0, price = 0.0;
+    bool index = false;
+
+    try
+    {
+        simdjson::ondemand::document doc = parser.iterate(payload);
+        std::string_view method;
+        if (doc["method"].get_string().get(method) != simdjson::SUCCESS)
+            return; // request acknowledgements and errors
+        if (method == "heartbeat")
+        {
+            std::string_view type;
+            if (doc["params"]["type"].get_string().get(type) == simdjson::SUCCESS && type == "test_request")
+                sendRequest("public/test", "");
+            return;
+        }
+        if (method != "subscription")
+            return;
+        simdjson::ondemand::object params = doc["params"].get_object();
+        std::string_view channel = params["channel"].get_string();
+        index = channel == indexChannel;
+        for (auto field : params["data"].get_object())
+        {
+            std::string_view key = field.unescaped_key();
+            double value = 0.0;
+            if (key == "instrument_name")
+                name = field.value().get_string();
+            else if (key == "price" && field.value().get_double().get(value) == simdjson::SUCCESS)
+                price = value;
+            else if (key == "best_bid_price" && field.value().get_double().get(value) == simdjson::SUCCESS)
+                bid = value;
+            else if (key == "best_ask_price" && field.value().get_double().get(value) == simdjson::SUCCESS)
+                ask = value;
+        }
+    }
+    catch (const simdjson::simdjson_error &e)
+    {
+        OEMS_LOG_WARN("Malformed option chain notification: {}", e.what());
+        return;
+    }
+
+    if (!index)
+    {
+        if (chain.setQuote(name, bid, ask))
+            quotesChanged = true;
+        return;
+    }
+    if (price <= 0.0)
+        return;
+    underlying = price;
+    if (computedAt > 0.0 && std::fabs(price / computedAt - 1.0) * 1e4 < options.moveBps)
+        return;
+    // a move: now, or at the next tick when the last recompute was too recent
+    if (UtilityNamespace::steadyNowNs() - lastComputeNs >= std::chrono::nanoseconds(options.minInterval).count())
+        recompute();
+    else
+        moved = true;
+}
@@ -0,0 +1,93 @@
+#pragma once
+
+#include <websocketpp/config/asio_client.hpp>
+#include <websocketpp/client.hpp>
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <simdjson.h>
+#include "heartbeat.hpp"
+#include "market_data_source.hpp"
+#include "metrics.hpp"
+#include "option_chain.hpp"
+#include "reconnecting_client.hpp"
+
+struct OptionChainOptions
+{
+    std::string currency = "ETH";
+    std::string restUrl = "https://test.deribit.com/api/v2/public/"; // get_instruments and get_book_summary_by_currency
+    std::string indexName;      // deribit_price_index.<name>, empty for <currency>_usd in lower case
+    size_t threads = 0;         // ChainCalculator threads, 0 for every CPU
+    double rate = 0.0;          // grows the underlying to each expiry's forward
+    double moveBps = 1.0;       // an underlying move this large recomputes the chain
+    std::chrono::milliseconds minInterval{100}; // least time between recomputes
+    std::chrono::milliseconds refresh{1000};    // recompute after quote changes while the underlying is still
+    std::chrono::minutes relist{60};            // reload the listing for new strikes and expiries
+    size_t channelsPerRequest = 200;
+};
+
+// Every option of one currency from the exchange WebSocket API. The listing and the first quotes
+// come from two REST requests (get_instruments and get_book_summary_by_currency) instead of one per
+// option; then quote.<instrument> keeps each row's best bid and ask and deribit_price_index the
+// underlying. The whole chain's implied volatilities and Greeks are recomputed in one batch by a
+// ChainCalculator when the underlying moves by moveBps, and after quote changes every refresh. The
+// connection is watched and failed over like DeribitStreamSource's, relisting on every reconnect.
+class OptionChainSource
+{
+public:
+    using ChainPtr = std::shared_ptr<const OptionChain>;
+    using ChainHandler = std::function<void(const ChainPtr &)>;
+
+    // stream supplies the URLs, heartbeat and reconnect settings
+    explicit OptionChainSource(OptionChainOptions options, MarketDataSourceOptions stream = MarketDataSourceOptions());
+    ~OptionChainSource();
+
+    const std::string &currency() const { return options.currency; }
+    // every recomputed chain goes to handler on the source's thread
+    void start(ChainHandler handler);
+    void stop();
+    // the last computed chain, null before the first
+    ChainPtr latest() const;
+
+private:
+    using Stream = ReconnectingClient<websocketpp::config::asio_tls_client>;
+
+    void scheduleTick();
+    bool loadChain();
+    void subscribeChain();
+    void recompute();
+    bool onOpen(websocketpp::connection_hdl hdl);
+    void onClose(websocketpp::connection_hdl hdl, bool wasConnected);
+    void onMessage(websocketpp::connection_hdl hdl, Stream::MessagePtr msg, int64_t receivedNs);
+    void sendRequest(const char *method, const std::string &params);
+
+    OptionChainOptions options;
+    MarketDataSourceOptions stream;
+    std::string indexChannel;
+    Stream websocket;
+    std::atomic<bool> stopping{false}; // aborts the REST listing in flight
+    ChainHandler handler;
+    uint64_t requestId = 0;              // I/O thread only
+    Stream::Client::timer_ptr tickTimer; // I/O thread only
+    simdjson::ondemand::parser parser;   // I/O thread only
+
+    OptionChain chain;          // I/O thread only
+    ChainCalculator calculator; // I/O thread only
+    double underlying = 0.0;    // I/O thread only, latest index price
+    double computedAt = 0.0;    // I/O thread only, underlying of the last recompute
+    int64_t lastComputeNs = 0;  // I/O thread only
+    int64_t listedNs = 0;       // I/O thread only
+    bool quotesChanged = false; // I/O thread only
+    bool moved = false;         // I/O thread only, a move arrived within minInterval of the last recompute
+
+    mutable std::mutex mutex;
+    ChainPtr published;
+
+    Histogram &computeLatency;
+    Counter &recomputes;
+    Counter &reconnects;
+    Gauge &connectedMetric;
+};
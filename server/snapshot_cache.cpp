@@ -0,0 +1,71 @@
+#include "snapshot_cache.hpp"
+
+SnapshotCache::SnapshotCache(Fetcher fetcher, std::chrono::milliseconds ttl)
+    : fetcher(std::move(fetcher)), ttl(ttl)
+{
+}
+
+SnapshotCache::SnapshotPtr SnapshotCache::get(const std::string &symbol)
+{
+    std::unique_lock<std::mutex> lock(mutex);
+    Entry &entry = entries[symbol];
+    if (entry.snapshot && std::chrono::steady_clock::now() - entry.snapshot->fetchedAt < ttl)
+    {
+        hitCount.fetch_add(1, std::memory_order_relaxed);
+        return entry.snapshot;
+    }
+    if (entry.fetching)
+    {
+        coalescedCount.fetch_add(1, std::memory_order_relaxed);
+        std::shared_future<SnapshotPtr> inflight = entry.inflight;
+        lock.unlock();
+        return inflight.get();
+    }
+
+    std::promise<SnapshotPtr> promise;
+    entry.fetching = true;
+    entry.inflight = promise.get_future().share();
+    fetchCount.fetch_add(1, std::memory_order_relaxed);
+    lock.unlock();
+
+    SnapshotPtr fetched;
+    try
+    {
+        fetched = fetcher(symbol);
+    }
+    catch (...)
+    {
+        // the next get() fetches again, and the waiters see the same exception
+        lock.lock();
+        entries[symbol].fetching = false;
+        lock.unlock();
+        promise.set_exception(std::current_exception());
+        throw;
+    }
+
+    lock.lock();
+    Entry &done = entries[symbol];
+    if (fetched)
+        done.snapshot = fetched;
+    done.fetching = false;
+    SnapshotPtr result = done.snapshot; // a failed fetch falls back to the stale snapshot
+    lock.unlock();
+
+    promise.set_value(result);
+    return result;
+}
+
+SnapshotCache::SnapshotPtr SnapshotCache::peek(const std::string &symbol) const
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    auto it = entries.find(symbol);
+    return it == entries.end() ? nullptr : it->second.snapshot;
+}
+
+void SnapshotCache::invalidate(const std::string &symbol)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    auto it = entries.find(symbol);
+    if (it != entries.end())
+        it->second.snapshot.reset();
+}
@@ -0,0 +1,64 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "local_book.hpp"
+
+struct OrderbookSnapshot
+{
+    std::string symbol;
+    std::string raw;          // upstream get_order_book reply, spliced verbatim into frames; empty for sources without one
+    int64_t exchangeTimestamp = 0; // result.timestamp reported by the exchange (ms)
+    std::vector<BookLevel> bids;
+    std::vector<BookLevel> asks;
+    std::chrono::steady_clock::time_point fetchedAt;
+    int64_t receivedNs = 0; // steady clock ns when the upstream reply landed, carried in frames as recv_ns
+};
+
+// Per-symbol order book snapshots with a TTL. Concurrent misses for one symbol share a single
+// upstream fetch and parse (single flight); everyone else waits on the same future.
+class SnapshotCache
+{
+public:
+    using SnapshotPtr = std::shared_ptr<const OrderbookSnapshot>;
+    // a MarketDataSource's fetch (market_data_source.hpp); null when there is no book
+    using Fetcher = std::function<SnapshotPtr(const std::string &symbol)>;
+
+    SnapshotCache(Fetcher fetcher, std::chrono::milliseconds ttl);
+
+    // fresh snapshot, fetching at most once per symbol at a time; null if the fetch failed and nothing is cached.
+    // An exception from the fetcher reaches this caller and every waiter on the same fetch
+    SnapshotPtr get(const std::string &symbol);
+    // whatever is cached regardless of age, never fetches
+    SnapshotPtr peek(const std::string &symbol) const;
+    void invalidate(const std::string &symbol);
+
+    uint64_t hits() const { return hitCount.load(std::memory_order_relaxed); }
+    uint64_t fetches() const { return fetchCount.load(std::memory_order_relaxed); }
+    uint64_t coalesced() const { return coalescedCount.load(std::memory_order_relaxed); }
+
+private:
+    struct Entry
+    {
+        SnapshotPtr snapshot;
+        std::shared_future<SnapshotPtr> inflight;
+        bool fetching = false;
+    };
+
+    Fetcher fetcher;
+    std::chrono::milliseconds ttl;
+    mutable std::mutex mutex;
+    std::unordered_map<std::string, Entry> entries;
+    // counted under mutex, read without it
+    std::atomic<uint64_t> hitCount{0};
+    std::atomic<uint64_t> fetchCount{0};
+    std::atomic<uint64_t> coalescedCount{0};
+};
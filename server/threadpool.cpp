@@ -14,6 +14,12 @@ ThreadPool::ThreadPool(size_t threadCount) : stop(false)
                                          std::unique_lock<std::mutex> lock(this->queueMutex);
                                          this->condition.wait(lock, [this]()
                                                               { return this->stop || !this->tasks.empty(); });
+                                         if (this->stop && !this->tasks.empty() && std::chrono::steady_clock::now() >= this->drainDeadline)
+                                         {
+                                             // out of time: whatever is still queued is not run
+                                             this->dropped += this->tasks.size();
+                                             this->tasks = {};
+                                         }
                                          if (this->stop && this->tasks.empty())
                                              return;
                                          task = std::move(this->tasks.front());
@@ -26,14 +32,37 @@ ThreadPool::ThreadPool(size_t threadCount) : stop(false)
 }
 
 ThreadPool::~ThreadPool()
+{
+    shutdownUntil(std::chrono::steady_clock::time_point::max());
+}
+
+size_t ThreadPool::shutdown(std::chrono::milliseconds drainTimeout)
+{
+    return shutdownUntil(std::chrono::steady_clock::now() + drainTimeout);
+}
+
+size_t ThreadPool::queued() const
+{
+    std::lock_guard<std::mutex> lock(queueMutex);
+    return tasks.size();
+}
+
+size_t ThreadPool::shutdownUntil(std::chrono::steady_clock::time_point deadline)
 {
     {
         std::unique_lock<std::mutex> lock(queueMutex);
-        stop = true;
+        if (!stop)
+        {
+            stop = true;
+            drainDeadline = deadline;
+        }
     }
     condition.notify_all();
     for (std::thread &worker : workers)
     {
-        worker.join();
+        if (worker.joinable())
+            worker.join();
     }
+    std::unique_lock<std::mutex> lock(queueMutex);
+    return dropped;
 }
@@ -8,30 +8,44 @@
 #include <mutex>
 #include <condition_variable>
 #include <atomic>
+#include <chrono>
 class ThreadPool
 {
 public:
     explicit ThreadPool(size_t threadCount);
+    // drains the whole queue
     ~ThreadPool();
+    // dropped once shutdown() has started
     template <class F>
     void enqueue(F &&task);
+    // stops taking tasks, keeps running queued ones until drainTimeout has passed, drops the rest
+    // and joins the workers (running tasks are never interrupted); returns how many were dropped
+    size_t shutdown(std::chrono::milliseconds drainTimeout);
+    // tasks waiting for a worker
+    size_t queued() const;
 
 private:
+    size_t shutdownUntil(std::chrono::steady_clock::time_point deadline);
+
     std::vector<std::thread> workers;
     std::queue<std::function<void()>> tasks;
 
-    std::mutex queueMutex;
+    mutable std::mutex queueMutex;
     std::condition_variable condition;
     std::atomic<bool> stop;
+    std::chrono::steady_clock::time_point drainDeadline; // guarded by queueMutex once stop is set
+    size_t dropped = 0;                                  // guarded by queueMutex
 };
 template <class F>
 void ThreadPool::enqueue(F &&task)
 {
     {
         std::unique_lock<std::mutex> lock(queueMutex);
+        if (stop)
+            return;
         tasks.emplace(std::forward<F>(task));
     }
     condition.notify_one();
 }
 
-#endif // THREADPOOL_HPP
\ No newline at end of file
+#endif // THREADPOOL_HPP
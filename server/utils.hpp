@@ -11,8 +11,11 @@
 #include <websocketpp/client.hpp>
 #include <functional>
 #include <unordered_map>
+#include <memory_resource>
 
 namespace UtilityNamespace {
     std::string getInstrumentOrderbook(const std::string& instrumentName);
     std::string sendGetRequest(const std::string& url);
+    // appends the reply to a caller-owned (arena) buffer, goes through the thread's HttpTransport
+    bool getInstrumentOrderbook(const std::string& instrumentName, std::pmr::string& out);
 }
\ No newline at end of file
@@ -1,125 +1,979 @@
 #include "websocket_server.hpp"
 #include "utils.hpp"
 #include "threadpool.hpp"
+#include "jsonrpc.hpp"
+#include "clock.hpp"
+#include "feed_decoder.hpp"
+#include "logger.hpp"
+#include <atomic>
+#include <cctype>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <sys/socket.h>
 // Implementation of the WebSocketServer methods
 
-WebSocketServer::WebSocketServer() : threadPool(4)
+WebSocketServer::WebSocketServer(std::unique_ptr<MarketDataSource> source)
+    : m_source(source ? std::move(source) : std::make_unique<RestSource>()),
+      m_snapshotCache([this](const std::string &symbol)
+                      {
+                          int64_t startNs = UtilityNamespace::steadyNowNs();
+                          SnapshotCache::SnapshotPtr snapshot = m_source->fetch(symbol);
+                          m_fetchLatency.record(UtilityNamespace::steadyNowNs() - startNs);
+                          return snapshot; },
+                      POLL_TICK / 2), // fresh on every tick, still shared by the streams polled in one tick
+      threadPool(4),
+      m_framesSent(UtilityNamespace::metrics().counter("md_frames_sent_total", "Frames written to client connections")),
+      m_bytesSent(UtilityNamespace::metrics().counter("md_bytes_sent_total", "Bytes of frames written to client connections")),
+      m_conflated(UtilityNamespace::metrics().counter("md_conflated_total", "Pushed books an interval stream skipped for a newer one")),
+      m_fetchLatency(UtilityNamespace::metrics().histogram("md_fetch_latency_ns", "Time to get a book from the market data source", {{"source", m_source->name()}})),
+      m_publishLatency(UtilityNamespace::metrics().histogram("md_publish_latency_ns", "Time from a book arriving from upstream to its update being queued for clients"))
 {
+    registerMetrics();
     m_server.init_asio();
+    m_server.set_reuse_addr(true);
+    // a restarted instance binds the same port before the old one stops listening, so there is
+    // no window without a listener
+    m_server.set_tcp_pre_bind_handler([](websocketpp::lib::shared_ptr<websocketpp::lib::asio::ip::tcp::acceptor> acceptor)
+                                      {
+                                          int one = 1;
+                                          if (setsockopt(acceptor->native_handle(), SOL_SOCKET, SO_REUSEPORT, &one, sizeof(one)) != 0)
+                                              OEMS_LOG_WARN("SO_REUSEPORT unavailable, restarts will refuse connections briefly");
+                                          return websocketpp::lib::error_code(); });
     m_server.set_open_handler(bind(&WebSocketServer::onOpen, this, std::placeholders::_1));
     m_server.set_close_handler(bind(&WebSocketServer::onClose, this, std::placeholders::_1));
     m_server.set_message_handler(bind(&WebSocketServer::onMessage, this, std::placeholders::_1, std::placeholders::_2));
 }
 
+void WebSocketServer::addOptionChain(std::unique_ptr<OptionChainSource> source)
+{
+    auto stream = std::make_shared<ChainStream>();
+    std::string currency = source->currency();
+    stream->source = std::move(source);
+    m_chains[currency] = std::move(stream);
+}
+
 void WebSocketServer::startServer(uint16_t port)
 {
-    std::cout << "started" << std::endl;
+    OEMS_LOG_INFO("started, books from the {} source", m_source->name());
+    if (m_source->pushes())
+        m_source->start([this](const SnapshotCache::SnapshotPtr &snapshot)
+                        { onSourceSnapshot(snapshot); });
+    for (const auto &entry : m_chains)
+    {
+        ChainPtr stream = entry.second;
+        stream->source->start([this, stream](const OptionChainSource::ChainPtr &chain)
+                              { publishChain(stream, *chain); });
+    }
     m_server.listen(port);
     m_server.start_accept();
-    threadPool.enqueue([this]()
-                       { m_server.run(); }); // Run the server in a thread pool
+    m_serverThread = std::thread([this]()
+                                 {
+                                     try
+                                     {
+                                         m_server.run();
+                                     }
+                                     catch (const std::exception &e)
+                                     {
+                                         OEMS_LOG_ERROR("WebSocket server stopped: {}", e.what());
+                                     } });
+}
+
+WebSocketServer::~WebSocketServer()
+{
+    stopServer(std::chrono::milliseconds(0));
+    MetricsRegistry &registry = UtilityNamespace::metrics();
+    for (const char *name : {"md_connections", "md_streams", "md_analytics_streams", "md_subscriptions", "md_task_queue_depth", "md_send_queue_depth"})
+        registry.removeSampled(name);
+}
+
+// sizes are sampled at scrape time; the lock-free counters are bound in the constructor
+void WebSocketServer::registerMetrics()
+{
+    MetricsRegistry &registry = UtilityNamespace::metrics();
+    for (const char *action : {"subscribe", "unsubscribe", "snapshot", "replay", "subscribe_analytics", "unsubscribe_analytics", "subscribe_chain", "unsubscribe_chain", "ping", "other"})
+        m_actionCounts[action] = &registry.counter("md_client_requests_total", "Client requests by action", {{"action", action}});
+    registry.sampled("md_connections", "Open client connections", {}, [this]()
+                     {
+                         std::shared_lock<std::shared_mutex> lock(m_subscribersMutex);
+                         return static_cast<double>(m_connections.size()); });
+    registry.sampled("md_streams", "Book streams with subscribers, one per symbol, depth and interval", {}, [this]()
+                     {
+                         std::shared_lock<std::shared_mutex> lock(m_subscribersMutex);
+                         return static_cast<double>(m_streams.size()); });
+    registry.sampled("md_analytics_streams", "Symbols with analytics subscribers", {}, [this]()
+                     {
+                         std::shared_lock<std::shared_mutex> lock(m_subscribersMutex);
+                         return static_cast<double>(m_analytics.size()); });
+    registry.sampled("md_subscriptions", "Client subscriptions to book streams, analytics and option chains", {}, [this]()
+                     {
+                         std::shared_lock<std::shared_mutex> lock(m_subscribersMutex);
+                         size_t total = 0;
+                         for (const auto &entry : m_streams)
+                             total += entry.second->subscribers.size();
+                         for (const auto &entry : m_analytics)
+                             total += entry.second->subscribers.size();
+                         for (const auto &entry : m_chains)
+                             total += entry.second->subscribers.size();
+                         return static_cast<double>(total); });
+    registry.sampled("md_task_queue_depth", "Polls and snapshot fetches waiting for a worker", {}, [this]()
+                     { return static_cast<double>(threadPool.queued()); });
+    registry.sampled("md_send_queue_depth", "Sends queued on the io thread", {}, [this]()
+                     {
+                         uint64_t done = m_sendsDone.value(); // first, so the difference cannot go negative
+                         return static_cast<double>(m_sendsPosted.value() - done); });
+}
+
+void WebSocketServer::onFrameSent(const std::string &frame, size_t sent)
+{
+    m_sendsDone.add();
+    if (sent == 0)
+        return;
+    m_framesSent.add(sent);
+    m_bytesSent.add(sent * frame.size());
 }
 
-void WebSocketServer::stopServer()
+void WebSocketServer::stopServer(std::chrono::milliseconds drainTimeout)
 {
+    if (m_stopping.exchange(true))
+        return;
+    auto deadline = std::chrono::steady_clock::now() + drainTimeout;
+    if (!m_serverThread.joinable())
+    {
+        m_source->stop();
+        for (const auto &entry : m_chains)
+            entry.second->source->stop();
+        threadPool.shutdown(std::chrono::milliseconds(0));
+        return;
+    }
+
+    // new clients go to the successor from here on
+    m_server.get_io_service().post([this]()
+                                   {
+                                       websocketpp::lib::error_code ec;
+                                       m_server.stop_listening(ec); });
+    // fetches in flight return empty, queued polls find nothing to publish
+    m_source->stop();
+    for (const auto &entry : m_chains)
+        entry.second->source->stop();
+    size_t dropped = threadPool.shutdown(std::chrono::duration_cast<std::chrono::milliseconds>(deadline - std::chrono::steady_clock::now()));
+    if (dropped)
+        OEMS_LOG_WARN("Dropped {} queued tasks at shutdown", dropped);
+
+    // posted after every frame already queued, so clients get those before the close
+    m_server.get_io_service().post([this]()
+                                   {
+                                       ConnectionSet connections;
+                                       {
+                                           std::shared_lock<std::shared_mutex> lock(m_subscribersMutex);
+                                           connections = m_connections;
+                                       }
+                                       for (const auto &hdl : connections)
+                                       {
+                                           websocketpp::lib::error_code ec;
+                                           m_server.close(hdl, websocketpp::close::status::going_away, "Server restarting", ec);
+                                       } });
+    while (std::chrono::steady_clock::now() < deadline)
+    {
+        {
+            std::shared_lock<std::shared_mutex> lock(m_subscribersMutex);
+            if (m_connections.empty())
+                break;
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    // handlers still queued are destroyed with the io_service without running
     m_server.stop();
+    m_serverThread.join();
+    OEMS_LOG_INFO("stopped");
+}
+
+// claims the next poll of a stream once its interval has passed, with half a tick of slack for timer jitter
+static bool pollDue(std::atomic<int64_t> &lastPollNs, int64_t nowNs, int64_t intervalMs)
+{
+    int64_t slackNs = std::chrono::nanoseconds(WebSocketServer::POLL_TICK).count() / 2;
+    if (nowNs - lastPollNs.load(std::memory_order_relaxed) < intervalMs * 1000000 - slackNs)
+        return false;
+    lastPollNs.store(nowNs, std::memory_order_relaxed);
+    return true;
 }
 
 void WebSocketServer::sendOrderbookUpdate()
 {
-    // Iterate over all subscribers
-    for (const auto &it : m_subscribers)
+    if (stopping())
+        return;
+    int64_t nowNs = UtilityNamespace::steadyNowNs();
+    std::set<std::string> busy;
     {
-        const std::string &symbol = it.first;
-        threadPool.enqueue([this, symbol]()
+        std::lock_guard<std::mutex> lock(m_pollingMutex);
+        busy = m_polling;
+    }
+
+    std::map<std::string, std::vector<StreamPtr>> dueStreams;
+    std::map<std::string, AnalyticsPtr> dueAnalytics;
+    bool pushed = m_source->pushes(); // raw streams and analytics are fed by onSourceSnapshot
+    {
+        std::shared_lock<std::shared_mutex> lock(m_subscribersMutex);
+        for (const auto &entry : m_streams)
+        {
+            if (pushed && entry.first.intervalMs == 0)
+                continue;
+            if (busy.count(entry.first.symbol) == 0 && pollDue(entry.second->lastPollNs, nowNs, entry.first.intervalMs))
+                dueStreams[entry.first.symbol].push_back(entry.second);
+        }
+        // analytics follow every change, like a raw stream
+        for (const auto &entry : m_analytics)
+        {
+            if (pushed)
+                break;
+            if (busy.count(entry.first) == 0 && pollDue(entry.second->lastPollNs, nowNs, 0))
+                dueAnalytics[entry.first] = entry.second;
+        }
+    }
+
+    std::set<std::string> symbols;
+    for (const auto &entry : dueStreams)
+        symbols.insert(entry.first);
+    for (const auto &entry : dueAnalytics)
+        symbols.insert(entry.first);
+    {
+        std::lock_guard<std::mutex> lock(m_pollingMutex);
+        m_polling.insert(symbols.begin(), symbols.end());
+    }
+
+    for (const std::string &symbol : symbols)
+    {
+        // one upstream fetch per symbol, fanned out to each due (depth, interval) stream
+        threadPool.enqueue([this, symbol, streams = std::move(dueStreams[symbol]), analytics = dueAnalytics[symbol]]()
                            {
-                                   std::string orderbook = UtilityNamespace::getInstrumentOrderbook(symbol);
-                                   const nlohmann::json orderbookJson = nlohmann::json::parse(orderbook);
-                                   for (const auto &hdl : m_subscribers[symbol])
+                               SnapshotCache::SnapshotPtr snapshot = m_snapshotCache.get(symbol);
+                               if (snapshot)
+                               {
+                                   for (const StreamPtr &stream : streams)
                                    {
-                                       auto currentTime = std::chrono::system_clock::now();
-                                       auto timestamp = std::chrono::duration_cast<std::chrono::milliseconds>(currentTime.time_since_epoch()).count();
+                                       uint64_t pushed = stream->pushedSincePoll.exchange(0, std::memory_order_relaxed);
+                                       if (pushed > 1)
+                                           m_conflated.add(pushed - 1); // only the latest goes out
+                                       publishSnapshot(stream, snapshot);
+                                   }
+                                   if (analytics)
+                                       publishAnalytics(symbol, analytics, snapshot);
+                               }
+                               std::lock_guard<std::mutex> lock(m_pollingMutex);
+                               m_polling.erase(symbol); });
+    }
+}
+
+// push sources deliver every book here; the raw streams and analytics of the symbol publish it
+// right away, interval streams still pick up the latest one on their poll
+void WebSocketServer::onSourceSnapshot(const SnapshotCache::SnapshotPtr &snapshot)
+{
+    if (stopping())
+        return;
+    thread_local std::vector<StreamPtr> streams; // reused, a replay calls this millions of times a second
+    streams.clear();
+    AnalyticsPtr analytics;
+    {
+        // publish outside the lock so subscribes are not starved by a fast source
+        std::shared_lock<std::shared_mutex> lock(m_subscribersMutex);
+        StreamKey first;
+        first.symbol = snapshot->symbol;
+        for (auto it = m_streams.lower_bound(first); it != m_streams.end() && it->first.symbol == snapshot->symbol; ++it)
+        {
+            if (it->first.intervalMs == 0)
+                streams.push_back(it->second);
+            else
+                it->second->pushedSincePoll.fetch_add(1, std::memory_order_relaxed);
+        }
+        auto it = m_analytics.find(snapshot->symbol);
+        if (it != m_analytics.end())
+            analytics = it->second;
+    }
+    for (const StreamPtr &stream : streams)
+        publishSnapshot(stream, snapshot);
+    if (analytics)
+        publishAnalytics(snapshot->symbol, analytics, snapshot);
+    streams.clear();
+}
+
+void WebSocketServer::watchSymbol(const std::string &symbol)
+{
+    if (m_watched[symbol]++ == 0)
+        m_source->watch(symbol);
+}
+
+void WebSocketServer::unwatchSymbol(const std::string &symbol)
+{
+    auto it = m_watched.find(symbol);
+    if (it == m_watched.end() || --it->second > 0)
+        return;
+    m_watched.erase(it);
+    m_source->unwatch(symbol);
+}
+
+WebSocketServer::StreamPtr WebSocketServer::subscribeStream(websocketpp::connection_hdl hdl, const StreamKey &key)
+{
+    StreamPtr current = clientStream(hdl, key.symbol);
+    if (current && !(current->key < key) && !(key < current->key))
+        return current;
+    unsubscribeStream(hdl, key.symbol); // a client reads one stream per symbol
+
+    StreamPtr &entry = m_streams[key];
+    if (!entry)
+    {
+        entry = std::make_shared<SymbolStream>(key);
+        entry->lastPollNs = UtilityNamespace::steadyNowNs(); // the subscribe fetches the first snapshot
+        watchSymbol(key.symbol);
+    }
+    entry->subscribers.insert(hdl);
+    m_clientStreams[hdl][key.symbol] = entry;
+    return entry;
+}
 
-                                       std::string combinedMessage = nlohmann::json{
-                                           {"symbol", symbol},
-                                           {"data", orderbookJson},
-                                           {"timestamp", timestamp}}.dump();
+void WebSocketServer::unsubscribeStream(websocketpp::connection_hdl hdl, const std::string &symbol)
+{
+    auto client = m_clientStreams.find(hdl);
+    if (client == m_clientStreams.end())
+        return;
+    auto it = client->second.find(symbol);
+    if (it == client->second.end())
+        return;
+    StreamPtr stream = it->second;
+    client->second.erase(it);
+    if (client->second.empty())
+        m_clientStreams.erase(client);
 
-                                       m_server.get_io_service().post([this, hdl, combinedMessage]() {
-                    m_server.send(hdl, combinedMessage, websocketpp::frame::opcode::text);
-                });
-                                   } });
+    stream->subscribers.erase(hdl);
+    if (stream->subscribers.empty())
+    {
+        m_streams.erase(stream->key); // in-flight polls keep their reference until they finish
+        unwatchSymbol(symbol);
     }
 }
 
-void WebSocketServer::onOpen(websocketpp::connection_hdl hdl)
+WebSocketServer::StreamPtr WebSocketServer::clientStream(websocketpp::connection_hdl hdl, const std::string &symbol)
 {
+    auto client = m_clientStreams.find(hdl);
+    if (client == m_clientStreams.end())
+        return nullptr;
+    auto it = client->second.find(symbol);
+    return it == client->second.end() ? nullptr : it->second;
+}
 
-    m_connections.insert(hdl);
-    std::cout << "Client connected." << std::endl;
+// rewrites one side of the stream state to match the top depth levels (all for 0), collecting
+// changed and removed (amount 0) levels
+static void diffLevels(std::map<double, double> &current, const std::vector<BookLevel> &levels, size_t depth, std::vector<BookLevel> &changes)
+{
+    size_t count = depth ? std::min(depth, levels.size()) : levels.size();
+    std::map<double, double> next;
+    for (size_t i = 0; i < count; ++i)
+    {
+        const BookLevel &level = levels[i];
+        next[level.price] = level.amount;
+        auto it = current.find(level.price);
+        if (it == current.end() || it->second != level.amount)
+            changes.push_back(level);
+    }
+    for (const auto &level : current)
+    {
+        if (next.find(level.first) == next.end())
+            changes.push_back({level.first, 0.0});
+    }
+    current.swap(next);
 }
 
-void WebSocketServer::onClose(websocketpp::connection_hdl hdl)
+// turns a new snapshot into the next sequenced update for the stream's subscribers
+bool WebSocketServer::publishSnapshot(const StreamPtr &stream, const SnapshotCache::SnapshotPtr &snapshot)
 {
+    SymbolStream &s = *stream;
+    std::lock_guard<std::mutex> lock(s.mutex);
+    if (s.published == snapshot)
+        return false; // served from cache, nothing new
 
-    m_connections.erase(hdl);
-    // Remove the connection from all subscriptions
-    for (auto &pair : m_subscribers)
+    std::vector<BookLevel> bidChanges, askChanges;
+    diffLevels(s.bids, snapshot->bids, s.key.depth, bidChanges);
+    diffLevels(s.asks, snapshot->asks, s.key.depth, askChanges);
+    bool first = !s.published;
+    s.published = snapshot;
+    if (first)
     {
-        pair.second.erase(hdl);
+        // subscribers that joined before there was a book get it as a snapshot
+        s.seq = 1;
+        broadcast(std::shared_ptr<const ConnectionSet>(stream, &stream->subscribers), buildSnapshotFrame(s));
+        return true;
     }
-    std::cout << "Client disconnected." << std::endl;
+    if (bidChanges.empty() && askChanges.empty())
+        return false; // changes beyond depth are not this stream's business
+
+    ++s.seq;
+    std::shared_ptr<const std::string> frame = buildUpdateFrame(s.key.symbol, s.seq, bidChanges, askChanges, snapshot->receivedNs);
+    s.replay.emplace_back(s.seq, frame);
+    if (s.replay.size() > REPLAY_DEPTH)
+        s.replay.pop_front();
+    // posted under the stream lock so frames leave in seq order
+    broadcast(std::shared_ptr<const ConnectionSet>(stream, &stream->subscribers), frame);
+    m_publishLatency.record(UtilityNamespace::steadyNowNs() - snapshot->receivedNs);
+    return false;
 }
 
-void WebSocketServer::onMessage(websocketpp::connection_hdl hdl, server::message_ptr msg)
+// derived values only change with the book, so they are computed once here for all analytics subscribers
+bool WebSocketServer::publishAnalytics(const std::string &symbol, const AnalyticsPtr &analytics, const SnapshotCache::SnapshotPtr &snapshot)
+{
+    AnalyticsStream &a = *analytics;
+    std::lock_guard<std::mutex> lock(a.mutex);
+    if (a.published == snapshot)
+        return false;
+    bool first = !a.published;
+    a.published = snapshot;
+
+    SoaBook levels;
+    levels.assign(snapshot->bids, snapshot->asks);
+    if (!first && levels.bidPrices == a.levels.bidPrices && levels.bidSizes == a.levels.bidSizes &&
+        levels.askPrices == a.levels.askPrices && levels.askSizes == a.levels.askSizes)
+        return false;
+    a.levels = std::move(levels);
+
+    BookAnalytics values = UtilityNamespace::computeAnalytics(a.levels, m_analyticsConfig);
+    if (values.mid > 0.0)
+        a.spreads.add(values.spreadBps);
+    values.spreadMeanBps = a.spreads.mean();
+    values.spreadStddevBps = a.spreads.stddev();
+    a.frame = buildAnalyticsFrame(symbol, ++a.seq, values, snapshot->receivedNs);
+    broadcast(std::shared_ptr<const ConnectionSet>(analytics, &analytics->subscribers), a.frame);
+    return first;
+}
+
+// the whole chain goes out on every recompute; a client keeps its rows while the listing is unchanged
+void WebSocketServer::publishChain(const ChainPtr &stream, const OptionChain &chain)
 {
-    auto payload = msg->get_payload();
-    auto json = nlohmann::json::parse(payload);
+    if (stopping())
+        return;
+    int64_t computedNs = UtilityNamespace::steadyNowNs();
+    std::lock_guard<std::mutex> lock(stream->mutex);
+    stream->frame = buildChainFrame(++stream->seq, chain, computedNs);
+    broadcast(std::shared_ptr<const ConnectionSet>(stream, &stream->subscribers), stream->frame);
+}
+
+static int64_t wallClockMillis()
+{
+    auto currentTime = std::chrono::system_clock::now();
+    return std::chrono::duration_cast<std::chrono::milliseconds>(currentTime.time_since_epoch()).count();
+}
 
-    if (json.contains("action"))
+// recv_ns: upstream reply landed, send_ns: frame published; both on this host's steady clock,
+// clients map them onto their own clock with the offset from ping/pong
+static void appendLatencyStamps(std::string &out, int64_t receivedNs)
+{
+    out += ",\"recv_ns\":";
+    out += std::to_string(receivedNs);
+    out += ",\"send_ns\":";
+    out += std::to_string(UtilityNamespace::steadyNowNs());
+}
+
+static void appendLevels(std::string &out, const std::vector<BookLevel> &levels)
+{
+    out += '[';
+    for (size_t i = 0; i < levels.size(); ++i)
+    {
+        if (i)
+            out += ',';
+        out += '[';
+        UtilityNamespace::appendJsonNumber(out, levels[i].price);
+        out += ',';
+        UtilityNamespace::appendJsonNumber(out, levels[i].amount);
+        out += ']';
+    }
+    out += ']';
+}
+
+std::shared_ptr<const std::string> WebSocketServer::buildUpdateFrame(const std::string &symbol, uint64_t seq, const std::vector<BookLevel> &bids, const std::vector<BookLevel> &asks, int64_t receivedNs)
+{
+    auto frame = std::make_shared<std::string>();
+    frame->reserve(symbol.size() + (bids.size() + asks.size()) * 32 + 96);
+    *frame += "{\"type\":\"update\",\"symbol\":";
+    UtilityNamespace::appendJsonString(*frame, symbol);
+    *frame += ",\"seq\":";
+    *frame += std::to_string(seq);
+    *frame += ",\"bids\":";
+    appendLevels(*frame, bids);
+    *frame += ",\"asks\":";
+    appendLevels(*frame, asks);
+    appendLatencyStamps(*frame, receivedNs);
+    *frame += ",\"timestamp\":";
+    *frame += std::to_string(wallClockMillis());
+    *frame += '}';
+    return frame;
+}
+
+static void appendField(std::string &out, const char *name, double value)
+{
+    out += ",\"";
+    out += name;
+    out += "\":";
+    UtilityNamespace::appendJsonNumber(out, value);
+}
+
+std::shared_ptr<const std::string> WebSocketServer::buildAnalyticsFrame(const std::string &symbol, uint64_t seq, const BookAnalytics &analytics, int64_t receivedNs)
+{
+    auto frame = std::make_shared<std::string>();
+    frame->reserve(symbol.size() + 384);
+    *frame += "{\"type\":\"analytics\",\"symbol\":";
+    UtilityNamespace::appendJsonString(*frame, symbol);
+    *frame += ",\"seq\":";
+    *frame += std::to_string(seq);
+    appendField(*frame, "best_bid", analytics.bestBid);
+    appendField(*frame, "best_ask", analytics.bestAsk);
+    appendField(*frame, "mid", analytics.mid);
+    appendField(*frame, "spread", analytics.spread);
+    appendField(*frame, "spread_bps", analytics.spreadBps);
+    appendField(*frame, "spread_mean_bps", analytics.spreadMeanBps);
+    appendField(*frame, "spread_stddev_bps", analytics.spreadStddevBps);
+    appendField(*frame, "microprice", analytics.microprice);
+    appendField(*frame, "imbalance", analytics.imbalance);
+    appendField(*frame, "bid_depth", analytics.bidDepth);
+    appendField(*frame, "ask_depth", analytics.askDepth);
+    appendField(*frame, "vwap_buy", analytics.vwapBuy);
+    appendField(*frame, "vwap_sell", analytics.vwapSell);
+    appendField(*frame, "fill_size", m_analyticsConfig.fillSize);
+    appendLatencyStamps(*frame, receivedNs);
+    *frame += ",\"timestamp\":";
+    *frame += std::to_string(wallClockMillis());
+    *frame += '}';
+    return frame;
+}
+
+// NaN (no two-sided quote, expired, mid outside the no-arbitrage bounds) goes out as null
+static void appendColumn(std::string &out, const char *name, const OptionChain::Column &column)
+{
+    out += ",\"";
+    out += name;
+    out += "\":[";
+    for (size_t i = 0; i < column.size(); ++i)
+    {
+        if (i)
+            out += ',';
+        if (std::isnan(column[i]))
+            out += "null";
+        else
+            UtilityNamespace::appendJsonNumber(out, column[i]);
+    }
+    out += ']';
+}
+
+// columns in the chain's row order; recv_ns is when the chain was computed
+std::shared_ptr<const std::string> WebSocketServer::buildChainFrame(uint64_t seq, const OptionChain &chain, int64_t receivedNs)
+{
+    auto frame = std::make_shared<std::string>();
+    frame->reserve(chain.size() * 128 + 256);
+    *frame += "{\"type\":\"chain\",\"symbol\":";
+    UtilityNamespace::appendJsonString(*frame, chain.currency);
+    *frame += ",\"seq\":";
+    *frame += std::to_string(seq);
+    appendField(*frame, "underlying_price", chain.underlyingPrice);
+    *frame += ",\"computed_ms\":";
+    *frame += std::to_string(chain.computedMs);
+    *frame += ",\"instruments\":[";
+    for (size_t i = 0; i < chain.size(); ++i)
     {
-        std::unique_lock<std::shared_mutex> lock(m_subscribersMutex);
-        if (json["action"] == "subscribe" && json.contains("symbol"))
+        if (i)
+            *frame += ',';
+        UtilityNamespace::appendJsonString(*frame, chain.names[i]);
+    }
+    *frame += ']';
+    appendColumn(*frame, "bid", chain.bids);
+    appendColumn(*frame, "ask", chain.asks);
+    appendColumn(*frame, "iv", chain.iv);
+    appendColumn(*frame, "delta", chain.delta);
+    appendColumn(*frame, "gamma", chain.gamma);
+    appendColumn(*frame, "vega", chain.vega);
+    appendColumn(*frame, "theta", chain.theta);
+    appendLatencyStamps(*frame, receivedNs);
+    *frame += ",\"timestamp\":";
+    *frame += std::to_string(wallClockMillis());
+    *frame += '}';
+    return frame;
+}
+
+void WebSocketServer::postTo(websocketpp::connection_hdl hdl, std::shared_ptr<const std::string> frame)
+{
+    m_sendsPosted.add();
+    m_server.get_io_service().post([this, hdl, frame]()
+                                   {
+        websocketpp::lib::error_code ec;
+        m_server.send(hdl, *frame, websocketpp::frame::opcode::text, ec);
+        onFrameSent(*frame, ec ? 0 : 1); });
+}
+
+// full-book streams splice the upstream book verbatim, depth-limited ones (and books from sources
+// without a raw reply) list their levels
+std::shared_ptr<const std::string> WebSocketServer::buildSnapshotFrame(const SymbolStream &stream)
+{
+    const OrderbookSnapshot &snapshot = *stream.published;
+    bool splice = stream.key.depth == 0 && !snapshot.raw.empty();
+    auto frame = std::make_shared<std::string>();
+    frame->reserve((splice ? snapshot.raw.size() : (stream.bids.size() + stream.asks.size()) * 32) + stream.key.symbol.size() + 128);
+    *frame += "{\"type\":\"snapshot\",\"symbol\":";
+    UtilityNamespace::appendJsonString(*frame, stream.key.symbol);
+    *frame += ",\"seq\":";
+    *frame += std::to_string(stream.seq);
+    *frame += ",\"depth\":";
+    *frame += std::to_string(stream.key.depth);
+    *frame += ",\"interval_ms\":";
+    *frame += std::to_string(stream.key.intervalMs);
+    if (splice)
+    {
+        *frame += ",\"data\":";
+        *frame += snapshot.raw;
+    }
+    else
+    {
+        std::vector<BookLevel> bids, asks;
+        for (auto it = stream.bids.rbegin(); it != stream.bids.rend(); ++it)
+            bids.push_back({it->first, it->second});
+        for (const auto &level : stream.asks)
+            asks.push_back({level.first, level.second});
+        *frame += ",\"bids\":";
+        appendLevels(*frame, bids);
+        *frame += ",\"asks\":";
+        appendLevels(*frame, asks);
+    }
+    appendLatencyStamps(*frame, snapshot.receivedNs);
+    *frame += ",\"timestamp\":";
+    *frame += std::to_string(wallClockMillis());
+    *frame += '}';
+    return frame;
+}
+
+void WebSocketServer::broadcast(std::shared_ptr<const ConnectionSet> subscribers, std::shared_ptr<const std::string> frame)
+{
+    m_sendsPosted.add();
+    m_server.get_io_service().post([this, subscribers, frame]()
+                                   {
+        std::shared_lock<std::shared_mutex> lock(m_subscribersMutex);
+        size_t sent = 0;
+        for (const auto &hdl : *subscribers)
         {
-            std::string symbol = json["symbol"];
-            m_subscribers[symbol].insert(hdl);
-            std::cout << "Client subscribed to: " << symbol << std::endl;
+            websocketpp::lib::error_code ec;
+            m_server.send(hdl, *frame, websocketpp::frame::opcode::text, ec);
+            sent += ec ? 0 : 1;
         }
-        else if (json["action"] == "unsubscribe" && json.contains("symbol"))
+        onFrameSent(*frame, sent); });
+}
+
+// rejected requests, answered inline on the io thread
+void WebSocketServer::sendError(websocketpp::connection_hdl hdl, const std::string &message)
+{
+    std::string frame = "{\"type\":\"error\",\"message\":";
+    UtilityNamespace::appendJsonString(frame, message);
+    frame += '}';
+    websocketpp::lib::error_code ec;
+    m_server.send(hdl, frame, websocketpp::frame::opcode::text, ec);
+}
+
+// late joiners get the published book right away instead of waiting for the next poll
+void WebSocketServer::sendSnapshot(websocketpp::connection_hdl hdl, const StreamPtr &stream)
+{
+    {
+        std::lock_guard<std::mutex> lock(stream->mutex);
+        if (stream->published)
         {
-            std::string symbol = json["symbol"];
-            m_subscribers[symbol].erase(hdl);
-            std::cout << "Client unsubscribed from: " << symbol << std::endl;
+            postTo(hdl, buildSnapshotFrame(*stream));
+            return;
         }
-        else
+    }
+    threadPool.enqueue([this, hdl, stream]()
+                       {
+                           SnapshotCache::SnapshotPtr snapshot = m_snapshotCache.get(stream->key.symbol);
+                           if (!snapshot || publishSnapshot(stream, snapshot))
+                               return; // no book yet, or the first one already went to every subscriber
+                           std::lock_guard<std::mutex> lock(stream->mutex);
+                           postTo(hdl, buildSnapshotFrame(*stream)); });
+}
+
+// the latest analytics frame, fetching the book first if nobody has polled the symbol yet
+void WebSocketServer::sendAnalytics(websocketpp::connection_hdl hdl, const std::string &symbol, const AnalyticsPtr &analytics)
+{
+    {
+        std::lock_guard<std::mutex> lock(analytics->mutex);
+        if (analytics->frame)
         {
-            std::cout << "Unknown action received: " << json["action"] << std::endl;
+            postTo(hdl, analytics->frame);
+            return;
         }
     }
+    threadPool.enqueue([this, hdl, symbol, analytics]()
+                       {
+                           SnapshotCache::SnapshotPtr snapshot = m_snapshotCache.get(symbol);
+                           if (!snapshot || publishAnalytics(symbol, analytics, snapshot))
+                               return;
+                           std::lock_guard<std::mutex> lock(analytics->mutex);
+                           if (analytics->frame)
+                               postTo(hdl, analytics->frame); });
 }
-int main()
+
+// resends updates from fromSeq out of the replay ring, or a snapshot if they have been evicted;
+// every request is answered, so a recovering client never waits on silence
+void WebSocketServer::replayFrom(websocketpp::connection_hdl hdl, const StreamPtr &stream, uint64_t fromSeq)
 {
-    WebSocketServer wsServer;
-    try
+    SymbolStream &s = *stream;
+    std::lock_guard<std::mutex> lock(s.mutex);
+    if (!s.published)
+    {
+        // the stream's first snapshot goes to every subscriber when it arrives
+        sendError(hdl, "No book published for " + s.key.symbol + " yet");
+        return;
+    }
+    // a client ahead of the stream (e.g. of a restarted server) can only resync from a snapshot
+    if (fromSeq > s.seq || s.replay.empty() || s.replay.front().first > fromSeq)
     {
-        wsServer.startServer(9002);
+        postTo(hdl, buildSnapshotFrame(s));
+        return;
+    }
+    for (const auto &entry : s.replay)
+    {
+        if (entry.first >= fromSeq)
+            postTo(hdl, entry.second);
+    }
+}
 
-        std::thread updateThread([&wsServer]()
-                                 {
-            while (true) {
-                wsServer.sendOrderbookUpdate();
-                std::this_thread::sleep_for(std::chrono::seconds(10));
-            } });
+// answered inline on the io thread so queueing in the pool does not skew the clock offset
+void WebSocketServer::sendPong(websocketpp::connection_hdl hdl, int64_t clientSentNs, int64_t receivedNs)
+{
+    std::string frame = UtilityNamespace::encodePong(clientSentNs, receivedNs, UtilityNamespace::steadyNowNs());
+    websocketpp::lib::error_code ec;
+    m_server.send(hdl, frame, websocketpp::frame::opcode::text, ec);
+}
+
+void WebSocketServer::onOpen(websocketpp::connection_hdl hdl)
+{
+    std::unique_lock<std::shared_mutex> lock(m_subscribersMutex);
+    m_connections.insert(hdl);
+    OEMS_LOG_INFO("Client connected.");
+}
+
+void WebSocketServer::onClose(websocketpp::connection_hdl hdl)
+{
+    std::unique_lock<std::shared_mutex> lock(m_subscribersMutex);
 
-        // Main thread handles server shutdown gracefully
-        updateThread.join();
+    m_connections.erase(hdl);
+    // Remove the connection from all subscriptions
+    auto client = m_clientStreams.find(hdl);
+    if (client != m_clientStreams.end())
+    {
+        for (auto &entry : client->second)
+        {
+            entry.second->subscribers.erase(hdl);
+            if (entry.second->subscribers.empty())
+            {
+                m_streams.erase(entry.second->key);
+                unwatchSymbol(entry.first);
+            }
+        }
+        m_clientStreams.erase(client);
+    }
+    for (auto it = m_analytics.begin(); it != m_analytics.end();)
+    {
+        it->second->subscribers.erase(hdl);
+        if (it->second->subscribers.empty())
+        {
+            unwatchSymbol(it->first);
+            it = m_analytics.erase(it);
+        }
+        else
+            ++it;
+    }
+    for (const auto &entry : m_chains)
+        entry.second->subscribers.erase(hdl);
+    OEMS_LOG_INFO("Client disconnected.");
+}
+
+// "raw", "250ms", "1s" or a number of milliseconds
+static bool parseInterval(const nlohmann::json &value, int64_t &intervalMs)
+{
+    if (value.is_number_integer())
+    {
+        intervalMs = value.get<int64_t>();
+        return intervalMs >= 0;
+    }
+    if (!value.is_string())
+        return false;
+    std::string text = value.get<std::string>();
+    if (text == "raw")
+    {
+        intervalMs = 0;
+        return true;
+    }
+    size_t digits = 0;
+    while (digits < text.size() && std::isdigit(static_cast<unsigned char>(text[digits])))
+        ++digits;
+    if (digits == 0 || digits > 9)
+        return false;
+    int64_t number = std::stoll(text.substr(0, digits));
+    std::string unit = text.substr(digits);
+    if (unit == "ms" || unit.empty())
+        intervalMs = number;
+    else if (unit == "s")
+        intervalMs = number * 1000;
+    else
+        return false;
+    return true;
+}
+
+// depth and interval of a subscribe request; intervals round up to whole poll ticks so that
+// requests with the same effective cadence share a stream
+static bool parseStreamOptions(const nlohmann::json &json, size_t &depth, int64_t &intervalMs)
+{
+    depth = 0;
+    if (json.contains("depth"))
+    {
+        if (!json["depth"].is_number_unsigned())
+            return false;
+        depth = json["depth"].get<size_t>();
+    }
+    intervalMs = std::chrono::milliseconds(WebSocketServer::DEFAULT_INTERVAL).count();
+    if (json.contains("interval") && !parseInterval(json["interval"], intervalMs))
+        return false;
+    int64_t tickMs = std::chrono::milliseconds(WebSocketServer::POLL_TICK).count();
+    if (intervalMs > 0)
+        intervalMs = (intervalMs + tickMs - 1) / tickMs * tickMs;
+    return true;
+}
+
+// runs on the io thread: a malformed request is answered with an error frame instead of escaping run()
+void WebSocketServer::onMessage(websocketpp::connection_hdl hdl, server::message_ptr msg)
+{
+    int64_t receivedNs = UtilityNamespace::steadyNowNs();
+    try
+    {
+        handleRequest(hdl, nlohmann::json::parse(msg->get_payload()), receivedNs);
+    }
+    catch (const nlohmann::json::exception &e)
+    {
+        OEMS_LOG_WARN("Malformed client request: {}", e.what());
+        sendError(hdl, "Malformed request");
     }
     catch (const std::exception &e)
     {
-        std::cerr << "Exception: " << e.what() << std::endl;
-        wsServer.stopServer();
+        OEMS_LOG_ERROR("Client request failed: {}", e.what());
+        sendError(hdl, "Request failed");
+    }
+}
+
+void WebSocketServer::handleRequest(websocketpp::connection_hdl hdl, const nlohmann::json &json, int64_t receivedNs)
+{
+    if (!json.is_object() || !json.contains("action"))
+        return;
+    auto counter = json["action"].is_string() ? m_actionCounts.find(json["action"].get<std::string>()) : m_actionCounts.end();
+    (counter != m_actionCounts.end() ? counter->second : m_actionCounts.at("other"))->add();
+    if (!json["action"].is_string())
+    {
+        sendError(hdl, "action must be a string");
+        return;
+    }
+    std::string action = json["action"];
+    if (action == "ping")
+    {
+        int64_t clientSentNs = 0;
+        if (UtilityNamespace::readPingTimestamp(json, clientSentNs))
+            sendPong(hdl, clientSentNs, receivedNs);
+        else
+            sendError(hdl, "ping needs an integer t0");
+        return;
+    }
+    bool hasSymbol = json.contains("symbol");
+    if (hasSymbol && !json["symbol"].is_string())
+    {
+        sendError(hdl, "symbol must be a string");
+        return;
     }
-    wsServer.stopServer();
+    std::string symbol = hasSymbol ? json["symbol"].get<std::string>() : std::string();
 
-    return 0;
-}
\ No newline at end of file
+    std::unique_lock<std::shared_mutex> lock(m_subscribersMutex);
+    if (stopping() && (action == "subscribe" || action == "subscribe_analytics" || action == "subscribe_chain"))
+    {
+        sendError(hdl, "Server is shutting down");
+        return;
+    }
+    if (action == "subscribe" && hasSymbol)
+    {
+        StreamKey key;
+        key.symbol = symbol;
+        if (!parseStreamOptions(json, key.depth, key.intervalMs))
+        {
+            sendError(hdl, "Invalid depth or interval for " + key.symbol);
+            return;
+        }
+        StreamPtr stream = subscribeStream(hdl, key);
+        OEMS_LOG_INFO("Client subscribed to: {} (depth {}, interval {} ms)", key.symbol, key.depth, key.intervalMs);
+        sendSnapshot(hdl, stream);
+    }
+    else if ((action == "snapshot" || action == "replay") && hasSymbol)
+    {
+        StreamPtr stream = clientStream(hdl, symbol);
+        if (!stream)
+            sendError(hdl, "Not subscribed to " + symbol);
+        else if (action == "snapshot")
+            sendSnapshot(hdl, stream);
+        else if (!json.contains("from_seq") || !json["from_seq"].is_number_unsigned())
+            sendError(hdl, "replay needs an unsigned from_seq");
+        else
+            replayFrom(hdl, stream, json["from_seq"].get<uint64_t>());
+    }
+    else if (action == "unsubscribe" && hasSymbol)
+    {
+        unsubscribeStream(hdl, symbol);
+        OEMS_LOG_INFO("Client unsubscribed from: {}", symbol);
+    }
+    else if (action == "subscribe_analytics" && hasSymbol)
+    {
+        AnalyticsPtr &analytics = m_analytics[symbol];
+        if (!analytics)
+        {
+            analytics = std::make_shared<AnalyticsStream>();
+            watchSymbol(symbol);
+        }
+        analytics->subscribers.insert(hdl);
+        OEMS_LOG_INFO("Client subscribed to analytics: {}", symbol);
+        sendAnalytics(hdl, symbol, analytics);
+    }
+    else if (action == "unsubscribe_analytics" && hasSymbol)
+    {
+        auto it = m_analytics.find(symbol);
+        if (it != m_analytics.end())
+        {
+            it->second->subscribers.erase(hdl);
+            if (it->second->subscribers.empty())
+            {
+                m_analytics.erase(it);
+                unwatchSymbol(symbol);
+            }
+        }
+        OEMS_LOG_INFO("Client unsubscribed from analytics: {}", symbol);
+    }
+    else if (action == "subscribe_chain" && hasSymbol)
+    {
+        auto it = m_chains.find(symbol);
+        if (it == m_chains.end())
+        {
+            sendError(hdl, "No option chain for " + symbol);
+            return;
+        }
+        it->second->subscribers.insert(hdl);
+        OEMS_LOG_INFO("Client subscribed to the {} option chain", symbol);
+        std::lock_guard<std::mutex> chainLock(it->second->mutex);
+        if (it->second->frame)
+            postTo(hdl, it->second->frame);
+    }
+    else if (action == "unsubscribe_chain" && hasSymbol)
+    {
+        auto it = m_chains.find(symbol);
+        if (it != m_chains.end())
+            it->second->subscribers.erase(hdl);
+        OEMS_LOG_INFO("Client unsubscribed from the {} option chain", symbol);
+    }
+    else
+    {
+        OEMS_LOG_WARN("Unknown action received: {}", action);
+        sendError(hdl, "Unknown action or missing symbol: " + action);
+    }
+}
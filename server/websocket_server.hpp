@@ -2,33 +2,173 @@
 
 #include <websocketpp/config/asio_no_tls.hpp>
 #include <websocketpp/server.hpp>
+#include <atomic>
+#include <chrono>
+#include <deque>
+#include <map>
+#include <memory>
+#include <mutex>
 #include <set>
 #include <string>
+#include <tuple>
+#include <vector>
 #include <thread>
 #include <nlohmann/json.hpp>
 #include <unordered_map>
 #include <shared_mutex>
 #include "threadpool.hpp"
+#include "snapshot_cache.hpp"
+#include "market_data_source.hpp"
+#include "option_chain_source.hpp"
+#include "book_analytics.hpp"
+#include "metrics.hpp"
 typedef websocketpp::server<websocketpp::config::asio> server;
 
 class WebSocketServer
 {
 public:
-    WebSocketServer();
+    // null serves books from the exchange's REST API (RestSource)
+    explicit WebSocketServer(std::unique_ptr<MarketDataSource> source = nullptr);
+    ~WebSocketServer();
+    // serves subscribe_chain for the source's currency; call before startServer
+    void addOptionChain(std::unique_ptr<OptionChainSource> source);
+    // the port is bound with SO_REUSEPORT, so a new instance can listen on it while this one drains
     void startServer(uint16_t port);
-    void stopServer();
+    // Graceful stop, safe to call more than once: stops listening (handing new clients to a successor
+    // on the same port), cancels upstream fetches, runs queued publishes, closes every connection with
+    // 1001 going away after its queued frames and waits for the closing handshakes. Whatever is left
+    // when drainTimeout runs out is dropped.
+    void stopServer(std::chrono::milliseconds drainTimeout = DRAIN_TIMEOUT);
+    bool stopping() const { return m_stopping.load(std::memory_order_relaxed); }
+    // polls the symbols that have a stream due; call once per POLL_TICK
     void sendOrderbookUpdate();
 
+    static constexpr std::chrono::milliseconds POLL_TICK{100};          // finest interval, and the cadence of raw streams
+    static constexpr std::chrono::milliseconds DEFAULT_INTERVAL{10000}; // streams subscribed without an interval
+    static constexpr std::chrono::milliseconds DRAIN_TIMEOUT{2000};
+
 private:
     void onOpen(websocketpp::connection_hdl hdl);
     void onClose(websocketpp::connection_hdl hdl);
     void onMessage(websocketpp::connection_hdl hdl, server::message_ptr msg);
+    // one parsed client request, on the io thread; onMessage turns what it throws into an error frame
+    void handleRequest(websocketpp::connection_hdl hdl, const nlohmann::json &json, int64_t receivedNs);
+    // every book a push source delivers, on the source's thread
+    void onSourceSnapshot(const SnapshotCache::SnapshotPtr &snapshot);
+
+    using ConnectionSet = std::set<websocketpp::connection_hdl, std::owner_less<websocketpp::connection_hdl>>;
+
+    // what a subscribe asked for; every client asking for the same key reads the same stream
+    struct StreamKey
+    {
+        std::string symbol;
+        size_t depth = 0;       // top levels per side, 0 for the whole book
+        int64_t intervalMs = 0; // least time between updates, 0 for raw
+        bool operator<(const StreamKey &other) const
+        {
+            return std::tie(symbol, depth, intervalMs) < std::tie(other.symbol, other.depth, other.intervalMs);
+        }
+    };
+
+    // sequenced feed state of one key, see local_book.hpp for the frame protocol
+    struct SymbolStream
+    {
+        explicit SymbolStream(StreamKey key) : key(std::move(key)) {}
+
+        const StreamKey key;
+        std::mutex mutex; // serializes seq assignment and keeps posts in seq order
+        uint64_t seq = 0;
+        SnapshotCache::SnapshotPtr published;
+        std::map<double, double> bids; // levels as of seq, trimmed to depth
+        std::map<double, double> asks;
+        std::deque<std::pair<uint64_t, std::shared_ptr<const std::string>>> replay; // recent update frames
+        std::atomic<int64_t> lastPollNs{0};
+        std::atomic<uint64_t> pushedSincePoll{0}; // books a push source delivered to an interval stream
+        ConnectionSet subscribers;                // guarded by m_subscribersMutex
+    };
+    using StreamPtr = std::shared_ptr<SymbolStream>;
+
+    // derived values for subscribe_analytics, published on every poll that changed the book
+    struct AnalyticsStream
+    {
+        std::mutex mutex;
+        uint64_t seq = 0;
+        SnapshotCache::SnapshotPtr published;
+        std::shared_ptr<const std::string> frame; // latest analytics frame
+        SoaBook levels;                           // scratch for the analytics kernels
+        SpreadStats spreads;
+        std::atomic<int64_t> lastPollNs{0};
+        ConnectionSet subscribers; // guarded by m_subscribersMutex
+    };
+    using AnalyticsPtr = std::shared_ptr<AnalyticsStream>;
+
+    // one currency's option chain for subscribe_chain, a frame per recompute of its source
+    struct ChainStream
+    {
+        std::unique_ptr<OptionChainSource> source;
+        std::mutex mutex;
+        uint64_t seq = 0;
+        std::shared_ptr<const std::string> frame; // latest chain frame
+        ConnectionSet subscribers;                // guarded by m_subscribersMutex
+    };
+    using ChainPtr = std::shared_ptr<ChainStream>;
+
+    static constexpr size_t REPLAY_DEPTH = 1024;
+
+    // the m_subscribersMutex must be held exclusively
+    StreamPtr subscribeStream(websocketpp::connection_hdl hdl, const StreamKey &key);
+    void unsubscribeStream(websocketpp::connection_hdl hdl, const std::string &symbol);
+    StreamPtr clientStream(websocketpp::connection_hdl hdl, const std::string &symbol);
+
+    // symbols with streams or analytics, so push sources only subscribe upstream to what is read
+    void watchSymbol(const std::string &symbol);
+    void unwatchSymbol(const std::string &symbol);
+
+    // true when this was the stream's first book, which went to its subscribers as a snapshot
+    bool publishSnapshot(const StreamPtr &stream, const SnapshotCache::SnapshotPtr &snapshot);
+    bool publishAnalytics(const std::string &symbol, const AnalyticsPtr &analytics, const SnapshotCache::SnapshotPtr &snapshot);
+    void sendSnapshot(websocketpp::connection_hdl hdl, const StreamPtr &stream);
+    void sendAnalytics(websocketpp::connection_hdl hdl, const std::string &symbol, const AnalyticsPtr &analytics);
+    // every chain a source computes, on the source's thread
+    void publishChain(const ChainPtr &stream, const OptionChain &chain);
+    void replayFrom(websocketpp::connection_hdl hdl, const StreamPtr &stream, uint64_t fromSeq);
+    void postTo(websocketpp::connection_hdl hdl, std::shared_ptr<const std::string> frame);
+    // subscribers aliases the stream that owns the set, so it outlives the posted send
+    void broadcast(std::shared_ptr<const ConnectionSet> subscribers, std::shared_ptr<const std::string> frame);
+    void sendError(websocketpp::connection_hdl hdl, const std::string &message);
+    std::shared_ptr<const std::string> buildSnapshotFrame(const SymbolStream &stream);
+    std::shared_ptr<const std::string> buildUpdateFrame(const std::string &symbol, uint64_t seq, const std::vector<BookLevel> &bids, const std::vector<BookLevel> &asks, int64_t receivedNs);
+    std::shared_ptr<const std::string> buildAnalyticsFrame(const std::string &symbol, uint64_t seq, const BookAnalytics &analytics, int64_t receivedNs);
+    std::shared_ptr<const std::string> buildChainFrame(uint64_t seq, const OptionChain &chain, int64_t receivedNs);
+    void sendPong(websocketpp::connection_hdl hdl, int64_t clientSentNs, int64_t receivedNs);
+    // a send handler ran: counts the frame to subscribers it reached
+    void onFrameSent(const std::string &frame, size_t sent);
+    void registerMetrics();
 
     server m_server;
-    std::set<websocketpp::connection_hdl, std::owner_less<websocketpp::connection_hdl>> m_connections;
-    std::unordered_map<std::string, std::set<websocketpp::connection_hdl, std::owner_less<websocketpp::connection_hdl>>> m_subscribers;
-    std::thread m_serverThread;
+    std::unique_ptr<MarketDataSource> m_source;
+    ConnectionSet m_connections;
+    AnalyticsConfig m_analyticsConfig;
+    std::thread m_serverThread; // runs m_server's io_service; every send and handler is on it
+    std::atomic<bool> m_stopping{false};
+    SnapshotCache m_snapshotCache;
     ThreadPool threadPool;
     std::shared_mutex m_subscribersMutex;
+    std::map<StreamKey, StreamPtr> m_streams; // only keys with subscribers
+    std::unordered_map<std::string, AnalyticsPtr> m_analytics;
+    std::map<std::string, ChainPtr> m_chains; // by currency, fixed once the server starts
+    std::unordered_map<std::string, size_t> m_watched; // streams and analytics per symbol
+    std::map<websocketpp::connection_hdl, std::map<std::string, StreamPtr>, std::owner_less<websocketpp::connection_hdl>> m_clientStreams; // one stream per client and symbol
+    std::mutex m_pollingMutex;
+    std::set<std::string> m_polling; // symbols with a poll queued or running, skipped until it finishes
 
-};
\ No newline at end of file
+    // in the process registry (UtilityNamespace::metrics()), served by MetricsServer
+    Counter &m_framesSent;
+    Counter &m_bytesSent;
+    Counter &m_conflated;
+    Histogram &m_fetchLatency;
+    Histogram &m_publishLatency;
+    std::map<std::string, Counter *> m_actionCounts; // per client action, "other" for the rest
+    Counter m_sendsPosted;                           // with m_sendsDone, the sends queued on the io thread
+    Counter m_sendsDone;
+};
@@ -0,0 +1,89 @@
+#include "arena.hpp"
+#include <algorithm>
+#include <cstdlib>
+#include <new>
+
+namespace
+{
+    thread_local uint64_t heapAllocations = 0;
+}
+
+namespace UtilityNamespace
+{
+    uint64_t threadHeapAllocations()
+    {
+        return heapAllocations;
+    }
+}
+
+#ifdef OEMS_COUNT_ALLOCATIONS
+// global new hook so allocation-free paths can be checked, adds one TLS increment per allocation
+void *operator new(size_t size)
+{
+    ++heapAllocations;
+    if (void *ptr = std::malloc(size ? size : 1))
+        return ptr;
+    throw std::bad_alloc();
+}
+
+void *operator new[](size_t size)
+{
+    return operator new(size);
+}
+
+void operator delete(void *ptr) noexcept
+{
+    std::free(ptr);
+}
+
+void operator delete[](void *ptr) noexcept
+{
+    std::free(ptr);
+}
+
+void operator delete(void *ptr, size_t) noexcept
+{
+    std::free(ptr);
+}
+
+void operator delete[](void *ptr, size_t) noexcept
+{
+    std::free(ptr);
+}
+
+// over-aligned types (alignas(64) ring indices, cache-line columns) come through these instead
+void *operator new(size_t size, std::align_val_t align)
+{
+    ++heapAllocations;
+    size_t alignment = std::max(static_cast<size_t>(align), sizeof(void *));
+    void *ptr = nullptr;
+    if (posix_memalign(&ptr, alignment, size ? size : 1) == 0)
+        return ptr;
+    throw std::bad_alloc();
+}
+
+void *operator new[](size_t size, std::align_val_t align)
+{
+    return operator new(size, align);
+}
+
+void operator delete(void *ptr, std::align_val_t) noexcept
+{
+    std::free(ptr);
+}
+
+void operator delete[](void *ptr, std::align_val_t) noexcept
+{
+    std::free(ptr);
+}
+
+void operator delete(void *ptr, size_t, std::align_val_t) noexcept
+{
+    std::free(ptr);
+}
+
+void operator delete[](void *ptr, size_t, std::align_val_t) noexcept
+{
+    std::free(ptr);
+}
+#endif
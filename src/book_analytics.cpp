@@ -0,0 +1,193 @@
+#include "book_analytics.hpp"
+#include <algorithm>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+void SoaBook::assign(const std::vector<BookLevel> &bids, const std::vector<BookLevel> &asks)
+{
+    bidPrices.resize(bids.size());
+    bidSizes.resize(bids.size());
+    for (size_t i = 0; i < bids.size(); ++i)
+    {
+        bidPrices[i] = bids[i].price;
+        bidSizes[i] = bids[i].amount;
+    }
+    askPrices.resize(asks.size());
+    askSizes.resize(asks.size());
+    for (size_t i = 0; i < asks.size(); ++i)
+    {
+        askPrices[i] = asks[i].price;
+        askSizes[i] = asks[i].amount;
+    }
+}
+
+void SoaBook::assign(const LocalOrderBook &book)
+{
+    bidPrices.clear();
+    bidSizes.clear();
+    askPrices.clear();
+    askSizes.clear();
+    for (const auto &level : book.bids)
+    {
+        bidPrices.push_back(level.first);
+        bidSizes.push_back(level.second);
+    }
+    for (const auto &level : book.asks)
+    {
+        askPrices.push_back(level.first);
+        askSizes.push_back(level.second);
+    }
+}
+
+namespace
+{
+#if defined(__AVX2__)
+    constexpr size_t LANES = 4;
+    using Vec = __m256d;
+    inline Vec load(const double *p) { return _mm256_loadu_pd(p); }
+    inline Vec zero() { return _mm256_setzero_pd(); }
+    inline Vec splat(double v) { return _mm256_set1_pd(v); }
+    inline Vec add(Vec a, Vec b) { return _mm256_add_pd(a, b); }
+    inline Vec mul(Vec a, Vec b) { return _mm256_mul_pd(a, b); }
+    // keeps value where low <= price <= high
+    inline Vec inBand(Vec price, Vec value, Vec low, Vec high)
+    {
+        Vec mask = _mm256_and_pd(_mm256_cmp_pd(price, low, _CMP_GE_OQ), _mm256_cmp_pd(price, high, _CMP_LE_OQ));
+        return _mm256_and_pd(mask, value);
+    }
+    inline double hsum(Vec v)
+    {
+        __m128d pair = _mm_add_pd(_mm256_castpd256_pd128(v), _mm256_extractf128_pd(v, 1));
+        return _mm_cvtsd_f64(_mm_add_sd(pair, _mm_unpackhi_pd(pair, pair)));
+    }
+#elif defined(__SSE2__)
+    constexpr size_t LANES = 2;
+    using Vec = __m128d;
+    inline Vec load(const double *p) { return _mm_loadu_pd(p); }
+    inline Vec zero() { return _mm_setzero_pd(); }
+    inline Vec splat(double v) { return _mm_set1_pd(v); }
+    inline Vec add(Vec a, Vec b) { return _mm_add_pd(a, b); }
+    inline Vec mul(Vec a, Vec b) { return _mm_mul_pd(a, b); }
+    inline Vec inBand(Vec price, Vec value, Vec low, Vec high)
+    {
+        Vec mask = _mm_and_pd(_mm_cmpge_pd(price, low), _mm_cmple_pd(price, high));
+        return _mm_and_pd(mask, value);
+    }
+    inline double hsum(Vec v)
+    {
+        return _mm_cvtsd_f64(_mm_add_sd(v, _mm_unpackhi_pd(v, v)));
+    }
+#else
+    // portable fallback with the same shape, one lane
+    constexpr size_t LANES = 1;
+    using Vec = double;
+    inline Vec load(const double *p) { return *p; }
+    inline Vec zero() { return 0.0; }
+    inline Vec splat(double v) { return v; }
+    inline Vec add(Vec a, Vec b) { return a + b; }
+    inline Vec mul(Vec a, Vec b) { return a * b; }
+    inline Vec inBand(Vec price, Vec value, Vec low, Vec high) { return price >= low && price <= high ? value : 0.0; }
+    inline double hsum(Vec v) { return v; }
+#endif
+}
+
+double UtilityNamespace::sumSizes(const double *sizes, size_t count)
+{
+    // two accumulators hide the add latency
+    Vec acc0 = zero(), acc1 = zero();
+    size_t i = 0;
+    for (; i + 2 * LANES <= count; i += 2 * LANES)
+    {
+        acc0 = add(acc0, load(sizes + i));
+        acc1 = add(acc1, load(sizes + i + LANES));
+    }
+    double total = hsum(add(acc0, acc1));
+    for (; i < count; ++i)
+        total += sizes[i];
+    return total;
+}
+
+double UtilityNamespace::sumWithinBand(const double *prices, const double *sizes, size_t count, double low, double high)
+{
+    Vec acc = zero();
+    Vec lowV = splat(low), highV = splat(high);
+    size_t i = 0;
+    for (; i + LANES <= count; i += LANES)
+        acc = add(acc, inBand(load(prices + i), load(sizes + i), lowV, highV));
+    double total = hsum(acc);
+    for (; i < count; ++i)
+    {
+        if (prices[i] >= low && prices[i] <= high)
+            total += sizes[i];
+    }
+    return total;
+}
+
+// whole vectors are taken while they fit in the remaining size, the crossing vector is walked level by level
+double UtilityNamespace::vwapToFill(const double *prices, const double *sizes, size_t count, double target)
+{
+    if (target <= 0.0)
+        return 0.0;
+    double filled = 0.0, notional = 0.0;
+    size_t i = 0;
+    for (; i + LANES <= count; i += LANES)
+    {
+        Vec size = load(sizes + i);
+        double blockSize = hsum(size);
+        if (filled + blockSize >= target)
+            break;
+        filled += blockSize;
+        notional += hsum(mul(load(prices + i), size));
+    }
+    for (; i < count && filled < target; ++i)
+    {
+        double take = std::min(sizes[i], target - filled);
+        filled += take;
+        notional += take * prices[i];
+    }
+    return filled + 1e-12 >= target ? notional / filled : 0.0;
+}
+
+// a prefix sum is one dependency chain, so it stays scalar
+void UtilityNamespace::cumulativeDepth(const double *sizes, size_t count, double *out)
+{
+    double running = 0.0;
+    for (size_t i = 0; i < count; ++i)
+    {
+        running += sizes[i];
+        out[i] = running;
+    }
+}
+
+BookAnalytics UtilityNamespace::computeAnalytics(const SoaBook &book, const AnalyticsConfig &config)
+{
+    BookAnalytics result;
+    size_t bidCount = book.bidPrices.size(), askCount = book.askPrices.size();
+    if (bidCount == 0 || askCount == 0)
+        return result;
+
+    result.bestBid = book.bidPrices[0];
+    result.bestAsk = book.askPrices[0];
+    result.mid = (result.bestBid + result.bestAsk) / 2.0;
+    result.spread = result.bestAsk - result.bestBid;
+    result.spreadBps = result.mid > 0.0 ? result.spread / result.mid * 10000.0 : 0.0;
+
+    double bidTop = book.bidSizes[0], askTop = book.askSizes[0];
+    result.microprice = bidTop + askTop > 0.0 ? (result.bestBid * askTop + result.bestAsk * bidTop) / (bidTop + askTop) : result.mid;
+
+    double bidQty = sumSizes(book.bidSizes.data(), std::min(config.imbalanceLevels, bidCount));
+    double askQty = sumSizes(book.askSizes.data(), std::min(config.imbalanceLevels, askCount));
+    result.imbalance = bidQty + askQty > 0.0 ? (bidQty - askQty) / (bidQty + askQty) : 0.0;
+
+    double band = result.mid * config.depthBandBps / 10000.0;
+    result.bidDepth = sumWithinBand(book.bidPrices.data(), book.bidSizes.data(), bidCount, result.mid - band, result.mid);
+    result.askDepth = sumWithinBand(book.askPrices.data(), book.askSizes.data(), askCount, result.mid, result.mid + band);
+
+    result.vwapBuy = vwapToFill(book.askPrices.data(), book.askSizes.data(), askCount, config.fillSize);
+    result.vwapSell = vwapToFill(book.bidPrices.data(), book.bidSizes.data(), bidCount, config.fillSize);
+    return result;
+}
@@ -0,0 +1,286 @@
+#include "feed_decoder.hpp"
+#include "jsonrpc.hpp"
+#include <charconv>
+#include <limits>
+#include <nlohmann/json.hpp>
+
+static void parseLevels(simdjson::ondemand::array levels, std::vector<BookLevel> &side)
+{
+    for (auto level : levels)
+    {
+        BookLevel parsed;
+        size_t index = 0;
+        for (auto number : level.get_array())
+        {
+            double value = number.get_double();
+            if (index == 0)
+                parsed.price = value;
+            else if (index == 1)
+                parsed.amount = value;
+            ++index;
+        }
+        side.push_back(parsed);
+    }
+}
+
+static FrameType frameType(std::string_view type)
+{
+    if (type == "snapshot")
+        return FrameType::Snapshot;
+    if (type == "update")
+        return FrameType::Update;
+    if (type == "pong")
+        return FrameType::Pong;
+    if (type == "analytics")
+        return FrameType::Analytics;
+    if (type == "chain")
+        return FrameType::Chain;
+    if (type == "error")
+        return FrameType::Error;
+    return FrameType::Unknown;
+}
+
+// where an analytics frame field goes, nullptr for fields that are not analytics values
+static double *analyticsField(BookAnalytics &analytics, std::string_view key)
+{
+    if (key == "best_bid")
+        return &analytics.bestBid;
+    if (key == "best_ask")
+        return &analytics.bestAsk;
+    if (key == "mid")
+        return &analytics.mid;
+    if (key == "spread")
+        return &analytics.spread;
+    if (key == "spread_bps")
+        return &analytics.spreadBps;
+    if (key == "spread_mean_bps")
+        return &analytics.spreadMeanBps;
+    if (key == "spread_stddev_bps")
+        return &analytics.spreadStddevBps;
+    if (key == "microprice")
+        return &analytics.microprice;
+    if (key == "imbalance")
+        return &analytics.imbalance;
+    if (key == "bid_depth")
+        return &analytics.bidDepth;
+    if (key == "ask_depth")
+        return &analytics.askDepth;
+    if (key == "vwap_buy")
+        return &analytics.vwapBuy;
+    if (key == "vwap_sell")
+        return &analytics.vwapSell;
+    return nullptr;
+}
+
+static void addChainRow(OptionChain &chain, std::string_view name)
+{
+    OptionContract contract;
+    if (!UtilityNamespace::parseOptionName(name, contract))
+        contract.name.assign(name.data(), name.size()); // keeps the rows aligned with the columns
+    chain.add(contract);
+}
+
+// the listing only changes when options are listed or expire, so the rows are rebuilt from the
+// first name that differs
+static void parseChainRows(simdjson::ondemand::array names, OptionChain &chain)
+{
+    size_t row = 0;
+    bool rebuilt = false;
+    for (auto value : names)
+    {
+        std::string_view name = value.get_string();
+        if (!rebuilt && row < chain.size() && chain.names[row] == name)
+        {
+            ++row;
+            continue;
+        }
+        if (!rebuilt)
+        {
+            std::vector<std::string> kept(chain.names.begin(), chain.names.begin() + row);
+            chain.clear();
+            for (const std::string &keptName : kept)
+                addChainRow(chain, keptName);
+            rebuilt = true;
+        }
+        addChainRow(chain, name);
+        ++row;
+    }
+    if (!rebuilt && row < chain.size())
+    {
+        std::vector<std::string> kept(chain.names.begin(), chain.names.begin() + row);
+        chain.clear();
+        for (const std::string &keptName : kept)
+            addChainRow(chain, keptName);
+    }
+}
+
+// null for rows without a value
+static void parseChainColumn(simdjson::ondemand::array values, OptionChain::Column &column)
+{
+    size_t row = 0;
+    for (auto value : values)
+    {
+        double number;
+        if (row < column.size())
+            column[row] = value.get_double().get(number) == simdjson::SUCCESS ? number : std::numeric_limits<double>::quiet_NaN();
+        ++row;
+    }
+}
+
+// where a chain frame column goes, nullptr for fields that are not chain columns
+static OptionChain::Column *chainColumn(OptionChain &chain, std::string_view key)
+{
+    if (key == "bid")
+        return &chain.bids;
+    if (key == "ask")
+        return &chain.asks;
+    if (key == "iv")
+        return &chain.iv;
+    if (key == "delta")
+        return &chain.delta;
+    if (key == "gamma")
+        return &chain.gamma;
+    if (key == "vega")
+        return &chain.vega;
+    if (key == "theta")
+        return &chain.theta;
+    return nullptr;
+}
+
+void UtilityNamespace::decodeFeedFrame(simdjson::ondemand::parser &parser, std::string &payload, FeedFrame &frame)
+{
+    frame.type = FrameType::Snapshot;
+    frame.symbol.clear();
+    frame.seq = 0;
+    frame.bids.clear();
+    frame.asks.clear();
+    frame.upstreamNs = 0;
+    frame.sentNs = 0;
+    frame.analytics = BookAnalytics();
+    frame.error.clear();
+
+    simdjson::ondemand::document doc = parser.iterate(payload);
+    for (auto field : doc.get_object())
+    {
+        std::string_view key = field.unescaped_key();
+        if (key == "type")
+        {
+            frame.type = frameType(field.value().get_string());
+        }
+        else if (key == "symbol")
+        {
+            std::string_view symbol = field.value().get_string();
+            frame.symbol.assign(symbol.data(), symbol.size());
+        }
+        else if (key == "seq")
+        {
+            frame.seq = field.value().get_uint64();
+        }
+        else if (key == "data")
+        {
+            simdjson::ondemand::object result = field.value()["result"].get_object();
+            for (auto side : result)
+            {
+                std::string_view sideKey = side.unescaped_key();
+                if (sideKey == "bids" || sideKey == "asks")
+                    parseLevels(side.value().get_array(), sideKey == "bids" ? frame.bids : frame.asks);
+            }
+        }
+        else if (key == "bids" || key == "asks")
+        {
+            parseLevels(field.value().get_array(), key == "bids" ? frame.bids : frame.asks);
+        }
+        else if (key == "recv_ns")
+        {
+            frame.upstreamNs = field.value().get_int64();
+        }
+        else if (key == "send_ns")
+        {
+            frame.sentNs = field.value().get_int64();
+        }
+        else if (key == "instruments")
+        {
+            parseChainRows(field.value().get_array(), frame.chain);
+        }
+        else if (OptionChain::Column *column = chainColumn(frame.chain, key))
+        {
+            parseChainColumn(field.value().get_array(), *column);
+        }
+        else if (key == "underlying_price")
+        {
+            frame.chain.underlyingPrice = field.value().get_double();
+        }
+        else if (key == "computed_ms")
+        {
+            frame.chain.computedMs = field.value().get_int64();
+        }
+        else if (key == "message")
+        {
+            std::string_view message = field.value().get_string();
+            frame.error.assign(message.data(), message.size());
+        }
+        else if (double *value = analyticsField(frame.analytics, key))
+        {
+            *value = field.value().get_double();
+        }
+    }
+    if (frame.type == FrameType::Chain)
+        frame.chain.currency = frame.symbol;
+}
+
+std::string UtilityNamespace::encodeSubscribe(const std::string &symbol, const StreamOptions &options)
+{
+    std::string message = "{\"action\":\"subscribe\",\"symbol\":";
+    appendJsonString(message, symbol);
+    if (options.depth)
+    {
+        message += ",\"depth\":";
+        message += std::to_string(options.depth);
+    }
+    if (!options.interval.empty())
+    {
+        message += ",\"interval\":";
+        appendJsonString(message, options.interval);
+    }
+    message += '}';
+    return message;
+}
+
+// an integer right after "key":, searched for backwards from end
+static bool findIntegerBefore(std::string_view payload, std::string_view key, size_t end, int64_t &value, size_t &at)
+{
+    at = payload.rfind(key, end);
+    if (at == std::string_view::npos)
+        return false;
+    const char *first = payload.data() + at + key.size();
+    return std::from_chars(first, payload.data() + payload.size(), value).ec == std::errc();
+}
+
+bool UtilityNamespace::findLatencyStamps(std::string_view payload, int64_t &upstreamNs, int64_t &sentNs)
+{
+    size_t sendAt = 0, recvAt = 0;
+    return findIntegerBefore(payload, "\"send_ns\":", std::string_view::npos, sentNs, sendAt) &&
+           findIntegerBefore(payload, "\"recv_ns\":", sendAt, upstreamNs, recvAt);
+}
+
+bool UtilityNamespace::readPingTimestamp(const nlohmann::json &request, int64_t &t0)
+{
+    auto field = request.find("t0");
+    if (field == request.end() || !field->is_number_integer())
+        return false;
+    t0 = field->get<int64_t>();
+    return true;
+}
+
+// the client spots pongs by this fixed prefix without a parse
+std::string UtilityNamespace::encodePong(int64_t t0, int64_t t1, int64_t t2)
+{
+    std::string frame = "{\"type\":\"pong\",\"t0\":";
+    frame += std::to_string(t0);
+    frame += ",\"t1\":";
+    frame += std::to_string(t1);
+    frame += ",\"t2\":";
+    frame += std::to_string(t2);
+    frame += '}';
+    return frame;
+}
@@ -0,0 +1,316 @@
+#include "feed_subscriber.hpp"
+#include "clock.hpp"
+#include "jsonrpc.hpp"
+#include "thread_affinity.hpp"
+#include <stdexcept>
+
+FeedSubscriber::FeedSubscriber(FeedSubscriberOptions opts)
+    : options(std::move(opts)), stream("Feed subscriber", options.endpoints, options.reconnect, options.heartbeat)
+{
+    Stream::Handlers handlers;
+    handlers.open = [this](websocketpp::connection_hdl hdl)
+    { return onOpen(hdl); };
+    handlers.close = [this](websocketpp::connection_hdl hdl, bool wasConnected)
+    { onClose(hdl, wasConnected); };
+    handlers.message = [this](websocketpp::connection_hdl hdl, Stream::MessagePtr msg, int64_t receivedNs)
+    { onMessage(hdl, std::move(msg), receivedNs); };
+    handlers.silent = [this]()
+    { heartbeatTimeoutCount.fetch_add(1, std::memory_order_relaxed); };
+    handlers.error = [this](const std::string &message)
+    { reportError(message); };
+    stream.setHandlers(std::move(handlers));
+    stream.setFollowGoingAway(true);
+    stream.client().set_socket_init_handler(bind(&FeedSubscriber::onSocketInit, this, std::placeholders::_1, std::placeholders::_2));
+}
+
+FeedSubscriber::~FeedSubscriber()
+{
+    stop();
+}
+
+void FeedSubscriber::start()
+{
+    stream.start([this]()
+                 { UtilityNamespace::pinCurrentThread(options.socket.ioCpu); });
+}
+
+// closes the connection; the stream gives the close handshake STOP_TIMEOUT before cutting the I/O off
+void FeedSubscriber::stop()
+{
+    stream.stop();
+}
+
+static std::string subscriptionMessage(const char *action, const std::string &symbol)
+{
+    std::string message = "{\"action\":\"";
+    message += action;
+    message += "\",\"symbol\":";
+    UtilityNamespace::appendJsonString(message, symbol);
+    message += '}';
+    return message;
+}
+
+void FeedSubscriber::subscribe(const std::string &symbol, BookHandler handler, StreamOptions streamOptions)
+{
+    auto subscription = std::make_shared<Subscription>();
+    subscription->handler = std::move(handler);
+    subscription->options = std::move(streamOptions);
+    std::string message = UtilityNamespace::encodeSubscribe(symbol, subscription->options);
+    {
+        std::lock_guard<std::mutex> lock(subscriptionsMutex);
+        subscriptions[symbol] = std::move(subscription);
+    }
+    post(std::move(message));
+}
+
+void FeedSubscriber::unsubscribe(const std::string &symbol)
+{
+    {
+        std::lock_guard<std::mutex> lock(subscriptionsMutex);
+        subscriptions.erase(symbol);
+    }
+    post(subscriptionMessage("unsubscribe", symbol));
+}
+
+void FeedSubscriber::subscribeAnalytics(const std::string &symbol, AnalyticsHandler handler)
+{
+    {
+        std::lock_guard<std::mutex> lock(subscriptionsMutex);
+        analyticsSubscriptions[symbol] = std::make_shared<AnalyticsHandler>(std::move(handler));
+    }
+    post(subscriptionMessage("subscribe_analytics", symbol));
+}
+
+void FeedSubscriber::unsubscribeAnalytics(const std::string &symbol)
+{
+    {
+        std::lock_guard<std::mutex> lock(subscriptionsMutex);
+        analyticsSubscriptions.erase(symbol);
+    }
+    post(subscriptionMessage("unsubscribe_analytics", symbol));
+}
+
+void FeedSubscriber::subscribeChain(const std::string &currency, ChainHandler handler)
+{
+    {
+        std::lock_guard<std::mutex> lock(subscriptionsMutex);
+        chainSubscriptions[currency] = std::make_shared<ChainHandler>(std::move(handler));
+    }
+    post(subscriptionMessage("subscribe_chain", currency));
+}
+
+void FeedSubscriber::unsubscribeChain(const std::string &currency)
+{
+    {
+        std::lock_guard<std::mutex> lock(subscriptionsMutex);
+        chainSubscriptions.erase(currency);
+    }
+    post(subscriptionMessage("unsubscribe_chain", currency));
+}
+
+void FeedSubscriber::setStatusHandler(StatusHandler handler)
+{
+    statusHandler = std::move(handler);
+}
+
+void FeedSubscriber::setErrorHandler(ErrorHandler handler)
+{
+    errorHandler = std::move(handler);
+}
+
+void FeedSubscriber::onSocketInit(websocketpp::connection_hdl, boost::asio::ip::tcp::socket &socket)
+{
+    socketFd = socket.native_handle();
+    UtilityNamespace::applySocketOptions(socketFd, options.socket, &connectionStats);
+}
+
+bool FeedSubscriber::onOpen(websocketpp::connection_hdl)
+{
+    if (statusHandler)
+        statusHandler(endpoint(), true);
+
+    // every symbol starts over from the snapshot the server sends on subscribe
+    std::vector<std::string> messages;
+    {
+        std::lock_guard<std::mutex> lock(subscriptionsMutex);
+        for (auto &entry : subscriptions)
+        {
+            entry.second->feed.sequencer.reset();
+            messages.push_back(UtilityNamespace::encodeSubscribe(entry.first, entry.second->options));
+        }
+        for (auto &entry : analyticsSubscriptions)
+            messages.push_back(subscriptionMessage("subscribe_analytics", entry.first));
+        for (auto &entry : chainSubscriptions)
+            messages.push_back(subscriptionMessage("subscribe_chain", entry.first));
+    }
+    for (const std::string &message : messages)
+        send(message);
+    return true;
+}
+
+// also for a failed attempt; the stream moves on to the next endpoint, or back to a draining one
+void FeedSubscriber::onClose(websocketpp::connection_hdl, bool wasConnected)
+{
+    socketFd = -1;
+    if (wasConnected && statusHandler)
+        statusHandler(endpoint(), false);
+    if (stream.running())
+        reconnectCount.fetch_add(1, std::memory_order_relaxed);
+}
+
+void FeedSubscriber::onMessage(websocketpp::connection_hdl, Stream::MessagePtr msg, int64_t receivedNs)
+{
+    std::string &payload = msg->get_raw_payload();
+    connectionStats.messagesReceived.fetch_add(1, std::memory_order_relaxed);
+    connectionStats.bytesReceived.fetch_add(payload.size(), std::memory_order_relaxed);
+    if (options.socket.quickAck && socketFd >= 0)
+        UtilityNamespace::rearmQuickAck(socketFd);
+
+    try
+    {
+        UtilityNamespace::decodeFeedFrame(parser, payload, frame);
+    }
+    catch (const simdjson::simdjson_error &e)
+    {
+        reportError(std::string("Malformed feed frame: ") + e.what());
+        return;
+    }
+    if (frame.type == FrameType::Analytics)
+    {
+        onAnalytics();
+        return;
+    }
+    if (frame.type == FrameType::Chain)
+    {
+        onChain();
+        return;
+    }
+    if (frame.type == FrameType::Error)
+    {
+        reportError("Server rejected a request: " + frame.error);
+        return;
+    }
+    if (frame.type != FrameType::Snapshot && frame.type != FrameType::Update)
+        return;
+
+    std::shared_ptr<Subscription> subscription;
+    {
+        std::lock_guard<std::mutex> lock(subscriptionsMutex);
+        auto it = subscriptions.find(frame.symbol);
+        if (it == subscriptions.end())
+            return; // late frame for a dropped subscription
+        subscription = it->second;
+    }
+
+    SymbolFeed &feed = subscription->feed;
+    switch (feed.onFrame(frame.type == FrameType::Snapshot, frame.seq, frame.bids, frame.asks))
+    {
+    case FrameAction::Apply:
+        if (subscription->handler)
+        {
+            try
+            {
+                subscription->handler(BookEvent{frame, feed.book, receivedNs});
+            }
+            catch (const std::exception &e)
+            {
+                reportError("Handler for " + frame.symbol + " threw: " + e.what());
+            }
+        }
+        break;
+    case FrameAction::Recover:
+    {
+        gapCount.fetch_add(1, std::memory_order_relaxed);
+        std::string message = "{\"action\":\"replay\",\"symbol\":";
+        UtilityNamespace::appendJsonString(message, frame.symbol);
+        message += ",\"from_seq\":";
+        message += std::to_string(feed.sequencer.expected());
+        message += '}';
+        send(message);
+        break;
+    }
+    case FrameAction::Resync:
+    {
+        std::string message = "{\"action\":\"snapshot\",\"symbol\":";
+        UtilityNamespace::appendJsonString(message, frame.symbol);
+        message += '}';
+        send(message);
+        break;
+    }
+    case FrameAction::Ignore:
+        break;
+    }
+}
+
+void FeedSubscriber::onAnalytics()
+{
+    std::shared_ptr<AnalyticsHandler> handler;
+    {
+        std::lock_guard<std::mutex> lock(subscriptionsMutex);
+        auto it = analyticsSubscriptions.find(frame.symbol);
+        if (it == analyticsSubscriptions.end())
+            return;
+        handler = it->second;
+    }
+    if (!*handler)
+        return;
+    try
+    {
+        (*handler)(frame.symbol, frame.analytics);
+    }
+    catch (const std::exception &e)
+    {
+        reportError("Analytics handler for " + frame.symbol + " threw: " + e.what());
+    }
+}
+
+void FeedSubscriber::onChain()
+{
+    std::shared_ptr<ChainHandler> handler;
+    {
+        std::lock_guard<std::mutex> lock(subscriptionsMutex);
+        auto it = chainSubscriptions.find(frame.symbol);
+        if (it == chainSubscriptions.end())
+            return;
+        handler = it->second;
+    }
+    if (!*handler)
+        return;
+    try
+    {
+        (*handler)(frame.chain);
+    }
+    catch (const std::exception &e)
+    {
+        reportError("Chain handler for " + frame.symbol + " threw: " + e.what());
+    }
+}
+
+// sends from the I/O thread, so callers on other threads never touch the connection
+void FeedSubscriber::post(std::string message)
+{
+    stream.client().get_io_service().post([this, message = std::move(message)]()
+                                          { send(message); });
+}
+
+// drops the message when disconnected, onOpen resubscribes everything
+void FeedSubscriber::send(const std::string &message)
+{
+    if (!stream.connected())
+        return;
+    websocketpp::lib::error_code ec;
+    stream.client().send(stream.connection(), message, websocketpp::frame::opcode::text, ec);
+    if (ec)
+    {
+        reportError("Send failed: " + ec.message());
+        return;
+    }
+    connectionStats.bytesSent.fetch_add(message.size(), std::memory_order_relaxed);
+}
+
+void FeedSubscriber::reportError(const std::string &message)
+{
+    connectionStats.failures.fetch_add(1, std::memory_order_relaxed);
+    if (errorHandler)
+        errorHandler(message);
+}
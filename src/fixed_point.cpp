@@ -0,0 +1,159 @@
+#include "fixed_point.hpp"
+#include <charconv>
+#include <cstring>
+#include <limits>
+#include <memory_resource>
+#include <string>
+
+namespace
+{
+    constexpr int64_t POW10[19] = {1LL, 10LL, 100LL, 1000LL, 10000LL, 100000LL, 1000000LL, 10000000LL, 100000000LL,
+                                   1000000000LL, 10000000000LL, 100000000000LL, 1000000000000LL, 10000000000000LL,
+                                   100000000000000LL, 1000000000000000LL, 10000000000000000LL, 100000000000000000LL,
+                                   1000000000000000000LL};
+
+    // text as mantissa * 10^exponent, with the mantissa's trailing zeros moved into the exponent
+    bool parseMantissa(std::string_view text, bool &negative, uint64_t &mantissa, int &exponent)
+    {
+        size_t i = 0;
+        negative = false;
+        if (i < text.size() && (text[i] == '-' || text[i] == '+'))
+            negative = text[i++] == '-';
+
+        mantissa = 0;
+        exponent = 0;
+        int zeros = 0; // zeros read since the last nonzero digit, not yet in the mantissa
+        bool digits = false;
+        bool point = false;
+        for (; i < text.size(); ++i)
+        {
+            char c = text[i];
+            if (c == '.' && !point)
+            {
+                point = true;
+                continue;
+            }
+            if (c < '0' || c > '9')
+                break;
+            digits = true;
+            if (point)
+                --exponent;
+            if (c == '0')
+            {
+                if (mantissa != 0)
+                    ++zeros;
+                continue;
+            }
+            for (; zeros >= 0; --zeros)
+            {
+                if (mantissa > std::numeric_limits<uint64_t>::max() / 10)
+                    return false;
+                mantissa *= 10;
+            }
+            zeros = 0;
+            if (mantissa > std::numeric_limits<uint64_t>::max() - static_cast<uint64_t>(c - '0'))
+                return false;
+            mantissa += static_cast<uint64_t>(c - '0');
+        }
+        if (!digits)
+            return false;
+        exponent += zeros;
+
+        if (i < text.size() && (text[i] == 'e' || text[i] == 'E'))
+        {
+            ++i;
+            bool negativeExponent = false;
+            if (i < text.size() && (text[i] == '-' || text[i] == '+'))
+                negativeExponent = text[i++] == '-';
+            int value = 0;
+            size_t start = i;
+            for (; i < text.size() && text[i] >= '0' && text[i] <= '9'; ++i)
+            {
+                if (value < 10000)
+                    value = value * 10 + (text[i] - '0');
+            }
+            if (i == start)
+                return false;
+            exponent += negativeExponent ? -value : value;
+        }
+        return i == text.size();
+    }
+}
+
+namespace UtilityNamespace
+{
+    bool parseDecimal(std::string_view text, int decimals, int64_t &units)
+    {
+        bool negative;
+        uint64_t mantissa;
+        int exponent;
+        if (decimals < 0 || decimals > MAX_DECIMALS || !parseMantissa(text, negative, mantissa, exponent))
+            return false;
+        if (mantissa == 0)
+        {
+            units = 0;
+            return true;
+        }
+        // the mantissa ends in a nonzero digit, so a negative shift always leaves a remainder
+        int shift = exponent + decimals;
+        if (shift < 0 || shift > MAX_DECIMALS || mantissa > static_cast<uint64_t>(std::numeric_limits<int64_t>::max() / POW10[shift]))
+            return false;
+        int64_t magnitude = static_cast<int64_t>(mantissa) * POW10[shift];
+        units = negative ? -magnitude : magnitude;
+        return true;
+    }
+
+    bool decimalPlaces(std::string_view text, int &decimals)
+    {
+        bool negative;
+        uint64_t mantissa;
+        int exponent;
+        if (!parseMantissa(text, negative, mantissa, exponent))
+            return false;
+        decimals = mantissa == 0 || exponent >= 0 ? 0 : -exponent;
+        return decimals <= MAX_DECIMALS;
+    }
+
+    char *formatDecimal(char *out, int64_t units, int decimals)
+    {
+        char digits[24];
+        uint64_t magnitude = units < 0 ? 0 - static_cast<uint64_t>(units) : static_cast<uint64_t>(units);
+        int count = static_cast<int>(std::to_chars(digits, digits + sizeof(digits), magnitude).ptr - digits);
+        if (units < 0)
+            *out++ = '-';
+
+        int whole = count - decimals; // digits before the point, <= 0 when there are none
+        if (whole > 0)
+        {
+            std::memcpy(out, digits, whole);
+            out += whole;
+        }
+        else
+        {
+            *out++ = '0';
+        }
+
+        int fractionStart = whole > 0 ? whole : 0;
+        while (count > fractionStart && digits[count - 1] == '0')
+            --count;
+        if (count > fractionStart)
+        {
+            *out++ = '.';
+            for (int i = whole; i < 0; ++i)
+                *out++ = '0';
+            std::memcpy(out, digits + fractionStart, count - fractionStart);
+            out += count - fractionStart;
+        }
+        return out;
+    }
+
+    template <class String>
+    void appendDecimal(String &out, int64_t units, int decimals)
+    {
+        char buffer[DECIMAL_TEXT_MAX];
+        out.append(buffer, formatDecimal(buffer, units, decimals));
+    }
+
+    template void appendDecimal<std::string>(std::string &, int64_t, int);
+    template void appendDecimal<std::pmr::string>(std::pmr::string &, int64_t, int);
+}
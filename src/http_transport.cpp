@@ -0,0 +1,185 @@
+#include "http_transport.hpp"
+#include "logger.hpp"
+#include "metrics.hpp"
+#include <mutex>
+
+namespace
+{
+    std::once_flag curlInitFlag;
+    std::mutex defaultOptionsMutex;
+    SocketOptions defaultOptions;
+
+    // every transport in the process, next to the per-transport ConnectionStats
+    struct TransportMetrics
+    {
+        Counter &requests = UtilityNamespace::metrics().counter("oems_http_requests_total", "HTTP requests performed");
+        Counter &failures = UtilityNamespace::metrics().counter("oems_http_failures_total", "HTTP requests that failed in transport");
+        Counter &bytesSent = UtilityNamespace::metrics().counter("oems_http_bytes_sent_total", "HTTP request bytes uploaded");
+        Counter &bytesReceived = UtilityNamespace::metrics().counter("oems_http_bytes_received_total", "HTTP reply bytes downloaded");
+    };
+
+    TransportMetrics &transportMetrics()
+    {
+        static TransportMetrics metrics;
+        return metrics;
+    }
+
+    size_t WriteCallback(void *contents, size_t size, size_t nmemb, std::pmr::string *s)
+    {
+        size_t newLength = size * nmemb;
+        s->append((char *)contents, newLength);
+        return newLength;
+    }
+}
+
+HttpTransport::HttpTransport(const SocketOptions &options) : socketOptions(options)
+{
+    std::call_once(curlInitFlag, []()
+                   { curl_global_init(CURL_GLOBAL_DEFAULT); });
+    curl = curl_easy_init();
+    if (curl)
+    {
+        curl_easy_setopt(curl, CURLOPT_SOCKOPTFUNCTION, &HttpTransport::onSocketOpened);
+        curl_easy_setopt(curl, CURLOPT_SOCKOPTDATA, this);
+        curl_easy_setopt(curl, CURLOPT_TCP_NODELAY, socketOptions.tcpNoDelay ? 1L : 0L);
+        curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, WriteCallback);
+    }
+}
+
+HttpTransport::~HttpTransport()
+{
+    if (headers)
+        curl_slist_free_all(headers);
+    if (curl)
+        curl_easy_cleanup(curl);
+}
+
+int HttpTransport::onSocketOpened(void *clientp, curl_socket_t fd, curlsocktype)
+{
+    auto *transport = static_cast<HttpTransport *>(clientp);
+    UtilityNamespace::applySocketOptions(fd, transport->socketOptions, &transport->connectionStats);
+    return CURL_SOCKOPT_OK;
+}
+
+// curl calls this about once a second while a transfer is stalled, and far more often while data flows
+int HttpTransport::onProgress(void *clientp, curl_off_t, curl_off_t, curl_off_t, curl_off_t)
+{
+    auto *transport = static_cast<HttpTransport *>(clientp);
+    return transport->abortFlag && transport->abortFlag->load(std::memory_order_relaxed) ? 1 : 0;
+}
+
+void HttpTransport::setAbortFlag(const std::atomic<bool> *flag)
+{
+    if (!curl || flag == abortFlag)
+        return;
+    abortFlag = flag;
+    curl_easy_setopt(curl, CURLOPT_XFERINFOFUNCTION, flag ? &HttpTransport::onProgress : nullptr);
+    curl_easy_setopt(curl, CURLOPT_XFERINFODATA, flag ? this : nullptr);
+    curl_easy_setopt(curl, CURLOPT_NOPROGRESS, flag ? 0L : 1L);
+}
+
+int HttpTransport::activeSocket() const
+{
+    curl_socket_t fd = CURL_SOCKET_BAD;
+    if (!curl || curl_easy_getinfo(curl, CURLINFO_ACTIVESOCKET, &fd) != CURLE_OK || fd == CURL_SOCKET_BAD)
+        return -1;
+    return static_cast<int>(fd);
+}
+
+bool HttpTransport::post(const char *url, std::string_view payload, const char *authHeader, std::pmr::string &response)
+{
+    if (!curl)
+        return false;
+
+    // the header list only changes when the token does
+    bool wantAuth = authHeader != nullptr;
+    if (!headers || wantAuth != headersHaveAuth || (wantAuth && cachedAuthHeader != authHeader))
+    {
+        if (headers)
+            curl_slist_free_all(headers);
+        headers = curl_slist_append(nullptr, "Content-Type: application/json");
+        if (wantAuth)
+        {
+            headers = curl_slist_append(headers, authHeader);
+            cachedAuthHeader = authHeader;
+        }
+        headersHaveAuth = wantAuth;
+    }
+
+    curl_easy_setopt(curl, CURLOPT_URL, url);
+    curl_easy_setopt(curl, CURLOPT_HTTPHEADER, headers);
+    curl_easy_setopt(curl, CURLOPT_POSTFIELDSIZE, static_cast<long>(payload.size()));
+    curl_easy_setopt(curl, CURLOPT_POSTFIELDS, payload.data());
+    return perform(response);
+}
+
+bool HttpTransport::get(const char *url, std::pmr::string &response)
+{
+    if (!curl)
+        return false;
+
+    curl_easy_setopt(curl, CURLOPT_URL, url);
+    curl_easy_setopt(curl, CURLOPT_HTTPHEADER, nullptr);
+    curl_easy_setopt(curl, CURLOPT_HTTPGET, 1L);
+    return perform(response);
+}
+
+bool HttpTransport::perform(std::pmr::string &response)
+{
+    if (abortFlag && abortFlag->load(std::memory_order_relaxed))
+        return false;
+    curl_easy_setopt(curl, CURLOPT_WRITEDATA, &response);
+    CURLcode res = curl_easy_perform(curl);
+    connectionStats.requests.fetch_add(1, std::memory_order_relaxed);
+    TransportMetrics &metrics = transportMetrics();
+    metrics.requests.add();
+
+    if (res == CURLE_ABORTED_BY_CALLBACK)
+        return false; // cancelled through the abort flag, not a failure
+    if (res != CURLE_OK)
+    {
+        connectionStats.failures.fetch_add(1, std::memory_order_relaxed);
+        metrics.failures.add();
+        OEMS_LOG_ERROR("cURL Error: {}", curl_easy_strerror(res));
+        return false;
+    }
+
+    curl_off_t uploaded = 0, downloaded = 0, totalMicros = 0;
+    curl_easy_getinfo(curl, CURLINFO_SIZE_UPLOAD_T, &uploaded);
+    curl_easy_getinfo(curl, CURLINFO_SIZE_DOWNLOAD_T, &downloaded);
+    curl_easy_getinfo(curl, CURLINFO_TOTAL_TIME_T, &totalMicros);
+    connectionStats.bytesSent.fetch_add(static_cast<uint64_t>(uploaded), std::memory_order_relaxed);
+    connectionStats.bytesReceived.fetch_add(static_cast<uint64_t>(downloaded), std::memory_order_relaxed);
+    connectionStats.totalMicros.fetch_add(static_cast<uint64_t>(totalMicros), std::memory_order_relaxed);
+    metrics.bytesSent.add(static_cast<uint64_t>(uploaded));
+    metrics.bytesReceived.add(static_cast<uint64_t>(downloaded));
+
+    if (socketOptions.quickAck)
+    {
+        int fd = activeSocket();
+        if (fd >= 0)
+            UtilityNamespace::rearmQuickAck(fd);
+    }
+    return true;
+}
+
+namespace UtilityNamespace
+{
+    void setDefaultSocketOptions(const SocketOptions &options)
+    {
+        std::lock_guard<std::mutex> lock(defaultOptionsMutex);
+        defaultOptions = options;
+    }
+
+    SocketOptions defaultSocketOptions()
+    {
+        std::lock_guard<std::mutex> lock(defaultOptionsMutex);
+        return defaultOptions;
+    }
+
+    HttpTransport &threadTransport()
+    {
+        thread_local HttpTransport transport(defaultSocketOptions());
+        return transport;
+    }
+}
@@ -0,0 +1,127 @@
+#include "instrument.hpp"
+#include "logger.hpp"
+#include <algorithm>
+#include <simdjson.h>
+
+namespace
+{
+    // raw_json_token() keeps the whitespace that follows the token
+    std::string_view trimmed(std::string_view token)
+    {
+        while (!token.empty() && (token.back() == ' ' || token.back() == '\n' || token.back() == '\r' || token.back() == '\t'))
+            token.remove_suffix(1);
+        return token;
+    }
+
+    bool positiveUnits(std::string_view text, int decimals, int64_t &units)
+    {
+        return UtilityNamespace::parseDecimal(text, decimals, units) && units > 0;
+    }
+}
+
+bool UtilityNamespace::makeInstrumentSpec(std::string name, std::string_view tickSize, std::string_view minTradeAmount,
+                                          const std::vector<std::pair<std::string_view, std::string_view>> &steps, InstrumentSpec &spec)
+{
+    // the price scale must hold the finest of the ticks and every step boundary
+    int priceDecimals, amountDecimals;
+    if (!decimalPlaces(tickSize, priceDecimals) || !decimalPlaces(minTradeAmount, amountDecimals))
+        return false;
+    for (const auto &[above, tick] : steps)
+    {
+        int aboveDecimals, tickDecimals;
+        if (!decimalPlaces(above, aboveDecimals) || !decimalPlaces(tick, tickDecimals))
+            return false;
+        priceDecimals = std::max({priceDecimals, aboveDecimals, tickDecimals});
+    }
+
+    spec.name = std::move(name);
+    spec.priceDecimals = priceDecimals;
+    spec.amountDecimals = amountDecimals;
+    spec.tickSteps.clear();
+    if (!positiveUnits(tickSize, priceDecimals, spec.tickUnits) || !positiveUnits(minTradeAmount, amountDecimals, spec.lotUnits))
+        return false;
+    for (const auto &[above, tick] : steps)
+    {
+        TickStep step{};
+        int64_t aboveUnits;
+        if (!parseDecimal(above, priceDecimals, aboveUnits) || !positiveUnits(tick, priceDecimals, step.tickUnits))
+            return false;
+        step.abovePrice = Price(aboveUnits);
+        spec.tickSteps.push_back(step);
+    }
+    std::sort(spec.tickSteps.begin(), spec.tickSteps.end(), [](const TickStep &a, const TickStep &b)
+              { return a.abovePrice < b.abovePrice; });
+    return true;
+}
+
+void InstrumentTable::add(InstrumentSpec spec)
+{
+    std::string name = spec.name;
+    specs.insert_or_assign(std::move(name), std::move(spec));
+}
+
+const InstrumentSpec *InstrumentTable::find(std::string_view name) const
+{
+    auto it = specs.find(name);
+    return it == specs.end() ? nullptr : &it->second;
+}
+
+// sizes are read from the raw number tokens, so 0.0001 stays 0.0001 instead of its nearest double
+size_t InstrumentTable::load(std::string_view reply)
+{
+    size_t added = 0;
+    try
+    {
+        simdjson::ondemand::parser parser;
+        simdjson::padded_string body(reply);
+        simdjson::ondemand::document doc = parser.iterate(body);
+        for (simdjson::ondemand::object instrument : doc["result"].get_array())
+        {
+            std::string name;
+            std::string_view tickSize, minTradeAmount;
+            std::vector<std::pair<std::string_view, std::string_view>> steps;
+            for (auto field : instrument)
+            {
+                std::string_view key = field.unescaped_key();
+                if (key == "instrument_name")
+                    name = std::string(std::string_view(field.value().get_string()));
+                else if (key == "tick_size")
+                    tickSize = trimmed(field.value().raw_json_token());
+                else if (key == "min_trade_amount")
+                    minTradeAmount = trimmed(field.value().raw_json_token());
+                else if (key == "tick_size_steps")
+                {
+                    for (simdjson::ondemand::object step : field.value().get_array())
+                    {
+                        std::string_view above, tick;
+                        for (auto stepField : step)
+                        {
+                            std::string_view stepKey = stepField.unescaped_key();
+                            if (stepKey == "above_price")
+                                above = trimmed(stepField.value().raw_json_token());
+                            else if (stepKey == "tick_size")
+                                tick = trimmed(stepField.value().raw_json_token());
+                        }
+                        steps.emplace_back(above, tick);
+                    }
+                }
+            }
+
+            InstrumentSpec spec;
+            if (UtilityNamespace::makeInstrumentSpec(name, tickSize, minTradeAmount, steps, spec))
+            {
+                add(std::move(spec));
+                ++added;
+            }
+            else
+            {
+                OEMS_LOG_WARN("Skipping instrument {}: unusable tick_size {} or min_trade_amount {}", name, tickSize, minTradeAmount);
+            }
+        }
+    }
+    catch (const simdjson::simdjson_error &e)
+    {
+        OEMS_LOG_ERROR("Failed to parse instruments: {}", e.what());
+    }
+    return added;
+}
@@ -0,0 +1,119 @@
+#include "jsonrpc.hpp"
+#include <charconv>
+
+namespace UtilityNamespace
+{
+    template <class String>
+    void appendJsonString(String &out, std::string_view value)
+    {
+        static const char hex[] = "0123456789abcdef";
+        out += '"';
+        size_t plain = 0; // start of the run of characters copied as they are
+        for (size_t i = 0; i < value.size(); ++i)
+        {
+            char c = value[i];
+            if (c != '"' && c != '\\' && static_cast<unsigned char>(c) >= 0x20)
+                continue;
+            out.append(value.data() + plain, i - plain);
+            plain = i + 1;
+            switch (c)
+            {
+            case '"':
+                out += "\\\"";
+                break;
+            case '\\':
+                out += "\\\\";
+                break;
+            case '\n':
+                out += "\\n";
+                break;
+            case '\r':
+                out += "\\r";
+                break;
+            case '\t':
+                out += "\\t";
+                break;
+            default:
+                out += "\\u00";
+                out += hex[(c >> 4) & 0xF];
+                out += hex[c & 0xF];
+                break;
+            }
+        }
+        out.append(value.data() + plain, value.size() - plain);
+        out += '"';
+    }
+
+    // shortest representation that round-trips, same digits nlohmann would print
+    template <class String>
+    void appendJsonNumber(String &out, double value)
+    {
+        char buffer[32];
+        auto result = std::to_chars(buffer, buffer + sizeof(buffer), value);
+        out.append(buffer, result.ptr);
+    }
+
+    template void appendJsonString<std::string>(std::string &, std::string_view);
+    template void appendJsonString<std::pmr::string>(std::pmr::string &, std::string_view);
+    template void appendJsonNumber<std::string>(std::string &, double);
+    template void appendJsonNumber<std::pmr::string>(std::pmr::string &, double);
+
+    void encodePlaceOrder(std::pmr::string &out, std::string_view side, std::string_view symbol, double amount, double price, std::string_view orderType)
+    {
+        out += "{\"jsonrpc\":\"2.0\",\"id\":2,\"method\":\"private/";
+        out += side;
+        out += "\",\"params\":{\"instrument_name\":";
+        appendJsonString(out, symbol);
+        out += ",\"amount\":";
+        appendJsonNumber(out, amount);
+        out += ",\"type\":";
+        appendJsonString(out, orderType);
+        out += ",\"price\":";
+        appendJsonNumber(out, price);
+        out += "}}";
+    }
+
+    void encodeCancelOrder(std::pmr::string &out, std::string_view orderId)
+    {
+        out += "{\"jsonrpc\":\"2.0\",\"id\":2,\"method\":\"private/cancel\",\"params\":{\"order_id\":";
+        appendJsonString(out, orderId);
+        out += "}}";
+    }
+
+    void encodeModifyOrder(std::pmr::string &out, std::string_view orderId, double amount, double price)
+    {
+        out += "{\"jsonrpc\":\"2.0\",\"id\":2,\"method\":\"private/edit\",\"params\":{\"order_id\":";
+        appendJsonString(out, orderId);
+        out += ",\"amount\":";
+        appendJsonNumber(out, amount);
+        out += ",\"price\":";
+        appendJsonNumber(out, price);
+        out += "}}";
+    }
+
+    void encodePlaceOrder(std::pmr::string &out, std::string_view side, const InstrumentSpec &instrument, Quantity amount, Price price, std::string_view orderType)
+    {
+        out += "{\"jsonrpc\":\"2.0\",\"id\":2,\"method\":\"private/";
+        out += side;
+        out += "\",\"params\":{\"instrument_name\":";
+        appendJsonString(out, instrument.name);
+        out += ",\"amount\":";
+        instrument.appendAmount(out, amount);
+        out += ",\"type\":";
+        appendJsonString(out, orderType);
+        out += ",\"price\":";
+        instrument.appendPrice(out, price);
+        out += "}}";
+    }
+
+    void encodeModifyOrder(std::pmr::string &out, std::string_view orderId, const InstrumentSpec &instrument, Quantity amount, Price price)
+    {
+        out += "{\"jsonrpc\":\"2.0\",\"id\":2,\"method\":\"private/edit\",\"params\":{\"order_id\":";
+        appendJsonString(out, orderId);
+        out += ",\"amount\":";
+        instrument.appendAmount(out, amount);
+        out += ",\"price\":";
+        instrument.appendPrice(out, price);
+        out += "}}";
+    }
+}
@@ -0,0 +1,224 @@
+#include "logger.hpp"
+#include "metrics.hpp"
+#include <charconv>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <ctime>
+
+namespace
+{
+    constexpr const char *LEVEL_NAMES[] = {"DEBUG", "INFO ", "WARN ", "ERROR"};
+
+    struct Line
+    {
+        int64_t timestampNs;
+        bool error; // goes to stderr
+        std::string text;
+    };
+
+    template <class T>
+    T readValue(const std::byte *&cursor)
+    {
+        T value;
+        std::memcpy(&value, cursor, sizeof(T));
+        cursor += sizeof(T);
+        return value;
+    }
+
+    void appendArg(std::string &out, const std::byte *&cursor)
+    {
+        char buffer[32];
+        const auto tag = static_cast<LogArgs::Tag>(*cursor++);
+        switch (tag)
+        {
+        case LogArgs::Int:
+            out.append(buffer, std::to_chars(buffer, buffer + sizeof(buffer), readValue<int64_t>(cursor)).ptr);
+            break;
+        case LogArgs::Unsigned:
+            out.append(buffer, std::to_chars(buffer, buffer + sizeof(buffer), readValue<uint64_t>(cursor)).ptr);
+            break;
+        case LogArgs::Double:
+            out.append(buffer, std::snprintf(buffer, sizeof(buffer), "%g", readValue<double>(cursor)));
+            break;
+        case LogArgs::Bool:
+            out += static_cast<bool>(*cursor++) ? "true" : "false";
+            break;
+        case LogArgs::Char:
+            out += static_cast<char>(*cursor++);
+            break;
+        case LogArgs::String:
+        case LogArgs::TruncatedString:
+        {
+            const uint32_t length = readValue<uint32_t>(cursor);
+            out.append(reinterpret_cast<const char *>(cursor), length);
+            cursor += length;
+            if (tag == LogArgs::TruncatedString)
+                out += "...";
+            break;
+        }
+        }
+    }
+
+    // time of day to the microsecond, e.g. 14:03:27.512034
+    void appendTime(std::string &out, int64_t wallNs)
+    {
+        thread_local time_t cachedSecond = -1; // per draining thread, loggers drain independently
+        thread_local char cachedText[16];
+        const time_t second = static_cast<time_t>(wallNs / 1000000000);
+        if (second != cachedSecond)
+        {
+            tm local{};
+            localtime_r(&second, &local);
+            std::strftime(cachedText, sizeof(cachedText), "%H:%M:%S", &local);
+            cachedSecond = second;
+        }
+        char micros[16];
+        std::snprintf(micros, sizeof(micros), ".%06d", static_cast<int>(wallNs % 1000000000 / 1000));
+        out += cachedText;
+        out += micros;
+    }
+
+    void writeAll(std::FILE *stream, const std::string &text)
+    {
+        if (text.empty())
+            return;
+        std::fwrite(text.data(), 1, text.size(), stream);
+        std::fflush(stream);
+    }
+}
+
+Logger::Logger()
+    : wallOffsetNs(UtilityNamespace::wallNowNs() - UtilityNamespace::steadyNowNs()),
+      sink([](const std::string &out, const std::string &err)
+           {
+               writeAll(stdout, out);
+               writeAll(stderr, err); }),
+      ringBytes(RING_BYTES)
+{
+    thread = std::thread(&Logger::run, this);
+    std::atexit([]()
+                { UtilityNamespace::logger().flush(); });
+}
+
+Logger::Logger(LogSink sink, size_t ringBytes)
+    : wallOffsetNs(UtilityNamespace::wallNowNs() - UtilityNamespace::steadyNowNs()), sink(std::move(sink)), ringBytes(ringBytes)
+{
+}
+
+Logger::~Logger()
+{
+    stopping = true;
+    if (thread.joinable())
+        thread.join();
+    drainAll();
+}
+
+Logger::RingHandle::~RingHandle()
+{
+    if (ring)
+        ring->retired.store(true, std::memory_order_release);
+}
+
+std::shared_ptr<LogRing> Logger::addRing()
+{
+    auto ring = std::make_shared<LogRing>(ringBytes);
+    std::lock_guard<std::mutex> lock(ringsMutex);
+    rings.push_back(ring);
+    return ring;
+}
+
+void Logger::flush()
+{
+    drainAll();
+}
+
+// backs off from 100us to 10ms while idle, so an idle process costs almost nothing
+void Logger::run()
+{
+    auto idle = std::chrono::microseconds(100);
+    while (!stopping.load(std::memory_order_relaxed))
+    {
+        if (drainAll() > 0)
+        {
+            idle = std::chrono::microseconds(100);
+            continue;
+        }
+        std::this_thread::sleep_for(idle);
+        idle = std::min<std::chrono::microseconds>(idle * 2, std::chrono::milliseconds(10));
+    }
+}
+
+// formats every ring's records, orders them by time across threads and writes them in one go per stream
+size_t Logger::drainAll()
+{
+    static Counter &droppedMetric = UtilityNamespace::metrics().counter("oems_log_dropped_total", "Log records dropped because the thread's ring was full");
+    std::lock_guard<std::mutex> drainLock(drainMutex);
+    std::vector<std::shared_ptr<LogRing>> current;
+    {
+        std::lock_guard<std::mutex> lock(ringsMutex);
+        current = rings;
+    }
+
+    std::vector<Line> lines;
+    uint64_t dropped = 0;
+    bool anyRetired = false;
+    for (const auto &ring : current)
+    {
+        const bool retired = ring->retired.load(std::memory_order_acquire); // read first, nothing follows it
+        ring->drain([&](const std::byte *record)
+                    {
+                        LogRecordHeader header;
+                        std::memcpy(&header, record, sizeof(header));
+                        const std::byte *cursor = record + sizeof(header);
+                        Line line{header.timestampNs, header.level >= static_cast<uint8_t>(LogLevel::Warn), std::string()};
+                        std::string &text = line.text;
+                        appendTime(text, header.timestampNs + wallOffsetNs);
+                        text += ' ';
+                        text += LEVEL_NAMES[header.level & 3];
+                        text += ' ';
+                        int remaining = header.argCount;
+                        for (const char *p = header.format; *p; ++p)
+                        {
+                            if (p[0] == '{' && p[1] == '}' && remaining > 0)
+                            {
+                                appendArg(text, cursor);
+                                --remaining;
+                                ++p;
+                            }
+                            else
+                            {
+                                text += *p;
+                            }
+                        }
+                        text += '\n';
+                        lines.push_back(std::move(line)); });
+        const uint64_t ringDropped = ring->dropped.load(std::memory_order_relaxed);
+        dropped += ringDropped - ring->reportedDrops;
+        ring->reportedDrops = ringDropped;
+        anyRetired = anyRetired || retired;
+    }
+
+    if (anyRetired)
+    {
+        std::lock_guard<std::mutex> lock(ringsMutex);
+        rings.erase(std::remove_if(rings.begin(), rings.end(), [](const std::shared_ptr<LogRing> &ring)
+                                   { return ring->retired.load(std::memory_order_acquire) && ring->empty(); }),
+                    rings.end());
+    }
+
+    if (lines.empty() && dropped == 0)
+        return 0;
+    std::stable_sort(lines.begin(), lines.end(), [](const Line &a, const Line &b)
+                     { return a.timestampNs < b.timestampNs; });
+    std::string out, err;
+    for (const Line &line : lines)
+        (line.error ? err : out) += line.text;
+    if (dropped > 0)
+    {
+        droppedMetric.add(dropped);
+        err += "Logger dropped " + std::to_string(dropped) + " records, a thread's ring was full\n";
+    }
+    sink(out, err);
+    return lines.size();
+}
@@ -1,5 +1,15 @@
+#include "book_analytics.hpp"
+#include "instrument.hpp"
+#include "md_pipeline.hpp"
+#include "memory_placement.hpp"
+#include "metrics.hpp"
+#include "order_journal.hpp"
 #include "order_manager.hpp"
+#include "session.hpp"
+#include "simulated_venue.hpp"
+#include "trade_export.hpp"
 #include "utils.hpp"
+#include "warmup.hpp"
 #include "websocket_con.hpp"
 
 double maxCPUUTIL = 0.0;
@@ -95,6 +105,7 @@ enum Action
     GET_POSITIONS,
     VIEW_OPEN_ORDERS,
     VIEW_TRADE_HISTORY,
+    EXPORT_TRADES,
     CONNECT,
     EXIT
 };
@@ -110,12 +121,83 @@ Action parseAction(const std::string &input)
         {"positions", GET_POSITIONS},
         {"open_orders", VIEW_OPEN_ORDERS},
         {"trade_history", VIEW_TRADE_HISTORY},
+        {"export", EXPORT_TRADES},
         {"connect", CONNECT},
         {"exit", EXIT}};
     return actionMap.count(input) ? actionMap[input] : EXIT;
 }
 
-void orderManagementSystem(OrderManager &orderManager)
+static void readLevels(simdjson::ondemand::array levels, std::vector<double> &prices, std::vector<double> &sizes)
+{
+    prices.clear();
+    sizes.clear();
+    for (simdjson::ondemand::array level : levels)
+    {
+        auto it = level.begin();
+        prices.push_back(double(*it));
+        ++it;
+        sizes.push_back(double(*it));
+    }
+}
+
+// derived values for a get_order_book reply; sizes are in the instrument's amount units
+void printBookAnalytics(std::string &response)
+{
+    SoaBook book;
+    try
+    {
+        simdjson::ondemand::parser parser;
+        simdjson::ondemand::document doc = parser.iterate(response);
+        simdjson::ondemand::object result = doc["result"];
+        readLevels(result["bids"], book.bidPrices, book.bidSizes);
+        readLevels(result["asks"], book.askPrices, book.askSizes);
+    }
+    catch (const simdjson::simdjson_error &e)
+    {
+        std::cerr << "Could not read book levels: " << e.what() << "\n";
+        return;
+    }
+    if (book.bidPrices.empty() || book.askPrices.empty())
+    {
+        std::cout << "Book has an empty side, no analytics\n";
+        return;
+    }
+
+    AnalyticsConfig config;
+    BookAnalytics a = UtilityNamespace::computeAnalytics(book, config);
+    std::cout << "Best bid/ask:  " << a.bestBid << " / " << a.bestAsk << "\n";
+    std::cout << "Spread:        " << a.spread << " (" << a.spreadBps << " bps)\n";
+    std::cout << "Mid:           " << a.mid << ", microprice " << a.microprice << "\n";
+    std::cout << "Imbalance:     " << a.imbalance << " over the top " << config.imbalanceLevels << " levels\n";
+    std::cout << "Depth " << config.depthBandBps << " bps: " << a.bidDepth << " bid / " << a.askDepth << " ask\n";
+    std::cout << "VWAP " << config.fillSize << ":       ";
+    if (a.vwapBuy > 0.0)
+        std::cout << "buy " << a.vwapBuy;
+    else
+        std::cout << "buy n/a";
+    if (a.vwapSell > 0.0)
+        std::cout << ", sell " << a.vwapSell << "\n";
+    else
+        std::cout << ", sell n/a\n";
+
+    std::vector<double> bidDepth(book.bidSizes.size()), askDepth(book.askSizes.size());
+    UtilityNamespace::cumulativeDepth(book.bidSizes.data(), bidDepth.size(), bidDepth.data());
+    UtilityNamespace::cumulativeDepth(book.askSizes.data(), askDepth.size(), askDepth.data());
+    std::cout << "Cumulative depth (bid price / size | ask price / size):\n";
+    for (size_t i = 0; i < std::max(bidDepth.size(), askDepth.size()); ++i)
+    {
+        std::cout << "  ";
+        if (i < bidDepth.size())
+            std::cout << book.bidPrices[i] << " / " << bidDepth[i];
+        std::cout << " | ";
+        if (i < askDepth.size())
+            std::cout << book.askPrices[i] << " / " << askDepth[i];
+        std::cout << "\n";
+    }
+}
+
+// simulated is the venue behind orderManager when paper trading, null against the exchange
+void orderManagementSystem(OrderManager &orderManager, SimulatedVenue *simulated)
 {
     while (true)
     {
@@ -127,8 +209,9 @@ void orderManagementSystem(OrderManager &orderManager)
         std::cout << "5. View positions (type 'positions')\n";
         std::cout << "6. View open orders (type 'open_orders')\n";
         std::cout << "7. View trade history (type 'trade_history')\n";
-        std::cout << "8. Connect to websocket server (type 'connect')\n";
-        std::cout << "9. Exit (type 'exit')\n";
+        std::cout << "8. Export full trade history to files (type 'export')\n";
+        std::cout << "9. Connect to websocket server (type 'connect')\n";
+        std::cout << "10. Exit (type 'exit')\n";
         std::cout << "Enter choice: ";
 
         std::string userInput;
@@ -269,6 +352,7 @@ void orderManagementSystem(OrderManager &orderManager)
             auto latency = std::chrono::duration_cast<std::chrono::milliseconds>(end - start).count();
             std::cout << "Market Data processing Latency: " << latency << " ms\n";
             std::cout << "Orderbook: " << UtilityNamespace::beautifyJSON(response) << "\n";
+            printBookAnalytics(response);
             maxCPUUTIL = std::max(maxCPUUTIL, getCurrentValue());
             maxMEMUTIL = std::max(maxMEMUTIL, getValue());
             break;
@@ -318,14 +402,83 @@ void orderManagementSystem(OrderManager &orderManager)
             maxMEMUTIL = std::max(maxMEMUTIL, getValue());
             break;
         }
+        case EXPORT_TRADES:
+        {
+            if (simulated)
+            {
+                std::cout << "The trade export reads the exchange's history; start with --venue deribit\n";
+                break;
+            }
+            std::string currencies, format;
+            int days;
+            std::cout << "Enter currencies, comma separated (e.g., BTC,ETH): ";
+            std::cin >> currencies;
+            std::cout << "Enter number of days to export: ";
+            std::cin >> days;
+            std::cout << "Enter format (csv/columnar): ";
+            std::cin >> format;
+
+            TradeExportOptions options;
+            options.currencies.clear();
+            for (size_t start = 0; start <= currencies.size();)
+            {
+                size_t comma = std::min(currencies.find(',', start), currencies.size());
+                if (comma > start)
+                    options.currencies.push_back(currencies.substr(start, comma - start));
+                start = comma + 1;
+            }
+            options.format = format == "columnar" ? TradeExportFormat::Columnar : TradeExportFormat::Csv;
+            auto now = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+            options.startTimestamp = now - static_cast<int64_t>(days) * 24 * 60 * 60 * 1000;
+            options.endTimestamp = now;
+
+            for (const TradeExportResult &result : TradeExporter(orderManager.session(), options).run())
+            {
+                if (!result.error.empty())
+                    std::cerr << result.currency << ": export failed: " << result.error << "\n";
+                std::cout << result.currency << ": " << result.rows << " trades in " << result.pages << " pages, " << result.bytes
+                          << " bytes written to " << result.path << " in " << result.elapsedNs / 1000000 << " ms\n";
+            }
+            maxCPUUTIL = std::max(maxCPUUTIL, getCurrentValue());
+            maxMEMUTIL = std::max(maxMEMUTIL, getValue());
+            break;
+        }
         case CONNECT:
         {
+            // an optional trigger runs on the feed: frames go through the pipeline's book, strategy and order threads
+            std::string symbol, side;
+            double amount = 0.0, limitPrice = 0.0;
+            std::cout << "Enter a trigger order as symbol, side, amount and limit price (e.g., BTC-PERPETUAL buy 10 64000), or none: ";
+            std::cin >> symbol;
+            MarketDataPipeline::Strategy strategy;
+            if (symbol != "none")
+            {
+                std::cin >> side >> amount >> limitPrice;
+                strategy = UtilityNamespace::triggerStrategy(symbol, side, amount, limitPrice);
+            }
+            // paper orders match against every book the feed brings, so the pipeline runs even without a trigger
+            if (simulated)
+                strategy = UtilityNamespace::simulatedVenueFeed(*simulated, std::move(strategy));
+            std::unique_ptr<MarketDataPipeline> pipeline;
+            if (strategy)
+            {
+                pipeline = std::make_unique<MarketDataPipeline>(orderManager, std::move(strategy));
+                pipeline->setOrderCallback([](const OrderIntent &intent, const std::string &response, int64_t tickToOrderNs)
+                                           { std::cout << "Trigger on " << intent.symbol << " sent " << intent.side << " " << intent.amount << " @ " << intent.price
+                                                       << " " << tickToOrderNs / 1000 << " us after the book update. Response: " << response << "\n"; });
+                pipeline->start();
+            }
+
             // Implement subscription and unsubscribe and disconnect feature
             WebSocketClient wsClient;
+            if (pipeline)
+                wsClient.setPipeline(pipeline.get());
+            if (symbol != "none")
+                wsClient.subscribe(symbol, StreamOptions{0, "raw"});
+            std::thread websocketThread;
             try
             {
-                std::thread websocketThread(&WebSocketClient::start, &wsClient);
-                websocketThread.detach();
+                websocketThread = std::thread(&WebSocketClient::start, &wsClient);
             }
             catch (const std::exception &e)
             {
@@ -335,6 +488,14 @@ void orderManagementSystem(OrderManager &orderManager)
 
             std::thread managerThread(&WebSocketClient::manageWebSocket, &wsClient);
             managerThread.join();
+            // DISC stopped the event loop; nothing reaches the pipeline once its thread is gone
+            websocketThread.join();
+            if (pipeline)
+            {
+                pipeline->stop();
+                if (pipeline->droppedMessages() > 0)
+                    std::cout << "Pipeline dropped " << pipeline->droppedMessages() << " frames\n";
+            }
             maxCPUUTIL = std::max(maxCPUUTIL, getCurrentValue());
             maxMEMUTIL = std::max(maxMEMUTIL, getValue());
             break;
@@ -353,9 +514,65 @@ void orderManagementSystem(OrderManager &orderManager)
     }
 }
 
-int main()
+// what the journal and the exchange say about our orders after a restart
+void printReconcileReport(const ReconcileReport &report)
+{
+    std::cout << "Recovered " << report.records << " journal records in " << report.elapsedNs / 1000000.0 << " ms\n";
+    for (const JournaledOrder &order : report.open)
+        std::cout << "  open:      " << order.orderId << " " << order.instrument << " " << order.direction << " " << order.amount << " @ " << order.price << " (filled " << order.filledAmount << ")\n";
+    for (const JournaledOrder &order : report.closed)
+        std::cout << "  closed:    " << order.orderId << " " << order.instrument << " was " << order.state << " at the last reply\n";
+    for (const JournaledOrder &order : report.unknown)
+        std::cout << "  unknown:   " << order.orderId << " " << order.instrument << " is open but was not placed by this journal\n";
+    for (const JournaledRequest &request : report.inDoubt)
+        std::cout << "  in doubt:  #" << request.sequence << " " << request.method << " " << request.payload << "\n";
+}
+
+// what the startup warm-up did and how long each step took
+void printWarmupReport(const WarmupReport &report)
+{
+    std::cout << "Warm-up " << (report.ready() ? "ready" : "FAILED") << " in " << report.elapsedNs / 1000000.0 << " ms\n";
+    for (const WarmupStep &step : report.steps)
+        std::cout << "  " << (step.ok ? "ok    " : "FAILED") << " " << step.name << ": " << step.elapsedNs / 1000000.0 << " ms, " << step.detail << "\n";
+}
+
+// deribit_order_management [--venue deribit|sim] [--metrics-port n] [--huge-pages] [--no-warmup]
+//   --venue: where orders go (default deribit); sim is a SimulatedVenue fed by the books of 'connect', no account needed
+//   --metrics-port: GET /metrics on loopback (default 9100, 0 turns it off)
+//   --huge-pages: queues, thread arenas and the CONNECT feed books on pre-faulted huge pages on each owner's NUMA node
+//   --no-warmup: skip the connection, codec and arena warm-up before the first order
+int main(int argc, char **argv)
 {
     init(); // Initialize CPU usage tracking
+    uint16_t metricsPort = 9100;
+    bool warmup = true;
+    bool paper = false;
+    for (int i = 1; i < argc; ++i)
+    {
+        if (std::strcmp(argv[i], "--venue") == 0 && i + 1 < argc && (std::strcmp(argv[i + 1], "sim") == 0 || std::strcmp(argv[i + 1], "deribit") == 0))
+            paper = std::strcmp(argv[++i], "sim") == 0;
+        else if (std::strcmp(argv[i], "--metrics-port") == 0 && i + 1 < argc)
+            metricsPort = static_cast<uint16_t>(std::atoi(argv[++i]));
+        else if (std::strcmp(argv[i], "--huge-pages") == 0)
+        {
+            // before any thread starts, so every arena and queue is created with it
+            MemoryPlacement placement;
+            placement.hugePages = true;
+            placement.numaNode = MemoryPlacement::CALLER_NODE;
+            placement.prefault = true;
+            UtilityNamespace::setMemoryPlacement(placement);
+        }
+        else if (std::strcmp(argv[i], "--no-warmup") == 0)
+            warmup = false;
+        else
+        {
+            std::cerr << "Usage: " << argv[0] << " [--venue deribit|sim] [--metrics-port n] [--huge-pages] [--no-warmup]\n";
+            return 1;
+        }
+    }
+    std::unique_ptr<MetricsServer> metricsServer;
+    if (metricsPort)
+        metricsServer = std::make_unique<MetricsServer>(UtilityNamespace::metrics(), metricsPort);
 
     // examples
     //"USDC_USDT", "buy", 10.0, 350.0,"market"  ->spot
@@ -367,16 +584,59 @@ int main()
     // option= ETH-26SEP25-1900-C
     try
     {
-        OrderManager orderManager;
-        std::cout << "Enter your account credentials to authenticate\n";
-        std::cout << "Enter your Client ID: ";
-        std::cin >> API_KEY;
-        std::cout << "Enter your Client Secret: ";
-        std::cin >> SECRET_KEY;
-        access_token = UtilityNamespace::authenticate();
-        std::cout << "Authenticated successfully.\nToken: " << access_token << "\n";
-
-        orderManagementSystem(orderManager);
+        // one loop serves every session's token refresh; more sessions (subaccounts) can share it
+        SessionLoop loop(1);
+        std::unique_ptr<Session> session;
+        std::unique_ptr<SimulatedVenue> simulated;
+        if (paper)
+        {
+            simulated = std::make_unique<SimulatedVenue>();
+            std::cout << "Paper trading on the simulated venue. Its books come from 'connect': subscribe to a symbol before trading it\n";
+        }
+        else
+        {
+            Credentials credentials;
+            std::cout << "Enter your account credentials to authenticate\n";
+            std::cout << "Enter your Client ID: ";
+            std::cin >> credentials.clientId;
+            std::cout << "Enter your Client Secret: ";
+            std::cin >> credentials.clientSecret;
+            session = std::make_unique<Session>(loop, "main", credentials);
+            session->authenticate();
+            std::cout << "Authenticated successfully.\nToken: " << session->accessToken() << "\n";
+        }
+        OrderManager orderManager = simulated ? OrderManager(*simulated) : OrderManager(*session);
+
+        // the exchange only: simulated orders end with the process and the venue has no instrument specs
+        std::unique_ptr<OrderJournal> journal;
+        InstrumentTable instruments;
+        if (session)
+        {
+            // replay the previous run's journal against the exchange before sending anything new
+            journal = std::make_unique<OrderJournal>("orders.journal");
+            if (journal->records() > 0)
+            {
+                ReconcileReport report = UtilityNamespace::reconcileOrders(*journal, orderManager.getOpenOrders());
+                printReconcileReport(report);
+                // settled orders are reported once; only what the next reconciliation needs is kept
+                if (uint64_t dropped = UtilityNamespace::compactJournal(*journal, report))
+                    std::cout << "Compacted the journal: dropped " << dropped << " settled records, kept " << journal->records() << "\n";
+            }
+            orderManager.setJournal(journal.get());
+
+            // tick and lot sizes, so typed prices are snapped to the tick instead of rejected
+            if (instruments.load(orderManager.getInstruments("any")) > 0)
+                orderManager.setInstruments(&instruments);
+            else
+                std::cerr << "Instrument specs unavailable; prices and amounts are sent as typed\n";
+        }
+
+        // connections, codecs and arena paid for now instead of by the first order
+        if (warmup)
+            printWarmupReport(UtilityNamespace::warmUp(orderManager));
+
+        orderManagementSystem(orderManager, simulated.get());
+        loop.stop();
     }
     catch (const std::exception &e)
     {
@@ -0,0 +1,189 @@
+#include "md_pipeline.hpp"
+#include "clock.hpp"
+#include "logger.hpp"
+#include "metrics.hpp"
+#include "simulated_venue.hpp"
+#include "thread_affinity.hpp"
+
+MarketDataPipeline::MarketDataPipeline(OrderManager &orderManager, Strategy strategy, size_t queueCapacity,
+                                       const MemoryPlacement &placement)
+    : orderManager(orderManager), strategy(std::move(strategy)), placement(placement), rawQueue(queueCapacity, placement),
+      bookQueue(queueCapacity, placement), orderQueue(queueCapacity, placement), running(false), dropped(0)
+{
+}
+
+MarketDataPipeline::~MarketDataPipeline()
+{
+    stop();
+}
+
+void MarketDataPipeline::setOrderCallback(OrderCallback callback)
+{
+    orderCallback = std::move(callback);
+}
+
+void MarketDataPipeline::setRecoveryHandler(RecoveryHandler handler)
+{
+    recoveryHandler = std::move(handler);
+}
+
+void MarketDataPipeline::start(int bookCpu, int strategyCpu, int orderCpu)
+{
+    if (running.exchange(true))
+        return;
+
+    threads.emplace_back([this, bookCpu]()
+                         {
+                             UtilityNamespace::pinCurrentThread(bookCpu);
+                             bookLoop(); });
+    threads.emplace_back([this, strategyCpu]()
+                         {
+                             UtilityNamespace::pinCurrentThread(strategyCpu);
+                             strategyLoop(); });
+    threads.emplace_back([this, orderCpu]()
+                         {
+                             UtilityNamespace::pinCurrentThread(orderCpu);
+                             orderLoop(); });
+}
+
+void MarketDataPipeline::stop()
+{
+    if (!running.exchange(false))
+        return;
+
+    // closing the intake queue lets every stage drain and close the next one in turn
+    rawQueue.close();
+    for (std::thread &thread : threads)
+    {
+        thread.join();
+    }
+    threads.clear();
+}
+
+bool MarketDataPipeline::submit(std::string payload)
+{
+    // frames that arrive after stop() are dropped like those of a full queue; one racing stop() either
+    // fails on the closed queue or is still drained by the book thread
+    RawMarketMessage message{std::move(payload), UtilityNamespace::steadyNowNs()};
+    if (!running.load(std::memory_order_acquire) || !rawQueue.tryPush(std::move(message)))
+    {
+        dropped.fetch_add(1, std::memory_order_relaxed);
+        static Counter &drops = UtilityNamespace::metrics().counter("oems_feed_dropped_total", "Feed lines or messages dropped because a consumer fell behind", {{"stage", "pipeline"}});
+        drops.add();
+        return false;
+    }
+    return true;
+}
+
+void MarketDataPipeline::bookLoop()
+{
+    // mapped (and pre-faulted) here so the pages land on the book thread's node before the first frame
+    if (placement.placed() && !bookPool)
+    {
+        bookMemory = std::make_unique<PlacedArena>(placement);
+        bookPool = std::make_unique<std::pmr::unsynchronized_pool_resource>(bookMemory.get());
+    }
+    RawMarketMessage message;
+    BookUpdate book;
+    while (rawQueue.pop(message))
+    {
+        if (buildBook(message, book))
+        {
+            bookQueue.push(std::move(book));
+        }
+    }
+    bookQueue.close();
+}
+
+void MarketDataPipeline::strategyLoop()
+{
+    BookUpdate book;
+    while (bookQueue.pop(book))
+    {
+        OrderIntent intent;
+        if (strategy && strategy(book, intent))
+        {
+            intent.receivedNs = book.receivedNs;
+            orderQueue.push(std::move(intent));
+        }
+    }
+    orderQueue.close();
+}
+
+void MarketDataPipeline::orderLoop()
+{
+    OrderIntent intent;
+    while (orderQueue.pop(intent))
+    {
+        std::string response = orderManager.placeOrder(intent.symbol, intent.side, intent.amount, intent.price, intent.orderType);
+        if (orderCallback)
+        {
+            orderCallback(intent, response, UtilityNamespace::steadyNowNs() - intent.receivedNs);
+        }
+    }
+}
+
+// applies a feed frame (see local_book.hpp) to the symbol's local book and copies the result into book;
+// returns false for frames that leave the book unchanged or out of sequence
+bool MarketDataPipeline::buildBook(RawMarketMessage &message, BookUpdate &book)
+{
+    book.receivedNs = message.receivedNs;
+    try
+    {
+        UtilityNamespace::decodeFeedFrame(parser, message.payload, frame);
+    }
+    catch (const simdjson::simdjson_error &e)
+    {
+        OEMS_LOG_ERROR("Pipeline failed to parse market data: {}", e.what());
+        return false;
+    }
+    if (frame.type == FrameType::Error)
+        OEMS_LOG_WARN("Server rejected a request: {}", frame.error);
+    if (frame.type != FrameType::Snapshot && frame.type != FrameType::Update)
+        return false;
+
+    std::pmr::memory_resource *resource = bookPool ? bookPool.get() : std::pmr::get_default_resource();
+    SymbolFeed &feed = feeds.try_emplace(frame.symbol, resource).first->second;
+    FrameAction action = feed.onFrame(frame.type == FrameType::Snapshot, frame.seq, frame.bids, frame.asks);
+    if (action == FrameAction::Recover && recoveryHandler)
+        recoveryHandler(frame.symbol, feed.sequencer.expected());
+    if (action == FrameAction::Resync && recoveryHandler)
+        recoveryHandler(frame.symbol, 0);
+    if (action != FrameAction::Apply)
+        return false;
+
+    book.symbol = frame.symbol;
+    feed.book.copyLevels(book.bids, book.asks);
+    book.builtNs = UtilityNamespace::steadyNowNs();
+    return true;
+}
+
+MarketDataPipeline::Strategy UtilityNamespace::triggerStrategy(std::string symbol, std::string side, double amount, double limitPrice)
+{
+    bool buy = side == "buy";
+    bool fired = false; // the strategy thread is the only caller
+    return [symbol = std::move(symbol), side = std::move(side), amount, limitPrice, buy, fired](const BookUpdate &book, OrderIntent &intent) mutable
+    {
+        if (fired || book.symbol != symbol)
+            return false;
+        const std::vector<BookLevel> &opposite = buy ? book.asks : book.bids;
+        if (opposite.empty() || (buy ? opposite.front().price > limitPrice : opposite.front().price < limitPrice))
+            return false;
+        fired = true;
+        intent.symbol = symbol;
+        intent.side = side;
+        intent.orderType = "limit";
+        intent.amount = amount;
+        intent.price = limitPrice;
+        return true;
+    };
+}
+
+MarketDataPipeline::Strategy UtilityNamespace::simulatedVenueFeed(SimulatedVenue &venue, MarketDataPipeline::Strategy next)
+{
+    return [&venue, next = std::move(next)](const BookUpdate &book, OrderIntent &intent)
+    {
+        venue.onBook(book.symbol, book.bids, book.asks, wallNowNs() / 1000000);
+        return next && next(book, intent);
+    };
+}
@@ -0,0 +1,185 @@
+#include "memory_placement.hpp"
+#include <algorithm>
+#include <cstdint>
+#include <new>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+namespace
+{
+    constexpr size_t HUGE_PAGE_SIZE = 2 * 1024 * 1024;
+    constexpr int MPOL_PREFERRED_MODE = 1; // <numaif.h>'s MPOL_PREFERRED, without a libnuma dependency
+
+    MemoryPlacement processPlacement;
+
+    size_t roundUp(size_t value, size_t multiple)
+    {
+        return (value + multiple - 1) / multiple * multiple;
+    }
+
+    // anonymous mapping aligned to a huge page, so the kernel can back it with transparent huge pages
+    void *mapAligned(size_t length)
+    {
+        size_t padded = length + HUGE_PAGE_SIZE;
+        void *raw = mmap(nullptr, padded, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (raw == MAP_FAILED)
+            return MAP_FAILED;
+        uintptr_t start = reinterpret_cast<uintptr_t>(raw);
+        uintptr_t aligned = roundUp(start, HUGE_PAGE_SIZE);
+        if (aligned > start)
+            munmap(raw, aligned - start);
+        size_t tail = start + padded - (aligned + length);
+        if (tail > 0)
+            munmap(reinterpret_cast<void *>(aligned + length), tail);
+        return reinterpret_cast<void *>(aligned);
+    }
+
+    // preferred rather than strict, so a full node spills over instead of failing the allocation
+    bool bindToNode(void *memory, size_t length, int node)
+    {
+        if (node < 0 || node >= 64)
+            return false;
+        unsigned long mask = 1UL << node;
+        return syscall(SYS_mbind, memory, length, MPOL_PREFERRED_MODE, &mask, 64UL, 0U) == 0;
+    }
+}
+
+PlacedBuffer::PlacedBuffer(size_t bytes, const MemoryPlacement &placement, size_t align)
+    : alignment(align)
+{
+    if (bytes == 0)
+        return;
+    if (!placement.placed())
+    {
+        memory = static_cast<std::byte *>(alignment > __STDCPP_DEFAULT_NEW_ALIGNMENT__ ? ::operator new(bytes, std::align_val_t(alignment))
+                                                                                       : ::operator new(bytes));
+        length = bytes;
+        return;
+    }
+
+    void *region = MAP_FAILED;
+    if (placement.hugePages)
+    {
+        length = roundUp(bytes, HUGE_PAGE_SIZE);
+        region = mmap(nullptr, length, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+        if (region != MAP_FAILED)
+            kind = PageKind::Huge;
+        else
+        {
+            // no reserved huge pages (vm.nr_hugepages): fall back to transparent ones
+            region = mapAligned(length);
+            if (region != MAP_FAILED)
+                kind = madvise(region, length, MADV_HUGEPAGE) == 0 ? PageKind::TransparentHuge : PageKind::Normal;
+        }
+    }
+    else
+    {
+        length = roundUp(bytes, static_cast<size_t>(sysconf(_SC_PAGESIZE)));
+        region = mmap(nullptr, length, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        kind = PageKind::Normal;
+    }
+    if (region == MAP_FAILED)
+    {
+        length = 0;
+        kind = PageKind::Heap;
+        throw std::bad_alloc();
+    }
+    memory = static_cast<std::byte *>(region);
+
+    // the policy only steers pages not yet touched, so bind before the prefault
+    int node = placement.numaNode == MemoryPlacement::CALLER_NODE ? UtilityNamespace::currentNumaNode() : placement.numaNode;
+    if (bindToNode(memory, length, node))
+        boundNode = node;
+    if (placement.prefault)
+    {
+        volatile std::byte *page = memory;
+        for (size_t offset = 0; offset < length; offset += 4096)
+            page[offset] = std::byte{0};
+    }
+}
+
+PlacedBuffer::~PlacedBuffer()
+{
+    release();
+}
+
+PlacedBuffer::PlacedBuffer(PlacedBuffer &&other) noexcept
+    : memory(other.memory), length(other.length), alignment(other.alignment), kind(other.kind), boundNode(other.boundNode)
+{
+    other.memory = nullptr;
+    other.length = 0;
+}
+
+PlacedBuffer &PlacedBuffer::operator=(PlacedBuffer &&other) noexcept
+{
+    if (this != &other)
+    {
+        release();
+        memory = other.memory;
+        length = other.length;
+        alignment = other.alignment;
+        kind = other.kind;
+        boundNode = other.boundNode;
+        other.memory = nullptr;
+        other.length = 0;
+    }
+    return *this;
+}
+
+void PlacedBuffer::release()
+{
+    if (!memory)
+        return;
+    if (kind != PageKind::Heap)
+        munmap(memory, length);
+    else if (alignment > __STDCPP_DEFAULT_NEW_ALIGNMENT__)
+        ::operator delete(memory, std::align_val_t(alignment));
+    else
+        ::operator delete(memory);
+    memory = nullptr;
+    length = 0;
+}
+
+PlacedArena::PlacedArena(const MemoryPlacement &placement, size_t chunkBytes) : placement(placement), chunkBytes(chunkBytes)
+{
+    mapped.emplace_back(chunkBytes, placement);
+}
+
+size_t PlacedArena::reserved() const
+{
+    size_t total = 0;
+    for (const PlacedBuffer &chunk : mapped)
+        total += chunk.size();
+    return total;
+}
+
+void *PlacedArena::do_allocate(size_t bytes, size_t alignment)
+{
+    size_t start = roundUp(offset, alignment);
+    if (mapped.empty() || start + bytes > mapped.back().size())
+    {
+        mapped.emplace_back(std::max(chunkBytes, bytes + alignment), placement);
+        start = 0; // chunks are page aligned
+    }
+    offset = start + bytes;
+    return mapped.back().data() + start;
+}
+
+int UtilityNamespace::currentNumaNode()
+{
+    unsigned cpu = 0, node = 0;
+    if (syscall(SYS_getcpu, &cpu, &node, nullptr) != 0)
+        return 0;
+    return static_cast<int>(node);
+}
+
+void UtilityNamespace::setMemoryPlacement(const MemoryPlacement &placement)
+{
+    processPlacement = placement;
+}
+
+const MemoryPlacement &UtilityNamespace::memoryPlacement()
+{
+    return processPlacement;
+}
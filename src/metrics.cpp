@@ -0,0 +1,340 @@
+#include "metrics.hpp"
+#include "jsonrpc.hpp"
+#include "logger.hpp"
+#include <arpa/inet.h>
+#include <cerrno>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <netinet/in.h>
+#include <poll.h>
+#include <stdexcept>
+#include <string_view>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+namespace
+{
+    constexpr double QUANTILES[] = {0.5, 0.9, 0.99, 0.999};
+
+    void appendValue(std::string &out, double value)
+    {
+        if (std::isnan(value))
+            out += "NaN";
+        else if (std::isinf(value))
+            out += value > 0 ? "+Inf" : "-Inf";
+        else if (value == std::floor(value) && std::fabs(value) < 9007199254740992.0) // counts stay exact
+            out += std::to_string(static_cast<int64_t>(value));
+        else
+            UtilityNamespace::appendJsonNumber(out, value);
+    }
+
+    // name="value",... with \, " and newlines escaped as the format asks
+    std::string renderLabels(const MetricLabels &labels)
+    {
+        std::string out;
+        for (const auto &label : labels)
+        {
+            if (!out.empty())
+                out += ',';
+            out += label.first;
+            out += "=\"";
+            for (char c : label.second)
+            {
+                if (c == '\\' || c == '"')
+                    out += '\\';
+                if (c == '\n')
+                    out += "\\n";
+                else
+                    out += c;
+            }
+            out += '"';
+        }
+        return out;
+    }
+
+    // name{labels,extra} value
+    void appendSample(std::string &out, const std::string &name, const char *suffix, const std::string &labels, const std::string &extra, double value)
+    {
+        out += name;
+        out += suffix;
+        if (!labels.empty() || !extra.empty())
+        {
+            out += '{';
+            out += labels;
+            if (!labels.empty() && !extra.empty())
+                out += ',';
+            out += extra;
+            out += '}';
+        }
+        out += ' ';
+        appendValue(out, value);
+        out += '\n';
+    }
+
+    bool sendAll(int fd, const char *data, size_t size)
+    {
+        while (size > 0)
+        {
+            ssize_t sent = ::send(fd, data, size, MSG_NOSIGNAL);
+            if (sent <= 0)
+                return false;
+            data += sent;
+            size -= static_cast<size_t>(sent);
+        }
+        return true;
+    }
+}
+
+uint64_t Counter::value() const
+{
+    uint64_t total = 0;
+    for (const Shard &shard : shards)
+        total += shard.value.load(std::memory_order_relaxed);
+    return total;
+}
+
+void Gauge::add(double delta)
+{
+    double v = current.load(std::memory_order_relaxed);
+    while (!current.compare_exchange_weak(v, v + delta, std::memory_order_relaxed))
+    {
+    }
+}
+
+void Histogram::collect(LatencyHistogram &out) const
+{
+    for (const LatencyHistogram &shard : shards)
+        out.merge(shard);
+}
+
+MetricsRegistry::Entry &MetricsRegistry::entry(const std::string &name, const std::string &help, Type type, const MetricLabels &labels)
+{
+    auto inserted = families.try_emplace(name);
+    Family &family = inserted.first->second;
+    if (inserted.second)
+    {
+        family.type = type;
+        family.help = help;
+    }
+    else if (family.type != type)
+    {
+        throw std::runtime_error("Metric " + name + " is already registered with another type");
+    }
+    std::string rendered = renderLabels(labels);
+    for (Entry &existing : family.entries)
+    {
+        if (existing.labels == rendered)
+            return existing;
+    }
+    family.entries.push_back(Entry());
+    family.entries.back().labels = std::move(rendered);
+    return family.entries.back();
+}
+
+Counter &MetricsRegistry::counter(const std::string &name, const std::string &help, const MetricLabels &labels)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    Entry &e = entry(name, help, Type::Counter, labels);
+    if (!e.counter)
+        e.counter = &counters.emplace_back();
+    return *e.counter;
+}
+
+Gauge &MetricsRegistry::gauge(const std::string &name, const std::string &help, const MetricLabels &labels)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    Entry &e = entry(name, help, Type::Gauge, labels);
+    if (!e.gauge)
+        e.gauge = &gauges.emplace_back();
+    return *e.gauge;
+}
+
+Histogram &MetricsRegistry::histogram(const std::string &name, const std::string &help, const MetricLabels &labels)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    Entry &e = entry(name, help, Type::Histogram, labels);
+    if (!e.histogram)
+        e.histogram = &histograms.emplace_back();
+    return *e.histogram;
+}
+
+void MetricsRegistry::sampled(const std::string &name, const std::string &help, const MetricLabels &labels, std::function<double()> sample)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    entry(name, help, Type::Gauge, labels).sample = std::move(sample);
+}
+
+void MetricsRegistry::sampledCounter(const std::string &name, const std::string &help, const MetricLabels &labels, std::function<double()> sample)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    entry(name, help, Type::Counter, labels).sample = std::move(sample);
+}
+
+void MetricsRegistry::removeSampled(const std::string &name, const MetricLabels &labels)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    auto family = families.find(name);
+    if (family == families.end())
+        return;
+    std::string rendered = renderLabels(labels);
+    auto &entries = family->second.entries;
+    for (auto it = entries.begin(); it != entries.end(); ++it)
+    {
+        if (it->labels == rendered && it->sample)
+        {
+            entries.erase(it);
+            break;
+        }
+    }
+    if (entries.empty())
+        families.erase(family);
+}
+
+// histograms become summaries: the quantiles are bucket upper bounds (~6%), quantile 1 is the max
+std::string MetricsRegistry::render() const
+{
+    std::string out;
+    out.reserve(8192);
+    std::lock_guard<std::mutex> lock(mutex);
+    for (const auto &item : families)
+    {
+        const std::string &name = item.first;
+        const Family &family = item.second;
+        static const char *const types[] = {"counter", "gauge", "summary"};
+        out += "# HELP " + name + ' ' + family.help + '\n';
+        out += "# TYPE " + name + ' ' + types[static_cast<int>(family.type)] + '\n';
+        for (const Entry &e : family.entries)
+        {
+            if (e.counter)
+                appendSample(out, name, "", e.labels, "", static_cast<double>(e.counter->value()));
+            else if (e.sample)
+                appendSample(out, name, "", e.labels, "", e.sample());
+            else if (e.gauge)
+                appendSample(out, name, "", e.labels, "", e.gauge->value());
+            else if (e.histogram)
+            {
+                LatencyHistogram merged;
+                e.histogram->collect(merged);
+                char quantile[32];
+                for (double q : QUANTILES)
+                {
+                    std::snprintf(quantile, sizeof(quantile), "quantile=\"%g\"", q);
+                    appendSample(out, name, "", e.labels, quantile, static_cast<double>(merged.percentile(q)));
+                }
+                appendSample(out, name, "", e.labels, "quantile=\"1\"", static_cast<double>(merged.max()));
+                appendSample(out, name, "_sum", e.labels, "", merged.mean() * merged.count());
+                appendSample(out, name, "_count", e.labels, "", static_cast<double>(merged.count()));
+            }
+        }
+    }
+    return out;
+}
+
+MetricsServer::MetricsServer(MetricsRegistry &registry, uint16_t port, const std::string &address) : registry(registry)
+{
+    sockaddr_in addr{};
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(port);
+    if (inet_pton(AF_INET, address.c_str(), &addr.sin_addr) != 1)
+    {
+        OEMS_LOG_ERROR("Metrics endpoint: bad address {}", address);
+        return;
+    }
+    int fd = ::socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    int one = 1;
+    if (fd < 0 || setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one)) != 0 ||
+        ::bind(fd, reinterpret_cast<sockaddr *>(&addr), sizeof(addr)) != 0 || ::listen(fd, 16) != 0)
+    {
+        OEMS_LOG_ERROR("Metrics endpoint: cannot listen on {}:{}: {}", address, port, std::strerror(errno));
+        if (fd >= 0)
+            ::close(fd);
+        return;
+    }
+    listenFd = fd;
+    thread = std::thread(&MetricsServer::serve, this);
+}
+
+MetricsServer::~MetricsServer()
+{
+    stopping = true;
+    if (thread.joinable())
+        thread.join();
+    if (listenFd >= 0)
+        ::close(listenFd);
+}
+
+// polls with a timeout so the destructor is noticed without closing the socket under accept()
+void MetricsServer::serve()
+{
+    pollfd pfd{listenFd, POLLIN, 0};
+    while (!stopping.load(std::memory_order_relaxed))
+    {
+        if (::poll(&pfd, 1, 200) <= 0)
+            continue;
+        int fd = ::accept4(listenFd, nullptr, nullptr, SOCK_CLOEXEC);
+        if (fd < 0)
+            continue;
+        answer(fd);
+        ::close(fd);
+    }
+}
+
+void MetricsServer::answer(int fd)
+{
+    timeval timeout{1, 0}; // a stalled scraper must not hold up the next one for long
+    setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+    char buffer[4096];
+    size_t size = 0;
+    while (size < sizeof(buffer))
+    {
+        ssize_t n = ::recv(fd, buffer + size, sizeof(buffer) - size, 0);
+        if (n <= 0)
+            return;
+        size += static_cast<size_t>(n);
+        if (std::string_view(buffer, size).find("\r\n\r\n") != std::string_view::npos)
+            break;
+    }
+
+    std::string_view request(buffer, size);
+    std::string_view line = request.substr(0, request.find("\r\n"));
+    bool metrics = line.rfind("GET /metrics ", 0) == 0 || line.rfind("GET /metrics?", 0) == 0;
+    std::string body = metrics ? registry.render() : std::string("Not found, try /metrics\n");
+    std::string head = metrics ? "HTTP/1.1 200 OK\r\nContent-Type: text/plain; version=0.0.4; charset=utf-8\r\n"
+                               : "HTTP/1.1 404 Not Found\r\nContent-Type: text/plain\r\n";
+    head += "Content-Length: " + std::to_string(body.size()) + "\r\nConnection: close\r\n\r\n";
+    if (sendAll(fd, head.data(), head.size()))
+        sendAll(fd, body.data(), body.size());
+}
+
+namespace UtilityNamespace
+{
+    MetricsRegistry &metrics()
+    {
+        static MetricsRegistry *registry = []()
+        {
+            auto *created = new MetricsRegistry(); // never destroyed, threads may record during exit
+            created->sampledCounter("process_cpu_seconds_total", "User and system CPU time of the process", {}, []()
+                             {
+                                 rusage usage{};
+                                 getrusage(RUSAGE_SELF, &usage);
+                                 return usage.ru_utime.tv_sec + usage.ru_stime.tv_sec + (usage.ru_utime.tv_usec + usage.ru_stime.tv_usec) / 1e6;
+                             });
+            created->sampled("process_resident_memory_bytes", "Resident set size of the process", {}, []()
+                             {
+                                 long pages = 0, resident = 0;
+                                 std::FILE *statm = std::fopen("/proc/self/statm", "r");
+                                 if (statm)
+                                 {
+                                     if (std::fscanf(statm, "%ld %ld", &pages, &resident) != 2)
+                                         resident = 0;
+                                     std::fclose(statm);
+                                 }
+                                 return static_cast<double>(resident) * sysconf(_SC_PAGESIZE);
+                             });
+            return created;
+        }();
+        return *registry;
+    }
+}
@@ -0,0 +1,592 @@
+#include "option_chain.hpp"
+#include "logger.hpp"
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <limits>
+#include <numeric>
+#include <simdjson.h>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+void OptionChain::clear()
+{
+    for (OptionChain::Column *column : {&expiryMs, &strikes, &logStrikes, &callPut, &bids, &asks, &iv, &delta, &gamma, &vega, &theta})
+        column->clear();
+    names.clear();
+    rows.clear();
+}
+
+size_t OptionChain::add(const OptionContract &contract)
+{
+    auto [it, added] = rows.try_emplace(contract.name, names.size());
+    if (!added)
+        return it->second;
+    double nan = std::numeric_limits<double>::quiet_NaN();
+    names.push_back(contract.name);
+    expiryMs.push_back(static_cast<double>(contract.expiryMs));
+    strikes.push_back(contract.strike);
+    logStrikes.push_back(std::log(contract.strike));
+    callPut.push_back(contract.call ? 1.0 : -1.0);
+    bids.push_back(0.0);
+    asks.push_back(0.0);
+    for (OptionChain::Column *column : {&iv, &delta, &gamma, &vega, &theta})
+        column->push_back(nan);
+    return it->second;
+}
+
+void OptionChain::sort()
+{
+    std::vector<size_t> order(size());
+    std::iota(order.begin(), order.end(), 0);
+    std::sort(order.begin(), order.end(), [this](size_t a, size_t b)
+              {
+                  if (expiryMs[a] != expiryMs[b])
+                      return expiryMs[a] < expiryMs[b];
+                  if (strikes[a] != strikes[b])
+                      return strikes[a] < strikes[b];
+                  return callPut[a] > callPut[b]; });
+    for (OptionChain::Column *column : {&expiryMs, &strikes, &logStrikes, &callPut, &bids, &asks, &iv, &delta, &gamma, &vega, &theta})
+    {
+        Column sorted(order.size());
+        for (size_t i = 0; i < order.size(); ++i)
+            sorted[i] = (*column)[order[i]];
+        column->swap(sorted);
+    }
+    std::vector<std::string> sortedNames(order.size());
+    for (size_t i = 0; i < order.size(); ++i)
+        sortedNames[i] = std::move(names[order[i]]);
+    names.swap(sortedNames);
+    for (size_t i = 0; i < names.size(); ++i)
+        rows.find(names[i])->second = i;
+}
+
+size_t OptionChain::find(std::string_view name) const
+{
+    auto it = rows.find(name);
+    return it == rows.end() ? npos : it->second;
+}
+
+bool OptionChain::setQuote(std::string_view name, double bid, double ask)
+{
+    size_t row = find(name);
+    if (row == npos)
+        return false;
+    bids[row] = bid > 0.0 ? bid : 0.0; // also turns NaN into no quote
+    asks[row] = ask > 0.0 ? ask : 0.0;
+    return true;
+}
+
+namespace
+{
+    int64_t daysFromCivil(int year, unsigned month, unsigned day)
+    {
+        year -= month <= 2;
+        const int64_t era = (year >= 0 ? year : year - 399) / 400;
+        const unsigned yearOfEra = static_cast<unsigned>(year - era * 400);
+        const unsigned dayOfYear = (153 * (month > 2 ? month - 3 : month + 9) + 2) / 5 + day - 1;
+        const unsigned dayOfEra = yearOfEra * 365 + yearOfEra / 4 - yearOfEra / 100 + dayOfYear;
+        return era * 146097 + static_cast<int64_t>(dayOfEra) - 719468;
+    }
+
+    bool parseDigits(std::string_view text, unsigned &value)
+    {
+        if (text.empty())
+            return false;
+        value = 0;
+        for (char c : text)
+        {
+            if (c < '0' || c > '9')
+                return false;
+            value = value * 10 + static_cast<unsigned>(c - '0');
+        }
+        return true;
+    }
+
+    // DMMMYY or DDMMMYY
+    bool parseExpiry(std::string_view text, int64_t &expiryMs)
+    {
+        static const char *const MONTHS[] = {"JAN", "FEB", "MAR", "APR", "MAY", "JUN", "JUL", "AUG", "SEP", "OCT", "NOV", "DEC"};
+        if (text.size() != 6 && text.size() != 7)
+            return false;
+        size_t dayDigits = text.size() - 5;
+        unsigned day, year;
+        if (!parseDigits(text.substr(0, dayDigits), day) || !parseDigits(text.substr(dayDigits + 3), year) || day == 0 || day > 31)
+            return false;
+        std::string_view month = text.substr(dayDigits, 3);
+        for (unsigned m = 0; m < 12; ++m)
+        {
+            if (month == MONTHS[m])
+            {
+                expiryMs = (daysFromCivil(2000 + static_cast<int>(year), m + 1, day) * 86400 + 8 * 3600) * 1000;
+                return true;
+            }
+        }
+        return false;
+    }
+
+    double numberOr(simdjson::simdjson_result<simdjson::ondemand::value> value, double fallback)
+    {
+        double number;
+        return value.get_double().get(number) == simdjson::SUCCESS ? number : fallback;
+    }
+}
+
+bool UtilityNamespace::parseOptionName(std::string_view name, OptionContract &contract)
+{
+    size_t expiryAt = name.find('-');
+    size_t strikeAt = expiryAt == std::string_view::npos ? expiryAt : name.find('-', expiryAt + 1);
+    size_t typeAt = strikeAt == std::string_view::npos ? strikeAt : name.find('-', strikeAt + 1);
+    if (typeAt == std::string_view::npos || typeAt + 2 != name.size() || expiryAt == 0)
+        return false;
+    char type = name.back();
+    if (type != 'C' && type != 'P')
+        return false;
+
+    int64_t expiryMs;
+    if (!parseExpiry(name.substr(expiryAt + 1, strikeAt - expiryAt - 1), expiryMs))
+        return false;
+    std::string strikeText(name.substr(strikeAt + 1, typeAt - strikeAt - 1));
+    std::replace(strikeText.begin(), strikeText.end(), 'd', '.');
+    char *parsedEnd = nullptr;
+    double strike = std::strtod(strikeText.c_str(), &parsedEnd);
+    if (strikeText.empty() || parsedEnd != strikeText.c_str() + strikeText.size() || !(strike > 0.0))
+        return false;
+
+    contract.name.assign(name.data(), name.size());
+    contract.currency.assign(name.data(), expiryAt);
+    contract.expiryMs = expiryMs;
+    contract.strike = strike;
+    contract.call = type == 'C';
+    return true;
+}
+
+// the name gives every field; strike and expiration_timestamp, when present, are the exact ones
+size_t UtilityNamespace::loadOptionInstruments(OptionChain &chain, std::string_view reply)
+{
+    size_t before = chain.size();
+    try
+    {
+        simdjson::ondemand::parser parser;
+        simdjson::padded_string body(reply);
+        simdjson::ondemand::document doc = parser.iterate(body);
+        for (simdjson::ondemand::object instrument : doc["result"].get_array())
+        {
+            OptionContract contract;
+            std::string_view name, kind = "option";
+            double strike = 0.0;
+            int64_t expiryMs = 0;
+            for (auto field : instrument)
+            {
+                std::string_view key = field.unescaped_key();
+                if (key == "instrument_name")
+                    name = field.value().get_string();
+                else if (key == "kind")
+                    kind = field.value().get_string();
+                else if (key == "strike")
+                    strike = numberOr(field.value(), 0.0);
+                else if (key == "expiration_timestamp" && field.value().get_int64().get(expiryMs) != simdjson::SUCCESS)
+                    expiryMs = 0;
+            }
+            if (kind != "option")
+                continue;
+            if (!parseOptionName(name, contract))
+            {
+                OEMS_LOG_WARN("Skipping option {}: not an option name", name);
+                continue;
+            }
+            if (strike > 0.0)
+                contract.strike = strike;
+            if (expiryMs > 0)
+                contract.expiryMs = expiryMs;
+            if (chain.currency.empty())
+                chain.currency = contract.currency;
+            chain.add(contract);
+        }
+    }
+    catch (const simdjson::simdjson_error &e)
+    {
+        OEMS_LOG_ERROR("Failed to parse option instruments: {}", e.what());
+    }
+    chain.sort();
+    return chain.size() - before;
+}
+
+size_t UtilityNamespace::loadOptionQuotes(OptionChain &chain, std::string_view reply, double *underlyingPrice)
+{
+    size_t quoted = 0;
+    bool priced = false;
+    try
+    {
+        simdjson::ondemand::parser parser;
+        simdjson::padded_string body(reply);
+        simdjson::ondemand::document doc = parser.iterate(body);
+        for (simdjson::ondemand::object summary : doc["result"].get_array())
+        {
+            std::string_view name;
+            double bid = 0.0, ask = 0.0, underlying = 0.0;
+            for (auto field : summary)
+            {
+                // prices are null when that side is empty
+                std::string_view key = field.unescaped_key();
+                if (key == "instrument_name")
+                    name = field.value().get_string();
+                else if (key == "bid_price")
+                    bid = numberOr(field.value(), 0.0);
+                else if (key == "ask_price")
+                    ask = numberOr(field.value(), 0.0);
+                else if (key == "underlying_price")
+                    underlying = numberOr(field.value(), 0.0);
+            }
+            if (!chain.setQuote(name, bid, ask))
+                continue;
+            ++quoted;
+            if (underlyingPrice && !priced && underlying > 0.0)
+            {
+                *underlyingPrice = underlying;
+                priced = true;
+            }
+        }
+    }
+    catch (const simdjson::simdjson_error &e)
+    {
+        OEMS_LOG_ERROR("Failed to parse option book summaries: {}", e.what());
+    }
+    return quoted;
+}
+
+namespace
+{
+#if defined(__AVX2__)
+    constexpr size_t LANES = 4;
+    using Vec = __m256d;
+    using Mask = __m256d; // all ones in the lanes where it holds
+    inline Vec load(const double *p) { return _mm256_loadu_pd(p); }
+    inline void store(double *p, Vec v) { _mm256_storeu_pd(p, v); }
+    inline Vec splat(double v) { return _mm256_set1_pd(v); }
+    inline Vec add(Vec a, Vec b) { return _mm256_add_pd(a, b); }
+    inline Vec sub(Vec a, Vec b) { return _mm256_sub_pd(a, b); }
+    inline Vec mul(Vec a, Vec b) { return _mm256_mul_pd(a, b); }
+    inline Vec div(Vec a, Vec b) { return _mm256_div_pd(a, b); }
+    inline Vec sqrtv(Vec a) { return _mm256_sqrt_pd(a); }
+    inline Vec minv(Vec a, Vec b) { return _mm256_min_pd(a, b); }
+    inline Vec maxv(Vec a, Vec b) { return _mm256_max_pd(a, b); }
+    inline Vec absv(Vec a) { return _mm256_andnot_pd(_mm256_set1_pd(-0.0), a); }
+    inline Mask less(Vec a, Vec b) { return _mm256_cmp_pd(a, b, _CMP_LT_OQ); }
+    inline Mask lessEq(Vec a, Vec b) { return _mm256_cmp_pd(a, b, _CMP_LE_OQ); }
+    inline Mask both(Mask a, Mask b) { return _mm256_and_pd(a, b); }
+    inline Mask either(Mask a, Mask b) { return _mm256_or_pd(a, b); }
+    inline Mask invert(Mask a) { return _mm256_xor_pd(a, _mm256_castsi256_pd(_mm256_set1_epi64x(-1))); }
+    inline Vec select(Mask mask, Vec a, Vec b) { return _mm256_blendv_pd(b, a, mask); }
+    inline bool all(Mask mask) { return _mm256_movemask_pd(mask) == 0xF; }
+    // 2^n from t = n + 1.5 * 2^52, whose low mantissa bits hold n
+    inline Vec pow2(Vec t)
+    {
+        __m256i bits = _mm256_add_epi64(_mm256_castpd_si256(t), _mm256_set1_epi64x(1023));
+        return _mm256_castsi256_pd(_mm256_slli_epi64(bits, 52));
+    }
+#elif defined(__SSE2__)
+    constexpr size_t LANES = 2;
+    using Vec = __m128d;
+    using Mask = __m128d;
+    inline Vec load(const double *p) { return _mm_loadu_pd(p); }
+    inline void store(double *p, Vec v) { _mm_storeu_pd(p, v); }
+    inline Vec splat(double v) { return _mm_set1_pd(v); }
+    inline Vec add(Vec a, Vec b) { return _mm_add_pd(a, b); }
+    inline Vec sub(Vec a, Vec b) { return _mm_sub_pd(a, b); }
+    inline Vec mul(Vec a, Vec b) { return _mm_mul_pd(a, b); }
+    inline Vec div(Vec a, Vec b) { return _mm_div_pd(a, b); }
+    inline Vec sqrtv(Vec a) { return _mm_sqrt_pd(a); }
+    inline Vec minv(Vec a, Vec b) { return _mm_min_pd(a, b); }
+    inline Vec maxv(Vec a, Vec b) { return _mm_max_pd(a, b); }
+    inline Vec absv(Vec a) { return _mm_andnot_pd(_mm_set1_pd(-0.0), a); }
+    inline Mask less(Vec a, Vec b) { return _mm_cmplt_pd(a, b); }
+    inline Mask lessEq(Vec a, Vec b) { return _mm_cmple_pd(a, b); }
+    inline Mask both(Mask a, Mask b) { return _mm_and_pd(a, b); }
+    inline Mask either(Mask a, Mask b) { return _mm_or_pd(a, b); }
+    inline Mask invert(Mask a) { return _mm_xor_pd(a, _mm_castsi128_pd(_mm_set1_epi64x(-1))); }
+    inline Vec select(Mask mask, Vec a, Vec b) { return _mm_or_pd(_mm_and_pd(mask, a), _mm_andnot_pd(mask, b)); }
+    inline bool all(Mask mask) { return _mm_movemask_pd(mask) == 0x3; }
+    inline Vec pow2(Vec t)
+    {
+        __m128i bits = _mm_add_epi64(_mm_castpd_si128(t), _mm_set1_epi64x(1023));
+        return _mm_castsi128_pd(_mm_slli_epi64(bits, 52));
+    }
+#else
+    // portable fallback with the same shape, one lane
+    constexpr size_t LANES = 1;
+    using Vec = double;
+    using Mask = bool;
+    inline Vec load(const double *p) { return *p; }
+    inline void store(double *p, Vec v) { *p = v; }
+    inline Vec splat(double v) { return v; }
+    inline Vec add(Vec a, Vec b) { return a + b; }
+    inline Vec sub(Vec a, Vec b) { return a - b; }
+    inline Vec mul(Vec a, Vec b) { return a * b; }
+    inline Vec div(Vec a, Vec b) { return a / b; }
+    inline Vec sqrtv(Vec a) { return std::sqrt(a); }
+    inline Vec minv(Vec a, Vec b) { return a < b ? a : b; }
+    inline Vec maxv(Vec a, Vec b) { return a > b ? a : b; }
+    inline Vec absv(Vec a) { return std::fabs(a); }
+    inline Mask less(Vec a, Vec b) { return a < b; }
+    inline Mask lessEq(Vec a, Vec b) { return a <= b; }
+    inline Mask both(Mask a, Mask b) { return a && b; }
+    inline Mask either(Mask a, Mask b) { return a || b; }
+    inline Mask invert(Mask a) { return !a; }
+    inline Vec select(Mask mask, Vec a, Vec b) { return mask ? a : b; }
+    inline bool all(Mask mask) { return mask; }
+    inline Vec pow2(Vec t)
+    {
+        uint64_t bits;
+        std::memcpy(&bits, &t, sizeof(bits));
+        bits = (bits + 1023) << 52;
+        std::memcpy(&t, &bits, sizeof(t));
+        return t;
+    }
+#endif
+
+    constexpr double MS_PER_YEAR = 365.0 * 86400.0 * 1000.0;
+    constexpr double INV_SQRT_2PI = 0.3989422804014327;
+    constexpr double SIGMA_MIN = 1e-4;
+    constexpr double SIGMA_MAX = 10.0;
+    constexpr double SIGMA_TOLERANCE = 1e-9;
+    constexpr double PRICE_TOLERANCE = 1e-13; // of the forward
+    constexpr int MAX_ITERATIONS = 40;
+
+    // e^x to about 1e-15 relative: x = n ln2 + r with |r| <= ln2 / 2, a degree 11 polynomial for e^r
+    inline Vec expv(Vec x)
+    {
+        constexpr double LOG2E = 1.4426950408889634;
+        constexpr double LN2_HI = 6.93147180369123816490e-01;
+        constexpr double LN2_LO = 1.90821492927058770002e-10;
+        constexpr double ROUND = 6755399441055744.0; // 1.5 * 2^52, adding it rounds to an integer
+        constexpr double COEFFICIENTS[] = {1.0 / 3628800.0, 1.0 / 362880.0, 1.0 / 40320.0, 1.0 / 5040.0, 1.0 / 720.0,
+                                           1.0 / 120.0, 1.0 / 24.0, 1.0 / 6.0, 0.5, 1.0, 1.0};
+        x = maxv(minv(x, splat(708.0)), splat(-708.0));
+        Vec t = add(mul(x, splat(LOG2E)), splat(ROUND));
+        Vec n = sub(t, splat(ROUND));
+        Vec r = sub(sub(x, mul(n, splat(LN2_HI))), mul(n, splat(LN2_LO)));
+        Vec p = splat(1.0 / 39916800.0);
+        for (double c : COEFFICIENTS)
+            p = add(mul(p, r), splat(c));
+        return mul(p, pow2(t));
+    }
+
+    // standard normal CDF from Hart's rational approximation (West, 2005), e = exp(-z * z / 2)
+    inline Vec normCdf(Vec z, Vec e)
+    {
+        constexpr double NUMERATOR[] = {0.700383064443688, 6.37396220353165, 33.912866078383, 112.079291497871,
+                                        221.213596169931, 220.206867912376};
+        constexpr double DENOMINATOR[] = {1.75566716318264, 16.064177579207, 86.7807322029461, 296.564248779674,
+                                          637.333633378831, 793.826512519948, 440.413735824752};
+        Vec a = absv(z);
+        Vec numerator = splat(3.52624965998911e-02);
+        for (double c : NUMERATOR)
+            numerator = add(mul(numerator, a), splat(c));
+        Vec denominator = splat(8.83883476483184e-02);
+        for (double c : DENOMINATOR)
+            denominator = add(mul(denominator, a), splat(c));
+        Vec tail = div(mul(e, numerator), denominator); // N(-|z|)
+        return select(less(splat(0.0), z), sub(splat(1.0), tail), tail);
+    }
+
+    struct Columns
+    {
+        const double *expiryMs, *strikes, *logStrikes, *callPut, *bids, *asks;
+        double *iv, *delta, *gamma, *vega, *theta;
+    };
+
+    struct Market
+    {
+        double spot, logSpot, rate, nowMs;
+    };
+
+    // LANES rows from row on
+    void solveBlock(const Columns &c, size_t row, const Market &market)
+    {
+        const Vec zero = splat(0.0), one = splat(1.0), half = splat(0.5);
+        const Vec spot = splat(market.spot), rate = splat(market.rate);
+        Vec years = mul(sub(load(c.expiryMs + row), splat(market.nowMs)), splat(1.0 / MS_PER_YEAR));
+        Vec bid = load(c.bids + row), ask = load(c.asks + row);
+        Mask valid = both(both(less(zero, bid), lessEq(bid, ask)), less(zero, years));
+        years = select(valid, years, one);
+
+        Vec sqrtT = sqrtv(years);
+        Vec rateT = mul(rate, years);
+        Vec growth = expv(rateT);
+        Vec discount = div(one, growth);
+        Vec forward = mul(spot, growth);
+        Vec strike = load(c.strikes + row), cp = load(c.callPut + row);
+        Vec moneyness = sub(add(splat(market.logSpot), rateT), load(c.logStrikes + row)); // ln(F / K)
+        Vec target = mul(mul(mul(add(bid, ask), half), spot), growth);                  // undiscounted USD price of the mid
+        Vec intrinsic = maxv(mul(cp, sub(forward, strike)), zero);
+        Vec upper = select(less(zero, cp), forward, strike);
+        valid = both(valid, both(less(intrinsic, target), less(target, upper)));
+        // rows without a price solve a harmless at-the-money stand-in, so no lane produces NaN
+        strike = select(valid, strike, forward);
+        moneyness = select(valid, moneyness, zero);
+        target = select(valid, target, mul(forward, splat(0.08)));
+
+        // Newton from the price's inflection point, sqrt(2 |ln(F / K)| / T), converges monotonically;
+        // a step leaving the bracket of known low and high volatilities bisects instead
+        Vec sigma = maxv(sqrtv(div(mul(splat(2.0), absv(moneyness)), years)), splat(SIGMA_MIN));
+        sigma = minv(sigma, splat(SIGMA_MAX));
+        Vec low = splat(SIGMA_MIN), high = splat(SIGMA_MAX);
+        Mask done = invert(valid);
+        for (int iteration = 0; iteration < MAX_ITERATIONS && !all(done); ++iteration)
+        {
+            Vec sd = mul(sigma, sqrtT);
+            Vec d1 = add(div(moneyness, sd), mul(half, sd));
+            Vec d2 = sub(d1, sd);
+            Vec e1 = expv(mul(splat(-0.5), mul(d1, d1)));
+            Vec e2 = expv(mul(splat(-0.5), mul(d2, d2)));
+            Vec price = mul(cp, sub(mul(forward, normCdf(mul(cp, d1), e1)), mul(strike, normCdf(mul(cp, d2), e2))));
+            Vec vega = mul(mul(forward, mul(e1, splat(INV_SQRT_2PI))), sqrtT);
+            Vec diff = sub(price, target);
+            Mask above = less(zero, diff);
+            high = select(above, minv(high, sigma), high);
+            low = select(above, low, maxv(low, sigma));
+            Vec next = sub(sigma, div(diff, maxv(vega, splat(1e-300))));
+            next = select(both(lessEq(low, next), lessEq(next, high)), next, mul(half, add(low, high)));
+            Mask priced = lessEq(absv(diff), mul(forward, splat(PRICE_TOLERANCE)));
+            next = select(priced, sigma, next);
+            Mask converged = either(priced, lessEq(absv(sub(next, sigma)), splat(SIGMA_TOLERANCE)));
+            sigma = select(done, sigma, next);
+            done = either(done, converged);
+        }
+        valid = both(valid, done);
+
+        Vec sd = mul(sigma, sqrtT);
+        Vec d1 = add(div(moneyness, sd), mul(half, sd));
+        Vec d2 = sub(d1, sd);
+        Vec e1 = expv(mul(splat(-0.5), mul(d1, d1)));
+        Vec e2 = expv(mul(splat(-0.5), mul(d2, d2)));
+        Vec pdf = mul(e1, splat(INV_SQRT_2PI));
+        // spot Greeks: F = S e^(rT), so the e^(rT) of dF/dS cancels the discount
+        Vec delta = mul(cp, normCdf(mul(cp, d1), e1));
+        Vec gamma = div(pdf, mul(spot, sd));
+        Vec vega = mul(mul(mul(spot, pdf), sqrtT), splat(0.01));
+        Vec decay = div(mul(mul(spot, pdf), sigma), mul(splat(2.0), sqrtT));
+        Vec carry = mul(mul(mul(cp, rate), mul(strike, discount)), normCdf(mul(cp, d2), e2));
+        Vec theta = mul(sub(sub(zero, decay), carry), splat(1.0 / 365.0));
+
+        const Vec nan = splat(std::numeric_limits<double>::quiet_NaN());
+        store(c.iv + row, select(valid, sigma, nan));
+        store(c.delta + row, select(valid, delta, nan));
+        store(c.gamma + row, select(valid, gamma, nan));
+        store(c.vega + row, select(valid, vega, nan));
+        store(c.theta + row, select(valid, theta, nan));
+    }
+}
+
+void UtilityNamespace::computeOptionGreeks(OptionChain &chain, size_t begin, size_t end, double underlyingPrice, int64_t nowMs, double rate)
+{
+    end = std::min(end, chain.size());
+    if (begin >= end || !(underlyingPrice > 0.0))
+        return;
+    Columns columns{chain.expiryMs.data(), chain.strikes.data(), chain.logStrikes.data(), chain.callPut.data(),
+                    chain.bids.data(), chain.asks.data(), chain.iv.data(), chain.delta.data(), chain.gamma.data(),
+                    chain.vega.data(), chain.theta.data()};
+    Market market{underlyingPrice, std::log(underlyingPrice), rate, static_cast<double>(nowMs)};
+
+    size_t row = begin;
+    for (; row + LANES <= end; row += LANES)
+        solveBlock(columns, row, market);
+    if (row == end)
+        return;
+
+    // the last rows through a padded copy, the padding has no quote
+    double inputs[6][LANES] = {}, outputs[5][LANES];
+    const double *sources[6] = {columns.expiryMs, columns.strikes, columns.logStrikes, columns.callPut, columns.bids, columns.asks};
+    double *targets[5] = {columns.iv, columns.delta, columns.gamma, columns.vega, columns.theta};
+    size_t count = end - row;
+    for (size_t column = 0; column < 6; ++column)
+        std::copy(sources[column] + row, sources[column] + end, inputs[column]);
+    Columns padded{inputs[0], inputs[1], inputs[2], inputs[3], inputs[4], inputs[5],
+                   outputs[0], outputs[1], outputs[2], outputs[3], outputs[4]};
+    solveBlock(padded, 0, market);
+    for (size_t column = 0; column < 5; ++column)
+        std::copy(outputs[column], outputs[column] + count, targets[column] + row);
+}
+
+ChainCalculator::ChainCalculator(size_t threadCount, double rate) : rate(rate)
+{
+    if (threadCount == 0)
+        threadCount = std::max(1u, std::thread::hardware_concurrency());
+    for (size_t i = 1; i < threadCount; ++i)
+        workers.emplace_back(&ChainCalculator::workerLoop, this, i);
+}
+
+ChainCalculator::~ChainCalculator()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    wake.notify_all();
+    for (std::thread &worker : workers)
+        worker.join();
+}
+
+void ChainCalculator::compute(OptionChain &chain, double underlyingPrice, int64_t nowMs)
+{
+    chain.underlyingPrice = underlyingPrice;
+    chain.computedMs = nowMs;
+    size_t rows = chain.size();
+    size_t blockCount = std::min(threads(), std::max<size_t>(1, rows / MIN_ROWS_PER_THREAD));
+    // whole cache lines per block (the columns are line aligned), so no two threads write the same line of an output column
+    size_t blockRows = ((rows + blockCount - 1) / blockCount + 7) / 8 * 8;
+    std::function<void(size_t)> run = [&](size_t block)
+    {
+        size_t begin = block * blockRows;
+        UtilityNamespace::computeOptionGreeks(chain, begin, std::min(rows, begin + blockRows), underlyingPrice, nowMs, rate);
+    };
+    if (blockCount == 1)
+    {
+        run(0);
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        job = &run;
+        blocks = blockCount;
+        pending = blockCount - 1;
+        ++generation;
+    }
+    wake.notify_all();
+    run(0);
+    std::unique_lock<std::mutex> lock(mutex);
+    finished.wait(lock, [this]()
+                  { return pending == 0; });
+    job = nullptr;
+}
+
+void ChainCalculator::workerLoop(size_t index)
+{
+    uint64_t seen = 0;
+    for (;;)
+    {
+        const std::function<void(size_t)> *task;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            wake.wait(lock, [&]()
+                      { return stopping || generation != seen; });
+            if (stopping)
+                return;
+            seen = generation;
+            if (index >= blocks)
+                continue;
+            task = job;
+        }
+        (*task)(index);
+        std::lock_guard<std::mutex> lock(mutex);
+        if (--pending == 0)
+            finished.notify_one();
+    }
+}
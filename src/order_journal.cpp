@@ -0,0 +1,511 @@
+#include "order_journal.hpp"
+#include "clock.hpp"
+#include "logger.hpp"
+#include <algorithm>
+#include <cstring>
+#include <cstdio>
+#include <fcntl.h>
+#include <limits>
+#include <simdjson.h>
+#include <stdexcept>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <unordered_map>
+#include <unordered_set>
+
+namespace
+{
+    uint32_t fnv1a(uint32_t hash, const void *data, size_t size)
+    {
+        const unsigned char *bytes = static_cast<const unsigned char *>(data);
+        for (size_t i = 0; i < size; ++i)
+        {
+            hash ^= bytes[i];
+            hash *= 16777619u;
+        }
+        return hash;
+    }
+
+    uint32_t recordChecksum(uint64_t sequence, const char *payload, size_t size)
+    {
+        return fnv1a(fnv1a(2166136261u, &sequence, sizeof(sequence)), payload, size);
+    }
+
+    size_t pageSize()
+    {
+        static const size_t size = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+        return size;
+    }
+}
+
+OrderJournal::OrderJournal(std::string path, JournalOptions opts)
+    : filePath(std::move(path)), options(opts), lastSync(std::chrono::steady_clock::now())
+{
+    fd = open(filePath.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+    if (fd < 0)
+        throw std::runtime_error("Cannot open order journal " + filePath + ": " + std::strerror(errno));
+
+    recover();
+    pending.reserve(options.groupBytes * 2);
+    writing.reserve(options.groupBytes * 2);
+    commitThread = std::thread([this]()
+                               { commitLoop(); });
+}
+
+OrderJournal::~OrderJournal()
+{
+    {
+        std::lock_guard<std::mutex> lock(pendingMutex);
+        running = false;
+    }
+    commitReady.notify_one();
+    commitThread.join();
+
+    std::lock_guard<std::mutex> lock(mapMutex);
+    if (map)
+    {
+        msync(map, mappedBytes, MS_SYNC);
+        munmap(map, mappedBytes);
+    }
+    if (ftruncate(fd, static_cast<off_t>(writeOffset)) != 0)
+        OEMS_LOG_ERROR("Cannot trim order journal {}: {}", filePath, std::strerror(errno));
+    close(fd);
+}
+
+// maps the existing file, walks the valid records and zeroes whatever a crash left behind them
+void OrderJournal::recover()
+{
+    struct stat info;
+    if (fstat(fd, &info) != 0)
+        throw std::runtime_error("Cannot stat order journal " + filePath);
+    size_t fileBytes = static_cast<size_t>(info.st_size);
+    if (fileBytes == 0)
+        return;
+
+    ensureCapacity(fileBytes);
+    size_t offset = 0;
+    uint64_t lastSequence = 0;
+    uint64_t valid = 0;
+    while (offset + sizeof(JournalRecordHeader) <= fileBytes)
+    {
+        JournalRecordHeader header;
+        std::memcpy(&header, map + offset, sizeof(header));
+        size_t end = offset + sizeof(header) + header.length;
+        if (header.sequence == 0 || end > fileBytes || header.methodLength > header.length || header.sequence != lastSequence + 1 ||
+            header.checksum != recordChecksum(header.sequence, map + offset + sizeof(header), header.length))
+            break;
+        lastSequence = header.sequence;
+        offset = end;
+        ++valid;
+    }
+
+    if (offset < fileBytes)
+        std::memset(map + offset, 0, fileBytes - offset);
+    writeOffset = offset;
+    syncedOffset = offset;
+    nextSequence = lastSequence + 1;
+    recordCount = valid;
+}
+
+uint64_t OrderJournal::appendRequest(std::string_view method, std::string_view payload)
+{
+    return append(JournalRecordType::Request, 0, true, method, payload);
+}
+
+void OrderJournal::appendAck(uint64_t requestSequence, bool ok, std::string_view response)
+{
+    append(JournalRecordType::Ack, requestSequence, ok, std::string_view(), response);
+}
+
+// the only work on the caller's thread: one copy into the pending group
+uint64_t OrderJournal::append(JournalRecordType type, uint64_t requestSequence, bool ok, std::string_view method, std::string_view body)
+{
+    // both lengths are narrowed into the header, and the copy below is sized from it
+    if (method.size() > std::numeric_limits<uint16_t>::max() || body.size() > std::numeric_limits<uint32_t>::max() - method.size())
+        throw std::runtime_error("Order journal record too long for " + filePath + ": method " + std::to_string(method.size()) +
+                                 " bytes, body " + std::to_string(body.size()) + " bytes");
+    JournalRecordHeader header{};
+    header.length = static_cast<uint32_t>(method.size() + body.size());
+    header.requestSequence = requestSequence;
+    header.timestampNs = UtilityNamespace::wallNowNs();
+    header.type = static_cast<uint8_t>(type);
+    header.status = ok ? 1 : 0;
+    header.methodLength = static_cast<uint16_t>(method.size());
+
+    bool wake;
+    {
+        std::lock_guard<std::mutex> lock(pendingMutex);
+        header.sequence = nextSequence++;
+        size_t start = pending.size();
+        pending.resize(start + sizeof(header) + header.length);
+        char *record = pending.data() + start;
+        std::memcpy(record + sizeof(header), method.data(), method.size());
+        std::memcpy(record + sizeof(header) + method.size(), body.data(), body.size());
+        header.checksum = recordChecksum(header.sequence, record + sizeof(header), header.length);
+        std::memcpy(record, &header, sizeof(header));
+        wake = pending.size() >= options.groupBytes;
+    }
+    if (wake)
+        commitReady.notify_one();
+    return header.sequence;
+}
+
+void OrderJournal::flush()
+{
+    std::unique_lock<std::mutex> lock(pendingMutex);
+    uint64_t ticket = ++flushRequested;
+    commitReady.notify_one();
+    flushDone.wait(lock, [this, ticket]()
+                   { return flushCompleted >= ticket; });
+}
+
+void OrderJournal::commitLoop()
+{
+    while (true)
+    {
+        uint64_t flushTicket;
+        bool stopping;
+        {
+            std::unique_lock<std::mutex> lock(pendingMutex);
+            commitReady.wait_for(lock, options.commitInterval, [this]()
+                                 { return !running || pending.size() >= options.groupBytes || flushRequested > flushCompleted; });
+            pending.swap(writing);
+            flushTicket = flushRequested;
+            stopping = !running;
+        }
+
+        if (!writing.empty())
+        {
+            write(writing);
+            writing.clear();
+            commitCount.fetch_add(1, std::memory_order_relaxed);
+        }
+
+        auto now = std::chrono::steady_clock::now();
+        bool flushing = flushTicket > flushCompleted;
+        if (flushing || stopping || options.fsync == FsyncPolicy::EveryCommit ||
+            (options.fsync == FsyncPolicy::Interval && now - lastSync >= options.syncInterval))
+        {
+            sync();
+            lastSync = now;
+        }
+
+        if (flushing)
+        {
+            {
+                std::lock_guard<std::mutex> lock(pendingMutex);
+                flushCompleted = flushTicket;
+            }
+            flushDone.notify_all();
+        }
+        if (stopping)
+        {
+            std::lock_guard<std::mutex> lock(pendingMutex);
+            if (pending.empty())
+                return;
+        }
+    }
+}
+
+void OrderJournal::write(const std::vector<char> &group)
+{
+    std::lock_guard<std::mutex> lock(mapMutex);
+    ensureCapacity(writeOffset + group.size());
+    std::memcpy(map + writeOffset, group.data(), group.size());
+    writeOffset += group.size();
+    size_t count = 0;
+    for (size_t offset = 0; offset < group.size(); ++count)
+    {
+        JournalRecordHeader header;
+        std::memcpy(&header, group.data() + offset, sizeof(header));
+        offset += sizeof(header) + header.length;
+    }
+    recordCount.fetch_add(count, std::memory_order_relaxed);
+}
+
+// grows the file by whole segments and remaps it; callers hold mapMutex (or run before the commit thread)
+void OrderJournal::ensureCapacity(size_t bytes)
+{
+    if (bytes <= mappedBytes)
+        return;
+    size_t segment = std::max(options.segmentBytes, pageSize());
+    size_t target = (bytes + segment - 1) / segment * segment;
+    if (map)
+        munmap(map, mappedBytes);
+    map = nullptr;
+
+    struct stat info;
+    if (fstat(fd, &info) == 0 && static_cast<size_t>(info.st_size) < target && ftruncate(fd, static_cast<off_t>(target)) != 0)
+        throw std::runtime_error("Cannot grow order journal " + filePath + ": " + std::strerror(errno));
+    void *mapped = mmap(nullptr, target, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (mapped == MAP_FAILED)
+        throw std::runtime_error("Cannot map order journal " + filePath + ": " + std::strerror(errno));
+    map = static_cast<char *>(mapped);
+    mappedBytes = target;
+}
+
+// msync the pages written since the last sync
+void OrderJournal::sync()
+{
+    std::lock_guard<std::mutex> lock(mapMutex);
+    if (!map || writeOffset == syncedOffset)
+        return;
+    size_t start = syncedOffset / pageSize() * pageSize();
+    if (msync(map + start, writeOffset - start, MS_SYNC) != 0)
+    {
+        OEMS_LOG_ERROR("Order journal sync failed: {}", std::strerror(errno));
+        return;
+    }
+    syncedOffset = writeOffset;
+    syncCount.fetch_add(1, std::memory_order_relaxed);
+}
+
+void OrderJournal::replay(const std::function<void(const JournalRecord &)> &visit) const
+{
+    std::lock_guard<std::mutex> lock(mapMutex);
+    size_t offset = 0;
+    while (offset < writeOffset)
+    {
+        JournalRecordHeader header;
+        std::memcpy(&header, map + offset, sizeof(header));
+        const char *payload = map + offset + sizeof(header);
+        JournalRecord record{static_cast<JournalRecordType>(header.type),
+                             header.sequence,
+                             header.requestSequence,
+                             header.timestampNs,
+                             header.status != 0,
+                             std::string_view(payload, header.methodLength),
+                             std::string_view(payload + header.methodLength, header.length - header.methodLength)};
+        visit(record);
+        offset += sizeof(header) + header.length;
+    }
+}
+
+uint64_t OrderJournal::compact(const std::function<bool(const JournalRecord &)> &keep)
+{
+    flush();
+    std::lock_guard<std::mutex> pendingLock(pendingMutex);
+    if (!pending.empty())
+        throw std::runtime_error("Order journal " + filePath + " was appended to while compacting");
+
+    std::vector<char> kept;
+    std::unordered_map<uint64_t, uint64_t> renumbered; // old request sequence to new
+    uint64_t count = 0, dropped = 0;
+    replay([&](const JournalRecord &record)
+           {
+               if (!keep(record))
+               {
+                   ++dropped;
+                   return;
+               }
+               JournalRecordHeader header{};
+               header.sequence = ++count;
+               if (record.type == JournalRecordType::Request)
+                   renumbered[record.sequence] = header.sequence;
+               else
+               {
+                   auto request = renumbered.find(record.requestSequence);
+                   header.requestSequence = request == renumbered.end() ? 0 : request->second;
+               }
+               header.length = static_cast<uint32_t>(record.method.size() + record.body.size());
+               header.timestampNs = record.timestampNs;
+               header.type = static_cast<uint8_t>(record.type);
+               header.status = record.ok ? 1 : 0;
+               header.methodLength = static_cast<uint16_t>(record.method.size());
+               size_t start = kept.size();
+               kept.resize(start + sizeof(header) + header.length);
+               char *out = kept.data() + start;
+               std::memcpy(out + sizeof(header), record.method.data(), record.method.size());
+               std::memcpy(out + sizeof(header) + record.method.size(), record.body.data(), record.body.size());
+               header.checksum = recordChecksum(header.sequence, out + sizeof(header), header.length);
+               std::memcpy(out, &header, sizeof(header)); });
+    if (dropped == 0)
+        return 0;
+
+    std::string tempPath = filePath + ".compact";
+    int tempFd = open(tempPath.c_str(), O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (tempFd < 0)
+        throw std::runtime_error("Cannot create " + tempPath + ": " + std::strerror(errno));
+    size_t written = 0;
+    while (written < kept.size())
+    {
+        ssize_t n = ::write(tempFd, kept.data() + written, kept.size() - written);
+        if (n <= 0)
+            break;
+        written += static_cast<size_t>(n);
+    }
+    if (written < kept.size() || fsync(tempFd) != 0 || std::rename(tempPath.c_str(), filePath.c_str()) != 0)
+    {
+        std::string reason = std::strerror(errno);
+        close(tempFd);
+        std::remove(tempPath.c_str());
+        throw std::runtime_error("Cannot compact order journal " + filePath + ": " + reason);
+    }
+
+    std::lock_guard<std::mutex> mapLock(mapMutex);
+    if (map)
+        munmap(map, mappedBytes);
+    map = nullptr;
+    mappedBytes = 0;
+    close(fd);
+    fd = tempFd;
+    ensureCapacity(kept.size());
+    writeOffset = kept.size();
+    syncedOffset = kept.size();
+    nextSequence = count + 1;
+    recordCount = count;
+    return dropped;
+}
+
+namespace
+{
+    // reads the fields of one Deribit order object
+    void parseOrder(simdjson::ondemand::object order, JournaledOrder &out)
+    {
+        for (auto field : order)
+        {
+            std::string_view key = field.unescaped_key();
+            if (key == "order_id")
+                out.orderId = std::string(std::string_view(field.value().get_string()));
+            else if (key == "instrument_name")
+                out.instrument = std::string(std::string_view(field.value().get_string()));
+            else if (key == "direction")
+                out.direction = std::string(std::string_view(field.value().get_string()));
+            else if (key == "order_state")
+                out.state = std::string(std::string_view(field.value().get_string()));
+            else if (key == "price")
+            {
+                double price;
+                if (field.value().get_double().get(price) == simdjson::SUCCESS) // "market_price" for market orders
+                    out.price = price;
+            }
+            else if (key == "amount")
+                out.amount = field.value().get_double();
+            else if (key == "filled_amount")
+                out.filledAmount = field.value().get_double();
+        }
+    }
+
+    bool isOpen(const std::string &state)
+    {
+        return state == "open" || state == "untriggered";
+    }
+}
+
+ReconcileReport UtilityNamespace::reconcileOrders(const OrderJournal &journal, const std::string &openOrdersResponse)
+{
+    int64_t start = steadyNowNs();
+    ReconcileReport report;
+    simdjson::ondemand::parser parser;
+
+    // journal pass: latest known state per order id, and requests still waiting for a usable reply
+    std::unordered_map<std::string, JournaledOrder> orders;
+    std::unordered_map<uint64_t, JournaledRequest> unanswered;
+    journal.replay([&](const JournalRecord &record)
+                   {
+        ++report.records;
+        if (record.type == JournalRecordType::Request)
+        {
+            unanswered[record.sequence] = JournaledRequest{record.sequence, record.timestampNs, std::string(record.method), std::string(record.body)};
+            return;
+        }
+        if (!record.ok)
+            return; // transport failure, the request stays in doubt
+
+        unanswered.erase(record.requestSequence);
+        try
+        {
+            simdjson::padded_string body(record.body);
+            simdjson::ondemand::document doc = parser.iterate(body);
+            simdjson::ondemand::object result;
+            if (doc["result"].get_object().get(result) != simdjson::SUCCESS)
+                return; // rejected by the exchange
+            JournaledOrder order;
+            simdjson::ondemand::object nested;
+            if (result["order"].get_object().get(nested) == simdjson::SUCCESS)
+                parseOrder(nested, order); // buy, sell and edit wrap the order
+            else
+            {
+                result.reset();
+                parseOrder(result, order); // cancel returns it directly
+            }
+            if (order.orderId.empty())
+                return;
+            order.lastSequence = record.sequence;
+            JournaledOrder &known = orders[order.orderId];
+            if (order.instrument.empty())
+                order.instrument = known.instrument;
+            known = std::move(order);
+        }
+        catch (const simdjson::simdjson_error &e)
+        {
+            OEMS_LOG_ERROR("Unreadable journaled reply {}: {}", record.sequence, e.what());
+        } });
+
+    // exchange pass
+    std::unordered_map<std::string, JournaledOrder> live;
+    try
+    {
+        simdjson::padded_string body(openOrdersResponse);
+        simdjson::ondemand::document doc = parser.iterate(body);
+        for (auto item : doc["result"].get_array())
+        {
+            JournaledOrder order;
+            parseOrder(item.get_object(), order);
+            if (!order.orderId.empty())
+                live[order.orderId] = std::move(order);
+        }
+        report.exchangeRead = true;
+    }
+    catch (const simdjson::simdjson_error &e)
+    {
+        OEMS_LOG_ERROR("Cannot read open orders for reconciliation: {}", e.what());
+    }
+
+    for (auto &entry : orders)
+    {
+        auto it = live.find(entry.first);
+        if (it != live.end())
+        {
+            it->second.lastSequence = entry.second.lastSequence;
+            report.open.push_back(std::move(it->second));
+            live.erase(it);
+        }
+        else if (isOpen(entry.second.state))
+        {
+            report.closed.push_back(std::move(entry.second));
+        }
+    }
+    for (auto &entry : live)
+    {
+        report.unknown.push_back(std::move(entry.second));
+    }
+    for (auto &entry : unanswered)
+    {
+        report.inDoubt.push_back(std::move(entry.second));
+    }
+    std::sort(report.inDoubt.begin(), report.inDoubt.end(), [](const JournaledRequest &a, const JournaledRequest &b)
+              { return a.sequence < b.sequence; });
+
+    report.elapsedNs = steadyNowNs() - start;
+    return report;
+}
+
+uint64_t UtilityNamespace::compactJournal(OrderJournal &journal, const ReconcileReport &report)
+{
+    if (!report.exchangeRead)
+        return 0;
+    std::unordered_set<uint64_t> keep; // in-doubt requests and the replies of open orders
+    for (const JournaledRequest &request : report.inDoubt)
+        keep.insert(request.sequence);
+    for (const JournaledOrder &order : report.open)
+        keep.insert(order.lastSequence);
+    std::unordered_set<uint64_t> answered; // requests of the kept replies
+    journal.replay([&](const JournalRecord &record)
+                   {
+                       if (record.type == JournalRecordType::Ack && keep.count(record.sequence))
+                           answered.insert(record.requestSequence); });
+    return journal.compact([&](const JournalRecord &record)
+                           { return keep.count(record.sequence) > 0 || answered.count(record.sequence) > 0; });
+}
@@ -1,67 +1,268 @@
 #include "order_manager.hpp"
 #include "utils.hpp"
+#include "arena.hpp"
+#include "jsonrpc.hpp"
+#include "logger.hpp"
+#include "clock.hpp"
+#include "metrics.hpp"
+#include <stdexcept>
 
-// function to place an order using the access access_token
-// order_manager.cpp
+// registered once per method, so the hot path only compares a few strings
+RequestMetrics &UtilityNamespace::requestMetrics(std::string_view path)
+{
+    static const char *const METHODS[] = {"private/buy", "private/sell", "private/cancel", "private/edit", "public/get_order_book",
+                                          "private/get_positions", "private/get_open_orders", "private/get_user_trades_by_currency", "public/get_instruments", "other"};
+    static std::vector<RequestMetrics> table = []()
+    {
+        MetricsRegistry &registry = UtilityNamespace::metrics();
+        std::vector<RequestMetrics> metrics;
+        for (const char *method : METHODS)
+        {
+            MetricLabels labels = {{"method", method}};
+            metrics.push_back({registry.counter("oems_requests_total", "Requests sent to the venue", labels),
+                               registry.counter("oems_request_failures_total", "Requests that got no reply from the venue", labels),
+                               registry.histogram("oems_request_latency_ns", "Time from sending a request to its reply", labels)});
+        }
+        return metrics;
+    }();
+    for (size_t i = 0; i + 1 < table.size(); ++i)
+    {
+        if (path == METHODS[i])
+            return table[i];
+    }
+    return table.back();
+}
+
+namespace
+{
+    bool timedPost(OrderVenue &venue, std::string_view path, std::string_view payload, std::pmr::string &response, double cost)
+    {
+        RequestMetrics &metrics = UtilityNamespace::requestMetrics(path);
+        int64_t startNs = UtilityNamespace::steadyNowNs();
+        bool ok = venue.post(path, payload, response, cost);
+        metrics.latency.record(UtilityNamespace::steadyNowNs() - startNs);
+        metrics.requests.add();
+        if (!ok)
+            metrics.failures.add();
+        return ok;
+    }
+}
+
+OrderManager::OrderManager(Session &session) : boundVenue(session), boundSession(&session)
+{
+}
+
+OrderManager::OrderManager(OrderVenue &venue) : boundVenue(venue), boundSession(dynamic_cast<Session *>(&venue))
+{
+}
+
+Session &OrderManager::session() const
+{
+    if (!boundSession)
+        throw std::runtime_error("OrderManager is not bound to an exchange session");
+    return *boundSession;
+}
+
+// function to place an order with the session's access token
 std::string OrderManager::placeOrder(const std::string &symbol, const std::string &type, double amount, double price, const std::string &orderType)
 {
-    std::string url = "https://test.deribit.com/api/v2/private/" + type; // 'buy' or 'sell'
+    ArenaScope scope;
+    std::pmr::string response(&scope.resource());
+    placeOrder(symbol, type, amount, price, orderType, response);
+    return std::string(response);
+}
 
-    nlohmann::json payload = {
-        {"jsonrpc", "2.0"},
-        {"id", 2},
-        {"method", "private/" + type},
-        {"params", {{"instrument_name", symbol}, {"amount", amount}, {"type", orderType}, {"price", price}}}};
+bool OrderManager::placeOrder(const std::string &symbol, const std::string &type, double amount, double price, const std::string &orderType, std::pmr::string &response)
+{
+    return sendPlaceOrder(symbol, type, amount, price, orderType, response, ORDER_COST);
+}
+
+bool OrderManager::sendPlaceOrder(const std::string &symbol, const std::string &type, double amount, double price, const std::string &orderType, std::pmr::string &response, double cost)
+{
+    if (const InstrumentSpec *instrument = instruments ? instruments->find(symbol) : nullptr)
+    {
+        Price tickPrice;
+        Quantity lotAmount;
+        if (!instrument->toPrice(price, tickPrice) || !instrument->toAmount(amount, lotAmount))
+        {
+            OEMS_LOG_WARN("Not sending {} {}: amount {} or price {} out of range", type, symbol, amount, price);
+            return false;
+        }
+        // never more aggressive or larger than asked
+        tickPrice = instrument->roundPrice(tickPrice, type == "sell" ? Rounding::Up : Rounding::Down);
+        lotAmount = instrument->roundAmount(lotAmount, Rounding::Down);
+        return sendPlaceOrder(*instrument, type, lotAmount, tickPrice, orderType, response, cost);
+    }
+
+    MessageArena &arena = threadArena();
+    std::pmr::string path("private/", &arena); // 'buy' or 'sell'
+    path += type;
 
-    // Authorization header
-    std::string authHeader = "Authorization: Bearer " + access_token;
+    std::pmr::string payload(&arena);
+    payload.reserve(256);
+    UtilityNamespace::encodePlaceOrder(payload, type, symbol, amount, price, orderType);
 
-    // Send POST request with authorization header
-    return UtilityNamespace::sendPostRequestWithAuth(url, payload.dump(), authHeader);
+    response.reserve(4096);
+    return send(path, payload, response, cost);
+}
+
+bool OrderManager::placeOrder(const InstrumentSpec &instrument, const std::string &type, Quantity amount, Price price, const std::string &orderType, std::pmr::string &response)
+{
+    return sendPlaceOrder(instrument, type, amount, price, orderType, response, ORDER_COST);
+}
+
+bool OrderManager::sendPlaceOrder(const InstrumentSpec &instrument, const std::string &type, Quantity amount, Price price, const std::string &orderType, std::pmr::string &response, double cost)
+{
+    if (!instrument.onTick(price) || !instrument.validAmount(amount))
+    {
+        OEMS_LOG_WARN("Not sending {} {}: amount {} or price {} off the lot or tick", type, instrument.name, instrument.toDouble(amount), instrument.toDouble(price));
+        return false;
+    }
+
+    MessageArena &arena = threadArena();
+    std::pmr::string path("private/", &arena);
+    path += type;
+
+    std::pmr::string payload(&arena);
+    payload.reserve(256);
+    UtilityNamespace::encodePlaceOrder(payload, type, instrument, amount, price, orderType);
+
+    response.reserve(4096);
+    return send(path, payload, response, cost);
 }
 
 // function to cancel an order
 std::string OrderManager::cancelOrder(const std::string &order_id)
 {
-    std::string url = "https://test.deribit.com/api/v2/private/cancel";
+    ArenaScope scope;
+    std::pmr::string response(&scope.resource());
+    cancelOrder(order_id, response);
+    return std::string(response);
+}
 
-    nlohmann::json payload = {
-        {"jsonrpc", "2.0"},
-        {"id", 2},
-        {"method", "private/cancel"},
-        {"params", {{"order_id", order_id}}}};
+bool OrderManager::cancelOrder(const std::string &order_id, std::pmr::string &response)
+{
+    return sendCancelOrder(order_id, response, ORDER_COST);
+}
 
-    std::string authHeader = "Authorization: Bearer " + access_token;
-    return UtilityNamespace::sendPostRequestWithAuth(url, payload.dump(), authHeader);
+bool OrderManager::sendCancelOrder(const std::string &order_id, std::pmr::string &response, double cost)
+{
+    std::pmr::string payload(&threadArena());
+    payload.reserve(128);
+    UtilityNamespace::encodeCancelOrder(payload, order_id);
+
+    response.reserve(4096);
+    return send("private/cancel", payload, response, cost);
 }
 
 // function to modify an order
 std::string OrderManager::modifyOrder(const std::string &order_id, double new_amount, double new_price)
 {
-    std::string url = "https://test.deribit.com/api/v2/private/edit";
-    nlohmann::json payload = {
-        {"jsonrpc", "2.0"},
-        {"id", 2},
-        {"method", "private/edit"},
-        {"params", {{"order_id", order_id}, {"amount", new_amount}, {"price", new_price}}}};
+    ArenaScope scope;
+    std::pmr::string response(&scope.resource());
+    modifyOrder(order_id, new_amount, new_price, response);
+    return std::string(response);
+}
+
+bool OrderManager::modifyOrder(const std::string &order_id, double new_amount, double new_price, std::pmr::string &response)
+{
+    return sendModifyOrder(order_id, new_amount, new_price, response, ORDER_COST);
+}
+
+bool OrderManager::sendModifyOrder(const std::string &order_id, double new_amount, double new_price, std::pmr::string &response, double cost)
+{
+    std::pmr::string payload(&threadArena());
+    payload.reserve(160);
+    UtilityNamespace::encodeModifyOrder(payload, order_id, new_amount, new_price);
+
+    response.reserve(4096);
+    return send("private/edit", payload, response, cost);
+}
+
+bool OrderManager::modifyOrder(const InstrumentSpec &instrument, const std::string &order_id, Quantity new_amount, Price new_price, std::pmr::string &response)
+{
+    if (!instrument.onTick(new_price) || !instrument.validAmount(new_amount))
+    {
+        OEMS_LOG_WARN("Not editing {}: amount {} or price {} off the lot or tick of {}", order_id, instrument.toDouble(new_amount), instrument.toDouble(new_price), instrument.name);
+        return false;
+    }
+
+    std::pmr::string payload(&threadArena());
+    payload.reserve(160);
+    UtilityNamespace::encodeModifyOrder(payload, order_id, instrument, new_amount, new_price);
+
+    response.reserve(4096);
+    return send("private/edit", payload, response, ORDER_COST);
+}
+
+// order requests go through here so the journal sees every request and its reply
+bool OrderManager::send(std::string_view path, std::string_view payload, std::pmr::string &response, double cost)
+{
+    uint64_t sequence = journal ? journal->appendRequest(path, payload) : 0;
+    bool ok = timedPost(boundVenue, path, payload, response, cost);
+    if (journal)
+        journal->appendAck(sequence, ok, response);
+    return ok;
+}
+
+// the venue takes the credits when it queues the task, so the request itself is sent at cost 0
+void OrderManager::placeOrderAsync(const std::string &symbol, const std::string &type, double amount, double price, const std::string &orderType, ResponseHandler done)
+{
+    boundVenue.submit([this, symbol, type, amount, price, orderType, done = std::move(done)]()
+                      {
+                          ArenaScope scope;
+                          std::pmr::string response(&scope.resource());
+                          bool ok = sendPlaceOrder(symbol, type, amount, price, orderType, response, 0.0);
+                          if (done)
+                              done(ok, std::string(response)); },
+                      ORDER_COST);
+}
+
+void OrderManager::cancelOrderAsync(const std::string &order_id, ResponseHandler done)
+{
+    boundVenue.submit([this, order_id, done = std::move(done)]()
+                      {
+                          ArenaScope scope;
+                          std::pmr::string response(&scope.resource());
+                          bool ok = sendCancelOrder(order_id, response, 0.0);
+                          if (done)
+                              done(ok, std::string(response)); },
+                      ORDER_COST);
+}
+
+void OrderManager::modifyOrderAsync(const std::string &order_id, double new_amount, double new_price, ResponseHandler done)
+{
+    boundVenue.submit([this, order_id, new_amount, new_price, done = std::move(done)]()
+                      {
+                          ArenaScope scope;
+                          std::pmr::string response(&scope.resource());
+                          bool ok = sendModifyOrder(order_id, new_amount, new_price, response, 0.0);
+                          if (done)
+                              done(ok, std::string(response)); },
+                      ORDER_COST);
+}
 
-    std::string authHeader = "Authorization: Bearer " + access_token;
-    return UtilityNamespace::sendPostRequestWithAuth(url, payload.dump(), authHeader);
+// blocking request through the venue for the account queries below
+std::string OrderManager::request(std::string_view path, const std::string &payload)
+{
+    ArenaScope scope;
+    std::pmr::string response(&scope.resource());
+    timedPost(boundVenue, path, payload, response, QUERY_COST);
+    return std::string(response);
 }
 
 // function to get order book
 std::string OrderManager::getOrderBook(const std::string &symbol)
 {
-    std::string url = "https://test.deribit.com/api/v2/public/get_order_book";
     std::string payload = "{\"jsonrpc\":\"2.0\", \"method\":\"public/get_order_book\", \"params\":{\"instrument_name\":\"" + symbol + "\"}, \"id\":4}";
-    std::string response = UtilityNamespace::sendPostRequest(url, payload);
+    std::string response = request("public/get_order_book", payload);
 
     // Parse response and handle errors
     simdjson::ondemand::parser parser;
     simdjson::ondemand::document jsonResponse = parser.iterate(response);
     if (jsonResponse["result"].error() != simdjson::SUCCESS)
     {
-        std::cerr << "Failed to fetch order book. Response: " << response << "\n";
+        OEMS_LOG_ERROR("Failed to fetch order book. Response: {}", response);
     }
     return response;
 }
@@ -69,70 +270,75 @@ std::string OrderManager::getOrderBook(const std::string &symbol)
 // function to get current positions
 std::string OrderManager::getCurrentPositions(const std::string &currency)
 {
-    std::string url = "https://test.deribit.com/api/v2/private/get_positions";
-
     nlohmann::json payload = {
         {"jsonrpc", "2.0"},
         {"id", 4},
         {"method", "private/get_positions"},
         {"params", {{"currency", currency}, {"kind", "future"}}}};
 
-    std::string authHeader = "Authorization: Bearer " + access_token;
-
-    std::string response = UtilityNamespace::sendPostRequestWithAuth(url, payload.dump(), authHeader);
+    std::string response = request("private/get_positions", payload.dump());
 
     // Parse response and handle errors
     simdjson::ondemand::parser parser;
     simdjson::ondemand::document jsonResponse = parser.iterate(response);
     if (jsonResponse["result"].error() != simdjson::SUCCESS)
     {
-        std::cerr << "Failed to fetch positions. Response: " << response << "\n";
+        OEMS_LOG_ERROR("Failed to fetch positions. Response: {}", response);
     }
     return response;
 }
 std::string OrderManager::getOpenOrders()
 {
-    std::string url = "https://test.deribit.com/api/v2/private/get_open_orders";
-
     nlohmann::json payload = {
         {"jsonrpc", "2.0"},
         {"id", 5},
         {"method", "private/get_open_orders"},
         {"params", {}}};
 
-    std::string authHeader = "Authorization: Bearer " + access_token;
-
-    std::string response = UtilityNamespace::sendPostRequestWithAuth(url, payload.dump(), authHeader);
+    std::string response = request("private/get_open_orders", payload.dump());
 
     // Parse response and handle errors
     simdjson::ondemand::parser parser;
     simdjson::ondemand::document jsonResponse = parser.iterate(response);
     if (jsonResponse["result"].error() != simdjson::SUCCESS)
     {
-        std::cerr << "Failed to fetch open orders. Response: " << response << "\n";
+        OEMS_LOG_ERROR("Failed to fetch open orders. Response: {}", response);
     }
     return response;
 }
 std::string OrderManager::getTradeHistory(const std::string &currency)
 {
-    std::string url = "https://test.deribit.com/api/v2/private/get_user_trades_by_currency";
-
     nlohmann::json payload = {
         {"jsonrpc", "2.0"},
         {"id", 6},
         {"method", "private/get_user_trades_by_currency"},
         {"params", {{"currency", currency}}}};
 
-    std::string authHeader = "Authorization: Bearer " + access_token;
+    std::string response = request("private/get_user_trades_by_currency", payload.dump());
+
+    // Parse response and handle errors
+    simdjson::ondemand::parser parser;
+    simdjson::ondemand::document jsonResponse = parser.iterate(response);
+    if (jsonResponse["result"].error() != simdjson::SUCCESS)
+    {
+        OEMS_LOG_ERROR("Failed to fetch trade history. Response: {}", response);
+    }
+    return response;
+}
+std::string OrderManager::getInstruments(const std::string &currency)
+{
+    std::string payload = "{\"jsonrpc\":\"2.0\",\"id\":7,\"method\":\"public/get_instruments\",\"params\":{\"currency\":";
+    UtilityNamespace::appendJsonString(payload, currency);
+    payload += ",\"expired\":false}}";
 
-    std::string response = UtilityNamespace::sendPostRequestWithAuth(url, payload.dump(), authHeader);
+    std::string response = request("public/get_instruments", payload);
 
     // Parse response and handle errors
     simdjson::ondemand::parser parser;
     simdjson::ondemand::document jsonResponse = parser.iterate(response);
     if (jsonResponse["result"].error() != simdjson::SUCCESS)
     {
-        std::cerr << "Failed to fetch trade history. Response: " << response << "\n";
+        OEMS_LOG_ERROR("Failed to fetch instruments. Response: {}", response);
     }
     return response;
 }
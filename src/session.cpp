@@ -0,0 +1,314 @@
+#include "session.hpp"
+#include "arena.hpp"
+#include "jsonrpc.hpp"
+#include "logger.hpp"
+#include <boost/asio/post.hpp>
+#include <algorithm>
+#include <simdjson.h>
+#include <stdexcept>
+
+RateLimiter::RateLimiter(double creditsPerSecond, double burstCredits, LimiterClock limiterClock)
+    : clock(std::move(limiterClock)), rate(creditsPerSecond), capacity(burstCredits), credits(burstCredits), lastNs(clock.now())
+{
+}
+
+std::chrono::nanoseconds RateLimiter::tryAcquire(double cost)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    int64_t nowNs = clock.now();
+    credits = std::min(capacity, credits + (nowNs - lastNs) * rate / 1e9);
+    lastNs = nowNs;
+    if (credits >= cost)
+    {
+        credits -= cost;
+        return std::chrono::nanoseconds(0);
+    }
+    // rounded up, so the credits are there once the wait is over
+    auto wait = std::chrono::duration<double>((cost - credits) / rate);
+    return std::max(std::chrono::ceil<std::chrono::nanoseconds>(wait), std::chrono::nanoseconds(1));
+}
+
+void RateLimiter::acquire(double cost)
+{
+    for (std::chrono::nanoseconds wait = tryAcquire(cost); wait.count() != 0; wait = tryAcquire(cost))
+    {
+        clock.sleep(wait);
+    }
+}
+
+SessionLoop::SessionLoop(size_t threadCount) : work(boost::asio::make_work_guard(io))
+{
+    for (size_t i = 0; i < std::max<size_t>(threadCount, 1); ++i)
+    {
+        threads.emplace_back([this]()
+                             { io.run(); });
+    }
+}
+
+SessionLoop::~SessionLoop()
+{
+    stop();
+}
+
+// pending timers and queued tasks are dropped, so stop the loop before destroying its sessions
+void SessionLoop::stop()
+{
+    work.reset();
+    io.stop();
+    for (std::thread &thread : threads)
+    {
+        if (thread.joinable())
+            thread.join();
+    }
+    threads.clear();
+}
+
+Session::TransportLease::TransportLease(Session &session) : session(session)
+{
+    std::unique_lock<std::mutex> lock(session.poolMutex);
+    if (session.idle.empty())
+    {
+        session.waitingMetric.add(1);
+        session.poolReady.wait(lock, [&session]()
+                               { return !session.idle.empty(); });
+        session.waitingMetric.add(-1);
+    }
+    transport = session.idle.back();
+    session.idle.pop_back();
+}
+
+Session::TransportLease::~TransportLease()
+{
+    {
+        std::lock_guard<std::mutex> lock(session.poolMutex);
+        session.idle.push_back(transport);
+    }
+    session.poolReady.notify_one();
+}
+
+Session::Session(SessionLoop &loop, std::string name, Credentials credentials, SessionOptions opts)
+    : loop(loop), sessionName(std::move(name)), credentials(std::move(credentials)), options(std::move(opts)),
+      limiter(options.creditsPerSecond, options.burstCredits, options.clock), refreshTimer(loop.context()),
+      throttledMetric(UtilityNamespace::metrics().counter("oems_throttled_total", "Requests that waited for rate-limit credits", {{"session", sessionName}})),
+      waitingMetric(UtilityNamespace::metrics().gauge("oems_transport_waiters", "Threads waiting for a free keep-alive transport", {{"session", sessionName}}))
+{
+    for (size_t i = 0; i < std::max<size_t>(options.poolSize, 1); ++i)
+    {
+        transports.push_back(std::make_unique<HttpTransport>(options.socket));
+        idle.push_back(transports.back().get());
+    }
+}
+
+Session::~Session() = default;
+
+void Session::authenticate()
+{
+    std::string payload = "{\"jsonrpc\":\"2.0\",\"id\":1,\"method\":\"public/auth\",\"params\":{\"grant_type\":\"client_credentials\",\"client_id\":";
+    UtilityNamespace::appendJsonString(payload, credentials.clientId);
+    payload += ",\"client_secret\":";
+    UtilityNamespace::appendJsonString(payload, credentials.clientSecret);
+    payload += "}}";
+    if (!requestToken(payload))
+        throw std::runtime_error("Authentication failed for session " + sessionName);
+}
+
+// posts an auth request and on success stores the tokens and schedules the next refresh
+bool Session::requestToken(const std::string &payload)
+{
+    ArenaScope scope;
+    std::pmr::string url(&scope.resource());
+    appendUrl(url, "public/auth");
+    std::string response;
+    {
+        std::pmr::string reply(&scope.resource());
+        TransportLease transport(*this);
+        if (!transport->post(url.c_str(), payload, nullptr, reply))
+        {
+            OEMS_LOG_ERROR("Session {}: auth request failed", sessionName);
+            return false;
+        }
+        response.assign(reply.data(), reply.size());
+    }
+
+    std::string accessToken, nextRefreshToken;
+    int64_t expiresIn = 0;
+    try
+    {
+        simdjson::ondemand::parser parser;
+        simdjson::ondemand::document doc = parser.iterate(response);
+        simdjson::ondemand::object result;
+        if (doc["result"].get_object().get(result) != simdjson::SUCCESS)
+        {
+            OEMS_LOG_ERROR("Session {}: authentication failed. Response: {}", sessionName, response);
+            return false;
+        }
+        for (auto field : result)
+        {
+            std::string_view key = field.unescaped_key();
+            if (key == "access_token")
+                accessToken = std::string(std::string_view(field.value().get_string()));
+            else if (key == "refresh_token")
+                nextRefreshToken = std::string(std::string_view(field.value().get_string()));
+            else if (key == "expires_in")
+                expiresIn = field.value().get_int64();
+        }
+    }
+    catch (const simdjson::simdjson_error &e)
+    {
+        OEMS_LOG_ERROR("Session {}: error parsing auth response: {}", sessionName, e.what());
+        return false;
+    }
+    if (accessToken.empty())
+        return false;
+
+    {
+        std::unique_lock<std::shared_mutex> lock(tokenMutex);
+        token = std::move(accessToken);
+        refreshToken = std::move(nextRefreshToken);
+    }
+    if (expiresIn > 0)
+        scheduleRefresh(std::chrono::seconds(expiresIn));
+    return true;
+}
+
+void Session::scheduleRefresh(std::chrono::seconds expiresIn)
+{
+    std::chrono::seconds delay = std::max(expiresIn - options.refreshMargin, std::chrono::seconds(1));
+    // the timer is only touched from loop threads
+    boost::asio::post(loop.context(), [this, delay]()
+                      {
+                          refreshTimer.expires_after(delay);
+                          refreshTimer.async_wait([this](const boost::system::error_code &ec)
+                                                  {
+                                                      if (!ec)
+                                                          refresh(); }); });
+}
+
+// refresh_token grant, falling back to the client credentials; retries in a few seconds if both fail
+void Session::refresh()
+{
+    std::string current;
+    {
+        std::shared_lock<std::shared_mutex> lock(tokenMutex);
+        current = refreshToken;
+    }
+    refreshCount.fetch_add(1, std::memory_order_relaxed);
+    if (!current.empty())
+    {
+        std::string payload = "{\"jsonrpc\":\"2.0\",\"id\":1,\"method\":\"public/auth\",\"params\":{\"grant_type\":\"refresh_token\",\"refresh_token\":";
+        UtilityNamespace::appendJsonString(payload, current);
+        payload += "}}";
+        if (requestToken(payload))
+            return;
+    }
+    try
+    {
+        authenticate();
+    }
+    catch (const std::exception &e)
+    {
+        OEMS_LOG_WARN("{}, retrying", e.what());
+        scheduleRefresh(options.refreshMargin + std::chrono::seconds(5));
+    }
+}
+
+std::string Session::accessToken() const
+{
+    std::shared_lock<std::shared_mutex> lock(tokenMutex);
+    return token;
+}
+
+void Session::appendUrl(std::pmr::string &url, std::string_view path) const
+{
+    url.reserve(options.baseUrl.size() + path.size() + 1);
+    url += options.baseUrl;
+    url += path;
+}
+
+bool Session::post(std::string_view path, std::string_view payload, std::pmr::string &response, double cost)
+{
+    if (cost > 0 && limiter.tryAcquire(cost).count() != 0)
+    {
+        throttledCount.fetch_add(1, std::memory_order_relaxed);
+        throttledMetric.add();
+        limiter.acquire(cost);
+    }
+
+    MessageArena &arena = threadArena();
+    std::pmr::string url(&arena);
+    appendUrl(url, path);
+    std::pmr::string authHeader("Authorization: Bearer ", &arena);
+    {
+        std::shared_lock<std::shared_mutex> lock(tokenMutex);
+        authHeader += token;
+    }
+
+    TransportLease transport(*this);
+    return transport->post(url.c_str(), payload, authHeader.c_str(), response);
+}
+
+bool Session::get(std::string_view pathAndQuery, std::pmr::string &response, double cost)
+{
+    if (cost > 0 && limiter.tryAcquire(cost).count() != 0)
+    {
+        throttledCount.fetch_add(1, std::memory_order_relaxed);
+        throttledMetric.add();
+        limiter.acquire(cost);
+    }
+
+    std::pmr::string url(&threadArena());
+    appendUrl(url, pathAndQuery);
+    TransportLease transport(*this);
+    return transport->get(url.c_str(), response);
+}
+
+size_t Session::warmTransports(std::string_view pathAndQuery)
+{
+    std::vector<std::unique_ptr<TransportLease>> leases;
+    for (size_t i = 0; i < transports.size(); ++i)
+        leases.push_back(std::make_unique<TransportLease>(*this));
+
+    size_t ready = 0;
+    for (const auto &transport : leases)
+    {
+        limiter.acquire(1.0);
+        ArenaScope scope;
+        std::pmr::string url(&scope.resource());
+        appendUrl(url, pathAndQuery);
+        std::pmr::string reply(&scope.resource());
+        if ((*transport)->get(url.c_str(), reply) && reply.find("\"result\"") != std::pmr::string::npos)
+            ++ready;
+        else
+            OEMS_LOG_WARN("Session {}: warm-up request {} failed: {}", sessionName, pathAndQuery, reply);
+    }
+    return ready;
+}
+
+// the credits are taken here, so the task's own requests should pass cost 0
+void Session::submit(std::function<void()> task, double cost)
+{
+    std::chrono::nanoseconds wait = limiter.tryAcquire(cost);
+    if (wait.count() == 0)
+    {
+        boost::asio::post(loop.context(), std::move(task));
+        return;
+    }
+    throttledCount.fetch_add(1, std::memory_order_relaxed);
+    throttledMetric.add();
+    deferSubmit(std::move(task), cost, wait);
+}
+
+// waits on a loop timer rather than a sleeping thread, then tries the budget again
+void Session::deferSubmit(std::function<void()> task, double cost, std::chrono::nanoseconds wait)
+{
+    auto timer = std::make_shared<boost::asio::steady_timer>(loop.context(), wait);
+    timer->async_wait([this, timer, task = std::move(task), cost](const boost::system::error_code &ec) mutable
+                      {
+                          if (ec)
+                              return;
+                          std::chrono::nanoseconds next = limiter.tryAcquire(cost);
+                          if (next.count() == 0)
+                              task();
+                          else
+                              deferSubmit(std::move(task), cost, next); });
+}
@@ -0,0 +1,651 @@
+#include "simulated_venue.hpp"
+#include "jsonrpc.hpp"
+#include <algorithm>
+#include <charconv>
+#include <limits>
+#include <thread>
+
+namespace
+{
+    constexpr double EPSILON = 1e-12; // amounts below this are gone
+
+    // spinning keeps sub-millisecond latencies accurate, longer ones sleep
+    void waitFor(std::chrono::nanoseconds delay)
+    {
+        if (delay <= std::chrono::nanoseconds::zero())
+            return;
+        auto until = std::chrono::steady_clock::now() + delay;
+        if (delay >= std::chrono::milliseconds(1))
+            std::this_thread::sleep_until(until);
+        while (std::chrono::steady_clock::now() < until)
+        {
+        }
+    }
+
+    template <class Levels>
+    double amountAt(const Levels &levels, double price)
+    {
+        auto it = levels.find(price);
+        return it == levels.end() ? 0.0 : it->second;
+    }
+}
+
+SimulatedVenue::SimulatedVenue(SimulatedVenueOptions options) : options(options)
+{
+}
+
+void SimulatedVenue::submit(std::function<void()> task, double)
+{
+    task();
+}
+
+double SimulatedVenue::position(const std::string &symbol) const
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    auto it = instruments.find(symbol);
+    return it == instruments.end() ? 0.0 : it->second.position;
+}
+
+// dispatches on path like the exchange's REST endpoint; malformed requests get a JSON-RPC error,
+// only a transport could fail, so this always returns true
+bool SimulatedVenue::post(std::string_view path, std::string_view payload, std::pmr::string &response, double)
+{
+    auto started = options.latency.count() ? std::chrono::steady_clock::now() : std::chrono::steady_clock::time_point();
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        fills.clear();
+        Request request;
+        scratch.reserve(payload.size() + simdjson::SIMDJSON_PADDING);
+        scratch.assign(payload.data(), payload.size());
+        try
+        {
+            simdjson::ondemand::document doc = parser.iterate(simdjson::padded_string_view(scratch.data(), scratch.size(), scratch.capacity()));
+            for (auto field : doc.get_object())
+            {
+                std::string_view key = field.unescaped_key();
+                if (key == "id")
+                {
+                    int64_t id = 0;
+                    if (field.value().get_int64().get(id) == simdjson::SUCCESS)
+                        request.id = static_cast<uint64_t>(id);
+                }
+                else if (key == "params")
+                {
+                    // null params, as in get_open_orders without filters, are no params
+                    simdjson::ondemand::object params;
+                    if (field.value().get_object().get(params) != simdjson::SUCCESS)
+                        continue;
+                    for (auto param : params)
+                    {
+                        std::string_view name = param.unescaped_key();
+                        if (name == "instrument_name")
+                            request.instrument = param.value().get_string();
+                        else if (name == "order_id")
+                            request.orderId = param.value().get_string();
+                        else if (name == "type")
+                            request.type = param.value().get_string();
+                        else if (name == "currency")
+                            request.currency = param.value().get_string();
+                        else if (name == "amount")
+                            request.amount = param.value().get_double();
+                        else if (name == "price")
+                        {
+                            request.price = param.value().get_double();
+                            request.hasPrice = true;
+                        }
+                        else if (name == "depth")
+                            request.depth = static_cast<size_t>(int64_t(param.value().get_int64()));
+                    }
+                }
+            }
+        }
+        catch (const simdjson::simdjson_error &)
+        {
+            appendError(response, request.id, -32602, "Invalid params");
+            path = {}; // answered
+        }
+
+        if (path == "private/buy" || path == "private/sell")
+            placeOrder(request, path == "private/buy", response);
+        else if (path == "private/cancel")
+            cancelOrder(request, response);
+        else if (path == "private/edit")
+            editOrder(request, response);
+        else if (path == "private/get_open_orders")
+            listOpenOrders(request, response);
+        else if (path == "private/get_positions")
+            listPositions(request, response);
+        else if (path == "public/get_order_book")
+            orderBook(request, response);
+        else if (!path.empty())
+            appendError(response, request.id, -32601, "Method not found");
+    }
+    if (options.latency.count())
+        waitFor(options.latency - (std::chrono::steady_clock::now() - started));
+    return true;
+}
+
+void SimulatedVenue::onBook(const std::string &symbol, const std::vector<BookLevel> &bids, const std::vector<BookLevel> &asks, int64_t timestampMs)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    fills.clear();
+    Instrument &instrument = instruments[symbol];
+    instrument.timestampMs = timestampMs;
+    BidLevels bidLevels;
+    for (const BookLevel &level : bids)
+    {
+        if (level.amount > EPSILON)
+            bidLevels[level.price] = level.amount;
+    }
+    AskLevels askLevels;
+    for (const BookLevel &level : asks)
+    {
+        if (level.amount > EPSILON)
+            askLevels[level.price] = level.amount;
+    }
+    updateQueues(instrument.bids, bidLevels, instrument.restingBids);
+    updateQueues(instrument.asks, askLevels, instrument.restingAsks);
+    instrument.bids.swap(bidLevels);
+    instrument.asks.swap(askLevels);
+    fillResting(instrument, instrument.asks, instrument.restingBids);
+    fillResting(instrument, instrument.bids, instrument.restingAsks);
+}
+
+void SimulatedVenue::placeOrder(const Request &request, bool buy, std::pmr::string &response)
+{
+    bool market = request.type == "market";
+    if (request.instrument.empty() || !(request.amount > 0.0) || (!market && !(request.hasPrice && request.price > 0.0)))
+    {
+        appendError(response, request.id, -32602, "Invalid params");
+        return;
+    }
+    auto entry = instruments.try_emplace(std::string(request.instrument)).first;
+    Instrument &instrument = entry->second;
+    Order &order = openOrders[nextOrderId];
+    order.id = nextOrderId++;
+    order.symbol = &entry->first;
+    order.instrument = &instrument;
+    order.buy = buy;
+    order.market = market;
+    order.price = market ? 0.0 : request.price;
+    order.amount = request.amount;
+    order.createdMs = order.updatedMs = instrument.timestampMs;
+    orderCount.fetch_add(1, std::memory_order_relaxed);
+
+    match(order, instrument);
+    if (order.amount - order.filled <= EPSILON)
+        order.state = OrderState::Filled;
+    else if (market)
+        order.state = OrderState::Cancelled; // no book left to take, the rest is not kept
+    else
+        rest(order, instrument);
+
+    beginResult(response, request.id);
+    response += "{\"order\":";
+    appendOrder(response, order);
+    response += ",\"trades\":";
+    appendFills(response, order);
+    response += '}';
+    endResult(response);
+    if (order.state != OrderState::Open)
+        openOrders.erase(uint64_t(order.id)); // erase by a copy, the key lives in the erased node
+}
+
+void SimulatedVenue::cancelOrder(const Request &request, std::pmr::string &response)
+{
+    Order *order = findOrder(request.orderId);
+    if (!order)
+    {
+        appendError(response, request.id, 10004, "order_not_found");
+        return;
+    }
+    Instrument &instrument = *order->instrument;
+    unrest(*order, instrument);
+    order->state = OrderState::Cancelled;
+    order->updatedMs = instrument.timestampMs;
+    beginResult(response, request.id);
+    appendOrder(response, *order); // the exchange returns the order itself here
+    endResult(response);
+    openOrders.erase(uint64_t(order->id));
+}
+
+// a lower amount keeps the order's place, a new price or a higher amount sends it to the back
+void SimulatedVenue::editOrder(const Request &request, std::pmr::string &response)
+{
+    Order *order = findOrder(request.orderId);
+    if (!order)
+    {
+        appendError(response, request.id, 10004, "order_not_found");
+        return;
+    }
+    double price = request.hasPrice ? request.price : order->price;
+    if (!(request.amount > order->filled + EPSILON) || !(price > 0.0))
+    {
+        appendError(response, request.id, -32602, "Invalid params");
+        return;
+    }
+    Instrument &instrument = *order->instrument;
+    if (price != order->price || request.amount > order->amount)
+    {
+        unrest(*order, instrument);
+        order->price = price;
+        order->amount = request.amount;
+        match(*order, instrument);
+        if (order->amount - order->filled <= EPSILON)
+            order->state = OrderState::Filled;
+        else
+            rest(*order, instrument);
+    }
+    else
+    {
+        order->amount = request.amount;
+    }
+    order->updatedMs = instrument.timestampMs;
+
+    beginResult(response, request.id);
+    response += "{\"order\":";
+    appendOrder(response, *order);
+    response += ",\"trades\":";
+    appendFills(response, *order);
+    response += '}';
+    endResult(response);
+    if (order->state != OrderState::Open)
+        openOrders.erase(uint64_t(order->id));
+}
+
+// oldest first, optionally for one instrument
+void SimulatedVenue::listOpenOrders(const Request &request, std::pmr::string &response)
+{
+    std::vector<const Order *> listed;
+    for (const auto &entry : openOrders)
+    {
+        if (request.instrument.empty() || *entry.second.symbol == request.instrument)
+            listed.push_back(&entry.second);
+    }
+    std::sort(listed.begin(), listed.end(), [](const Order *a, const Order *b)
+              { return a->id < b->id; });
+    beginResult(response, request.id);
+    response += '[';
+    for (size_t i = 0; i < listed.size(); ++i)
+    {
+        if (i)
+            response += ',';
+        appendOrder(response, *listed[i]);
+    }
+    response += ']';
+    endResult(response);
+}
+
+// instruments named <currency>-..., all of them without a currency
+void SimulatedVenue::listPositions(const Request &request, std::pmr::string &response)
+{
+    std::vector<std::pair<std::string_view, double>> listed;
+    for (const auto &entry : instruments)
+    {
+        const std::string &symbol = entry.first;
+        if (!request.currency.empty() && (symbol.compare(0, request.currency.size(), request.currency) != 0 ||
+                                          symbol.size() <= request.currency.size() || (symbol[request.currency.size()] != '-' && symbol[request.currency.size()] != '_')))
+            continue;
+        listed.emplace_back(symbol, entry.second.position);
+    }
+    std::sort(listed.begin(), listed.end());
+    beginResult(response, request.id);
+    response += '[';
+    for (size_t i = 0; i < listed.size(); ++i)
+    {
+        if (i)
+            response += ',';
+        double size = listed[i].second;
+        response += "{\"instrument_name\":";
+        UtilityNamespace::appendJsonString(response, listed[i].first);
+        response += ",\"size\":";
+        UtilityNamespace::appendJsonNumber(response, size);
+        response += ",\"direction\":\"";
+        response += size > EPSILON ? "buy" : size < -EPSILON ? "sell"
+                                                            : "zero";
+        response += "\"}";
+    }
+    response += ']';
+    endResult(response);
+}
+
+// the market's book with the simulated orders added in
+void SimulatedVenue::orderBook(const Request &request, std::pmr::string &response)
+{
+    auto it = instruments.find(std::string(request.instrument));
+    if (it == instruments.end())
+    {
+        appendError(response, request.id, 10028, "instrument_not_found");
+        return;
+    }
+    const Instrument &instrument = it->second;
+    BidLevels bids = instrument.bids;
+    for (const auto &level : instrument.restingBids)
+    {
+        for (uint64_t id : level.second)
+        {
+            const Order &order = openOrders.at(id);
+            bids[level.first] += order.amount - order.filled;
+        }
+    }
+    AskLevels asks = instrument.asks;
+    for (const auto &level : instrument.restingAsks)
+    {
+        for (uint64_t id : level.second)
+        {
+            const Order &order = openOrders.at(id);
+            asks[level.first] += order.amount - order.filled;
+        }
+    }
+    size_t depth = request.depth ? request.depth : std::numeric_limits<size_t>::max();
+    auto appendSide = [&response, depth](const auto &levels)
+    {
+        response += '[';
+        size_t count = 0;
+        for (const auto &level : levels)
+        {
+            if (count == depth)
+                break;
+            if (count++)
+                response += ',';
+            response += '[';
+            UtilityNamespace::appendJsonNumber(response, level.first);
+            response += ',';
+            UtilityNamespace::appendJsonNumber(response, level.second);
+            response += ']';
+        }
+        response += ']';
+    };
+
+    beginResult(response, request.id);
+    response += "{\"timestamp\":";
+    response += std::to_string(instrument.timestampMs);
+    response += ",\"instrument_name\":";
+    UtilityNamespace::appendJsonString(response, request.instrument);
+    if (!bids.empty())
+    {
+        response += ",\"best_bid_price\":";
+        UtilityNamespace::appendJsonNumber(response, bids.begin()->first);
+    }
+    if (!asks.empty())
+    {
+        response += ",\"best_ask_price\":";
+        UtilityNamespace::appendJsonNumber(response, asks.begin()->first);
+    }
+    response += ",\"bids\":";
+    appendSide(bids);
+    response += ",\"asks\":";
+    appendSide(asks);
+    response += '}';
+    endResult(response);
+}
+
+void SimulatedVenue::match(Order &taker, Instrument &instrument)
+{
+    if (taker.buy)
+        take(taker, instrument, instrument.asks, instrument.restingAsks);
+    else
+        take(taker, instrument, instrument.bids, instrument.restingBids);
+}
+
+// walks the other side best price first; at one price the market's displayed amount goes before
+// simulated orders, which queue behind it
+template <class Levels, class Queue>
+void SimulatedVenue::take(Order &taker, Instrument &instrument, Levels &levels, Queue &resting)
+{
+    auto better = levels.key_comp(); // better(a, b): a is the better price for the taker
+    double limit = taker.market ? (taker.buy ? std::numeric_limits<double>::infinity() : -std::numeric_limits<double>::infinity()) : taker.price;
+    while (taker.amount - taker.filled > EPSILON)
+    {
+        auto market = levels.begin();
+        auto simulated = resting.begin();
+        bool hasMarket = market != levels.end() && !better(limit, market->first);
+        bool hasSimulated = simulated != resting.end() && !better(limit, simulated->first);
+        if (!hasMarket && !hasSimulated)
+            return;
+
+        if (hasMarket && (!hasSimulated || !better(simulated->first, market->first)))
+        {
+            double amount = std::min(taker.amount - taker.filled, market->second);
+            fill(taker, instrument, market->first, amount, false);
+            auto queue = resting.find(market->first);
+            if (queue != resting.end())
+            {
+                for (uint64_t id : queue->second)
+                {
+                    Order &order = openOrders.at(id);
+                    order.queueAhead = std::max(0.0, order.queueAhead - amount);
+                }
+            }
+            market->second -= amount;
+            if (market->second <= EPSILON)
+                levels.erase(market);
+        }
+        else
+        {
+            Order &maker = openOrders.at(simulated->second.front());
+            double amount = std::min(taker.amount - taker.filled, maker.amount - maker.filled);
+            fill(maker, instrument, simulated->first, amount, true);
+            fill(taker, instrument, simulated->first, amount, false);
+            if (maker.amount - maker.filled <= EPSILON)
+            {
+                maker.state = OrderState::Filled;
+                simulated->second.pop_front();
+                if (simulated->second.empty())
+                    resting.erase(simulated);
+                openOrders.erase(uint64_t(maker.id));
+            }
+        }
+    }
+}
+
+// fills resting orders that the other side of a new book reaches, best price and oldest first
+template <class Levels, class Queue>
+void SimulatedVenue::fillResting(Instrument &instrument, Levels &opposite, Queue &resting)
+{
+    auto oppositeBetter = opposite.key_comp();
+    for (auto level = resting.begin(); level != resting.end();)
+    {
+        double price = level->first;
+        double aheadTaken = 0.0; // amount at exactly this price that went to the queue ahead
+        std::deque<uint64_t> &queue = level->second;
+        while (!queue.empty())
+        {
+            Order &order = openOrders.at(queue.front());
+            order.queueAhead = std::max(0.0, order.queueAhead - aheadTaken);
+            while (order.amount - order.filled > EPSILON && !opposite.empty())
+            {
+                auto best = opposite.begin();
+                if (oppositeBetter(price, best->first))
+                    break; // does not reach this price
+                bool through = oppositeBetter(best->first, price);
+                double amount;
+                if (!through && order.queueAhead > EPSILON)
+                {
+                    amount = std::min(order.queueAhead, best->second);
+                    order.queueAhead -= amount;
+                    aheadTaken += amount;
+                }
+                else
+                {
+                    amount = std::min(order.amount - order.filled, best->second);
+                    fill(order, instrument, price, amount, true);
+                }
+                best->second -= amount;
+                if (best->second <= EPSILON)
+                    opposite.erase(best);
+            }
+            if (order.amount - order.filled > EPSILON)
+                return; // the book does not reach further back in the queue or to worse prices
+            order.state = OrderState::Filled;
+            queue.pop_front();
+            openOrders.erase(uint64_t(order.id));
+        }
+        level = resting.erase(level);
+    }
+}
+
+// moves resting orders up as the displayed amount at their price shrinks; new amount joins behind.
+// Only prices displayed before can have anything ahead, so stale orders far from the book cost nothing
+template <class Levels, class Queue>
+void SimulatedVenue::updateQueues(const Levels &before, const Levels &after, Queue &resting)
+{
+    for (const auto &displayed : before)
+    {
+        auto level = resting.find(displayed.first);
+        if (level == resting.end())
+            continue;
+        double previous = displayed.second;
+        double current = amountAt(after, displayed.first);
+        double decrease = previous - current;
+        for (uint64_t id : level->second)
+        {
+            Order &order = openOrders.at(id);
+            if (decrease > 0.0)
+            {
+                if (options.queueModel == QueueModel::Optimistic)
+                    order.queueAhead -= decrease;
+                else
+                    order.queueAhead -= decrease * order.queueAhead / previous;
+            }
+            order.queueAhead = std::max(0.0, std::min(order.queueAhead, current));
+        }
+    }
+}
+
+void SimulatedVenue::rest(Order &order, Instrument &instrument)
+{
+    if (order.buy)
+    {
+        order.queueAhead = amountAt(instrument.bids, order.price);
+        instrument.restingBids[order.price].push_back(order.id);
+    }
+    else
+    {
+        order.queueAhead = amountAt(instrument.asks, order.price);
+        instrument.restingAsks[order.price].push_back(order.id);
+    }
+}
+
+void SimulatedVenue::unrest(const Order &order, Instrument &instrument)
+{
+    auto remove = [&order](auto &resting)
+    {
+        auto level = resting.find(order.price);
+        if (level == resting.end())
+            return;
+        auto it = std::find(level->second.begin(), level->second.end(), order.id);
+        if (it != level->second.end())
+            level->second.erase(it);
+        if (level->second.empty())
+            resting.erase(level);
+    };
+    if (order.buy)
+        remove(instrument.restingBids);
+    else
+        remove(instrument.restingAsks);
+}
+
+void SimulatedVenue::fill(Order &order, Instrument &instrument, double price, double amount, bool maker)
+{
+    order.filled += amount;
+    order.filledValue += price * amount;
+    order.updatedMs = instrument.timestampMs;
+    instrument.position += order.buy ? amount : -amount;
+    fills.push_back({nextTradeId++, order.id, price, amount, maker});
+    tradeCount.fetch_add(1, std::memory_order_relaxed);
+}
+
+// ids are SIM-<n>
+SimulatedVenue::Order *SimulatedVenue::findOrder(std::string_view orderId)
+{
+    constexpr std::string_view prefix = "SIM-";
+    if (orderId.substr(0, prefix.size()) != prefix)
+        return nullptr;
+    uint64_t id = 0;
+    const char *end = orderId.data() + orderId.size();
+    if (std::from_chars(orderId.data() + prefix.size(), end, id).ptr != end)
+        return nullptr;
+    auto it = openOrders.find(id);
+    return it == openOrders.end() ? nullptr : &it->second;
+}
+
+void SimulatedVenue::appendOrder(std::pmr::string &out, const Order &order) const
+{
+    static const char *const states[] = {"open", "filled", "cancelled"};
+    out += "{\"order_id\":\"SIM-";
+    out += std::to_string(order.id);
+    out += "\",\"instrument_name\":";
+    UtilityNamespace::appendJsonString(out, *order.symbol);
+    out += order.buy ? ",\"direction\":\"buy\"" : ",\"direction\":\"sell\"";
+    out += order.market ? ",\"order_type\":\"market\",\"price\":\"market_price\"" : ",\"order_type\":\"limit\",\"price\":";
+    if (!order.market)
+        UtilityNamespace::appendJsonNumber(out, order.price);
+    out += ",\"amount\":";
+    UtilityNamespace::appendJsonNumber(out, order.amount);
+    out += ",\"filled_amount\":";
+    UtilityNamespace::appendJsonNumber(out, order.filled);
+    out += ",\"average_price\":";
+    UtilityNamespace::appendJsonNumber(out, order.filled > 0.0 ? order.filledValue / order.filled : 0.0);
+    out += ",\"order_state\":\"";
+    out += states[static_cast<int>(order.state)];
+    out += "\",\"creation_timestamp\":";
+    out += std::to_string(order.createdMs);
+    out += ",\"last_update_timestamp\":";
+    out += std::to_string(order.updatedMs);
+    out += '}';
+}
+
+// this request's fills of order
+void SimulatedVenue::appendFills(std::pmr::string &out, const Order &order) const
+{
+    out += '[';
+    bool first = true;
+    for (const Fill &fill : fills)
+    {
+        if (fill.orderId != order.id)
+            continue;
+        if (!first)
+            out += ',';
+        first = false;
+        out += "{\"trade_id\":\"SIM-T";
+        out += std::to_string(fill.tradeId);
+        out += "\",\"order_id\":\"SIM-";
+        out += std::to_string(fill.orderId);
+        out += "\",\"instrument_name\":";
+        UtilityNamespace::appendJsonString(out, *order.symbol);
+        out += order.buy ? ",\"direction\":\"buy\"" : ",\"direction\":\"sell\"";
+        out += ",\"price\":";
+        UtilityNamespace::appendJsonNumber(out, fill.price);
+        out += ",\"amount\":";
+        UtilityNamespace::appendJsonNumber(out, fill.amount);
+        out += fill.maker ? ",\"liquidity\":\"M\"" : ",\"liquidity\":\"T\"";
+        out += ",\"timestamp\":";
+        out += std::to_string(order.updatedMs);
+        out += '}';
+    }
+    out += ']';
+}
+
+void SimulatedVenue::beginResult(std::pmr::string &out, uint64_t requestId)
+{
+    out += "{\"jsonrpc\":\"2.0\",\"id\":";
+    out += std::to_string(requestId);
+    out += ",\"result\":";
+}
+
+void SimulatedVenue::endResult(std::pmr::string &out)
+{
+    out += ",\"testnet\":true}";
+}
+
+void SimulatedVenue::appendError(std::pmr::string &out, uint64_t requestId, int code, std::string_view message)
+{
+    out += "{\"jsonrpc\":\"2.0\",\"id\":";
+    out += std::to_string(requestId);
+    out += ",\"error\":{\"code\":";
+    out += std::to_string(code);
+    out += ",\"message\":";
+    UtilityNamespace::appendJsonString(out, message);
+    out += "}}";
+}
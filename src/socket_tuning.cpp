@@ -0,0 +1,85 @@
+#include "socket_tuning.hpp"
+#include <cstring>
+#include <ctime>
+#include <sys/socket.h>
+#include <linux/errqueue.h>
+#include <linux/net_tstamp.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+
+namespace UtilityNamespace
+{
+    static bool setIntOption(int fd, int level, int name, int value, ConnectionStats *stats)
+    {
+        if (setsockopt(fd, level, name, &value, sizeof(value)) == 0)
+            return true;
+        if (stats)
+            stats->optionFailures.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+
+    bool applySocketOptions(int fd, const SocketOptions &options, ConnectionStats *stats)
+    {
+        bool ok = true;
+        if (stats)
+            stats->socketsOpened.fetch_add(1, std::memory_order_relaxed);
+
+        if (options.tcpNoDelay)
+            ok &= setIntOption(fd, IPPROTO_TCP, TCP_NODELAY, 1, stats);
+        if (options.quickAck)
+            ok &= setIntOption(fd, IPPROTO_TCP, TCP_QUICKACK, 1, stats);
+        if (options.busyPollMicros > 0)
+            ok &= setIntOption(fd, SOL_SOCKET, SO_BUSY_POLL, options.busyPollMicros, stats);
+        if (options.sendBufferBytes > 0)
+            ok &= setIntOption(fd, SOL_SOCKET, SO_SNDBUF, options.sendBufferBytes, stats);
+        if (options.receiveBufferBytes > 0)
+            ok &= setIntOption(fd, SOL_SOCKET, SO_RCVBUF, options.receiveBufferBytes, stats);
+        return ok;
+    }
+
+    bool enableRxTimestamping(int fd, RxTimestamping mode)
+    {
+        if (mode == RxTimestamping::None)
+            return true;
+        int flags = mode == RxTimestamping::Hardware
+                        ? SOF_TIMESTAMPING_RX_HARDWARE | SOF_TIMESTAMPING_RAW_HARDWARE
+                        : SOF_TIMESTAMPING_RX_SOFTWARE | SOF_TIMESTAMPING_SOFTWARE;
+        return setIntOption(fd, SOL_SOCKET, SO_TIMESTAMPING, flags, nullptr);
+    }
+
+    void rearmQuickAck(int fd)
+    {
+        int one = 1;
+        setsockopt(fd, IPPROTO_TCP, TCP_QUICKACK, &one, sizeof(one));
+    }
+
+    long receiveWithTimestamp(int fd, void *buffer, size_t length, int64_t &timestampNs)
+    {
+        char control[CMSG_SPACE(sizeof(scm_timestamping))];
+        iovec iov{buffer, length};
+        msghdr message;
+        std::memset(&message, 0, sizeof(message));
+        message.msg_iov = &iov;
+        message.msg_iovlen = 1;
+        message.msg_control = control;
+        message.msg_controllen = sizeof(control);
+
+        long received = recvmsg(fd, &message, 0);
+        timestampNs = 0;
+        if (received < 0)
+            return received;
+
+        for (cmsghdr *cmsg = CMSG_FIRSTHDR(&message); cmsg; cmsg = CMSG_NXTHDR(&message, cmsg))
+        {
+            if (cmsg->cmsg_level == SOL_SOCKET && cmsg->cmsg_type == SCM_TIMESTAMPING)
+            {
+                scm_timestamping stamps;
+                std::memcpy(&stamps, CMSG_DATA(cmsg), sizeof(stamps));
+                // ts[0] is the software stamp, ts[2] the raw hardware one
+                const timespec &ts = stamps.ts[2].tv_sec || stamps.ts[2].tv_nsec ? stamps.ts[2] : stamps.ts[0];
+                timestampNs = static_cast<int64_t>(ts.tv_sec) * 1000000000LL + ts.tv_nsec;
+            }
+        }
+        return received;
+    }
+}
@@ -0,0 +1,475 @@
+#include "trade_export.hpp"
+#include "arena.hpp"
+#include "clock.hpp"
+#include "jsonrpc.hpp"
+#include <chrono>
+#include <cstring>
+#include <simdjson.h>
+#include <stdexcept>
+#include <thread>
+#include <unordered_set>
+
+namespace
+{
+    // Deribit's answer to a request over the account's rate limit
+    constexpr int64_t TOO_MANY_REQUESTS = 10028;
+
+    // pads page for simdjson if it has to; true when it is a too_many_requests error
+    bool rateLimited(simdjson::ondemand::parser &parser, std::pmr::string &page)
+    {
+        if (page.capacity() - page.size() < simdjson::SIMDJSON_PADDING)
+            page.reserve(page.size() + simdjson::SIMDJSON_PADDING);
+        simdjson::ondemand::document doc;
+        int64_t code;
+        return parser.iterate(simdjson::padded_string_view(page.data(), page.size(), page.capacity())).get(doc) == simdjson::SUCCESS &&
+               doc["error"]["code"].get_int64().get(code) == simdjson::SUCCESS && code == TOO_MANY_REQUESTS;
+    }
+
+    // CSV fields are quoted only when they need it, which exchange ids never do
+    void appendCsvField(std::string &out, std::string_view value)
+    {
+        if (value.find_first_of(",\"\n") == std::string_view::npos)
+        {
+            out += value;
+            return;
+        }
+        out += '"';
+        for (char c : value)
+        {
+            if (c == '"')
+                out += '"';
+            out += c;
+        }
+        out += '"';
+    }
+
+    class CsvTradeWriter : public TradeWriter
+    {
+    public:
+        CsvTradeWriter(const std::string &path, size_t indexStride) : TradeWriter(path, "w"), indexStride(indexStride ? indexStride : 1)
+        {
+            line = "timestamp,trade_seq,trade_id,order_id,instrument,direction,price,amount,fee,fee_currency,index_price,liquidity\n";
+            writeBytes(line.data(), line.size());
+        }
+
+        void write(const TradeRow &row) override
+        {
+            if (rowCount % indexStride == 0)
+                addIndex(row.timestamp, rowCount, byteCount);
+            line.clear();
+            line += std::to_string(row.timestamp);
+            line += ',';
+            line += std::to_string(row.tradeSeq);
+            line += ',';
+            appendCsvField(line, row.tradeId);
+            line += ',';
+            appendCsvField(line, row.orderId);
+            line += ',';
+            appendCsvField(line, row.instrument);
+            line += ',';
+            appendCsvField(line, row.direction);
+            line += ',';
+            UtilityNamespace::appendJsonNumber(line, row.price);
+            line += ',';
+            UtilityNamespace::appendJsonNumber(line, row.amount);
+            line += ',';
+            UtilityNamespace::appendJsonNumber(line, row.fee);
+            line += ',';
+            appendCsvField(line, row.feeCurrency);
+            line += ',';
+            UtilityNamespace::appendJsonNumber(line, row.indexPrice);
+            line += ',';
+            appendCsvField(line, row.liquidity);
+            line += '\n';
+            writeBytes(line.data(), line.size());
+            ++rowCount;
+        }
+
+        void finish() override
+        {
+            if (!close())
+                throw std::runtime_error("Trade export write failed");
+        }
+
+    private:
+        size_t indexStride;
+        std::string line; // reused for every row
+    };
+
+    // string column of one block: end offsets plus the concatenated bytes
+    struct StringColumn
+    {
+        std::vector<uint32_t> offsets{0};
+        std::string bytes;
+
+        void push(std::string_view value)
+        {
+            bytes += value;
+            offsets.push_back(static_cast<uint32_t>(bytes.size()));
+        }
+        void clear()
+        {
+            offsets.assign(1, 0);
+            bytes.clear();
+        }
+    };
+
+    class ColumnarTradeWriter : public TradeWriter
+    {
+    public:
+        ColumnarTradeWriter(const std::string &path, size_t blockRows) : TradeWriter(path, "wb"), blockRows(blockRows ? blockRows : 1)
+        {
+            writeBytes("OEMSTRD1", 8);
+            reserveBlock();
+        }
+
+        void write(const TradeRow &row) override
+        {
+            timestamps.push_back(row.timestamp);
+            tradeSeqs.push_back(row.tradeSeq);
+            prices.push_back(row.price);
+            amounts.push_back(row.amount);
+            fees.push_back(row.fee);
+            indexPrices.push_back(row.indexPrice);
+            directions.push_back(row.direction == "buy" ? 0 : 1);
+            liquidity.push_back(row.liquidity.empty() ? 0 : static_cast<uint8_t>(row.liquidity[0]));
+            tradeIds.push(row.tradeId);
+            orderIds.push(row.orderId);
+            instruments.push(row.instrument);
+            feeCurrencies.push(row.feeCurrency);
+            ++rowCount;
+            if (timestamps.size() == blockRows)
+                flushBlock();
+        }
+
+        void finish() override
+        {
+            flushBlock();
+            if (!close())
+                throw std::runtime_error("Trade export write failed");
+        }
+
+    private:
+        template <class T>
+        void writeColumn(const std::vector<T> &column)
+        {
+            writeBytes(column.data(), column.size() * sizeof(T));
+        }
+
+        void writeColumn(const StringColumn &column)
+        {
+            writeColumn(column.offsets);
+            writeBytes(column.bytes.data(), column.bytes.size());
+        }
+
+        void flushBlock()
+        {
+            if (timestamps.empty())
+                return;
+            uint32_t rows = static_cast<uint32_t>(timestamps.size());
+            addIndex(timestamps.front(), rowCount - rows, byteCount);
+            writeBytes(&rows, sizeof(rows));
+            writeBytes(&timestamps.front(), sizeof(int64_t));
+            writeBytes(&timestamps.back(), sizeof(int64_t));
+            writeColumn(timestamps);
+            writeColumn(tradeSeqs);
+            writeColumn(prices);
+            writeColumn(amounts);
+            writeColumn(fees);
+            writeColumn(indexPrices);
+            writeColumn(directions);
+            writeColumn(liquidity);
+            writeColumn(tradeIds);
+            writeColumn(orderIds);
+            writeColumn(instruments);
+            writeColumn(feeCurrencies);
+
+            timestamps.clear();
+            tradeSeqs.clear();
+            prices.clear();
+            amounts.clear();
+            fees.clear();
+            indexPrices.clear();
+            directions.clear();
+            liquidity.clear();
+            tradeIds.clear();
+            orderIds.clear();
+            instruments.clear();
+            feeCurrencies.clear();
+        }
+
+        void reserveBlock()
+        {
+            timestamps.reserve(blockRows);
+            tradeSeqs.reserve(blockRows);
+            prices.reserve(blockRows);
+            amounts.reserve(blockRows);
+            fees.reserve(blockRows);
+            indexPrices.reserve(blockRows);
+            directions.reserve(blockRows);
+            liquidity.reserve(blockRows);
+        }
+
+        size_t blockRows;
+        std::vector<int64_t> timestamps;
+        std::vector<uint64_t> tradeSeqs;
+        std::vector<double> prices, amounts, fees, indexPrices;
+        std::vector<uint8_t> directions, liquidity;
+        StringColumn tradeIds, orderIds, instruments, feeCurrencies;
+    };
+}
+
+TradeWriter::TradeWriter(const std::string &path, const char *mode)
+{
+    file = std::fopen(path.c_str(), mode);
+    index = std::fopen((path + ".idx").c_str(), "wb");
+    if (!file || !index)
+    {
+        close();
+        throw std::runtime_error("Cannot create trade export " + path);
+    }
+    std::setvbuf(file, nullptr, _IOFBF, 1 << 20);
+}
+
+TradeWriter::~TradeWriter()
+{
+    close();
+}
+
+std::unique_ptr<TradeWriter> TradeWriter::create(TradeExportFormat format, const std::string &path, size_t indexStride)
+{
+    if (format == TradeExportFormat::Columnar)
+        return std::make_unique<ColumnarTradeWriter>(path, indexStride);
+    return std::make_unique<CsvTradeWriter>(path, indexStride);
+}
+
+void TradeWriter::writeBytes(const void *data, size_t size)
+{
+    if (size && std::fwrite(data, 1, size, file) != size)
+        throw std::runtime_error("Trade export write failed");
+    byteCount += size;
+}
+
+void TradeWriter::addIndex(int64_t timestamp, uint64_t row, uint64_t offset)
+{
+    TradeIndexEntry entry{timestamp, row, offset};
+    if (std::fwrite(&entry, sizeof(entry), 1, index) != 1)
+        throw std::runtime_error("Trade export index write failed");
+}
+
+bool TradeWriter::close()
+{
+    bool ok = true;
+    if (file)
+        ok = std::fclose(file) == 0;
+    if (index)
+        ok = std::fclose(index) == 0 && ok;
+    file = nullptr;
+    index = nullptr;
+    return ok;
+}
+
+TradeExporter::TradeExporter(Session &session, TradeExportOptions options) : session(session), options(std::move(options))
+{
+}
+
+std::vector<TradeExportResult> TradeExporter::run()
+{
+    std::vector<TradeExportResult> results(options.currencies.size());
+    std::vector<std::thread> workers;
+    for (size_t i = 0; i < options.currencies.size(); ++i)
+    {
+        workers.emplace_back([this, i, &results]()
+                             { results[i] = exportCurrency(options.currencies[i]); });
+    }
+    for (std::thread &worker : workers)
+    {
+        worker.join();
+    }
+    return results;
+}
+
+static void parseTrade(simdjson::ondemand::object trade, TradeRow &row)
+{
+    row = TradeRow();
+    for (auto field : trade)
+    {
+        std::string_view key = field.unescaped_key();
+        if (key == "timestamp")
+            row.timestamp = field.value().get_int64();
+        else if (key == "trade_seq")
+            row.tradeSeq = field.value().get_uint64();
+        else if (key == "price")
+            row.price = field.value().get_double();
+        else if (key == "amount")
+            row.amount = field.value().get_double();
+        else if (key == "fee")
+            row.fee = field.value().get_double();
+        else if (key == "index_price")
+            row.indexPrice = field.value().get_double();
+        else if (key == "trade_id")
+            row.tradeId = field.value().get_string();
+        else if (key == "order_id")
+            row.orderId = field.value().get_string();
+        else if (key == "instrument_name")
+            row.instrument = field.value().get_string();
+        else if (key == "direction")
+            row.direction = field.value().get_string();
+        else if (key == "fee_currency")
+            row.feeCurrency = field.value().get_string();
+        else if (key == "liquidity")
+            row.liquidity = field.value().get_string();
+    }
+}
+
+// pages forward from startTimestamp; the next page starts at the last timestamp seen, and trades
+// at that timestamp already written are skipped so fills sharing a millisecond are not lost or doubled.
+// Timestamps are the only continuation the endpoint has, so a millisecond holding more fills than the
+// exchange's largest page cannot be walked past without losing some: the export stops with an error.
+TradeExportResult TradeExporter::exportCurrency(const std::string &currency)
+{
+    int64_t start = UtilityNamespace::steadyNowNs();
+    TradeExportResult result;
+    result.currency = currency;
+    result.path = options.directory + "/trades_" + currency + (options.format == TradeExportFormat::Csv ? ".csv" : ".col");
+
+    int64_t endTimestamp = options.endTimestamp ? options.endTimestamp : UtilityNamespace::wallNowNs() / 1000000;
+    int64_t cursor = options.startTimestamp;
+    std::unordered_set<std::string> idsAtCursor;
+    size_t count = options.pageSize;
+    simdjson::ondemand::parser parser;
+    try
+    {
+        std::unique_ptr<TradeWriter> writer = TradeWriter::create(options.format, result.path, options.indexStride);
+        bool hasMore = true;
+        while (hasMore)
+        {
+            ArenaScope scope;
+            std::pmr::string payload(&scope.resource());
+            payload += "{\"jsonrpc\":\"2.0\",\"id\":7,\"method\":\"private/get_user_trades_by_currency_and_time\",\"params\":{\"currency\":";
+            UtilityNamespace::appendJsonString(payload, currency);
+            payload += ",\"start_timestamp\":";
+            payload += std::to_string(cursor);
+            payload += ",\"end_timestamp\":";
+            payload += std::to_string(endTimestamp);
+            payload += ",\"count\":";
+            payload += std::to_string(count);
+            payload += ",\"sorting\":\"asc\",\"include_old\":true}}";
+
+            std::pmr::string page(&scope.resource());
+            page.reserve(count * 512 + simdjson::SIMDJSON_PADDING);
+            // transport failures and rate limit errors back off and ask again; other errors end the export
+            bool fetched = false, throttled = false;
+            for (int attempt = 0; attempt <= options.maxRetries && !fetched; ++attempt)
+            {
+                if (attempt > 0)
+                    std::this_thread::sleep_for(options.retryDelay * (1 << (attempt - 1)));
+                page.clear();
+                throttled = false;
+                fetched = session.post("private/get_user_trades_by_currency_and_time", payload, page);
+                if (fetched && rateLimited(parser, page))
+                {
+                    fetched = false;
+                    throttled = true;
+                }
+            }
+            if (!fetched)
+            {
+                result.error = (throttled ? "rate limited after retries at timestamp " : "request failed after retries at timestamp ") + std::to_string(cursor);
+                break;
+            }
+            ++result.pages;
+
+            simdjson::ondemand::document doc = parser.iterate(simdjson::padded_string_view(page.data(), page.size(), page.capacity()));
+            simdjson::ondemand::object body;
+            if (doc["result"].get_object().get(body) != simdjson::SUCCESS)
+            {
+                result.error = "exchange error: " + std::string(page.data(), page.size());
+                break;
+            }
+
+            hasMore = false;
+            uint64_t written = 0;
+            TradeRow row;
+            for (auto field : body)
+            {
+                std::string_view key = field.unescaped_key();
+                if (key == "has_more")
+                {
+                    hasMore = field.value().get_bool();
+                }
+                else if (key == "trades")
+                {
+                    for (auto trade : field.value().get_array())
+                    {
+                        parseTrade(trade.get_object(), row);
+                        if (row.timestamp > cursor)
+                        {
+                            cursor = row.timestamp;
+                            idsAtCursor.clear();
+                        }
+                        if (!idsAtCursor.emplace(row.tradeId).second)
+                            continue; // already written from the previous page
+                        writer->write(row);
+                        ++written;
+                    }
+                }
+            }
+            // a page of nothing but fills already written is a page of one millisecond: ask again for the
+            // largest page, and fail rather than skip past fills that no page reaches
+            if (hasMore && written == 0)
+            {
+                if (count >= TradeExportOptions::MAX_PAGE_SIZE)
+                {
+                    result.error = "more than " + std::to_string(count) + " fills at timestamp " + std::to_string(cursor) + ", export is incomplete";
+                    break;
+                }
+                count = TradeExportOptions::MAX_PAGE_SIZE;
+            }
+            else
+                count = options.pageSize;
+        }
+        writer->finish();
+        result.rows = writer->rows();
+        result.bytes = writer->bytes();
+    }
+    catch (const std::exception &e)
+    {
+        result.error = e.what();
+    }
+    result.elapsedNs = UtilityNamespace::steadyNowNs() - start;
+    return result;
+}
+
+bool UtilityNamespace::findTradeIndex(const std::string &indexPath, int64_t timestamp, TradeIndexEntry &entry)
+{
+    std::FILE *file = std::fopen(indexPath.c_str(), "rb");
+    if (!file)
+        return false;
+    std::fseek(file, 0, SEEK_END);
+    long count = std::ftell(file) / static_cast<long>(sizeof(TradeIndexEntry));
+
+    // last entry with entry.timestamp <= timestamp, or the first one
+    long low = 0, high = count - 1, found = count ? 0 : -1;
+    while (low <= high)
+    {
+        long mid = low + (high - low) / 2;
+        TradeIndexEntry probe;
+        std::fseek(file, mid * static_cast<long>(sizeof(TradeIndexEntry)), SEEK_SET);
+        if (std::fread(&probe, sizeof(probe), 1, file) != 1)
+            break;
+        if (probe.timestamp <= timestamp)
+        {
+            found = mid;
+            low = mid + 1;
+        }
+        else
+        {
+            high = mid - 1;
+        }
+    }
+    bool ok = found >= 0 && std::fseek(file, found * static_cast<long>(sizeof(TradeIndexEntry)), SEEK_SET) == 0 &&
+              std::fread(&entry, sizeof(entry), 1, file) == 1;
+    std::fclose(file);
+    return ok;
+}
@@ -0,0 +1,197 @@
+#include "warmup.hpp"
+#include "arena.hpp"
+#include "book_analytics.hpp"
+#include "clock.hpp"
+#include "feed_decoder.hpp"
+#include "jsonrpc.hpp"
+#include "logger.hpp"
+#include "metrics.hpp"
+#include <simdjson.h>
+
+namespace
+{
+    // frames of the local feed protocol and an order reply, shaped like the real ones
+    const char SNAPSHOT_FRAME[] = R"({"type":"snapshot","symbol":"WARMUP","seq":1,"bids":[[100.0,1.0],[99.5,2.0],[99.0,3.0]],"asks":[[100.5,1.0],[101.0,2.0],[101.5,3.0]],"recv_ns":1,"send_ns":2,"timestamp":3})";
+    const char UPDATE_FRAME[] = R"({"type":"update","symbol":"WARMUP","seq":2,"bids":[[99.5,0]],"asks":[[100.5,4.0]],"recv_ns":4,"send_ns":5,"timestamp":6})";
+    const char ORDER_REPLY[] = R"({"jsonrpc":"2.0","id":2,"result":{"trades":[],"order":{"order_id":"WARMUP-1","order_state":"open","instrument_name":"BTC-PERPETUAL","direction":"buy","price":50000.0,"amount":10.0,"filled_amount":0.0}},"usIn":1,"usOut":2,"usDiff":1,"testnet":true})";
+    const char OPEN_ORDERS_REQUEST[] = R"({"jsonrpc":"2.0","id":9,"method":"private/get_open_orders","params":{}})";
+
+    template <class Step>
+    void runStep(WarmupReport &report, const char *name, Step step)
+    {
+        WarmupStep result;
+        result.name = name;
+        int64_t start = UtilityNamespace::steadyNowNs();
+        try
+        {
+            result.ok = step(result.detail);
+        }
+        catch (const std::exception &e)
+        {
+            result.ok = false;
+            result.detail = e.what();
+        }
+        result.elapsedNs = UtilityNamespace::steadyNowNs() - start;
+        if (!result.ok)
+            OEMS_LOG_WARN("Warm-up step {} failed: {}", result.name, result.detail);
+        report.steps.push_back(std::move(result));
+    }
+
+    // the encoded request parses and names the method it is sent to
+    bool parsesAs(simdjson::ondemand::parser &parser, const std::pmr::string &request, std::string_view method)
+    {
+        UtilityNamespace::requestMetrics(method); // registers the method's metrics on first use
+        simdjson::ondemand::document doc;
+        std::string_view parsed;
+        if (parser.iterate(simdjson::padded_string_view(request.data(), request.size(), request.capacity())).get(doc) != simdjson::SUCCESS)
+            return false;
+        if (doc["method"].get_string().get(parsed) != simdjson::SUCCESS || parsed != method)
+            return false;
+        simdjson::ondemand::object params;
+        return doc["params"].get_object().get(params) == simdjson::SUCCESS;
+    }
+
+    bool parsesOrderReply(simdjson::ondemand::parser &parser, const simdjson::padded_string &reply)
+    {
+        simdjson::ondemand::document doc;
+        std::string_view orderId;
+        if (parser.iterate(reply).get(doc) != simdjson::SUCCESS)
+            return false;
+        return doc["result"]["order"]["order_id"].get_string().get(orderId) == simdjson::SUCCESS && !orderId.empty();
+    }
+
+    // encoders and order replies, each request parsed back so a broken encoder fails the warm-up
+    bool warmCodecs(const OrderManager &orderManager, const WarmupOptions &options, std::string &detail)
+    {
+        const InstrumentTable *instruments = orderManager.instrumentTable();
+        const InstrumentSpec *spec = instruments ? instruments->find(options.instrument) : nullptr;
+        simdjson::ondemand::parser parser;
+        simdjson::padded_string reply(std::string_view(ORDER_REPLY, sizeof(ORDER_REPLY) - 1));
+        size_t requests = 0, failed = 0;
+        auto check = [&](const std::pmr::string &request, std::string_view method)
+        {
+            ++requests;
+            if (!parsesAs(parser, request, method))
+                ++failed;
+        };
+
+        for (size_t pass = 0; pass < options.passes; ++pass)
+        {
+            ArenaScope scope;
+            std::pmr::string request(&scope.resource());
+            request.reserve(256 + simdjson::SIMDJSON_PADDING);
+            bool buy = pass % 2 == 0;
+            double price = 50000.0 + 0.5 * (pass % 64);
+
+            request.clear();
+            UtilityNamespace::encodePlaceOrder(request, buy ? "buy" : "sell", options.instrument, 10.0, price, "limit");
+            check(request, buy ? "private/buy" : "private/sell");
+            request.clear();
+            UtilityNamespace::encodeModifyOrder(request, "WARMUP-1", 20.0, price);
+            check(request, "private/edit");
+            request.clear();
+            UtilityNamespace::encodeCancelOrder(request, "WARMUP-1");
+            check(request, "private/cancel");
+
+            Price tickPrice;
+            if (spec && spec->toPrice(price, tickPrice))
+            {
+                tickPrice = spec->roundPrice(tickPrice, Rounding::Down);
+                request.clear();
+                UtilityNamespace::encodePlaceOrder(request, buy ? "buy" : "sell", *spec, Quantity(spec->lotUnits), tickPrice, "limit");
+                check(request, buy ? "private/buy" : "private/sell");
+                request.clear();
+                UtilityNamespace::encodeModifyOrder(request, "WARMUP-1", *spec, Quantity(spec->lotUnits), tickPrice);
+                check(request, "private/edit");
+            }
+
+            ++requests;
+            if (!parsesOrderReply(parser, reply))
+                ++failed;
+        }
+
+        detail = std::to_string(requests) + " requests and replies";
+        detail += spec ? ", fixed point for " + options.instrument : ", no instrument spec for " + options.instrument;
+        if (failed)
+            detail += ", " + std::to_string(failed) + " did not parse back";
+        return failed == 0;
+    }
+
+    // the subscriber's decode, book and analytics path
+    bool warmFeed(const WarmupOptions &options, std::string &detail)
+    {
+        simdjson::ondemand::parser parser;
+        FeedFrame frame;
+        SymbolFeed feed;
+        SoaBook book;
+        std::string payload;
+        size_t applied = 0;
+        for (size_t pass = 0; pass < options.passes; ++pass)
+        {
+            payload.assign(SNAPSHOT_FRAME, sizeof(SNAPSHOT_FRAME) - 1);
+            UtilityNamespace::decodeFeedFrame(parser, payload, frame);
+            feed.onFrame(true, frame.seq, frame.bids, frame.asks);
+            payload.assign(UPDATE_FRAME, sizeof(UPDATE_FRAME) - 1);
+            UtilityNamespace::decodeFeedFrame(parser, payload, frame);
+            if (feed.onFrame(false, frame.seq, frame.bids, frame.asks) == FrameAction::Apply)
+                ++applied;
+            book.assign(feed.book);
+            UtilityNamespace::computeAnalytics(book);
+        }
+        detail = std::to_string(2 * options.passes) + " frames";
+        return applied == options.passes;
+    }
+}
+
+WarmupReport UtilityNamespace::warmUp(OrderManager &orderManager, const WarmupOptions &options)
+{
+    WarmupReport report;
+    int64_t start = steadyNowNs();
+
+    // the block's free bytes once, so its pages are faulted in now rather than by the first order; not
+    // allocated, which inside a caller's ArenaScope would send the caller's next allocation to the heap
+    runStep(report, "arena", [](std::string &detail)
+            {
+                size_t bytes = threadArena().prefault();
+                detail = std::to_string(bytes / 1024) + " KiB";
+                return true; });
+    runStep(report, "codecs", [&](std::string &detail)
+            { return warmCodecs(orderManager, options, detail); });
+    runStep(report, "feed", [&](std::string &detail)
+            { return warmFeed(options, detail); });
+
+    Session *session = dynamic_cast<Session *>(&orderManager.venue());
+    if (options.connect && session)
+    {
+        runStep(report, "transports", [&](std::string &detail)
+                {
+                    size_t ready = session->warmTransports("public/test");
+                    detail = std::to_string(ready) + " of " + std::to_string(session->poolSize()) + " connected";
+                    return ready == session->poolSize(); });
+    }
+    if (options.validate)
+    {
+        runStep(report, "private path", [&](std::string &detail)
+                {
+                    ArenaScope scope;
+                    std::pmr::string response(&scope.resource());
+                    if (!orderManager.venue().post("private/get_open_orders", OPEN_ORDERS_REQUEST, response))
+                    {
+                        detail = "no reply";
+                        return false;
+                    }
+                    if (response.find("\"result\"") == std::pmr::string::npos)
+                    {
+                        detail = std::string(response.substr(0, 200));
+                        return false;
+                    }
+                    detail = "private/get_open_orders answered";
+                    return true; });
+    }
+
+    report.elapsedNs = steadyNowNs() - start;
+    static Gauge &ready = metrics().gauge("oems_ready", "1 once the startup warm-up has passed");
+    ready.set(report.ready() ? 1.0 : 0.0);
+    OEMS_LOG_INFO("Warm-up {} in {} us", report.ready() ? "passed" : "failed", report.elapsedNs / 1000);
+    return report;
+}
@@ -1,109 +1,181 @@
 #include "websocket_con.hpp"
+#include "clock.hpp"
+#include "logger.hpp"
+#include "md_pipeline.hpp"
+#include "metrics.hpp"
+#include "thread_affinity.hpp"
+#include <sstream>
+#include <stdexcept>
 
-WebSocketClient::WebSocketClient() : running(true)
+namespace
 {
-    client.init_asio();
-    client.set_message_handler(bind(&WebSocketClient::onMessage, this, std::placeholders::_1, std::placeholders::_2));
-    client.set_open_handler(bind(&WebSocketClient::onOpen, this, std::placeholders::_1));
+    struct FeedMetrics
+    {
+        Counter &frames = UtilityNamespace::metrics().counter("oems_feed_frames_total", "Market data frames received");
+        Counter &bytes = UtilityNamespace::metrics().counter("oems_feed_bytes_received_total", "Market data bytes received");
+        Counter &displayDrops = UtilityNamespace::metrics().counter("oems_feed_dropped_total", "Feed lines or messages dropped because a consumer fell behind", {{"stage", "display"}});
+        Histogram &server = UtilityNamespace::metrics().histogram("oems_feed_latency_ns", "Feed latency by stage", {{"stage", "server"}});
+        Histogram &wire = UtilityNamespace::metrics().histogram("oems_feed_latency_ns", "Feed latency by stage", {{"stage", "wire"}});
+        Histogram &endToEnd = UtilityNamespace::metrics().histogram("oems_feed_latency_ns", "Feed latency by stage", {{"stage", "end_to_end"}});
+    };
+
+    FeedMetrics &feedMetrics()
+    {
+        static FeedMetrics metrics;
+        return metrics;
+    }
+}
+
+WebSocketClient::WebSocketClient(WebSocketClientOptions options)
+    : clientOptions(std::move(options)), stream("WebSocket client", clientOptions.endpoints, clientOptions.reconnect, clientOptions.heartbeat),
+      displayQueue(1024, UtilityNamespace::memoryPlacement())
+{
+    Stream::Handlers handlers;
+    handlers.open = [this](websocketpp::connection_hdl hdl)
+    { return onOpen(hdl); };
+    handlers.close = [this](websocketpp::connection_hdl hdl, bool wasConnected)
+    { onClose(hdl, wasConnected); };
+    handlers.message = [this](websocketpp::connection_hdl hdl, Stream::MessagePtr msg, int64_t receivedNs)
+    { onMessage(hdl, std::move(msg), receivedNs); };
+    // the server answers every ping with a pong frame, which also feeds the clock offset estimate
+    handlers.ping = [this]()
+    { sendPing(); };
+    stream.setHandlers(std::move(handlers));
+    stream.setFollowGoingAway(true);
+    stream.client().set_socket_init_handler(bind(&WebSocketClient::onSocketInit, this, std::placeholders::_1, std::placeholders::_2));
+    displayThread = std::thread([this]()
+                                { displayLoop(); });
 }
 WebSocketClient::~WebSocketClient()
 {
-    if (running)
+    if (stream.running())
     {
         disconnect();
     }
+    displayQueue.close();
+    displayThread.join();
 }
 void WebSocketClient::start()
 {
-    websocketpp::lib::error_code ec;
-    std::string uri = "ws://localhost:9002";
-    auto con = client.get_connection(uri, ec);
-
-    if (ec)
-    {
-        std::cerr << "Connection error: " << ec.message() << std::endl;
-        return;
-    }
-
-    client.connect(con);
-    globalHdl = con->get_handle();
+    // this thread runs the event loop for the connection
+    stream.run([this]()
+               { UtilityNamespace::pinCurrentThread(clientOptions.socket.ioCpu); });
+    OEMS_LOG_INFO("Server Stopped");
+}
 
-    try
+// while disconnected the subscription is only recorded; onOpen sends it
+void WebSocketClient::subscribe(const std::string &symbol, const StreamOptions &options)
+{
     {
-        client.run();
+        std::lock_guard<std::mutex> lock(symbolMutex);
+        subscribedSymbols[symbol] = options;
     }
-    catch (const std::exception &e)
+    std::string message = UtilityNamespace::encodeSubscribe(symbol, options);
+    websocketpp::lib::error_code ec;
+    if (stream.connected())
+        stream.client().send(stream.connection(), message, websocketpp::frame::opcode::text, ec);
+    if (!stream.connected() || ec)
     {
-        std::cerr << "WebSocket client error: " << e.what() << std::endl;
+        OEMS_LOG_INFO("Subscription to {} is sent on reconnect", symbol);
+        return;
     }
-    std::cout << "Server Stopped" << std::endl;
-}
-
-void WebSocketClient::subscribe(const std::string &symbol)
-{
-    nlohmann::json subscribeMessage = {{"action", "subscribe"}, {"symbol", symbol}};
-    client.send(globalHdl, subscribeMessage.dump(), websocketpp::frame::opcode::text);
-    std::lock_guard<std::mutex> lock(symbolMutex);
-    subscribedSymbols.insert(symbol);
-    std::cout << "Subscribed to: " << symbol << std::endl;
+    connectionStats.bytesSent.fetch_add(message.size(), std::memory_order_relaxed);
+    OEMS_LOG_INFO("Subscribed to: {}", symbol);
 }
 
 void WebSocketClient::unsubscribe(const std::string &symbol)
 {
+    {
+        std::lock_guard<std::mutex> lock(symbolMutex);
+        subscribedSymbols.erase(symbol);
+        feeds.erase(symbol);
+    }
     nlohmann::json unsubscribeMessage = {{"action", "unsubscribe"}, {"symbol", symbol}};
-    client.send(globalHdl, unsubscribeMessage.dump(), websocketpp::frame::opcode::text);
-    std::lock_guard<std::mutex> lock(symbolMutex);
-    subscribedSymbols.erase(symbol);
-    std::cout << "Unsubscribed from: " << symbol << std::endl;
+    std::string message = unsubscribeMessage.dump();
+    websocketpp::lib::error_code ec;
+    if (stream.connected())
+        stream.client().send(stream.connection(), message, websocketpp::frame::opcode::text, ec);
+    if (stream.connected() && !ec)
+        connectionStats.bytesSent.fetch_add(message.size(), std::memory_order_relaxed);
+    OEMS_LOG_INFO("Unsubscribed from: {}", symbol);
 }
 
-void WebSocketClient::disconnect()
+void WebSocketClient::requestReplay(const std::string &symbol, uint64_t fromSeq)
 {
-    if (!running)
+    nlohmann::json replayMessage = {{"action", "replay"}, {"symbol", symbol}, {"from_seq", fromSeq}};
+    std::string message = replayMessage.dump();
+    websocketpp::lib::error_code ec;
+    stream.client().send(stream.connection(), message, websocketpp::frame::opcode::text, ec);
+    if (ec)
     {
-        std::cerr << "Already disconnected." << std::endl;
+        OEMS_LOG_ERROR("Replay request failed: {}", ec.message());
         return;
     }
+    connectionStats.bytesSent.fetch_add(message.size(), std::memory_order_relaxed);
+}
 
-    std::cout << "Disconnecting from server..." << std::endl;
-
+void WebSocketClient::requestSnapshot(const std::string &symbol)
+{
+    nlohmann::json snapshotMessage = {{"action", "snapshot"}, {"symbol", symbol}};
+    std::string message = snapshotMessage.dump();
     websocketpp::lib::error_code ec;
-    client.close(globalHdl, websocketpp::close::status::going_away, "Client disconnecting", ec);
-
+    stream.client().send(stream.connection(), message, websocketpp::frame::opcode::text, ec);
     if (ec)
     {
-        std::cerr << "Error during disconnect: " << ec.message() << std::endl;
+        OEMS_LOG_ERROR("Snapshot request failed: {}", ec.message());
+        return;
     }
+    connectionStats.bytesSent.fetch_add(message.size(), std::memory_order_relaxed);
+}
 
-    // Stop the WebSocket++ event loop
-    client.stop();
-    running = false;
+// closes on the io thread and waits for the close handshake, cutting the I/O off after
+// STOP_TIMEOUT; from any thread but the one in start()
+void WebSocketClient::disconnect()
+{
+    if (!stream.running())
+    {
+        OEMS_LOG_WARN("Already disconnected");
+        return;
+    }
+
+    OEMS_LOG_INFO("Disconnecting from server");
+    stream.stop();
 
-    // Clear resources
     std::lock_guard<std::mutex> lock(symbolMutex);
     subscribedSymbols.clear();
-
-    std::cout << "Disconnected from server." << std::endl;
+    feeds.clear();
+    OEMS_LOG_INFO("Disconnected from server");
 }
 
 void WebSocketClient::manageWebSocket()
 {
-    while (running)
+    while (stream.running())
     {
-        std::cout << "For subscribing, enter SUB, unsubscribing enter UNSUB, and for disconnecting from the server enter DISC\n";
+        std::cout << "For subscribing, enter SUB, unsubscribing enter UNSUB, latency statistics enter STATS, and for disconnecting from the server enter DISC\n";
         std::cout << "Then enter the symbol to subscribe or unsubscribe (e.g., SUB BTC-PERPETUAL)\n";
+        std::cout << "SUB also takes an optional depth and interval (e.g., SUB BTC-PERPETUAL 10 100ms, 0 for the full book, raw for every change)\n";
         std::string action, symbol;
         std::cin >> action;
         if (action == "SUB")
         {
-            std::cin >> symbol;
-            subscribe(symbol);
+            std::string line;
+            std::getline(std::cin, line);
+            std::istringstream args(line);
+            StreamOptions options;
+            args >> symbol >> options.depth >> options.interval;
+            if (symbol.empty())
+                std::cin >> symbol; // symbol typed on the next line
+            subscribe(symbol, options);
         }
         else if (action == "UNSUB")
         {
             std::cin >> symbol;
             unsubscribe(symbol);
         }
+        else if (action == "STATS")
+        {
+            printLatency(std::cout);
+        }
         else
         {
             disconnect();
@@ -112,29 +184,236 @@ void WebSocketClient::manageWebSocket()
     }
 }
 
-void WebSocketClient::onMessage(websocketpp::connection_hdl, websocketpp::config::asio::message_type::ptr msg)
+void WebSocketClient::setPipeline(MarketDataPipeline *pipeline)
+{
+    this->pipeline = pipeline;
+    if (pipeline)
+    {
+        pipeline->setRecoveryHandler([this](const std::string &symbol, uint64_t fromSeq)
+                                     {
+                                         if (fromSeq == 0)
+                                             requestSnapshot(symbol);
+                                         else
+                                             requestReplay(symbol, fromSeq); });
+    }
+}
+
+void WebSocketClient::onSocketInit(websocketpp::connection_hdl, boost::asio::ip::tcp::socket &socket)
 {
+    socketFd = socket.native_handle();
+    UtilityNamespace::applySocketOptions(socketFd, clientOptions.socket, &connectionStats);
+}
+
+void WebSocketClient::onMessage(websocketpp::connection_hdl, Stream::MessagePtr msg, int64_t receivedNs)
+{
+    connectionStats.messagesReceived.fetch_add(1, std::memory_order_relaxed);
+    connectionStats.bytesReceived.fetch_add(msg->get_payload().size(), std::memory_order_relaxed);
+    feedMetrics().frames.add();
+    feedMetrics().bytes.add(msg->get_payload().size());
+    if (clientOptions.socket.quickAck && socketFd >= 0)
+    {
+        UtilityNamespace::rearmQuickAck(socketFd);
+    }
+
+    // the server writes pongs with this fixed prefix, so they are spotted without a parse
+    const std::string &payload = msg->get_payload();
+    if (payload.compare(0, 14, "{\"type\":\"pong\"") == 0)
+    {
+        onPong(payload, receivedNs);
+        return;
+    }
+
+    if (pipeline)
+    {
+        // the book thread decodes the frame, so the stamps are picked out of it here
+        int64_t upstreamNs = 0, sentNs = 0;
+        if (UtilityNamespace::findLatencyStamps(payload, upstreamNs, sentNs))
+            recordLatency(upstreamNs, sentNs, receivedNs);
+        pipeline->submit(std::move(msg->get_raw_payload()));
+        return;
+    }
     try
     {
-        auto receivedTime = std::chrono::system_clock::now();
-        nlohmann::json orderbookData = nlohmann::json::parse(msg->get_payload());
-        if (orderbookData.contains("timestamp"))
+        nlohmann::json frame = nlohmann::json::parse(payload);
+        auto upstream = frame.find("recv_ns");
+        auto sent = frame.find("send_ns");
+        if (upstream != frame.end() && sent != frame.end())
+            recordLatency(upstream->get<int64_t>(), sent->get<int64_t>(), receivedNs);
+
+        std::string type = frame.value("type", "snapshot");
+        if (type == "error")
+        {
+            display("Server rejected a request: " + frame.value("message", ""));
+            return;
+        }
+        if (type != "snapshot" && type != "update")
+            return;
+        std::string symbol = frame.value("symbol", "");
+        uint64_t seq = frame.value("seq", uint64_t(0));
+
+        std::unique_lock<std::mutex> lock(symbolMutex);
+        SymbolFeed &feed = feedFor(symbol);
+        if (type == "snapshot")
         {
-            auto sentTimestamp = orderbookData["timestamp"].get<long long>();
-            auto receivedTimestamp = std::chrono::duration_cast<std::chrono::milliseconds>(receivedTime.time_since_epoch()).count();
-            auto propagationDelay = receivedTimestamp - sentTimestamp;
-            std::cout << "Propagation delay: " << propagationDelay << " ms" << std::endl;
+            // full-book snapshots carry the upstream reply, depth-limited ones just their levels
+            nlohmann::json &result = frame.contains("data") ? frame["data"]["result"] : frame;
+            feed.book.clear();
+            for (const auto &level : result.value("bids", nlohmann::json::array()))
+                feed.book.apply(true, level[0].get<double>(), level[1].get<double>());
+            for (const auto &level : result.value("asks", nlohmann::json::array()))
+                feed.book.apply(false, level[0].get<double>(), level[1].get<double>());
+            feed.sequencer.onSnapshot(seq);
+            lock.unlock();
+            nlohmann::json body = frame.contains("data") ? std::move(frame["data"]) : nlohmann::json{{"bids", std::move(frame["bids"])}, {"asks", std::move(frame["asks"])}};
+            display("Received orderbook snapshot for " + symbol + " (seq " + std::to_string(seq) + "):\n", std::move(body));
+            return;
+        }
+
+        switch (feed.sequencer.onUpdate(seq))
+        {
+        case FrameAction::Apply:
+            for (const auto &level : frame.at("bids"))
+                feed.book.apply(true, level[0].get<double>(), level[1].get<double>());
+            for (const auto &level : frame.at("asks"))
+                feed.book.apply(false, level[0].get<double>(), level[1].get<double>());
+            display("Update " + std::to_string(seq) + " for " + symbol + ": best bid " +
+                    std::to_string(feed.book.bids.empty() ? 0.0 : feed.book.bids.begin()->first) + ", best ask " +
+                    std::to_string(feed.book.asks.empty() ? 0.0 : feed.book.asks.begin()->first));
+            break;
+        case FrameAction::Recover:
+        {
+            uint64_t fromSeq = feed.sequencer.expected();
+            lock.unlock();
+            display("Gap on " + symbol + ": expected seq " + std::to_string(fromSeq) + ", got " + std::to_string(seq) + ", requesting replay");
+            requestReplay(symbol, fromSeq);
+            break;
+        }
+        case FrameAction::Resync:
+            lock.unlock();
+            display("Replay did not close the gap on " + symbol + ", requesting a snapshot");
+            requestSnapshot(symbol);
+            break;
+        case FrameAction::Ignore:
+            break;
         }
-        std::cout << "Received orderbook update:\n"
-                  << orderbookData.dump(4) << std::endl;
     }
     catch (const std::exception &e)
     {
-        std::cerr << "JSON parsing error: " << e.what() << std::endl;
+        OEMS_LOG_ERROR("JSON parsing error: {}", e.what());
+    }
+}
+// level nodes from a pool over placed memory when a placement is set (--huge-pages), mapped on the
+// first frame so the pages land on the io thread's node
+SymbolFeed &WebSocketClient::feedFor(const std::string &symbol)
+{
+    if (!bookPool && UtilityNamespace::memoryPlacement().placed())
+    {
+        bookMemory = std::make_unique<PlacedArena>(UtilityNamespace::memoryPlacement());
+        bookPool = std::make_unique<std::pmr::unsynchronized_pool_resource>(bookMemory.get());
+    }
+    std::pmr::memory_resource *resource = bookPool ? bookPool.get() : std::pmr::get_default_resource();
+    return feeds.try_emplace(symbol, resource).first->second;
+}
+
+bool WebSocketClient::onOpen(websocketpp::connection_hdl)
+{
+    display("Connected to server " + stream.endpoint() + ".");
+
+    // the books start over from the snapshots that answer these; a pipeline resyncs the same way
+    std::vector<std::string> messages;
+    {
+        std::lock_guard<std::mutex> lock(symbolMutex);
+        feeds.clear();
+        for (const auto &entry : subscribedSymbols)
+            messages.push_back(UtilityNamespace::encodeSubscribe(entry.first, entry.second));
+    }
+    for (const std::string &message : messages)
+    {
+        websocketpp::lib::error_code ec;
+        stream.client().send(stream.connection(), message, websocketpp::frame::opcode::text, ec);
+        if (!ec)
+            connectionStats.bytesSent.fetch_add(message.size(), std::memory_order_relaxed);
+    }
+    sendPing(); // the first clock offset sample, the stream's heartbeat sends the rest
+    return true;
+}
+
+// also for a failed attempt; the stream moves on to the next endpoint, or back to a draining one
+void WebSocketClient::onClose(websocketpp::connection_hdl, bool wasConnected)
+{
+    socketFd = -1;
+    if (wasConnected && stream.running())
+        display("Connection to " + stream.endpoint() + " lost, reconnecting.");
+}
+
+void WebSocketClient::sendPing()
+{
+    std::string message = "{\"action\":\"ping\",\"t0\":" + std::to_string(UtilityNamespace::steadyNowNs()) + "}";
+    websocketpp::lib::error_code ec;
+    stream.client().send(stream.connection(), message, websocketpp::frame::opcode::text, ec);
+    if (!ec)
+        connectionStats.bytesSent.fetch_add(message.size(), std::memory_order_relaxed);
+}
+
+void WebSocketClient::onPong(const std::string &payload, int64_t receivedNs)
+{
+    try
+    {
+        nlohmann::json pong = nlohmann::json::parse(payload);
+        clockSync.onPong(pong.at("t0").get<int64_t>(), pong.at("t1").get<int64_t>(), pong.at("t2").get<int64_t>(), receivedNs);
+        roundTripLatency.record(clockSync.roundTripNs());
+        clockOffsetNs.store(clockSync.offsetNs(), std::memory_order_relaxed);
+        clockSynced.store(true, std::memory_order_release);
+    }
+    catch (const std::exception &e)
+    {
+        OEMS_LOG_WARN("Malformed pong: {}", e.what());
     }
 }
-void WebSocketClient::onOpen(websocketpp::connection_hdl hdl)
+
+// server stamps are on the server's steady clock; our receive time is moved onto it with the ping/pong offset
+void WebSocketClient::recordLatency(int64_t upstreamNs, int64_t sentNs, int64_t receivedNs)
+{
+    FeedMetrics &metrics = feedMetrics();
+    serverLatency.record(sentNs - upstreamNs);
+    metrics.server.record(sentNs - upstreamNs);
+    if (!clockSynced.load(std::memory_order_acquire))
+        return;
+    int64_t arrivedNs = receivedNs + clockOffsetNs.load(std::memory_order_relaxed);
+    wireLatency.record(arrivedNs - sentNs);
+    endToEndLatency.record(arrivedNs - upstreamNs);
+    metrics.wire.record(arrivedNs - sentNs);
+    metrics.endToEnd.record(arrivedNs - upstreamNs);
+}
+
+void WebSocketClient::printLatency(std::ostream &out) const
+{
+    out << "clock offset: " << (clockSynced ? std::to_string(clockOffsetNs.load(std::memory_order_relaxed)) + " ns" : std::string("not synced"))
+        << ", dropped display lines: " << droppedDisplays.load(std::memory_order_relaxed) << "\n";
+    serverLatency.print(out, "server (upstream -> publish)");
+    wireLatency.print(out, "wire (publish -> receive)");
+    endToEndLatency.print(out, "end to end (upstream -> receive)");
+    roundTripLatency.print(out, "ping round trip");
+}
+
+// never blocks the receive thread: lines are dropped when the display falls behind
+void WebSocketClient::display(std::string text, nlohmann::json body)
 {
-    globalHdl = hdl;
-    std::cout << "Connected to server." << std::endl;
+    if (!displayQueue.tryPush(DisplayEvent{std::move(text), std::move(body)}))
+    {
+        droppedDisplays.fetch_add(1, std::memory_order_relaxed);
+        feedMetrics().displayDrops.add();
+    }
+}
+
+void WebSocketClient::displayLoop()
+{
+    DisplayEvent event;
+    while (displayQueue.pop(event))
+    {
+        std::cout << event.text;
+        if (!event.body.is_null())
+            std::cout << event.body.dump(4);
+        std::cout << std::endl;
+    }
 }
@@ -0,0 +1,74 @@
+#include "arena.hpp"
+#include <gtest/gtest.h>
+#include <cstdint>
+#include <string>
+
+TEST(MessageArena, ResetRewindsTheBlock)
+{
+    MessageArena arena(1024);
+    void *first = arena.allocate(100, 8);
+    EXPECT_GE(arena.used(), 100u);
+    arena.reset();
+    EXPECT_EQ(arena.used(), 0u);
+    EXPECT_EQ(arena.resetCount(), 1u);
+    // the same bytes again, nothing from the heap
+    EXPECT_EQ(arena.allocate(100, 8), first);
+    EXPECT_EQ(arena.upstreamAllocations(), 0u);
+}
+
+TEST(MessageArena, HonoursAlignment)
+{
+    // past max_align_t too, which the block itself is not aligned to
+    MessageArena arena(4096);
+    for (size_t alignment : {16u, 64u, 256u, 1024u})
+    {
+        (void)arena.allocate(1, 1);
+        void *aligned = arena.allocate(16, alignment);
+        EXPECT_EQ(reinterpret_cast<uintptr_t>(aligned) % alignment, 0u) << alignment;
+    }
+    EXPECT_EQ(arena.upstreamAllocations(), 0u);
+}
+
+// an overflowing message is served from the heap, and the next reset grows the block to fit it
+TEST(MessageArena, OverflowGrowsTheBlockOnReset)
+{
+    MessageArena arena(256);
+    size_t before = arena.capacity();
+    (void)arena.allocate(200, 8);
+    (void)arena.allocate(200, 8);
+    EXPECT_EQ(arena.upstreamAllocations(), 1u);
+    arena.reset();
+    EXPECT_GT(arena.capacity(), before);
+    (void)arena.allocate(200, 8);
+    (void)arena.allocate(200, 8);
+    EXPECT_EQ(arena.upstreamAllocations(), 1u);
+}
+
+// pages are touched without taking the bytes, so a message already under way still fits in the block
+TEST(MessageArena, PrefaultLeavesTheFreeBytesFree)
+{
+    MessageArena arena(1024);
+    ArenaScope scope(arena);
+    (void)arena.allocate(100, 1);
+    EXPECT_EQ(arena.prefault(), arena.capacity() - 100);
+    EXPECT_EQ(arena.used(), 100u);
+    (void)arena.allocate(arena.capacity() - 100, 1);
+    EXPECT_EQ(arena.upstreamAllocations(), 0u);
+}
+
+TEST(ArenaScope, OutermostScopeResets)
+{
+    MessageArena arena(4096);
+    {
+        ArenaScope outer(arena);
+        std::pmr::string text("a string long enough to leave the small buffer", &outer.resource());
+        {
+            ArenaScope inner(arena);
+            (void)inner.resource().allocate(64, 8);
+        }
+        EXPECT_EQ(arena.resetCount(), 0u);
+        EXPECT_GT(arena.used(), 0u);
+    }
+    EXPECT_EQ(arena.resetCount(), 1u);
+    EXPECT_EQ(arena.used(), 0u);
+}
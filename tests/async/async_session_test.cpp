@@ -0,0 +1,253 @@
+#include "async_session.hpp"
+#include <gtest/gtest.h>
+#include <boost/asio/co_spawn.hpp>
+#include <boost/asio/detached.hpp>
+#include <boost/asio/steady_timer.hpp>
+#include <boost/asio/use_awaitable.hpp>
+#include <boost/asio/use_future.hpp>
+#include <arpa/inet.h>
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <map>
+#include <mutex>
+#include <netinet/in.h>
+#include <string>
+#include <sys/socket.h>
+#include <thread>
+#include <unistd.h>
+
+namespace
+{
+    // HTTP/1.1 on loopback that answers the first request on each connection, then reads the next one
+    // and hangs up without a reply: an idle keep-alive connection timing out as a request arrives
+    class HangUpServer
+    {
+    public:
+        HangUpServer()
+        {
+            listenFd = socket(AF_INET, SOCK_STREAM, 0);
+            sockaddr_in addr{};
+            addr.sin_family = AF_INET;
+            addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+            bind(listenFd, reinterpret_cast<sockaddr *>(&addr), sizeof(addr));
+            listen(listenFd, 4);
+            socklen_t len = sizeof(addr);
+            getsockname(listenFd, reinterpret_cast<sockaddr *>(&addr), &len);
+            port = ntohs(addr.sin_port);
+            worker = std::thread([this]()
+                                 {
+                                     int fd;
+                                     while ((fd = accept(listenFd, nullptr, nullptr)) >= 0)
+                                     {
+                                         serve(fd);
+                                         close(fd);
+                                     } });
+        }
+
+        ~HangUpServer()
+        {
+            shutdown(listenFd, SHUT_RDWR);
+            close(listenFd);
+            worker.join();
+        }
+
+        std::string url() const { return "http://127.0.0.1:" + std::to_string(port) + "/"; }
+
+        // requests read for target, answered or not
+        int received(const std::string &target)
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            return counts[target];
+        }
+
+    private:
+        void serve(int fd)
+        {
+            std::string buffer;
+            char chunk[4096];
+            for (int request = 0; request < 2; ++request)
+            {
+                size_t headerEnd;
+                while ((headerEnd = buffer.find("\r\n\r\n")) == std::string::npos)
+                {
+                    long got = recv(fd, chunk, sizeof(chunk), 0);
+                    if (got <= 0)
+                        return;
+                    buffer.append(chunk, got);
+                }
+                size_t contentLength = 0;
+                size_t pos = buffer.find("Content-Length:");
+                if (pos != std::string::npos && pos < headerEnd)
+                    contentLength = std::strtoul(buffer.c_str() + pos + 15, nullptr, 10);
+                while (buffer.size() < headerEnd + 4 + contentLength)
+                {
+                    long got = recv(fd, chunk, sizeof(chunk), 0);
+                    if (got <= 0)
+                        return;
+                    buffer.append(chunk, got);
+                }
+                size_t targetStart = buffer.find(' ') + 1;
+                {
+                    std::lock_guard<std::mutex> lock(mutex);
+                    ++counts[buffer.substr(targetStart, buffer.find(' ', targetStart) - targetStart)];
+                }
+                buffer.erase(0, headerEnd + 4 + contentLength);
+                if (request == 1)
+                    return;
+                std::string body = "{\"jsonrpc\":\"2.0\",\"id\":1,\"result\":{}}";
+                std::string reply = "HTTP/1.1 200 OK\r\nContent-Type: application/json\r\nContent-Length: " +
+                                    std::to_string(body.size()) + "\r\n\r\n" + body;
+                if (send(fd, reply.data(), reply.size(), MSG_NOSIGNAL) < 0)
+                    return;
+            }
+        }
+
+        int listenFd;
+        int port = 0;
+        std::thread worker;
+        std::mutex mutex;
+        std::map<std::string, int> counts;
+    };
+
+    // HTTP/1.1 on loopback that answers each request late and with Connection: close, so no
+    // connection is ever reused and every request needs a slot of its own
+    class ClosingServer
+    {
+    public:
+        ClosingServer()
+        {
+            listenFd = socket(AF_INET, SOCK_STREAM, 0);
+            sockaddr_in addr{};
+            addr.sin_family = AF_INET;
+            addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+            bind(listenFd, reinterpret_cast<sockaddr *>(&addr), sizeof(addr));
+            listen(listenFd, 4);
+            socklen_t len = sizeof(addr);
+            getsockname(listenFd, reinterpret_cast<sockaddr *>(&addr), &len);
+            port = ntohs(addr.sin_port);
+            worker = std::thread([this]()
+                                 {
+                                     int fd;
+                                     while ((fd = accept(listenFd, nullptr, nullptr)) >= 0)
+                                     {
+                                         serve(fd);
+                                         close(fd);
+                                     } });
+        }
+
+        ~ClosingServer()
+        {
+            shutdown(listenFd, SHUT_RDWR);
+            close(listenFd);
+            worker.join();
+        }
+
+        std::string url() const { return "http://127.0.0.1:" + std::to_string(port) + "/"; }
+
+    private:
+        void serve(int fd)
+        {
+            std::string buffer;
+            char chunk[4096];
+            size_t headerEnd;
+            while ((headerEnd = buffer.find("\r\n\r\n")) == std::string::npos)
+            {
+                long got = recv(fd, chunk, sizeof(chunk), 0);
+                if (got <= 0)
+                    return;
+                buffer.append(chunk, got);
+            }
+            std::this_thread::sleep_for(std::chrono::milliseconds(20));
+            std::string body = "{\"jsonrpc\":\"2.0\",\"id\":1,\"result\":{}}";
+            std::string reply = "HTTP/1.1 200 OK\r\nConnection: close\r\nContent-Type: application/json\r\nContent-Length: " +
+                                std::to_string(body.size()) + "\r\n\r\n" + body;
+            send(fd, reply.data(), reply.size(), MSG_NOSIGNAL);
+        }
+
+        int listenFd;
+        int port = 0;
+        std::thread worker;
+    };
+
+    // two requests in a row on one keep-alive connection; the results of both
+    std::pair<bool, bool> postTwice(HangUpServer &server, const std::string &path)
+    {
+        boost::asio::io_context io;
+        AsyncSessionOptions options;
+        options.maxConnections = 1;
+        options.baseUrl = server.url();
+        AsyncSession session(io, "async-test", Credentials(), options);
+        std::future<std::pair<bool, bool>> results = boost::asio::co_spawn(io, [&]() -> boost::asio::awaitable<std::pair<bool, bool>>
+                                                                           {
+                                                                               std::string first, second;
+                                                                               bool a = co_await session.post(path, "{}", first);
+                                                                               bool b = co_await session.post(path, "{}", second);
+                                                                               co_return std::make_pair(a, b); },
+                                                                           boost::asio::use_future);
+        io.run();
+        session.close();
+        return results.get();
+    }
+}
+
+// the second order was read by the server before it hung up, so it may have executed: not sent again
+TEST(AsyncSession, DoesNotResendAWrittenPrivateRequest)
+{
+    HangUpServer server;
+    auto [first, second] = postTwice(server, "private/buy");
+    EXPECT_TRUE(first);
+    EXPECT_FALSE(second);
+    EXPECT_EQ(server.received("/private/buy"), 2);
+}
+
+TEST(AsyncSession, ResendsAPublicRequestOnAStaleConnection)
+{
+    HangUpServer server;
+    auto [first, second] = postTwice(server, "public/get_time");
+    EXPECT_TRUE(first);
+    EXPECT_TRUE(second);
+    EXPECT_EQ(server.received("/public/get_time"), 3);
+}
+
+// a dropped connection's slot goes to the waiting request, not to whichever request asks next
+TEST(AsyncSession, HandsADroppedSlotToTheWaiterWithoutExceedingTheLimit)
+{
+    ClosingServer server;
+    boost::asio::io_context io;
+    AsyncSessionOptions options;
+    options.maxConnections = 1;
+    options.baseUrl = server.url();
+    AsyncSession session(io, "async-test", Credentials(), options);
+    int succeeded = 0, running = 2;
+    size_t mostOpen = 0;
+    // the first requester asks again as soon as its first reply is in, ahead of the waiter
+    auto requester = [&](int requests) -> boost::asio::awaitable<void>
+    {
+        for (int i = 0; i < requests; ++i)
+        {
+            std::string response;
+            if (co_await session.post("public/get_time", "{}", response))
+                ++succeeded;
+        }
+        --running;
+    };
+    auto watcher = [&]() -> boost::asio::awaitable<void>
+    {
+        boost::asio::steady_timer timer(io);
+        while (running > 0)
+        {
+            mostOpen = std::max(mostOpen, session.openConnections());
+            timer.expires_after(std::chrono::milliseconds(1));
+            co_await timer.async_wait(boost::asio::use_awaitable);
+        }
+    };
+    boost::asio::co_spawn(io, requester(2), boost::asio::detached);
+    boost::asio::co_spawn(io, requester(1), boost::asio::detached);
+    boost::asio::co_spawn(io, watcher(), boost::asio::detached);
+    io.run();
+    session.close();
+    EXPECT_EQ(succeeded, 3);
+    EXPECT_EQ(mostOpen, 1u);
+    EXPECT_EQ(session.openConnections(), 0u);
+}
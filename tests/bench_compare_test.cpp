@@ -0,0 +1,88 @@
+#include <gtest/gtest.h>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <string>
+#include <sys/wait.h>
+
+namespace
+{
+    // a Google Benchmark JSON result with one median aggregate per case, in ns
+    std::string results(std::initializer_list<std::pair<const char *, double>> cases, const char *failed = nullptr)
+    {
+        std::string json = "{\"context\":{},\"benchmarks\":[";
+        for (const auto &[name, ns] : cases)
+        {
+            if (json.back() != '[')
+                json += ',';
+            json += std::string("{\"name\":\"") + name + "_median\",\"run_name\":\"" + name +
+                    "\",\"run_type\":\"aggregate\",\"aggregate_name\":\"median\",\"real_time\":" + std::to_string(ns) +
+                    ",\"cpu_time\":" + std::to_string(ns) + ",\"time_unit\":\"ns\"}";
+        }
+        if (failed)
+            json += std::string(json.back() == '[' ? "" : ",") + "{\"name\":\"" + failed + "\",\"run_name\":\"" + failed +
+                    "\",\"run_type\":\"iteration\",\"error_occurred\":true,\"error_message\":\"boom\"}";
+        return json + "]}";
+    }
+
+    std::string write(const std::string &name, const std::string &content)
+    {
+        std::string path = testing::TempDir() + "bench_compare_" + name + ".json";
+        std::ofstream(path) << content;
+        return path;
+    }
+
+    // exit status of bench_compare with args, its table thrown away
+    int compare(const std::string &args)
+    {
+        int status = std::system((std::string(BENCH_COMPARE_PATH) + " " + args + " > /dev/null 2>&1").c_str());
+        return WIFEXITED(status) ? WEXITSTATUS(status) : -1;
+    }
+}
+
+TEST(BenchCompare, PassesWithinTheTolerance)
+{
+    std::string baseline = write("base_ok", results({{"BM_Encode", 100.0}, {"BM_Parse", 200.0}}));
+    std::string current = write("cur_ok", results({{"BM_Encode", 109.0}, {"BM_Parse", 150.0}, {"BM_New", 5.0}}));
+    EXPECT_EQ(compare(baseline + " " + current), 0);
+}
+
+TEST(BenchCompare, FailsOnASlowerCase)
+{
+    std::string baseline = write("base_slow", results({{"BM_Encode", 100.0}, {"BM_Parse", 200.0}}));
+    std::string current = write("cur_slow", results({{"BM_Encode", 100.0}, {"BM_Parse", 230.0}}));
+    EXPECT_EQ(compare(baseline + " " + current), 1);
+    // unless the tolerance covers it
+    EXPECT_EQ(compare(baseline + " " + current + " 20"), 0);
+}
+
+TEST(BenchCompare, FailsOnAnErroredCase)
+{
+    std::string baseline = write("base_err", results({{"BM_Encode", 100.0}, {"BM_Parse", 200.0}}));
+    std::string current = write("cur_err", results({{"BM_Encode", 100.0}}, "BM_Parse"));
+    EXPECT_EQ(compare(baseline + " " + current), 1);
+}
+
+TEST(BenchCompare, FailsWhenABaselineCaseIsMissing)
+{
+    std::string baseline = write("base_gone", results({{"BM_Encode", 100.0}, {"BM_Parse", 200.0}}));
+    std::string current = write("cur_gone", results({{"BM_Encode", 100.0}}));
+    EXPECT_EQ(compare(baseline + " " + current), 1);
+}
+
+TEST(BenchCompare, MissingBaselineIsAnErrorUnlessSkipped)
+{
+    std::string current = write("cur_nobase", results({{"BM_Encode", 100.0}}));
+    std::string missing = testing::TempDir() + "bench_compare_no_such_baseline.json";
+    EXPECT_EQ(compare(missing + " " + current), 2);
+    EXPECT_EQ(compare("--skip-missing-baseline " + missing + " " + current), 0);
+    // the flag only covers a missing baseline, not a broken one
+    std::string broken = write("base_broken", "{\"benchmarks\":[");
+    EXPECT_EQ(compare("--skip-missing-baseline " + broken + " " + current), 2);
+}
+
+TEST(BenchCompare, RejectsMissingArguments)
+{
+    EXPECT_EQ(compare(""), 2);
+    EXPECT_EQ(compare("--skip-missing-baseline only_one.json"), 2);
+}
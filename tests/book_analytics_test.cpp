@@ -0,0 +1,182 @@
+#include "book_analytics.hpp"
+#include <gtest/gtest.h>
+#include <algorithm>
+#include <random>
+#include <vector>
+
+// the kernels run whole vectors and then a scalar tail, so these depths cover no vector, exact
+// multiples of two and four lanes and every tail length after them
+namespace
+{
+    const size_t DEPTHS[] = {1, 2, 3, 4, 5, 6, 7, 8, 9, 11, 16, 17, 31, 33, 100};
+
+    // bids down and asks up from 100 in 0.5 ticks, sizes between 0.05 and 3
+    SoaBook randomBook(size_t bidCount, size_t askCount, unsigned seed)
+    {
+        std::mt19937 random(seed);
+        std::uniform_real_distribution<double> size(0.05, 3.0);
+        SoaBook book;
+        for (size_t i = 0; i < bidCount; ++i)
+        {
+            book.bidPrices.push_back(99.5 - 0.5 * i);
+            book.bidSizes.push_back(size(random));
+        }
+        for (size_t i = 0; i < askCount; ++i)
+        {
+            book.askPrices.push_back(100.0 + 0.5 * i);
+            book.askSizes.push_back(size(random));
+        }
+        return book;
+    }
+
+    double scalarVwap(const std::vector<double> &prices, const std::vector<double> &sizes, double target)
+    {
+        if (target <= 0.0)
+            return 0.0;
+        double filled = 0.0, notional = 0.0;
+        for (size_t i = 0; i < prices.size() && filled < target; ++i)
+        {
+            double take = std::min(sizes[i], target - filled);
+            filled += take;
+            notional += take * prices[i];
+        }
+        return filled + 1e-12 >= target ? notional / filled : 0.0;
+    }
+
+    // the definitions in book_analytics.hpp, level by level
+    BookAnalytics scalarAnalytics(const SoaBook &book, const AnalyticsConfig &config)
+    {
+        BookAnalytics result;
+        if (book.bidPrices.empty() || book.askPrices.empty())
+            return result;
+        result.bestBid = book.bidPrices[0];
+        result.bestAsk = book.askPrices[0];
+        result.mid = (result.bestBid + result.bestAsk) / 2.0;
+        result.spread = result.bestAsk - result.bestBid;
+        result.spreadBps = result.spread / result.mid * 10000.0;
+        double bidTop = book.bidSizes[0], askTop = book.askSizes[0];
+        result.microprice = (result.bestBid * askTop + result.bestAsk * bidTop) / (bidTop + askTop);
+
+        double bidQty = 0.0, askQty = 0.0;
+        for (size_t i = 0; i < std::min(config.imbalanceLevels, book.bidSizes.size()); ++i)
+            bidQty += book.bidSizes[i];
+        for (size_t i = 0; i < std::min(config.imbalanceLevels, book.askSizes.size()); ++i)
+            askQty += book.askSizes[i];
+        result.imbalance = (bidQty - askQty) / (bidQty + askQty);
+
+        double band = result.mid * config.depthBandBps / 10000.0;
+        for (size_t i = 0; i < book.bidPrices.size(); ++i)
+        {
+            if (book.bidPrices[i] >= result.mid - band && book.bidPrices[i] <= result.mid)
+                result.bidDepth += book.bidSizes[i];
+        }
+        for (size_t i = 0; i < book.askPrices.size(); ++i)
+        {
+            if (book.askPrices[i] >= result.mid && book.askPrices[i] <= result.mid + band)
+                result.askDepth += book.askSizes[i];
+        }
+        result.vwapBuy = scalarVwap(book.askPrices, book.askSizes, config.fillSize);
+        result.vwapSell = scalarVwap(book.bidPrices, book.bidSizes, config.fillSize);
+        return result;
+    }
+
+    // the vector sums add in another order, so allow for rounding
+    void expectSame(const BookAnalytics &actual, const BookAnalytics &expected)
+    {
+        const double TOLERANCE = 1e-9;
+        EXPECT_DOUBLE_EQ(actual.bestBid, expected.bestBid);
+        EXPECT_DOUBLE_EQ(actual.bestAsk, expected.bestAsk);
+        EXPECT_DOUBLE_EQ(actual.mid, expected.mid);
+        EXPECT_DOUBLE_EQ(actual.spread, expected.spread);
+        EXPECT_DOUBLE_EQ(actual.spreadBps, expected.spreadBps);
+        EXPECT_DOUBLE_EQ(actual.microprice, expected.microprice);
+        EXPECT_NEAR(actual.imbalance, expected.imbalance, TOLERANCE);
+        EXPECT_NEAR(actual.bidDepth, expected.bidDepth, TOLERANCE);
+        EXPECT_NEAR(actual.askDepth, expected.askDepth, TOLERANCE);
+        EXPECT_NEAR(actual.vwapBuy, expected.vwapBuy, TOLERANCE);
+        EXPECT_NEAR(actual.vwapSell, expected.vwapSell, TOLERANCE);
+    }
+}
+
+TEST(ComputeAnalytics, MatchesTheScalarDefinitionsAtEveryDepth)
+{
+    AnalyticsConfig config;
+    config.depthBandBps = 250.0; // a few levels inside the band, the rest outside
+    unsigned seed = 1;
+    for (size_t bids : DEPTHS)
+    {
+        for (size_t asks : {size_t(1), size_t(3), size_t(8), size_t(13)})
+        {
+            SoaBook book = randomBook(bids, asks, seed++);
+            // a fill inside the first level, one that crosses a vector and one deeper than the book
+            for (double fillSize : {0.01, 4.5, 1000.0})
+            {
+                for (size_t levels : {size_t(1), size_t(5), size_t(10)})
+                {
+                    SCOPED_TRACE(testing::Message() << bids << " bids, " << asks << " asks, fill " << fillSize << ", " << levels << " levels");
+                    config.fillSize = fillSize;
+                    config.imbalanceLevels = levels;
+                    expectSame(UtilityNamespace::computeAnalytics(book, config), scalarAnalytics(book, config));
+                }
+            }
+        }
+    }
+}
+
+TEST(ComputeAnalytics, EmptySideLeavesEverythingZero)
+{
+    for (SoaBook book : {randomBook(0, 0, 1), randomBook(7, 0, 2), randomBook(0, 9, 3)})
+    {
+        BookAnalytics result = UtilityNamespace::computeAnalytics(book);
+        EXPECT_EQ(result.bestBid, 0.0);
+        EXPECT_EQ(result.bestAsk, 0.0);
+        EXPECT_EQ(result.mid, 0.0);
+        EXPECT_EQ(result.spreadBps, 0.0);
+        EXPECT_EQ(result.microprice, 0.0);
+        EXPECT_EQ(result.imbalance, 0.0);
+        EXPECT_EQ(result.bidDepth, 0.0);
+        EXPECT_EQ(result.askDepth, 0.0);
+        EXPECT_EQ(result.vwapBuy, 0.0);
+        EXPECT_EQ(result.vwapSell, 0.0);
+    }
+}
+
+TEST(AnalyticsKernels, MatchScalarLoopsOnOddLengths)
+{
+    for (size_t count = 0; count <= 19; ++count)
+    {
+        SCOPED_TRACE(testing::Message() << count << " levels");
+        SoaBook book = randomBook(count, 0, static_cast<unsigned>(count + 100));
+        const double *prices = book.bidPrices.data(), *sizes = book.bidSizes.data();
+
+        double total = 0.0, banded = 0.0;
+        for (size_t i = 0; i < count; ++i)
+        {
+            total += sizes[i];
+            if (prices[i] >= 97.0 && prices[i] <= 99.0)
+                banded += sizes[i];
+        }
+        EXPECT_NEAR(UtilityNamespace::sumSizes(sizes, count), total, 1e-12);
+        EXPECT_NEAR(UtilityNamespace::sumWithinBand(prices, sizes, count, 97.0, 99.0), banded, 1e-12);
+
+        std::vector<double> cumulative(count);
+        UtilityNamespace::cumulativeDepth(sizes, count, cumulative.data());
+        double running = 0.0;
+        for (size_t i = 0; i < count; ++i)
+        {
+            running += sizes[i];
+            EXPECT_DOUBLE_EQ(cumulative[i], running);
+        }
+
+        // every prefix size, so the fill ends inside each vector and on each boundary
+        running = 0.0;
+        for (size_t i = 0; i < count; ++i)
+        {
+            running += sizes[i];
+            EXPECT_NEAR(UtilityNamespace::vwapToFill(prices, sizes, count, running), scalarVwap(book.bidPrices, book.bidSizes, running), 1e-9);
+            EXPECT_NEAR(UtilityNamespace::vwapToFill(prices, sizes, count, running - sizes[i] / 2), scalarVwap(book.bidPrices, book.bidSizes, running - sizes[i] / 2), 1e-9);
+        }
+        EXPECT_EQ(UtilityNamespace::vwapToFill(prices, sizes, count, total + 1.0), 0.0);
+        EXPECT_EQ(UtilityNamespace::vwapToFill(prices, sizes, count, 0.0), 0.0);
+    }
+}
@@ -0,0 +1,79 @@
+#include "clock_sync.hpp"
+#include "feed_decoder.hpp"
+#include <gtest/gtest.h>
+#include <nlohmann/json.hpp>
+#include <string>
+
+TEST(FindLatencyStamps, ReadsTheServerStampsWithoutAParse)
+{
+    std::string frame = R"({"type":"update","symbol":"BTC-PERPETUAL","seq":2,"bids":[[99.5,0]],"asks":[[100.5,4.0]],"recv_ns":1700000000123,"send_ns":1700000000456,"timestamp":6})";
+    int64_t upstreamNs = 0, sentNs = 0;
+    ASSERT_TRUE(UtilityNamespace::findLatencyStamps(frame, upstreamNs, sentNs));
+    EXPECT_EQ(upstreamNs, 1700000000123);
+    EXPECT_EQ(sentNs, 1700000000456);
+
+    // the same stamps the book thread decodes
+    simdjson::ondemand::parser parser;
+    FeedFrame decoded;
+    UtilityNamespace::decodeFeedFrame(parser, frame, decoded);
+    EXPECT_EQ(decoded.upstreamNs, upstreamNs);
+    EXPECT_EQ(decoded.sentNs, sentNs);
+}
+
+TEST(FindLatencyStamps, FalseUnlessBothArePresent)
+{
+    int64_t upstreamNs = 0, sentNs = 0;
+    EXPECT_FALSE(UtilityNamespace::findLatencyStamps(R"({"type":"error","message":"Unknown symbol"})", upstreamNs, sentNs));
+    EXPECT_FALSE(UtilityNamespace::findLatencyStamps(R"({"type":"update","recv_ns":1})", upstreamNs, sentNs));
+    EXPECT_FALSE(UtilityNamespace::findLatencyStamps(R"({"type":"update","send_ns":2})", upstreamNs, sentNs));
+    EXPECT_FALSE(UtilityNamespace::findLatencyStamps(R"({"type":"update","recv_ns":"1","send_ns":2})", upstreamNs, sentNs));
+}
+
+TEST(PingTimestamp, AcceptsOnlyAnIntegerT0)
+{
+    int64_t t0 = 0;
+    EXPECT_TRUE(UtilityNamespace::readPingTimestamp(nlohmann::json::parse(R"({"action":"ping","t0":123456789012})"), t0));
+    EXPECT_EQ(t0, 123456789012);
+    EXPECT_TRUE(UtilityNamespace::readPingTimestamp(nlohmann::json::parse(R"({"action":"ping","t0":-5})"), t0));
+    EXPECT_EQ(t0, -5);
+
+    t0 = 7;
+    EXPECT_FALSE(UtilityNamespace::readPingTimestamp(nlohmann::json::parse(R"({"action":"ping"})"), t0));
+    EXPECT_FALSE(UtilityNamespace::readPingTimestamp(nlohmann::json::parse(R"({"action":"ping","t0":1.5})"), t0));
+    EXPECT_FALSE(UtilityNamespace::readPingTimestamp(nlohmann::json::parse(R"({"action":"ping","t0":"123"})"), t0));
+    EXPECT_FALSE(UtilityNamespace::readPingTimestamp(nlohmann::json::parse(R"({"action":"ping","t0":null})"), t0));
+    EXPECT_EQ(t0, 7);
+}
+
+// the server's clock runs 500 ns ahead, each way takes 100 ns and the server holds the ping 20 ns
+TEST(ClockSync, ReadsTheOffsetFromAPong)
+{
+    std::string pong = UtilityNamespace::encodePong(1000, 1600, 1620);
+    EXPECT_EQ(pong.compare(0, 14, "{\"type\":\"pong\""), 0);
+    simdjson::ondemand::parser parser;
+    FeedFrame frame;
+    UtilityNamespace::decodeFeedFrame(parser, pong, frame);
+    EXPECT_EQ(frame.type, FrameType::Pong);
+
+    nlohmann::json parsed = nlohmann::json::parse(pong);
+    ClockSync sync;
+    EXPECT_FALSE(sync.valid());
+    sync.onPong(parsed.at("t0").get<int64_t>(), parsed.at("t1").get<int64_t>(), parsed.at("t2").get<int64_t>(), 1220);
+    EXPECT_TRUE(sync.valid());
+    EXPECT_EQ(sync.roundTripNs(), 200);
+    EXPECT_EQ(sync.offsetNs(), 500);
+}
+
+TEST(ClockSync, KeepsTheOffsetOfTheFastestRoundTrip)
+{
+    ClockSync sync;
+    sync.onPong(1000, 1600, 1620, 1220);
+    // the pong queued 1000 ns on its way back, which skews that sample's offset by half of it
+    sync.onPong(2000, 2600, 2620, 3220);
+    EXPECT_EQ(sync.roundTripNs(), 1200);
+    EXPECT_EQ(sync.offsetNs(), 500);
+    // a faster exchange wins
+    sync.onPong(3000, 3550, 3560, 3060);
+    EXPECT_EQ(sync.roundTripNs(), 50);
+    EXPECT_EQ(sync.offsetNs(), 525);
+}
@@ -0,0 +1,201 @@
+#include "feed_subscriber.hpp"
+#include <websocketpp/config/asio_no_tls.hpp>
+#include <websocketpp/server.hpp>
+#include <gtest/gtest.h>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace std::chrono_literals;
+
+namespace
+{
+    // WebSocket server on a loopback port that records what clients send, numbered by connection,
+    // and sends or closes on the latest connection when told to
+    class LocalFeedServer
+    {
+    public:
+        using Server = websocketpp::server<websocketpp::config::asio>;
+
+        LocalFeedServer()
+        {
+            server.clear_access_channels(websocketpp::log::alevel::all);
+            server.clear_error_channels(websocketpp::log::elevel::all);
+            server.init_asio();
+            server.set_reuse_addr(true);
+            server.set_open_handler([this](websocketpp::connection_hdl hdl)
+                                    {
+                                        std::lock_guard<std::mutex> lock(mutex);
+                                        latest = hdl;
+                                        ++opened;
+                                        changed.notify_all(); });
+            server.set_message_handler([this](websocketpp::connection_hdl, Server::message_ptr msg)
+                                       {
+                                           std::lock_guard<std::mutex> lock(mutex);
+                                           received.push_back({opened, msg->get_payload()});
+                                           changed.notify_all(); });
+            server.listen(websocketpp::lib::asio::ip::tcp::v4(), 0);
+            websocketpp::lib::asio::error_code ec;
+            port = server.get_local_endpoint(ec).port();
+            server.start_accept();
+            worker = std::thread([this]()
+                                 { server.run(); });
+        }
+
+        ~LocalFeedServer()
+        {
+            server.stop();
+            worker.join();
+        }
+
+        std::string url() const { return "ws://127.0.0.1:" + std::to_string(port); }
+
+        void send(const std::string &frame)
+        {
+            server.get_io_service().post([this, frame]()
+                                         {
+                                             websocketpp::lib::error_code ec;
+                                             server.send(latest, frame, websocketpp::frame::opcode::text, ec); });
+        }
+
+        void close(websocketpp::close::status::value code)
+        {
+            server.get_io_service().post([this, code]()
+                                         {
+                                             websocketpp::lib::error_code ec;
+                                             server.close(latest, code, "", ec); });
+        }
+
+        // what arrived on the connectionth connection, counting from 1, once count messages have
+        bool waitForMessages(int connection, size_t count, std::vector<std::string> &messages, std::chrono::milliseconds timeout = 5000ms)
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            bool arrived = changed.wait_for(lock, timeout, [&]()
+                                            { return on(connection).size() >= count; });
+            messages = on(connection);
+            return arrived;
+        }
+
+        // blocks until message arrives on any connection
+        bool waitForMessage(const std::string &message, std::chrono::milliseconds timeout = 5000ms)
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            return changed.wait_for(lock, timeout, [&]()
+                                    {
+                                        for (const auto &entry : received)
+                                        {
+                                            if (entry.second == message)
+                                                return true;
+                                        }
+                                        return false; });
+        }
+
+    private:
+        std::vector<std::string> on(int connection) const
+        {
+            std::vector<std::string> messages;
+            for (const auto &entry : received)
+            {
+                if (entry.first == connection)
+                    messages.push_back(entry.second);
+            }
+            return messages;
+        }
+
+        Server server;
+        uint16_t port = 0;
+        std::thread worker;
+        std::mutex mutex;
+        std::condition_variable changed;
+        websocketpp::connection_hdl latest;                  // server thread only
+        int opened = 0;                                      // guarded by mutex
+        std::vector<std::pair<int, std::string>> received; // guarded by mutex
+    };
+
+    FeedSubscriberOptions localOptions(const LocalFeedServer &server, std::chrono::milliseconds reconnectDelay)
+    {
+        FeedSubscriberOptions options;
+        options.endpoints = {server.url()};
+        options.reconnect.initialDelay = reconnectDelay;
+        options.reconnect.maxDelay = reconnectDelay;
+        options.reconnect.jitter = 0.0;
+        return options;
+    }
+
+    std::string bookFrame(const char *type, uint64_t seq)
+    {
+        return std::string("{\"type\":\"") + type + "\",\"symbol\":\"BTC-PERPETUAL\",\"seq\":" + std::to_string(seq) +
+               ",\"bids\":[[100.0," + std::to_string(seq) + ".0]],\"asks\":[[101.0,1.0]]}";
+    }
+}
+
+// subscriptions made before start() and everything subscribed so far go out again on every open
+TEST(FeedSubscriber, ResubscribesOnEveryOpen)
+{
+    LocalFeedServer server;
+    FeedSubscriber subscriber(localOptions(server, 10ms));
+    StreamOptions depth;
+    depth.depth = 5;
+    subscriber.subscribe("BTC-PERPETUAL", nullptr, depth);
+    subscriber.subscribeAnalytics("ETH-PERPETUAL", nullptr);
+    subscriber.start();
+
+    std::vector<std::string> first, second;
+    ASSERT_TRUE(server.waitForMessages(1, 2, first));
+    EXPECT_EQ(first, (std::vector<std::string>{UtilityNamespace::encodeSubscribe("BTC-PERPETUAL", depth),
+                                               "{\"action\":\"subscribe_analytics\",\"symbol\":\"ETH-PERPETUAL\"}"}));
+
+    server.close(websocketpp::close::status::normal);
+    ASSERT_TRUE(server.waitForMessages(2, 2, second));
+    EXPECT_EQ(second, first);
+    EXPECT_GE(subscriber.reconnects(), 1u);
+    subscriber.stop();
+}
+
+// a gap asks for a replay from the first missing seq; a replay that never comes turns into a snapshot request
+TEST(FeedSubscriber, GapAsksForAReplayThenASnapshot)
+{
+    LocalFeedServer server;
+    FeedSubscriber subscriber(localOptions(server, 10ms));
+    std::atomic<int> applied{0};
+    subscriber.subscribe("BTC-PERPETUAL", [&applied](const BookEvent &)
+                         { ++applied; });
+    subscriber.start();
+    std::vector<std::string> messages;
+    ASSERT_TRUE(server.waitForMessages(1, 1, messages));
+
+    server.send(bookFrame("snapshot", 1));
+    server.send(bookFrame("update", 2));
+    server.send(bookFrame("update", 4));
+    ASSERT_TRUE(server.waitForMessage("{\"action\":\"replay\",\"symbol\":\"BTC-PERPETUAL\",\"from_seq\":3}"));
+    EXPECT_EQ(subscriber.gaps(), 1u);
+    EXPECT_EQ(applied.load(), 2);
+
+    for (uint64_t seq = 5; seq < 5 + FeedSequencer::DEFAULT_RECOVERY_LIMIT; ++seq)
+        server.send(bookFrame("update", seq));
+    ASSERT_TRUE(server.waitForMessage("{\"action\":\"snapshot\",\"symbol\":\"BTC-PERPETUAL\"}"));
+    EXPECT_EQ(subscriber.gaps(), 1u);
+    EXPECT_EQ(applied.load(), 2);
+    subscriber.stop();
+}
+
+// a draining server's successor listens on the same endpoint, so going_away skips the backoff
+TEST(FeedSubscriber, GoingAwayReconnectsAtOnce)
+{
+    LocalFeedServer server;
+    FeedSubscriber subscriber(localOptions(server, 60000ms));
+    subscriber.subscribe("BTC-PERPETUAL", nullptr);
+    subscriber.start();
+    std::vector<std::string> messages;
+    ASSERT_TRUE(server.waitForMessages(1, 1, messages));
+
+    server.close(websocketpp::close::status::going_away);
+    ASSERT_TRUE(server.waitForMessages(2, 1, messages, 5000ms));
+    EXPECT_EQ(messages, (std::vector<std::string>{UtilityNamespace::encodeSubscribe("BTC-PERPETUAL")}));
+    EXPECT_EQ(subscriber.reconnects(), 1u);
+    subscriber.stop();
+}
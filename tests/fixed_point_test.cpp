@@ -0,0 +1,152 @@
+#include "fixed_point.hpp"
+#include <gtest/gtest.h>
+#include <cstdint>
+#include <limits>
+#include <string>
+
+namespace
+{
+    std::string format(int64_t units, int decimals)
+    {
+        char buffer[UtilityNamespace::DECIMAL_TEXT_MAX];
+        return std::string(buffer, UtilityNamespace::formatDecimal(buffer, units, decimals));
+    }
+
+    bool parses(const char *text, int decimals, int64_t expected)
+    {
+        int64_t units = 12345;
+        return UtilityNamespace::parseDecimal(text, decimals, units) && units == expected;
+    }
+
+    bool rejected(const char *text, int decimals)
+    {
+        int64_t units;
+        return !UtilityNamespace::parseDecimal(text, decimals, units);
+    }
+}
+
+TEST(ParseDecimal, ReadsExactText)
+{
+    EXPECT_TRUE(parses("64000.5", 1, 640005));
+    EXPECT_TRUE(parses("64000.5", 4, 640005000));
+    EXPECT_TRUE(parses("-0.0005", 4, -5));
+    EXPECT_TRUE(parses("+1.", 0, 1));
+    EXPECT_TRUE(parses(".25", 2, 25));
+    EXPECT_TRUE(parses("0012.500", 1, 125));
+    EXPECT_TRUE(parses("5e-4", 4, 5));
+    EXPECT_TRUE(parses("1.5E3", 0, 1500));
+    EXPECT_TRUE(parses("-0", 2, 0));
+    EXPECT_TRUE(parses("0e99999", 18, 0));
+    EXPECT_TRUE(parses("100e-2", 0, 1));
+}
+
+TEST(ParseDecimal, RejectsWhatItWouldHaveToRound)
+{
+    EXPECT_TRUE(rejected("64000.55", 1));
+    EXPECT_TRUE(rejected("5e-4", 3));
+    EXPECT_TRUE(rejected("1e-99999", 18));
+}
+
+TEST(ParseDecimal, RejectsMalformedText)
+{
+    for (const char *text : {"", "-", ".", "e5", "1e", "1e+", "+-1", "1.2.3", "1 ", " 1", "0x10", "1,5", "nan"})
+        EXPECT_TRUE(rejected(text, 2)) << '"' << text << '"';
+    EXPECT_TRUE(rejected("1", -1));
+    EXPECT_TRUE(rejected("1", UtilityNamespace::MAX_DECIMALS + 1));
+}
+
+TEST(ParseDecimal, RejectsWhatDoesNotFit)
+{
+    EXPECT_TRUE(parses("9223372036854775807", 0, std::numeric_limits<int64_t>::max()));
+    EXPECT_TRUE(parses("-9223372036854775807", 0, -std::numeric_limits<int64_t>::max()));
+    EXPECT_TRUE(rejected("9223372036854775808", 0));
+    EXPECT_TRUE(rejected("9.223372036854775808", 18));
+    EXPECT_TRUE(rejected("1e19", 0));
+    EXPECT_TRUE(rejected("1", 19));
+    // too many digits for the mantissa, including ones that would wrap around a 64 bit integer
+    EXPECT_TRUE(rejected("18446744073709551615", 0));
+    EXPECT_TRUE(rejected("18446744073709551619", 0));
+    EXPECT_TRUE(rejected("184467440737095516190", 0));
+    EXPECT_TRUE(rejected("1.8446744073709551619", 18));
+}
+
+TEST(DecimalPlaces, CountsTheFewestThatHoldTheText)
+{
+    int decimals = -1;
+    EXPECT_TRUE(UtilityNamespace::decimalPlaces("0.05", decimals));
+    EXPECT_EQ(decimals, 2);
+    EXPECT_TRUE(UtilityNamespace::decimalPlaces("2.500", decimals));
+    EXPECT_EQ(decimals, 1);
+    EXPECT_TRUE(UtilityNamespace::decimalPlaces("1500", decimals));
+    EXPECT_EQ(decimals, 0);
+    EXPECT_TRUE(UtilityNamespace::decimalPlaces("5e-4", decimals));
+    EXPECT_EQ(decimals, 4);
+    EXPECT_FALSE(UtilityNamespace::decimalPlaces("1e-19", decimals));
+    EXPECT_FALSE(UtilityNamespace::decimalPlaces("18446744073709551619", decimals));
+}
+
+TEST(FormatDecimal, WritesTheShortestExactText)
+{
+    EXPECT_EQ(format(640005, 1), "64000.5");
+    EXPECT_EQ(format(640000, 1), "64000");
+    EXPECT_EQ(format(-5, 4), "-0.0005");
+    EXPECT_EQ(format(0, 0), "0");
+    EXPECT_EQ(format(0, 8), "0");
+    EXPECT_EQ(format(1, 18), "0.000000000000000001");
+    EXPECT_EQ(format(100, 2), "1");
+    EXPECT_EQ(format(1200, 0), "1200");
+    EXPECT_EQ(format(std::numeric_limits<int64_t>::max(), 0), "9223372036854775807");
+    EXPECT_EQ(format(std::numeric_limits<int64_t>::min(), 0), "-9223372036854775808");
+    EXPECT_EQ(format(std::numeric_limits<int64_t>::min(), 18), "-9.223372036854775808");
+}
+
+TEST(FormatDecimal, RoundTripsThroughParse)
+{
+    for (int64_t units : {int64_t(1), int64_t(-1), int64_t(10), int64_t(123456789), int64_t(-1000000007), std::numeric_limits<int64_t>::max()})
+    {
+        for (int decimals = 0; decimals <= UtilityNamespace::MAX_DECIMALS; ++decimals)
+        {
+            int64_t parsed = 0;
+            ASSERT_TRUE(UtilityNamespace::parseDecimal(format(units, decimals), decimals, parsed)) << units << " " << decimals;
+            EXPECT_EQ(parsed, units);
+        }
+    }
+}
+
+TEST(AppendDecimal, AppendsToTheString)
+{
+    std::string out = "price=";
+    UtilityNamespace::appendDecimal(out, -25, 1);
+    EXPECT_EQ(out, "price=-2.5");
+}
+
+TEST(RoundToStep, RoundsBothWays)
+{
+    using UtilityNamespace::roundToStep;
+    EXPECT_EQ(roundToStep(12, 5, Rounding::Down), 10);
+    EXPECT_EQ(roundToStep(12, 5, Rounding::Up), 15);
+    EXPECT_EQ(roundToStep(12, 5, Rounding::Nearest), 10);
+    EXPECT_EQ(roundToStep(15, 5, Rounding::Up), 15);
+    // halves round up, towards +infinity for negative values too
+    EXPECT_EQ(roundToStep(5, 10, Rounding::Nearest), 10);
+    EXPECT_EQ(roundToStep(-5, 10, Rounding::Nearest), 0);
+    EXPECT_EQ(roundToStep(-6, 10, Rounding::Nearest), -10);
+    EXPECT_EQ(roundToStep(-12, 5, Rounding::Down), -15);
+    EXPECT_EQ(roundToStep(-12, 5, Rounding::Up), -10);
+    EXPECT_EQ(roundToStep(-15, 5, Rounding::Down), -15);
+    EXPECT_EQ(roundToStep(7, 1, Rounding::Up), 7);
+}
+
+TEST(RoundToStep, HandlesStepsNearTheLimit)
+{
+    using UtilityNamespace::roundToStep;
+    constexpr int64_t MAX = std::numeric_limits<int64_t>::max();
+    constexpr int64_t step = MAX - 1; // twice the remainder would not fit
+    EXPECT_EQ(roundToStep(step - 1, step, Rounding::Nearest), step);
+    EXPECT_EQ(roundToStep(step / 2, step, Rounding::Nearest), step);
+    EXPECT_EQ(roundToStep(step / 2 - 1, step, Rounding::Nearest), 0);
+    EXPECT_EQ(roundToStep(MAX, MAX, Rounding::Nearest), MAX);
+    EXPECT_EQ(roundToStep(MAX - 1, 2, Rounding::Down), MAX - 1);
+    EXPECT_EQ(roundToStep(std::numeric_limits<int64_t>::min(), 2, Rounding::Up), std::numeric_limits<int64_t>::min());
+    static_assert(roundToStep(-7, 2, Rounding::Nearest) == -6);
+}
@@ -0,0 +1,103 @@
+#include "heartbeat.hpp"
+#include <gtest/gtest.h>
+#include <chrono>
+
+using namespace std::chrono_literals;
+
+namespace
+{
+    ReconnectBackoff backoff(std::chrono::milliseconds initial, std::chrono::milliseconds max, double jitter)
+    {
+        ReconnectOptions options;
+        options.initialDelay = initial;
+        options.maxDelay = max;
+        options.jitter = jitter;
+        return ReconnectBackoff(options);
+    }
+
+    constexpr int64_t MS = 1000000;
+}
+
+TEST(ReconnectBackoff, DoublesUpToTheCap)
+{
+    ReconnectBackoff delays = backoff(100ms, 1000ms, 0.0);
+    EXPECT_EQ(delays.next(), 100ms);
+    EXPECT_EQ(delays.next(), 200ms);
+    EXPECT_EQ(delays.next(), 400ms);
+    EXPECT_EQ(delays.next(), 800ms);
+    EXPECT_EQ(delays.next(), 1000ms);
+    EXPECT_EQ(delays.next(), 1000ms);
+}
+
+TEST(ReconnectBackoff, ResetStartsOver)
+{
+    ReconnectBackoff delays = backoff(50ms, 5000ms, 0.0);
+    delays.next();
+    delays.next();
+    delays.next();
+    delays.reset();
+    EXPECT_EQ(delays.next(), 50ms);
+    EXPECT_EQ(delays.next(), 100ms);
+}
+
+// jitter takes up to that fraction off each delay, never adds to it
+TEST(ReconnectBackoff, JitterStaysWithinItsFraction)
+{
+    ReconnectBackoff delays = backoff(1000ms, 1000ms, 0.25);
+    bool varied = false;
+    std::chrono::milliseconds first = delays.next();
+    for (int attempt = 0; attempt < 200; ++attempt)
+    {
+        std::chrono::milliseconds delay = delays.next();
+        EXPECT_GE(delay, 750ms);
+        EXPECT_LE(delay, 1000ms);
+        varied = varied || delay != first;
+    }
+    EXPECT_TRUE(varied);
+}
+
+TEST(ReconnectBackoff, JitterIsClampedToTheWholeDelay)
+{
+    ReconnectBackoff above = backoff(100ms, 100ms, 3.0);
+    ReconnectBackoff below = backoff(100ms, 100ms, -1.0);
+    for (int attempt = 0; attempt < 100; ++attempt)
+    {
+        std::chrono::milliseconds delay = above.next();
+        EXPECT_GE(delay, 0ms);
+        EXPECT_LE(delay, 100ms);
+        EXPECT_EQ(below.next(), 100ms);
+    }
+}
+
+TEST(HeartbeatMonitor, ExpiresOnlyAfterTheTimeout)
+{
+    HeartbeatOptions options;
+    options.interval = 1000ms;
+    options.timeout = 5000ms;
+    HeartbeatMonitor heartbeat(options);
+    heartbeat.onReceive(10000 * MS);
+    EXPECT_FALSE(heartbeat.expired(10000 * MS));
+    EXPECT_FALSE(heartbeat.expired(15000 * MS));
+    EXPECT_TRUE(heartbeat.expired(15000 * MS + 1));
+    // any frame pushes the deadline out
+    heartbeat.onReceive(14000 * MS);
+    EXPECT_FALSE(heartbeat.expired(18000 * MS));
+    EXPECT_TRUE(heartbeat.expired(19001 * MS));
+}
+
+TEST(HeartbeatMonitor, NeverExpiresWhenTurnedOff)
+{
+    HeartbeatOptions noPings;
+    noPings.interval = 0ms;
+    HeartbeatMonitor off(noPings);
+    off.onReceive(0);
+    EXPECT_FALSE(off.enabled());
+    EXPECT_FALSE(off.expired(3600000 * MS));
+
+    HeartbeatOptions noTimeout;
+    noTimeout.timeout = 0ms;
+    HeartbeatMonitor pingsOnly(noTimeout);
+    pingsOnly.onReceive(0);
+    EXPECT_TRUE(pingsOnly.enabled());
+    EXPECT_FALSE(pingsOnly.expired(3600000 * MS));
+}
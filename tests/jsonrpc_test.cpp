@@ -0,0 +1,84 @@
+#include "jsonrpc.hpp"
+#include <gtest/gtest.h>
+#include <nlohmann/json.hpp>
+#include <limits>
+#include <string>
+
+namespace
+{
+    nlohmann::json parse(const std::pmr::string &text)
+    {
+        return nlohmann::json::parse(text.begin(), text.end());
+    }
+}
+
+TEST(Jsonrpc, EscapesStrings)
+{
+    std::string out;
+    UtilityNamespace::appendJsonString(out, std::string_view("a\"b\\c\nd\te\x01", 10));
+    EXPECT_EQ(out, "\"a\\\"b\\\\c\\nd\\te\\u0001\"");
+    EXPECT_EQ(nlohmann::json::parse(out).get<std::string>(), std::string("a\"b\\c\nd\te\x01", 10));
+}
+
+TEST(Jsonrpc, NumbersRoundTrip)
+{
+    for (double value : {0.0, -0.5, 64000.5, 0.1, 1e-8, 123456789.125, std::numeric_limits<double>::max()})
+    {
+        std::string out;
+        UtilityNamespace::appendJsonNumber(out, value);
+        EXPECT_EQ(nlohmann::json::parse(out).get<double>(), value) << out;
+    }
+    // shortest digits, as nlohmann prints them
+    std::string out;
+    UtilityNamespace::appendJsonNumber(out, 0.1);
+    EXPECT_EQ(out, "0.1");
+}
+
+TEST(Jsonrpc, PlaceOrderParsesBack)
+{
+    std::pmr::string out;
+    UtilityNamespace::encodePlaceOrder(out, "buy", "BTC-\"PERP\"", 10.0, 64000.5, "limit");
+    nlohmann::json request = parse(out);
+    EXPECT_EQ(request["jsonrpc"], "2.0");
+    EXPECT_EQ(request["method"], "private/buy");
+    EXPECT_EQ(request["params"]["instrument_name"], "BTC-\"PERP\"");
+    EXPECT_EQ(request["params"]["amount"], 10.0);
+    EXPECT_EQ(request["params"]["price"], 64000.5);
+    EXPECT_EQ(request["params"]["type"], "limit");
+}
+
+TEST(Jsonrpc, CancelAndModifyParseBack)
+{
+    std::pmr::string cancel;
+    UtilityNamespace::encodeCancelOrder(cancel, "ETH-123\\4");
+    nlohmann::json request = parse(cancel);
+    EXPECT_EQ(request["method"], "private/cancel");
+    EXPECT_EQ(request["params"]["order_id"], "ETH-123\\4");
+
+    std::pmr::string edit;
+    UtilityNamespace::encodeModifyOrder(edit, "ETH-1", 2.5, 3100.25);
+    request = parse(edit);
+    EXPECT_EQ(request["method"], "private/edit");
+    EXPECT_EQ(request["params"]["amount"], 2.5);
+    EXPECT_EQ(request["params"]["price"], 3100.25);
+}
+
+// fixed-point numbers are written in the instrument's scale, exactly
+TEST(Jsonrpc, FixedPointOrdersParseBack)
+{
+    InstrumentSpec spec;
+    ASSERT_TRUE(UtilityNamespace::makeInstrumentSpec("BTC-PERPETUAL", "0.5", "10", {}, spec));
+    std::pmr::string out;
+    UtilityNamespace::encodePlaceOrder(out, "sell", spec, Quantity(120), Price(640005), "limit");
+    EXPECT_NE(out.find("\"amount\":120,"), std::pmr::string::npos);
+    EXPECT_NE(out.find("\"price\":64000.5}"), std::pmr::string::npos);
+    nlohmann::json request = parse(out);
+    EXPECT_EQ(request["method"], "private/sell");
+    EXPECT_EQ(request["params"]["price"], 64000.5);
+
+    std::pmr::string edit;
+    UtilityNamespace::encodeModifyOrder(edit, "BTC-9", spec, Quantity(10), Price(5));
+    request = parse(edit);
+    EXPECT_EQ(request["params"]["amount"], 10);
+    EXPECT_EQ(request["params"]["price"], 0.5);
+}
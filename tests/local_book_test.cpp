@@ -0,0 +1,87 @@
+#include "local_book.hpp"
+#include <gtest/gtest.h>
+#include <vector>
+
+TEST(FeedSequencer, IgnoresUpdatesBeforeTheSnapshot)
+{
+    FeedSequencer sequencer;
+    EXPECT_EQ(sequencer.onUpdate(1), FrameAction::Ignore);
+    EXPECT_FALSE(sequencer.synced());
+    sequencer.onSnapshot(10);
+    EXPECT_TRUE(sequencer.synced());
+    EXPECT_EQ(sequencer.expected(), 11u);
+    EXPECT_EQ(sequencer.onUpdate(11), FrameAction::Apply);
+    EXPECT_EQ(sequencer.onUpdate(12), FrameAction::Apply);
+}
+
+TEST(FeedSequencer, IgnoresStaleAndDuplicateUpdates)
+{
+    FeedSequencer sequencer;
+    sequencer.onSnapshot(10);
+    EXPECT_EQ(sequencer.onUpdate(10), FrameAction::Ignore); // already in the snapshot
+    EXPECT_EQ(sequencer.onUpdate(11), FrameAction::Apply);
+    EXPECT_EQ(sequencer.onUpdate(11), FrameAction::Ignore);
+    EXPECT_EQ(sequencer.onUpdate(5), FrameAction::Ignore);
+    EXPECT_EQ(sequencer.expected(), 12u);
+    EXPECT_EQ(sequencer.gaps(), 0u);
+}
+
+// one replay per gap; the replayed frames close it and the stream carries on
+TEST(FeedSequencer, GapRecoversOnReplay)
+{
+    FeedSequencer sequencer;
+    sequencer.onSnapshot(1);
+    EXPECT_EQ(sequencer.onUpdate(4), FrameAction::Recover);
+    EXPECT_EQ(sequencer.expected(), 2u);
+    EXPECT_FALSE(sequencer.synced());
+    EXPECT_EQ(sequencer.onUpdate(5), FrameAction::Ignore);
+    EXPECT_EQ(sequencer.onUpdate(2), FrameAction::Apply);
+    EXPECT_TRUE(sequencer.synced());
+    EXPECT_EQ(sequencer.onUpdate(3), FrameAction::Apply);
+    EXPECT_EQ(sequencer.onUpdate(4), FrameAction::Apply);
+    EXPECT_EQ(sequencer.gaps(), 1u);
+}
+
+// a replay that never arrives turns into a snapshot request, repeated until one does
+TEST(FeedSequencer, StalledRecoveryFallsBackToASnapshot)
+{
+    FeedSequencer sequencer(3);
+    sequencer.onSnapshot(1);
+    EXPECT_EQ(sequencer.onUpdate(5), FrameAction::Recover);
+    EXPECT_EQ(sequencer.onUpdate(6), FrameAction::Ignore);
+    EXPECT_EQ(sequencer.onUpdate(7), FrameAction::Ignore);
+    EXPECT_EQ(sequencer.onUpdate(8), FrameAction::Resync);
+    EXPECT_EQ(sequencer.onUpdate(9), FrameAction::Ignore);
+    EXPECT_EQ(sequencer.onUpdate(10), FrameAction::Ignore);
+    EXPECT_EQ(sequencer.onUpdate(11), FrameAction::Resync);
+    EXPECT_EQ(sequencer.resyncs(), 2u);
+
+    sequencer.onSnapshot(11);
+    EXPECT_TRUE(sequencer.synced());
+    EXPECT_EQ(sequencer.onUpdate(12), FrameAction::Apply);
+    // a later gap gets its own replay first
+    EXPECT_EQ(sequencer.onUpdate(14), FrameAction::Recover);
+    EXPECT_EQ(sequencer.gaps(), 2u);
+}
+
+TEST(SymbolFeed, SnapshotReplacesAndUpdatesPatchTheBook)
+{
+    SymbolFeed feed;
+    EXPECT_EQ(feed.onFrame(true, 1, {{100.0, 1.0}, {99.0, 2.0}}, {{101.0, 3.0}}), FrameAction::Apply);
+    EXPECT_EQ(feed.onFrame(false, 2, {{99.0, 0.0}, {99.5, 4.0}}, {{100.5, 1.0}}), FrameAction::Apply);
+    std::vector<BookLevel> bids, asks;
+    feed.book.copyLevels(bids, asks);
+    ASSERT_EQ(bids.size(), 2u);
+    EXPECT_EQ(bids[0].price, 100.0);
+    EXPECT_EQ(bids[1].price, 99.5);
+    EXPECT_EQ(bids[1].amount, 4.0);
+    ASSERT_EQ(asks.size(), 2u);
+    EXPECT_EQ(asks[0].price, 100.5);
+
+    // out of sequence levels are not applied
+    EXPECT_EQ(feed.onFrame(false, 4, {{98.0, 1.0}}, {}), FrameAction::Recover);
+    EXPECT_EQ(feed.book.bids.count(98.0), 0u);
+    EXPECT_EQ(feed.onFrame(true, 4, {{98.0, 1.0}}, {}), FrameAction::Apply);
+    EXPECT_EQ(feed.book.bids.size(), 1u);
+    EXPECT_TRUE(feed.book.asks.empty());
+}
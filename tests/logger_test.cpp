@@ -0,0 +1,134 @@
+#include "logger.hpp"
+#include "metrics.hpp"
+#include <gtest/gtest.h>
+#include <cstdlib>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace
+{
+    // what a sink logger wrote, each line without its time and level
+    struct Captured
+    {
+        std::vector<std::string> out, err;
+    };
+
+    LogSink capture(Captured &captured)
+    {
+        return [&captured](const std::string &out, const std::string &err)
+        {
+            auto split = [](const std::string &text, std::vector<std::string> &lines)
+            {
+                size_t start = 0, end;
+                while ((end = text.find('\n', start)) != std::string::npos)
+                {
+                    std::string line = text.substr(start, end - start);
+                    // "14:03:27.512034 INFO  text", the level padded to five
+                    lines.push_back(line.size() > 22 && line[15] == ' ' ? line.substr(22) : line);
+                    start = end + 1;
+                }
+            };
+            split(out, captured.out);
+            split(err, captured.err);
+        };
+    }
+
+    // the ring of the thread that logs belongs to the first logger it writes to, so each batch gets a thread
+    template <class F>
+    void onNewThread(F &&f)
+    {
+        std::thread(std::forward<F>(f)).join();
+    }
+}
+
+TEST(Logger, WritesNothingBeforeAFlush)
+{
+    Captured captured;
+    Logger logger(capture(captured));
+    onNewThread([&]()
+                { logger.write(LogLevel::Info, "held {}", 1); });
+    EXPECT_TRUE(captured.out.empty());
+    logger.flush();
+    EXPECT_EQ(captured.out, std::vector<std::string>{"held 1"});
+}
+
+TEST(Logger, FormatsEveryArgumentKindAndSplitsByLevel)
+{
+    Captured captured;
+    Logger logger(capture(captured));
+    onNewThread([&]()
+                {
+                    std::string symbol = "BTC-PERPETUAL";
+                    logger.write(LogLevel::Debug, "{} {} {} {}", -3, uint64_t{18446744073709551615u}, 1.5, true);
+                    logger.write(LogLevel::Info, "{}{}{}", 'x', symbol, "!");
+                    logger.write(LogLevel::Warn, "spare {} {}", 7);
+                    logger.write(LogLevel::Error, "long {}", std::string(LogArgs::MAX_STRING + 1, 'a')); });
+    logger.flush();
+    EXPECT_EQ(captured.out, (std::vector<std::string>{"-3 18446744073709551615 1.5 true", "xBTC-PERPETUAL!"}));
+    ASSERT_EQ(captured.err.size(), 2u);
+    EXPECT_EQ(captured.err[0], "spare 7 {}");
+    EXPECT_EQ(captured.err[1], "long " + std::string(LogArgs::MAX_STRING, 'a') + "...");
+}
+
+// a thread's records keep their order, and the threads' records are merged by time
+TEST(Logger, KeepsTimeOrderWithinAndAcrossThreads)
+{
+    Captured captured;
+    Logger logger(capture(captured));
+    std::vector<std::string> expected;
+    for (int batch = 0; batch < 3; ++batch)
+    {
+        onNewThread([&logger, batch]()
+                    {
+                        for (int i = 0; i < 100; ++i)
+                            logger.write(LogLevel::Info, "record {}", batch * 100 + i); });
+        for (int i = 0; i < 100; ++i)
+            expected.push_back("record " + std::to_string(batch * 100 + i));
+    }
+    logger.flush();
+    EXPECT_EQ(captured.out, expected);
+}
+
+// a full ring drops the newest records and says how many; drained, it takes records again
+TEST(Logger, DropsAndCountsRecordsThatDoNotFit)
+{
+    Captured captured;
+    Counter &dropped = UtilityNamespace::metrics().counter("oems_log_dropped_total", "Log records dropped because the thread's ring was full");
+    const uint64_t droppedBefore = dropped.value();
+    // 24 header bytes and a 9 byte argument round up to 40, so 256 bytes hold six records
+    Logger logger(capture(captured), 256);
+    onNewThread([&]()
+                {
+                    for (int i = 0; i < 10; ++i)
+                        logger.write(LogLevel::Info, "record {}", i);
+                    logger.flush();
+                    logger.write(LogLevel::Info, "after {}", 10); });
+    logger.flush();
+    EXPECT_EQ(captured.out, (std::vector<std::string>{"record 0", "record 1", "record 2", "record 3", "record 4", "record 5", "after 10"}));
+    EXPECT_EQ(captured.err, std::vector<std::string>{"Logger dropped 4 records, a thread's ring was full"});
+    EXPECT_EQ(dropped.value() - droppedBefore, 4u);
+}
+
+TEST(Logger, DestructionWritesWhatIsLeft)
+{
+    Captured captured;
+    {
+        Logger logger(capture(captured));
+        onNewThread([&]()
+                    { logger.write(LogLevel::Error, "last words"); });
+    }
+    EXPECT_EQ(captured.err, std::vector<std::string>{"last words"});
+}
+
+// the forked child has no logger thread, so only the exit handler can write the record
+TEST(LoggerDeathTest, ExitFlushesTheProcessLogger)
+{
+    UtilityNamespace::logger().flush();
+    EXPECT_EXIT(
+        {
+            OEMS_LOG_ERROR("written at exit {}", 42);
+            std::exit(3);
+        },
+        testing::ExitedWithCode(3), "ERROR written at exit 42");
+}
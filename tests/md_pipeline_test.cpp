@@ -0,0 +1,117 @@
+#include "md_pipeline.hpp"
+#include "order_manager.hpp"
+#include "simulated_venue.hpp"
+#include <gtest/gtest.h>
+#include <string>
+#include <vector>
+
+namespace
+{
+    const char *SNAPSHOT = "{\"type\":\"snapshot\",\"symbol\":\"BTC-PERPETUAL\",\"seq\":5,\"bids\":[[99.0,1.0]],\"asks\":[[101.0,2.0]]}";
+}
+
+// frames in, one order out: the trigger fires when the ask reaches the limit and only once
+TEST(MarketDataPipeline, TriggerPlacesOneOrder)
+{
+    SimulatedVenue venue;
+    OrderManager manager(venue);
+    MarketDataPipeline pipeline(manager, UtilityNamespace::triggerStrategy("BTC-PERPETUAL", "buy", 1.0, 100.0), 16);
+    std::vector<std::string> responses; // order thread until stop()
+    pipeline.setOrderCallback([&responses](const OrderIntent &intent, const std::string &response, int64_t tickToOrderNs)
+                              {
+                                  EXPECT_EQ(intent.price, 100.0);
+                                  EXPECT_GE(tickToOrderNs, 0);
+                                  responses.push_back(response); });
+    pipeline.start();
+    ASSERT_TRUE(pipeline.submit(SNAPSHOT));
+    ASSERT_TRUE(pipeline.submit("{\"type\":\"update\",\"symbol\":\"BTC-PERPETUAL\",\"seq\":6,\"bids\":[],\"asks\":[[99.5,1.0]]}"));
+    ASSERT_TRUE(pipeline.submit("{\"type\":\"update\",\"symbol\":\"BTC-PERPETUAL\",\"seq\":7,\"bids\":[],\"asks\":[[99.0,1.0]]}"));
+    pipeline.stop();
+
+    ASSERT_EQ(responses.size(), 1u);
+    EXPECT_NE(responses[0].find("\"order_id\""), std::string::npos);
+    EXPECT_EQ(venue.orders(), 1u);
+    EXPECT_EQ(pipeline.droppedMessages(), 0u);
+}
+
+// with the books fed to the venue, the trigger's order takes the ask it fired on
+TEST(MarketDataPipeline, SimulatedVenueFillsAgainstTheFeed)
+{
+    SimulatedVenue venue;
+    OrderManager manager(venue);
+    MarketDataPipeline pipeline(manager, UtilityNamespace::simulatedVenueFeed(venue, UtilityNamespace::triggerStrategy("BTC-PERPETUAL", "buy", 1.0, 100.0)), 16);
+    pipeline.start();
+    ASSERT_TRUE(pipeline.submit(SNAPSHOT));
+    ASSERT_TRUE(pipeline.submit("{\"type\":\"update\",\"symbol\":\"BTC-PERPETUAL\",\"seq\":6,\"bids\":[],\"asks\":[[99.5,1.0]]}"));
+    pipeline.stop();
+
+    EXPECT_EQ(venue.orders(), 1u);
+    EXPECT_EQ(venue.trades(), 1u);
+    EXPECT_EQ(venue.position("BTC-PERPETUAL"), 1.0);
+}
+
+// without a trigger the feed only keeps the venue's books current
+TEST(MarketDataPipeline, SimulatedVenueFeedAloneSendsNothing)
+{
+    SimulatedVenue venue;
+    OrderManager manager(venue);
+    MarketDataPipeline pipeline(manager, UtilityNamespace::simulatedVenueFeed(venue), 16);
+    pipeline.start();
+    ASSERT_TRUE(pipeline.submit(SNAPSHOT));
+    pipeline.stop();
+
+    EXPECT_EQ(venue.orders(), 0u);
+    std::string book = manager.getOrderBook("BTC-PERPETUAL");
+    EXPECT_NE(book.find("\"best_bid_price\":99"), std::string::npos) << book;
+    EXPECT_NE(book.find("\"best_ask_price\":101"), std::string::npos) << book;
+}
+
+TEST(MarketDataPipeline, GapAsksForAReplay)
+{
+    SimulatedVenue venue;
+    OrderManager manager(venue);
+    MarketDataPipeline pipeline(manager, nullptr, 16);
+    std::vector<uint64_t> replays; // book thread until stop()
+    pipeline.setRecoveryHandler([&replays](const std::string &symbol, uint64_t fromSeq)
+                                {
+                                    EXPECT_EQ(symbol, "BTC-PERPETUAL");
+                                    replays.push_back(fromSeq); });
+    pipeline.start();
+    ASSERT_TRUE(pipeline.submit(SNAPSHOT));
+    ASSERT_TRUE(pipeline.submit("{\"type\":\"update\",\"symbol\":\"BTC-PERPETUAL\",\"seq\":8,\"bids\":[[98.0,1.0]],\"asks\":[]}"));
+    pipeline.stop();
+
+    ASSERT_EQ(replays.size(), 1u);
+    EXPECT_EQ(replays[0], 6u);
+}
+
+TEST(MarketDataPipeline, SubmitAfterStopIsDropped)
+{
+    SimulatedVenue venue;
+    OrderManager manager(venue);
+    MarketDataPipeline pipeline(manager, nullptr, 16);
+    pipeline.start();
+    pipeline.stop();
+    EXPECT_FALSE(pipeline.submit(SNAPSHOT));
+    EXPECT_EQ(pipeline.droppedMessages(), 1u);
+}
+
+TEST(MarketDataPipeline, StalledRecoveryAsksForASnapshot)
+{
+    SimulatedVenue venue;
+    OrderManager manager(venue);
+    MarketDataPipeline pipeline(manager, nullptr, 128);
+    std::vector<uint64_t> replays; // book thread until stop()
+    pipeline.setRecoveryHandler([&replays](const std::string &, uint64_t fromSeq)
+                                { replays.push_back(fromSeq); });
+    pipeline.start();
+    ASSERT_TRUE(pipeline.submit(SNAPSHOT));
+    for (uint64_t seq = 8; seq <= 8 + FeedSequencer::DEFAULT_RECOVERY_LIMIT; ++seq)
+        ASSERT_TRUE(pipeline.submit("{\"type\":\"update\",\"symbol\":\"BTC-PERPETUAL\",\"seq\":" + std::to_string(seq) + ",\"bids\":[],\"asks\":[]}"));
+    pipeline.stop();
+
+    // the replay from 6, then a snapshot request
+    ASSERT_EQ(replays.size(), 2u);
+    EXPECT_EQ(replays[0], 6u);
+    EXPECT_EQ(replays[1], 0u);
+}
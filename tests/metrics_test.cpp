@@ -0,0 +1,90 @@
+#include "metrics.hpp"
+#include <gtest/gtest.h>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+// the whole exposition for one metric of each kind, byte for byte: families sorted by name, HELP and
+// TYPE before the samples, labels escaped and histograms as summaries
+TEST(MetricsRegistry, RendersThePrometheusTextFormat)
+{
+    MetricsRegistry registry;
+    registry.counter("oems_orders_total", "Orders sent", {{"method", "private/buy"}}).add(3);
+    registry.counter("oems_orders_total", "Orders sent", {{"method", "private/sell"}}).add();
+    registry.gauge("oems_open_orders", "Orders resting on the book").set(2.5);
+    registry.sampled("oems_queue_depth", "Tasks waiting", {{"queue", "say \"hi\"\\\n"}}, []()
+                     { return 7.0; });
+    registry.sampledCounter("oems_cpu_seconds_total", "CPU time", {}, []()
+                            { return 1.25; });
+    Histogram &latency = registry.histogram("oems_rtt_ns", "Round trip", {{"venue", "sim"}});
+    for (int64_t ns = 1; ns <= 10; ++ns) // below 16 every bucket holds one value, so the quantiles are exact
+        latency.record(ns);
+
+    EXPECT_EQ(registry.render(),
+              "# HELP oems_cpu_seconds_total CPU time\n"
+              "# TYPE oems_cpu_seconds_total counter\n"
+              "oems_cpu_seconds_total 1.25\n"
+              "# HELP oems_open_orders Orders resting on the book\n"
+              "# TYPE oems_open_orders gauge\n"
+              "oems_open_orders 2.5\n"
+              "# HELP oems_orders_total Orders sent\n"
+              "# TYPE oems_orders_total counter\n"
+              "oems_orders_total{method=\"private/buy\"} 3\n"
+              "oems_orders_total{method=\"private/sell\"} 1\n"
+              "# HELP oems_queue_depth Tasks waiting\n"
+              "# TYPE oems_queue_depth gauge\n"
+              "oems_queue_depth{queue=\"say \\\"hi\\\"\\\\\\n\"} 7\n"
+              "# HELP oems_rtt_ns Round trip\n"
+              "# TYPE oems_rtt_ns summary\n"
+              "oems_rtt_ns{venue=\"sim\",quantile=\"0.5\"} 5\n"
+              "oems_rtt_ns{venue=\"sim\",quantile=\"0.9\"} 9\n"
+              "oems_rtt_ns{venue=\"sim\",quantile=\"0.99\"} 9\n"
+              "oems_rtt_ns{venue=\"sim\",quantile=\"0.999\"} 9\n"
+              "oems_rtt_ns{venue=\"sim\",quantile=\"1\"} 10\n"
+              "oems_rtt_ns_sum{venue=\"sim\"} 55\n"
+              "oems_rtt_ns_count{venue=\"sim\"} 10\n");
+}
+
+TEST(MetricsRegistry, SameNameAndLabelsGiveTheSameMetric)
+{
+    MetricsRegistry registry;
+    Counter &first = registry.counter("oems_orders_total", "Orders sent", {{"method", "private/buy"}});
+    EXPECT_EQ(&registry.counter("oems_orders_total", "Orders sent", {{"method", "private/buy"}}), &first);
+    EXPECT_NE(&registry.counter("oems_orders_total", "Orders sent", {{"method", "private/sell"}}), &first);
+    EXPECT_THROW(registry.gauge("oems_orders_total", "Orders sent"), std::runtime_error);
+    EXPECT_THROW(registry.sampled("oems_orders_total", "Orders sent", {}, []()
+                                  { return 0.0; }),
+                 std::runtime_error);
+}
+
+TEST(MetricsRegistry, RemovedSampleLeavesTheOutput)
+{
+    MetricsRegistry registry;
+    registry.sampled("oems_queue_depth", "Tasks waiting", {}, []()
+                     { return 1.0; });
+    registry.removeSampled("oems_queue_depth");
+    EXPECT_EQ(registry.render(), "");
+}
+
+// every thread adds to its own shard; a scrape sees the sum
+TEST(Counter, SumsTheShardsOfEveryThread)
+{
+    Counter counter;
+    std::vector<std::thread> threads;
+    for (size_t t = 0; t < METRIC_SHARDS + 4; ++t)
+        threads.emplace_back([&counter]()
+                             {
+                                 for (int i = 0; i < 1000; ++i)
+                                     counter.add(); });
+    for (std::thread &thread : threads)
+        thread.join();
+    EXPECT_EQ(counter.value(), (METRIC_SHARDS + 4) * 1000);
+}
+
+TEST(ProcessMetrics, CpuTimeIsACounter)
+{
+    std::string rendered = UtilityNamespace::metrics().render();
+    EXPECT_NE(rendered.find("# TYPE process_cpu_seconds_total counter\n"), std::string::npos);
+    EXPECT_NE(rendered.find("# TYPE process_resident_memory_bytes gauge\n"), std::string::npos);
+}
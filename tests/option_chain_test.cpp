@@ -0,0 +1,249 @@
+#include "option_chain.hpp"
+#include <gtest/gtest.h>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <string>
+#include <vector>
+
+namespace
+{
+    constexpr double SPOT = 2500.0;
+    constexpr double MS_PER_YEAR = 365.0 * 86400.0 * 1000.0;
+    constexpr int64_t NOW_MS = 1750000000000; // 2025-06-15
+
+    double normCdf(double z)
+    {
+        return 0.5 * std::erfc(-z / std::sqrt(2.0));
+    }
+
+    double blackPrice(double forward, double strike, double sigma, double years, double cp)
+    {
+        double sd = sigma * std::sqrt(years);
+        double d1 = std::log(forward / strike) / sd + 0.5 * sd;
+        return cp * (forward * normCdf(cp * d1) - strike * normCdf(cp * (d1 - sd)));
+    }
+
+    double smile(double strike, double years)
+    {
+        double m = std::log(strike / SPOT);
+        return 0.6 + 0.05 / std::sqrt(years * 12.0) + 0.8 * m * m - 0.1 * m;
+    }
+
+    // five expiries, strikes 1000 to 4000 by 100, calls and puts, quoted around the smile's price
+    OptionChain smileChain()
+    {
+        OptionChain chain;
+        for (const char *expiry : {"20JUN25", "27JUN25", "25JUL25", "26SEP25", "26DEC25"})
+        {
+            for (int strike = 1000; strike <= 4000; strike += 100)
+            {
+                for (char type : {'C', 'P'})
+                {
+                    OptionContract contract;
+                    std::string name = std::string("ETH-") + expiry + "-" + std::to_string(strike) + "-" + type;
+                    EXPECT_TRUE(UtilityNamespace::parseOptionName(name, contract)) << name;
+                    chain.add(contract);
+                    double years = (contract.expiryMs - NOW_MS) / MS_PER_YEAR;
+                    double price = blackPrice(SPOT, strike, smile(strike, years), years, type == 'C' ? 1.0 : -1.0) / SPOT;
+                    chain.setQuote(name, price * 0.999, price * 1.001);
+                }
+            }
+        }
+        chain.sort();
+        return chain;
+    }
+
+    // Black-76 at rate 0 one option at a time: bisection on the price, then the closed-form Greeks
+    void scalarGreeks(OptionChain &chain)
+    {
+        const double nan = std::numeric_limits<double>::quiet_NaN();
+        for (size_t row = 0; row < chain.size(); ++row)
+        {
+            double years = (chain.expiryMs[row] - NOW_MS) / MS_PER_YEAR;
+            double cp = chain.callPut[row], strike = chain.strikes[row];
+            double target = 0.5 * (chain.bids[row] + chain.asks[row]) * SPOT;
+            chain.iv[row] = chain.delta[row] = chain.gamma[row] = chain.vega[row] = chain.theta[row] = nan;
+            if (chain.bids[row] <= 0.0 || years <= 0.0 || target <= std::max(cp * (SPOT - strike), 0.0))
+                continue;
+            double low = 1e-4, high = 10.0;
+            for (int iteration = 0; iteration < 200; ++iteration)
+            {
+                double mid = 0.5 * (low + high);
+                (blackPrice(SPOT, strike, mid, years, cp) > target ? high : low) = mid;
+            }
+            double sigma = 0.5 * (low + high), sqrtT = std::sqrt(years), sd = sigma * sqrtT;
+            double d1 = std::log(SPOT / strike) / sd + 0.5 * sd;
+            double pdf = std::exp(-0.5 * d1 * d1) / std::sqrt(2.0 * M_PI);
+            chain.iv[row] = sigma;
+            chain.delta[row] = cp * normCdf(cp * d1);
+            chain.gamma[row] = pdf / (SPOT * sd);
+            chain.vega[row] = SPOT * pdf * sqrtT * 0.01;
+            chain.theta[row] = -SPOT * pdf * sigma / (2.0 * sqrtT) / 365.0;
+        }
+    }
+
+    // same NaN rows, and no finite value further apart than tolerance
+    void expectClose(const OptionChain::Column &actual, const OptionChain::Column &expected, double tolerance, const char *column)
+    {
+        ASSERT_EQ(actual.size(), expected.size());
+        for (size_t row = 0; row < actual.size(); ++row)
+        {
+            ASSERT_EQ(std::isnan(actual[row]), std::isnan(expected[row])) << column << " row " << row;
+            if (!std::isnan(expected[row]))
+            {
+                EXPECT_NEAR(actual[row], expected[row], tolerance) << column << " row " << row;
+            }
+        }
+    }
+}
+
+TEST(ParseOptionName, ReadsEveryField)
+{
+    OptionContract contract;
+    ASSERT_TRUE(UtilityNamespace::parseOptionName("ETH-26SEP25-1900-C", contract));
+    EXPECT_EQ(contract.name, "ETH-26SEP25-1900-C");
+    EXPECT_EQ(contract.currency, "ETH");
+    EXPECT_EQ(contract.expiryMs, 1758873600000); // 2025-09-26 08:00 UTC
+    EXPECT_EQ(contract.strike, 1900.0);
+    EXPECT_TRUE(contract.call);
+
+    ASSERT_TRUE(UtilityNamespace::parseOptionName("XRP_USDC-30MAY25-2d2-P", contract));
+    EXPECT_EQ(contract.currency, "XRP_USDC");
+    EXPECT_EQ(contract.expiryMs, 1748592000000);
+    EXPECT_DOUBLE_EQ(contract.strike, 2.2);
+    EXPECT_FALSE(contract.call);
+
+    ASSERT_TRUE(UtilityNamespace::parseOptionName("BTC-1JAN26-100000-C", contract));
+    EXPECT_EQ(contract.expiryMs, 1767254400000);
+}
+
+TEST(ParseOptionName, RejectsMalformedNames)
+{
+    OptionContract contract;
+    for (const char *name : {"", "ETH", "ETH-PERPETUAL", "ETH-26SEP25", "ETH-26SEP25-1900", "ETH-26SEP25-1900-X",
+                             "ETH-26SEP25-1900-CC", "-26SEP25-1900-C", "ETH-26XYZ25-1900-C", "ETH-32SEP25-1900-C",
+                             "ETH-0SEP25-1900-C", "ETH-26SEP2025-1900-C", "ETH-26SEP25--C", "ETH-26SEP25-abc-C",
+                             "ETH-26SEP25-0-C", "ETH-26SEP25--5-P", "ETH-26SEP25-1900-C-1"})
+        EXPECT_FALSE(UtilityNamespace::parseOptionName(name, contract)) << name;
+}
+
+TEST(LoadOptionInstruments, AddsOptionsSortedAndSkipsTheRest)
+{
+    OptionChain chain;
+    size_t added = UtilityNamespace::loadOptionInstruments(chain, R"({"result":[
+        {"instrument_name":"ETH-26SEP25-2000-P","kind":"option","strike":2000.0,"expiration_timestamp":1758873600000},
+        {"instrument_name":"ETH-26SEP25-2000-C","kind":"option","strike":2000.0,"expiration_timestamp":1758873600000},
+        {"instrument_name":"ETH-27JUN25-2500-C","kind":"option"},
+        {"instrument_name":"ETH-PERPETUAL","kind":"future"},
+        {"instrument_name":"not an option","kind":"option"}]})");
+    EXPECT_EQ(added, 3u);
+    ASSERT_EQ(chain.size(), 3u);
+    EXPECT_EQ(chain.currency, "ETH");
+    // by expiry, strike, then call before put
+    EXPECT_EQ(chain.names[0], "ETH-27JUN25-2500-C");
+    EXPECT_EQ(chain.names[1], "ETH-26SEP25-2000-C");
+    EXPECT_EQ(chain.names[2], "ETH-26SEP25-2000-P");
+    EXPECT_EQ(chain.find("ETH-26SEP25-2000-P"), 2u);
+    EXPECT_EQ(chain.callPut[2], -1.0);
+    EXPECT_DOUBLE_EQ(chain.logStrikes[1], std::log(2000.0));
+    EXPECT_TRUE(std::isnan(chain.iv[0]));
+
+    // a repeated listing adds nothing
+    EXPECT_EQ(UtilityNamespace::loadOptionInstruments(chain, R"({"result":[{"instrument_name":"ETH-26SEP25-2000-C","kind":"option"}]})"), 0u);
+    EXPECT_EQ(UtilityNamespace::loadOptionInstruments(chain, "{\"result\":"), 0u);
+}
+
+TEST(LoadOptionQuotes, QuotesKnownRowsAndTakesTheFirstUnderlying)
+{
+    OptionChain chain;
+    UtilityNamespace::loadOptionInstruments(chain, R"({"result":[
+        {"instrument_name":"ETH-26SEP25-2000-C","kind":"option"},
+        {"instrument_name":"ETH-26SEP25-2000-P","kind":"option"}]})");
+    double underlying = 0.0;
+    size_t quoted = UtilityNamespace::loadOptionQuotes(chain, R"({"result":[
+        {"instrument_name":"ETH-26SEP25-2000-C","bid_price":0.25,"ask_price":0.26,"underlying_price":2510.5},
+        {"instrument_name":"ETH-26SEP25-2000-P","bid_price":null,"ask_price":0.04,"underlying_price":2511.0},
+        {"instrument_name":"ETH-26SEP25-9000-C","bid_price":0.001,"ask_price":0.002}]})",
+                                                       &underlying);
+    EXPECT_EQ(quoted, 2u);
+    EXPECT_EQ(underlying, 2510.5);
+    EXPECT_EQ(chain.bids[0], 0.25);
+    EXPECT_EQ(chain.asks[0], 0.26);
+    EXPECT_EQ(chain.bids[1], 0.0); // null: no bid
+    EXPECT_EQ(chain.asks[1], 0.04);
+}
+
+// the SIMD kernel, odd tail included, against a scalar Black-76 solve of every row
+TEST(ComputeOptionGreeks, MatchesScalarBlack76)
+{
+    OptionChain simd = smileChain();
+    ASSERT_NE(simd.size() % 4, 0u);
+    OptionChain scalar = simd;
+    UtilityNamespace::computeOptionGreeks(simd, 0, simd.size(), SPOT, NOW_MS);
+    scalarGreeks(scalar);
+
+    size_t solved = 0;
+    for (double iv : simd.iv)
+        solved += !std::isnan(iv);
+    EXPECT_GT(solved, simd.size() * 9 / 10);
+    // deep in the money a week out the price barely moves with the volatility, so it pins iv only to ~1e-6
+    expectClose(simd.iv, scalar.iv, 1e-5, "iv");
+    expectClose(simd.delta, scalar.delta, 1e-6, "delta");
+    expectClose(simd.gamma, scalar.gamma, 1e-8, "gamma");
+    expectClose(simd.vega, scalar.vega, 1e-4, "vega");
+    expectClose(simd.theta, scalar.theta, 1e-4, "theta");
+}
+
+TEST(ComputeOptionGreeks, LeavesUnquotedAndExpiredRowsNaN)
+{
+    OptionChain chain;
+    OptionContract contract;
+    ASSERT_TRUE(UtilityNamespace::parseOptionName("ETH-26SEP25-2500-C", contract));
+    chain.add(contract);
+    ASSERT_TRUE(UtilityNamespace::parseOptionName("ETH-1JUN25-2500-C", contract));
+    chain.add(contract);
+    chain.sort();
+    chain.setQuote("ETH-1JUN25-2500-C", 0.01, 0.02); // expired before NOW_MS
+    UtilityNamespace::computeOptionGreeks(chain, 0, chain.size(), SPOT, NOW_MS);
+    for (size_t row = 0; row < chain.size(); ++row)
+    {
+        EXPECT_TRUE(std::isnan(chain.iv[row])) << row;
+        EXPECT_TRUE(std::isnan(chain.delta[row])) << row;
+    }
+}
+
+TEST(ChainCalculator, ThreadCountDoesNotChangeTheResult)
+{
+    OptionChain single = smileChain();
+    ASSERT_GE(single.size(), 4 * ChainCalculator::MIN_ROWS_PER_THREAD);
+    ChainCalculator one(1);
+    one.compute(single, SPOT, NOW_MS);
+    for (size_t threads : {2u, 3u, 4u})
+    {
+        OptionChain parallel = smileChain();
+        ChainCalculator calculator(threads);
+        calculator.compute(parallel, SPOT, NOW_MS);
+        EXPECT_EQ(parallel.underlyingPrice, SPOT);
+        EXPECT_EQ(parallel.computedMs, NOW_MS);
+        for (const auto &[actual, expected] : {std::make_pair(&parallel.iv, &single.iv), std::make_pair(&parallel.delta, &single.delta),
+                                               std::make_pair(&parallel.gamma, &single.gamma), std::make_pair(&parallel.vega, &single.vega),
+                                               std::make_pair(&parallel.theta, &single.theta)})
+        {
+            for (size_t row = 0; row < single.size(); ++row)
+            {
+                if (std::isnan((*expected)[row]))
+                    EXPECT_TRUE(std::isnan((*actual)[row])) << threads << " threads, row " << row;
+                else
+                    EXPECT_EQ((*actual)[row], (*expected)[row]) << threads << " threads, row " << row;
+            }
+        }
+    }
+}
+
+TEST(OptionChain, ColumnsStartOnACacheLine)
+{
+    OptionChain chain = smileChain();
+    for (const OptionChain::Column *column : {&chain.strikes, &chain.iv, &chain.delta, &chain.theta})
+        EXPECT_EQ(reinterpret_cast<uintptr_t>(column->data()) % 64, 0u);
+}
@@ -0,0 +1,230 @@
+#include "order_journal.hpp"
+#include <gtest/gtest.h>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace
+{
+    std::string journalPath(const std::string &name)
+    {
+        std::string path = testing::TempDir() + name;
+        std::remove(path.c_str());
+        return path;
+    }
+
+    std::vector<uint64_t> sequences(const OrderJournal &journal)
+    {
+        std::vector<uint64_t> out;
+        journal.replay([&out](const JournalRecord &record)
+                       { out.push_back(record.sequence); });
+        return out;
+    }
+
+    // FNV-1a over the sequence and the payload, as the journal checks it
+    uint32_t checksum(uint64_t sequence, const std::string &payload)
+    {
+        uint32_t hash = 2166136261u;
+        auto mix = [&hash](const void *data, size_t size)
+        {
+            for (size_t i = 0; i < size; ++i)
+            {
+                hash ^= static_cast<const unsigned char *>(data)[i];
+                hash *= 16777619u;
+            }
+        };
+        mix(&sequence, sizeof(sequence));
+        mix(payload.data(), payload.size());
+        return hash;
+    }
+
+    std::string orderReply(const std::string &id, const std::string &state, double filled = 0.0)
+    {
+        return "{\"jsonrpc\":\"2.0\",\"id\":1,\"result\":{\"order\":{\"order_id\":\"" + id + "\",\"instrument_name\":\"BTC-PERPETUAL\",\"direction\":\"buy\",\"order_state\":\"" +
+               state + "\",\"price\":64000.0,\"amount\":10.0,\"filled_amount\":" + std::to_string(filled) + "},\"trades\":[]}}";
+    }
+}
+
+TEST(OrderJournal, ReopensWithEveryRecord)
+{
+    std::string path = journalPath("reopen.journal");
+    {
+        OrderJournal journal(path);
+        uint64_t request = journal.appendRequest("private/buy", "{\"id\":1}");
+        EXPECT_EQ(request, 1u);
+        journal.appendAck(request, true, "{\"result\":{}}");
+        journal.flush();
+    }
+    OrderJournal journal(path);
+    EXPECT_EQ(journal.records(), 2u);
+    std::vector<JournalRecord> records;
+    std::vector<std::string> bodies;
+    journal.replay([&](const JournalRecord &record)
+                   {
+                       records.push_back(record);
+                       bodies.emplace_back(record.body); });
+    ASSERT_EQ(records.size(), 2u);
+    EXPECT_EQ(records[0].type, JournalRecordType::Request);
+    EXPECT_EQ(bodies[0], "{\"id\":1}");
+    EXPECT_EQ(records[1].type, JournalRecordType::Ack);
+    EXPECT_EQ(records[1].requestSequence, 1u);
+    EXPECT_TRUE(records[1].ok);
+    EXPECT_EQ(journal.appendRequest("private/cancel", "{}"), 3u);
+}
+
+// a crash mid-write leaves a record whose checksum fails and maybe a partial header after it;
+// both are dropped and the next append reuses the torn record's sequence
+TEST(OrderJournal, RecoverDropsATornTail)
+{
+    std::string path = journalPath("torn.journal");
+    {
+        OrderJournal journal(path);
+        for (int i = 0; i < 3; ++i)
+            journal.appendRequest("private/buy", "{\"id\":" + std::to_string(i) + "}");
+        journal.flush();
+    }
+    {
+        std::fstream file(path, std::ios::in | std::ios::out | std::ios::binary);
+        file.seekp(-2, std::ios::end);
+        file.put('#'); // inside the last record's payload
+        file.seekp(0, std::ios::end);
+        const char partial[12] = {9, 0, 0, 0, 1, 2, 3, 4, 4, 0, 0, 0};
+        file.write(partial, sizeof(partial));
+    }
+
+    OrderJournal journal(path);
+    EXPECT_EQ(journal.records(), 2u);
+    EXPECT_EQ(sequences(journal), (std::vector<uint64_t>{1, 2}));
+    EXPECT_EQ(journal.appendRequest("private/sell", "{}"), 3u);
+    journal.flush();
+    EXPECT_EQ(sequences(journal), (std::vector<uint64_t>{1, 2, 3}));
+}
+
+TEST(OrderJournal, RefusesRecordsTheHeaderCannotDescribe)
+{
+    OrderJournal journal(journalPath("oversized.journal"));
+    EXPECT_THROW(journal.appendRequest(std::string(70000, 'm'), "{}"), std::runtime_error);
+    EXPECT_EQ(journal.appendRequest("private/buy", "{}"), 1u);
+    journal.flush();
+    EXPECT_EQ(sequences(journal), std::vector<uint64_t>{1});
+}
+
+// a record with a good checksum whose method would run past its own end is not replayed
+TEST(OrderJournal, RecoverStopsAtAMethodLongerThanItsRecord)
+{
+    std::string path = journalPath("method.journal");
+    {
+        OrderJournal journal(path);
+        journal.appendRequest("private/buy", "{}");
+        journal.flush();
+    }
+    {
+        std::string payload = "abcd";
+        JournalRecordHeader header{};
+        header.length = static_cast<uint32_t>(payload.size());
+        header.sequence = 2;
+        header.checksum = checksum(header.sequence, payload);
+        header.type = static_cast<uint8_t>(JournalRecordType::Request);
+        header.methodLength = 100;
+        std::ofstream file(path, std::ios::binary | std::ios::app);
+        file.write(reinterpret_cast<const char *>(&header), sizeof(header));
+        file.write(payload.data(), static_cast<std::streamsize>(payload.size()));
+    }
+    OrderJournal journal(path);
+    EXPECT_EQ(journal.records(), 1u);
+    EXPECT_EQ(sequences(journal), std::vector<uint64_t>{1});
+}
+
+TEST(ReconcileOrders, SortsOrdersByWhatTheExchangeSays)
+{
+    OrderJournal journal(journalPath("reconcile.journal"));
+    journal.appendAck(journal.appendRequest("private/buy", "{\"a\":1}"), true, orderReply("A", "open"));
+    journal.appendAck(journal.appendRequest("private/buy", "{\"b\":1}"), true, orderReply("B", "open"));
+    uint64_t noReply = journal.appendRequest("private/buy", "{\"c\":1}");
+    uint64_t failed = journal.appendRequest("private/buy", "{\"d\":1}");
+    journal.appendAck(failed, false, "");
+    journal.appendAck(journal.appendRequest("private/buy", "{\"e\":1}"), true, "{\"jsonrpc\":\"2.0\",\"id\":5,\"error\":{\"code\":10009,\"message\":\"not_enough_funds\"}}");
+    journal.flush();
+
+    // A is still open and partly filled, B is gone, C was never journaled
+    std::string openOrders = "{\"jsonrpc\":\"2.0\",\"id\":9,\"result\":["
+                             "{\"order_id\":\"A\",\"instrument_name\":\"BTC-PERPETUAL\",\"direction\":\"buy\",\"order_state\":\"open\",\"price\":64000.0,\"amount\":10.0,\"filled_amount\":4.0},"
+                             "{\"order_id\":\"C\",\"instrument_name\":\"ETH-PERPETUAL\",\"direction\":\"sell\",\"order_state\":\"open\",\"price\":3000.0,\"amount\":1.0,\"filled_amount\":0.0}]}";
+    ReconcileReport report = UtilityNamespace::reconcileOrders(journal, openOrders);
+
+    EXPECT_EQ(report.records, 9u);
+    ASSERT_EQ(report.open.size(), 1u);
+    EXPECT_EQ(report.open[0].orderId, "A");
+    EXPECT_EQ(report.open[0].filledAmount, 4.0);
+    EXPECT_EQ(report.open[0].lastSequence, 2u);
+    ASSERT_EQ(report.closed.size(), 1u);
+    EXPECT_EQ(report.closed[0].orderId, "B");
+    ASSERT_EQ(report.unknown.size(), 1u);
+    EXPECT_EQ(report.unknown[0].orderId, "C");
+    EXPECT_EQ(report.unknown[0].instrument, "ETH-PERPETUAL");
+    // no reply, and a transport failure; the rejected order is settled
+    ASSERT_EQ(report.inDoubt.size(), 2u);
+    EXPECT_EQ(report.inDoubt[0].sequence, noReply);
+    EXPECT_EQ(report.inDoubt[1].sequence, failed);
+    EXPECT_EQ(report.inDoubt[0].method, "private/buy");
+}
+
+// the settled orders go and a second reconciliation, after a reopen, finds the same open and in-doubt orders
+TEST(ReconcileOrders, CompactionKeepsWhatTheNextReconciliationNeeds)
+{
+    std::string path = journalPath("compact.journal");
+    std::string openOrders = "{\"jsonrpc\":\"2.0\",\"id\":9,\"result\":["
+                             "{\"order_id\":\"A\",\"instrument_name\":\"BTC-PERPETUAL\",\"direction\":\"buy\",\"order_state\":\"open\",\"price\":64000.0,\"amount\":10.0,\"filled_amount\":4.0}]}";
+    {
+        OrderJournal journal(path);
+        uint64_t a = journal.appendRequest("private/buy", "{\"a\":1}");
+        journal.appendAck(a, true, orderReply("A", "open"));
+        journal.appendAck(journal.appendRequest("private/buy", "{\"b\":1}"), true, orderReply("B", "open"));
+        journal.appendAck(journal.appendRequest("private/edit", "{\"a\":2}"), true, orderReply("A", "open", 4.0));
+        journal.appendRequest("private/buy", "{\"c\":1}");
+        journal.flush();
+
+        ReconcileReport report = UtilityNamespace::reconcileOrders(journal, openOrders);
+        EXPECT_EQ(report.closed.size(), 1u);
+        EXPECT_EQ(UtilityNamespace::compactJournal(journal, report), 4u);
+        EXPECT_EQ(journal.records(), 3u);
+        EXPECT_EQ(journal.appendRequest("private/cancel", "{}"), 4u);
+        journal.flush();
+    }
+
+    OrderJournal journal(path);
+    std::vector<JournalRecord> records;
+    std::vector<std::string> bodies;
+    journal.replay([&](const JournalRecord &record)
+                   {
+                       records.push_back(record);
+                       bodies.emplace_back(record.body); });
+    ASSERT_EQ(records.size(), 4u);
+    EXPECT_EQ(bodies[0], "{\"a\":2}");
+    EXPECT_EQ(records[1].type, JournalRecordType::Ack);
+    EXPECT_EQ(records[1].requestSequence, 1u);
+    EXPECT_EQ(bodies[2], "{\"c\":1}");
+    EXPECT_EQ(records[3].method, "private/cancel");
+
+    ReconcileReport report = UtilityNamespace::reconcileOrders(journal, openOrders);
+    ASSERT_EQ(report.open.size(), 1u);
+    EXPECT_EQ(report.open[0].orderId, "A");
+    EXPECT_TRUE(report.closed.empty());
+    ASSERT_EQ(report.inDoubt.size(), 2u);
+    EXPECT_EQ(report.inDoubt[0].payload, "{\"c\":1}");
+}
+
+// without the exchange's view every journaled order would look closed, so nothing is dropped
+TEST(ReconcileOrders, UnreadableOpenOrdersSkipTheCompaction)
+{
+    OrderJournal journal(journalPath("keep.journal"));
+    journal.appendAck(journal.appendRequest("private/buy", "{\"a\":1}"), true, orderReply("A", "open"));
+    journal.flush();
+    ReconcileReport report = UtilityNamespace::reconcileOrders(journal, "not json");
+    EXPECT_FALSE(report.exchangeRead);
+    EXPECT_EQ(UtilityNamespace::compactJournal(journal, report), 0u);
+    EXPECT_EQ(journal.records(), 2u);
+}
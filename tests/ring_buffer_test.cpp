@@ -0,0 +1,210 @@
+#include "ring_buffer.hpp"
+#include <gtest/gtest.h>
+#include <atomic>
+#include <string>
+#include <thread>
+#include <vector>
+
+TEST(SpscRingBuffer, RoundsCapacityUpToAPowerOfTwo)
+{
+    SpscRingBuffer<int> ring(5);
+    EXPECT_EQ(ring.capacity(), 8u);
+    SpscRingBuffer<int> tiny(0);
+    EXPECT_EQ(tiny.capacity(), 2u);
+}
+
+TEST(SpscRingBuffer, FullAndEmpty)
+{
+    SpscRingBuffer<int> ring(4);
+    int value = -1;
+    EXPECT_TRUE(ring.empty());
+    EXPECT_FALSE(ring.tryPop(value));
+    for (int i = 0; i < 4; ++i)
+        EXPECT_TRUE(ring.tryPush(i));
+    EXPECT_TRUE(ring.full());
+    EXPECT_EQ(ring.size(), 4u);
+    EXPECT_FALSE(ring.tryPush(4));
+    ASSERT_TRUE(ring.tryPop(value));
+    EXPECT_EQ(value, 0);
+    EXPECT_FALSE(ring.full());
+    EXPECT_TRUE(ring.tryPush(4));
+    for (int expected = 1; expected <= 4; ++expected)
+    {
+        ASSERT_TRUE(ring.tryPop(value));
+        EXPECT_EQ(value, expected);
+    }
+    EXPECT_TRUE(ring.empty());
+    EXPECT_FALSE(ring.tryPop(value));
+}
+
+// indices keep counting past the capacity, so the slots are reused many times over
+TEST(SpscRingBuffer, WrapsAroundInOrder)
+{
+    SpscRingBuffer<std::string> ring(4);
+    std::string value;
+    int next = 0;
+    for (int round = 0; round < 1000; ++round)
+    {
+        for (int i = 0; i < 3; ++i)
+            ASSERT_TRUE(ring.tryPush(std::to_string(round * 3 + i)));
+        for (int i = 0; i < 3; ++i)
+        {
+            ASSERT_TRUE(ring.tryPop(value));
+            EXPECT_EQ(value, std::to_string(next++));
+        }
+    }
+    EXPECT_TRUE(ring.empty());
+}
+
+TEST(SpscRingBuffer, CloseDrainsThenFails)
+{
+    SpscRingBuffer<int, BlockingWait> ring(4);
+    ASSERT_TRUE(ring.push(1));
+    ASSERT_TRUE(ring.push(2));
+    ring.close();
+    int value = 0;
+    ASSERT_TRUE(ring.pop(value));
+    EXPECT_EQ(value, 1);
+    ASSERT_TRUE(ring.pop(value));
+    EXPECT_EQ(value, 2);
+    EXPECT_FALSE(ring.pop(value));
+}
+
+// with room left a push after close() still fails, so a closed stage takes nothing new
+TEST(SpscRingBuffer, PushAfterCloseFails)
+{
+    SpscRingBuffer<int, BlockingWait> ring(4);
+    ring.close();
+    EXPECT_FALSE(ring.push(1));
+    EXPECT_TRUE(ring.empty());
+}
+
+TEST(SpscRingBuffer, HandsEveryElementAcrossThreads)
+{
+    constexpr int COUNT = 100000;
+    SpscRingBuffer<int, YieldingWait> ring(64);
+    std::thread producer([&ring]()
+                         {
+                             for (int i = 0; i < COUNT; ++i)
+                                 ring.push(i);
+                             ring.close(); });
+    int value = 0, expected = 0;
+    while (ring.pop(value))
+        ASSERT_EQ(value, expected++);
+    producer.join();
+    EXPECT_EQ(expected, COUNT);
+}
+
+TEST(MpscRingBuffer, FullAndEmpty)
+{
+    MpscRingBuffer<int> ring(4);
+    int value = -1;
+    EXPECT_TRUE(ring.empty());
+    EXPECT_FALSE(ring.tryPop(value));
+    for (int i = 0; i < 4; ++i)
+        EXPECT_TRUE(ring.tryPush(i));
+    EXPECT_TRUE(ring.full());
+    EXPECT_FALSE(ring.tryPush(4));
+    ASSERT_TRUE(ring.tryPop(value));
+    EXPECT_EQ(value, 0);
+    EXPECT_TRUE(ring.tryPush(4));
+    for (int expected = 1; expected <= 4; ++expected)
+    {
+        ASSERT_TRUE(ring.tryPop(value));
+        EXPECT_EQ(value, expected);
+    }
+    EXPECT_TRUE(ring.empty());
+}
+
+TEST(MpscRingBuffer, WrapsAroundInOrder)
+{
+    MpscRingBuffer<int> ring(2);
+    int value = 0;
+    for (int i = 0; i < 1000; ++i)
+    {
+        ASSERT_TRUE(ring.tryPush(i));
+        ASSERT_TRUE(ring.tryPop(value));
+        EXPECT_EQ(value, i);
+    }
+    EXPECT_TRUE(ring.empty());
+}
+
+TEST(MpscRingBuffer, PushAfterCloseFails)
+{
+    MpscRingBuffer<int, BlockingWait> ring(4);
+    ASSERT_TRUE(ring.push(1));
+    ring.close();
+    EXPECT_FALSE(ring.push(2));
+    int value = 0;
+    ASSERT_TRUE(ring.pop(value));
+    EXPECT_EQ(value, 1);
+    EXPECT_FALSE(ring.pop(value));
+}
+
+TEST(MpscRingBuffer, TryPushAfterCloseFails)
+{
+    MpscRingBuffer<int> ring(4);
+    ASSERT_TRUE(ring.tryPush(1));
+    ring.close();
+    EXPECT_FALSE(ring.tryPush(2));
+    int value = 0;
+    ASSERT_TRUE(ring.pop(value));
+    EXPECT_EQ(value, 1);
+    EXPECT_FALSE(ring.pop(value));
+}
+
+// producers racing close(): whatever tryPush accepted is popped, nothing more
+TEST(MpscRingBuffer, CloseLosesNoAcceptedPush)
+{
+    constexpr int PRODUCERS = 4;
+    MpscRingBuffer<int, YieldingWait> ring(64);
+    std::atomic<bool> done{false};
+    std::atomic<int> accepted{0};
+    std::vector<std::thread> producers;
+    for (int p = 0; p < PRODUCERS; ++p)
+        producers.emplace_back([&ring, &done, &accepted, p]()
+                               {
+                                   while (!done.load())
+                                   {
+                                       if (ring.tryPush(p))
+                                           accepted.fetch_add(1);
+                                   } });
+    int popped = 0, value = 0;
+    while (popped < 1000 && ring.pop(value))
+        ++popped;
+    ring.close();
+    while (ring.pop(value))
+        ++popped;
+    done = true;
+    for (std::thread &producer : producers)
+        producer.join();
+    EXPECT_FALSE(ring.tryPop(value));
+    EXPECT_EQ(popped, accepted.load());
+}
+
+// every producer's elements arrive exactly once and in that producer's order
+TEST(MpscRingBuffer, KeepsPerProducerOrder)
+{
+    constexpr int PRODUCERS = 4;
+    constexpr int PER_PRODUCER = 20000;
+    MpscRingBuffer<int, YieldingWait> ring(128);
+    std::vector<std::thread> producers;
+    for (int p = 0; p < PRODUCERS; ++p)
+        producers.emplace_back([&ring, p]()
+                               {
+                                   for (int i = 0; i < PER_PRODUCER; ++i)
+                                       ring.push(p * PER_PRODUCER + i); });
+    std::vector<int> next(PRODUCERS, 0);
+    int value = 0;
+    for (int received = 0; received < PRODUCERS * PER_PRODUCER; ++received)
+    {
+        ASSERT_TRUE(ring.pop(value));
+        int producer = value / PER_PRODUCER;
+        ASSERT_EQ(value % PER_PRODUCER, next[producer]++);
+    }
+    for (std::thread &producer : producers)
+        producer.join();
+    for (int count : next)
+        EXPECT_EQ(count, PER_PRODUCER);
+    EXPECT_TRUE(ring.empty());
+}
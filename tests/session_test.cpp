@@ -0,0 +1,169 @@
+#include "arena.hpp"
+#include "order_manager.hpp"
+#include "session.hpp"
+#include <gtest/gtest.h>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+using namespace std::chrono_literals;
+
+namespace
+{
+    // simulated time: sleeping moves it forward at once, and the test moves it on its own
+    class FakeClock
+    {
+    public:
+        LimiterClock clock()
+        {
+            LimiterClock limiterClock;
+            limiterClock.now = [this]()
+            { return nowNs.load(); };
+            limiterClock.sleep = [this](std::chrono::nanoseconds wait)
+            {
+                slept.push_back(wait);
+                nowNs += wait.count();
+            };
+            return limiterClock;
+        }
+
+        void advance(std::chrono::nanoseconds by) { nowNs += by.count(); }
+
+        std::atomic<int64_t> nowNs{1000000000};
+        std::vector<std::chrono::nanoseconds> slept; // sleeping thread only
+    };
+
+    // nothing listens there, so requests fail at once after the limiter let them through
+    SessionOptions limitedOptions(FakeClock &fake, double creditsPerSecond, double burstCredits)
+    {
+        SessionOptions options;
+        options.poolSize = 1;
+        options.creditsPerSecond = creditsPerSecond;
+        options.burstCredits = burstCredits;
+        options.baseUrl = "http://127.0.0.1:1/api/v2/";
+        options.clock = fake.clock();
+        return options;
+    }
+
+    void post(Session &session, double cost)
+    {
+        ArenaScope scope;
+        std::pmr::string response(&scope.resource());
+        session.post("private/buy", "{}", response, cost);
+    }
+}
+
+TEST(RateLimiter, StartsFullAndRefillsAtItsRate)
+{
+    FakeClock fake;
+    RateLimiter limiter(4.0, 2.0, fake.clock());
+    EXPECT_EQ(limiter.tryAcquire(1.0), 0ns);
+    EXPECT_EQ(limiter.tryAcquire(1.0), 0ns);
+    EXPECT_EQ(limiter.tryAcquire(1.0), 250ms);
+    fake.advance(100ms);
+    EXPECT_EQ(limiter.tryAcquire(1.0), 150ms);
+    fake.advance(150ms);
+    EXPECT_EQ(limiter.tryAcquire(1.0), 0ns);
+    EXPECT_EQ(limiter.tryAcquire(1.0), 250ms);
+}
+
+TEST(RateLimiter, RefillStopsAtTheBurst)
+{
+    FakeClock fake;
+    RateLimiter limiter(4.0, 2.0, fake.clock());
+    EXPECT_EQ(limiter.tryAcquire(2.0), 0ns);
+    fake.advance(10s);
+    EXPECT_EQ(limiter.tryAcquire(1.0), 0ns);
+    EXPECT_EQ(limiter.tryAcquire(1.0), 0ns);
+    EXPECT_EQ(limiter.tryAcquire(1.0), 250ms);
+}
+
+// a request takes its cost, a free one takes nothing, and a refused one leaves the credits alone
+TEST(RateLimiter, EachCostTakesItsShare)
+{
+    FakeClock fake;
+    RateLimiter limiter(10.0, 10.0, fake.clock());
+    EXPECT_EQ(limiter.tryAcquire(4.0), 0ns);
+    EXPECT_EQ(limiter.tryAcquire(5.0), 0ns);
+    EXPECT_EQ(limiter.tryAcquire(3.0), 200ms);
+    EXPECT_EQ(limiter.tryAcquire(0.0), 0ns);
+    EXPECT_EQ(limiter.tryAcquire(1.0), 0ns);
+    EXPECT_EQ(limiter.tryAcquire(0.0), 0ns);
+    EXPECT_EQ(limiter.tryAcquire(0.5), 50ms);
+}
+
+TEST(RateLimiter, AcquireSleepsForTheShortfall)
+{
+    FakeClock fake;
+    RateLimiter limiter(4.0, 2.0, fake.clock());
+    limiter.acquire(2.0);
+    EXPECT_TRUE(fake.slept.empty());
+    limiter.acquire(1.0);
+    limiter.acquire(2.0);
+    ASSERT_EQ(fake.slept.size(), 2u);
+    EXPECT_EQ(fake.slept[0], 250ms);
+    EXPECT_EQ(fake.slept[1], 500ms);
+    EXPECT_EQ(fake.nowNs.load(), 1000000000 + std::chrono::nanoseconds(750ms).count());
+}
+
+// orders and queries each wait for their own cost; cost 0, whose credits submit() took when queueing, never waits
+TEST(Session, PostWaitsForTheCostOfEachRequestClass)
+{
+    FakeClock fake;
+    SessionLoop loop(1);
+    Session session(loop, "limit-test", Credentials(), limitedOptions(fake, 4.0, 2.0));
+    post(session, OrderManager::ORDER_COST);
+    post(session, OrderManager::QUERY_COST);
+    post(session, 0.0);
+    EXPECT_EQ(session.throttled(), 0u);
+    EXPECT_TRUE(fake.slept.empty());
+
+    post(session, OrderManager::ORDER_COST);
+    EXPECT_EQ(session.throttled(), 1u);
+    ASSERT_EQ(fake.slept.size(), 1u);
+    EXPECT_EQ(fake.slept[0], 250ms);
+    post(session, 0.0);
+    EXPECT_EQ(session.throttled(), 1u);
+    loop.stop();
+}
+
+// a submitted task over the budget waits on a loop timer, not a thread, until the credits refill
+TEST(Session, SubmitDefersUntilTheCreditsRefill)
+{
+    FakeClock fake;
+    SessionLoop loop(1);
+    Session session(loop, "submit-test", Credentials(), limitedOptions(fake, 1000.0, 1.0));
+    std::mutex mutex;
+    std::condition_variable ran;
+    int done = 0;
+    auto task = [&]()
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        ++done;
+        ran.notify_all();
+    };
+
+    session.submit(task, 1.0);
+    session.submit(task, 1.0);
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        ASSERT_TRUE(ran.wait_for(lock, 5s, [&]()
+                                 { return done >= 1; }));
+        // the deferred task retries every simulated millisecond, which never passes by itself
+        EXPECT_FALSE(ran.wait_for(lock, 50ms, [&]()
+                                  { return done >= 2; }));
+    }
+    EXPECT_EQ(session.throttled(), 1u);
+    EXPECT_TRUE(fake.slept.empty());
+
+    fake.advance(1ms);
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        EXPECT_TRUE(ran.wait_for(lock, 5s, [&]()
+                                 { return done == 2; }));
+    }
+    loop.stop();
+}
@@ -0,0 +1,105 @@
+#include "order_manager.hpp"
+#include "simulated_venue.hpp"
+#include <gtest/gtest.h>
+#include <nlohmann/json.hpp>
+#include <set>
+#include <string>
+
+namespace
+{
+    const std::string SYMBOL = "BTC-PERPETUAL";
+
+    nlohmann::json place(OrderManager &manager, const std::string &side, double amount, double price)
+    {
+        return nlohmann::json::parse(manager.placeOrder(SYMBOL, side, amount, price, "limit"))["result"];
+    }
+
+    std::set<std::string> openOrderIds(OrderManager &manager)
+    {
+        std::set<std::string> ids;
+        nlohmann::json reply = nlohmann::json::parse(manager.getOpenOrders());
+        for (const auto &order : reply["result"])
+            ids.insert(order["order_id"].get<std::string>());
+        return ids;
+    }
+}
+
+// better prices first, the market's amount is used up, and simulated orders at one price fill oldest first
+TEST(SimulatedVenue, MatchesInPriceTimePriority)
+{
+    SimulatedVenue venue;
+    OrderManager manager(venue);
+    venue.onBook(SYMBOL, {}, {{101.0, 2.0}, {102.0, 5.0}}, 1000);
+    std::string first = place(manager, "sell", 1.0, 103.0)["order"]["order_id"];
+    std::string second = place(manager, "sell", 1.0, 103.0)["order"]["order_id"];
+
+    nlohmann::json taker = place(manager, "buy", 4.0, 102.0);
+    EXPECT_EQ(taker["order"]["order_state"], "filled");
+    ASSERT_EQ(taker["trades"].size(), 2u);
+    EXPECT_EQ(taker["trades"][0]["price"], 101.0);
+    EXPECT_EQ(taker["trades"][0]["amount"], 2.0);
+    EXPECT_EQ(taker["trades"][1]["price"], 102.0);
+    EXPECT_EQ(taker["trades"][1]["amount"], 2.0);
+
+    // taken liquidity stays gone until the next book
+    EXPECT_EQ(place(manager, "buy", 3.0, 102.0)["order"]["order_state"], "filled");
+    nlohmann::json resting = place(manager, "buy", 1.0, 102.0);
+    EXPECT_EQ(resting["order"]["order_state"], "open");
+    EXPECT_TRUE(resting["trades"].empty());
+
+    EXPECT_EQ(place(manager, "buy", 1.0, 103.0)["order"]["order_state"], "filled");
+    std::set<std::string> open = openOrderIds(manager);
+    EXPECT_EQ(open.count(first), 0u);
+    EXPECT_EQ(open.count(second), 1u);
+    EXPECT_DOUBLE_EQ(venue.position(SYMBOL), 8.0 - 1.0 + 0.0); // 8 bought by takers, 1 sold by the first maker
+    EXPECT_EQ(venue.trades(), 5u); // a fill between two simulated orders is a trade on each
+}
+
+// Two orders rest behind a level that grows and then shrinks by 7: the optimistic model moves the
+// first order up by all of it, the proportional one by its share. Trades at its price then reach it
+// only under the optimistic model, and a book through its price fills it under either.
+class SimulatedVenueQueue : public testing::TestWithParam<QueueModel>
+{
+};
+
+TEST_P(SimulatedVenueQueue, ShrinkingLevelMovesTheQueue)
+{
+    SimulatedVenueOptions options;
+    options.queueModel = GetParam();
+    SimulatedVenue venue(options);
+    OrderManager manager(venue);
+    venue.onBook(SYMBOL, {{100.0, 10.0}}, {{101.0, 10.0}}, 1000);
+    EXPECT_EQ(place(manager, "buy", 1.0, 100.0)["order"]["order_state"], "open"); // 10 ahead
+    venue.onBook(SYMBOL, {{100.0, 14.0}}, {{101.0, 10.0}}, 1001);
+    EXPECT_EQ(place(manager, "buy", 1.0, 100.0)["order"]["order_state"], "open"); // 14 ahead
+    venue.onBook(SYMBOL, {{100.0, 7.0}}, {{101.0, 10.0}}, 1002);
+
+    // 4 traded at exactly 100: 3 ahead of the first order when optimistic, 5 when proportional
+    venue.onBook(SYMBOL, {{100.0, 7.0}}, {{100.0, 4.0}}, 1003);
+    bool optimistic = GetParam() == QueueModel::Optimistic;
+    EXPECT_DOUBLE_EQ(venue.position(SYMBOL), optimistic ? 1.0 : 0.0);
+
+    venue.onBook(SYMBOL, {{99.0, 7.0}}, {{99.5, 2.0}}, 1004);
+    EXPECT_DOUBLE_EQ(venue.position(SYMBOL), 2.0);
+    EXPECT_TRUE(openOrderIds(manager).empty());
+}
+
+INSTANTIATE_TEST_SUITE_P(Models, SimulatedVenueQueue, testing::Values(QueueModel::Optimistic, QueueModel::Proportional));
+
+// the same calls give byte-identical replies
+TEST(SimulatedVenue, IsDeterministic)
+{
+    auto run = []()
+    {
+        SimulatedVenue venue;
+        OrderManager manager(venue);
+        std::string replies;
+        venue.onBook(SYMBOL, {{99.0, 3.0}}, {{101.0, 3.0}}, 1000);
+        replies += manager.placeOrder(SYMBOL, "buy", 5.0, 101.0, "limit");
+        replies += manager.placeOrder(SYMBOL, "sell", 1.0, 100.0, "limit");
+        venue.onBook(SYMBOL, {{99.0, 3.0}}, {{100.5, 3.0}}, 1001);
+        replies += manager.getOpenOrders();
+        return replies;
+    };
+    EXPECT_EQ(run(), run());
+}
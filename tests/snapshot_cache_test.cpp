@@ -0,0 +1,76 @@
+#include "snapshot_cache.hpp"
+#include <gtest/gtest.h>
+#include <atomic>
+#include <chrono>
+#include <stdexcept>
+#include <thread>
+
+namespace
+{
+    SnapshotCache::SnapshotPtr makeSnapshot(const std::string &symbol)
+    {
+        auto snapshot = std::make_shared<OrderbookSnapshot>();
+        snapshot->symbol = symbol;
+        snapshot->fetchedAt = std::chrono::steady_clock::now();
+        return snapshot;
+    }
+}
+
+TEST(SnapshotCache, HitsWithinTheTtl)
+{
+    int calls = 0;
+    SnapshotCache cache([&calls](const std::string &symbol)
+                        {
+                            ++calls;
+                            return makeSnapshot(symbol); },
+                        std::chrono::seconds(60));
+    SnapshotCache::SnapshotPtr first = cache.get("BTC-PERPETUAL");
+    EXPECT_EQ(cache.get("BTC-PERPETUAL"), first);
+    EXPECT_EQ(calls, 1);
+    EXPECT_EQ(cache.hits(), 1u);
+    cache.invalidate("BTC-PERPETUAL");
+    EXPECT_NE(cache.get("BTC-PERPETUAL"), first);
+    EXPECT_EQ(calls, 2);
+}
+
+// a throwing fetch must not leave the symbol marked in flight, or every later get() waits forever
+TEST(SnapshotCache, ThrowingFetchIsRetried)
+{
+    bool fail = true;
+    SnapshotCache cache([&fail](const std::string &symbol)
+                        {
+                            if (fail)
+                                throw std::runtime_error("upstream down");
+                            return makeSnapshot(symbol); },
+                        std::chrono::seconds(60));
+    EXPECT_THROW(cache.get("BTC-PERPETUAL"), std::runtime_error);
+    fail = false;
+    SnapshotCache::SnapshotPtr snapshot = cache.get("BTC-PERPETUAL");
+    ASSERT_TRUE(snapshot);
+    EXPECT_EQ(snapshot->symbol, "BTC-PERPETUAL");
+    EXPECT_EQ(cache.fetches(), 2u);
+}
+
+TEST(SnapshotCache, WaitersShareTheFetchException)
+{
+    std::atomic<bool> started{false}, release{false};
+    SnapshotCache cache([&](const std::string &) -> SnapshotCache::SnapshotPtr
+                        {
+                            started = true;
+                            while (!release)
+                                std::this_thread::yield();
+                            throw std::runtime_error("upstream down"); },
+                        std::chrono::seconds(60));
+    std::thread fetcher([&cache]()
+                        { EXPECT_THROW(cache.get("ETH-PERPETUAL"), std::runtime_error); });
+    while (!started)
+        std::this_thread::yield();
+    std::thread waiter([&cache]()
+                       { EXPECT_THROW(cache.get("ETH-PERPETUAL"), std::runtime_error); });
+    // the waiter is coalesced onto the fetch in flight before it is let go
+    while (cache.coalesced() == 0)
+        std::this_thread::yield();
+    release = true;
+    fetcher.join();
+    waiter.join();
+}
@@ -0,0 +1,296 @@
+#include "trade_export.hpp"
+#include <gtest/gtest.h>
+#include <algorithm>
+#include <arpa/inet.h>
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <functional>
+#include <netinet/in.h>
+#include <stdexcept>
+#include <string>
+#include <sys/socket.h>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+namespace
+{
+    // keep-alive HTTP/1.1 on loopback; every request body goes to handler and its result is the reply
+    class MockHttpServer
+    {
+    public:
+        explicit MockHttpServer(std::function<std::string(const std::string &body)> handler) : handler(std::move(handler))
+        {
+            listenFd = socket(AF_INET, SOCK_STREAM, 0);
+            sockaddr_in addr{};
+            addr.sin_family = AF_INET;
+            addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+            bind(listenFd, reinterpret_cast<sockaddr *>(&addr), sizeof(addr));
+            listen(listenFd, 4);
+            socklen_t len = sizeof(addr);
+            getsockname(listenFd, reinterpret_cast<sockaddr *>(&addr), &len);
+            port = ntohs(addr.sin_port);
+            worker = std::thread([this]()
+                                 {
+                                     int fd;
+                                     while ((fd = accept(listenFd, nullptr, nullptr)) >= 0)
+                                     {
+                                         serve(fd);
+                                         close(fd);
+                                     } });
+        }
+
+        ~MockHttpServer()
+        {
+            shutdown(listenFd, SHUT_RDWR);
+            close(listenFd);
+            worker.join();
+        }
+
+        std::string url() const { return "http://127.0.0.1:" + std::to_string(port) + "/"; }
+
+    private:
+        void serve(int fd)
+        {
+            std::string buffer;
+            char chunk[4096];
+            while (true)
+            {
+                size_t headerEnd;
+                while ((headerEnd = buffer.find("\r\n\r\n")) == std::string::npos)
+                {
+                    long received = recv(fd, chunk, sizeof(chunk), 0);
+                    if (received <= 0)
+                        return;
+                    buffer.append(chunk, received);
+                }
+                size_t contentLength = 0;
+                size_t pos = buffer.find("Content-Length:");
+                if (pos != std::string::npos && pos < headerEnd)
+                    contentLength = std::strtoul(buffer.c_str() + pos + 15, nullptr, 10);
+                while (buffer.size() < headerEnd + 4 + contentLength)
+                {
+                    long received = recv(fd, chunk, sizeof(chunk), 0);
+                    if (received <= 0)
+                        return;
+                    buffer.append(chunk, received);
+                }
+                std::string body = handler(buffer.substr(headerEnd + 4, contentLength));
+                buffer.erase(0, headerEnd + 4 + contentLength);
+                std::string reply = "HTTP/1.1 200 OK\r\nContent-Type: application/json\r\nContent-Length: " +
+                                    std::to_string(body.size()) + "\r\n\r\n" + body;
+                if (send(fd, reply.data(), reply.size(), MSG_NOSIGNAL) < 0)
+                    return;
+            }
+        }
+
+        std::function<std::string(const std::string &)> handler;
+        int listenFd;
+        int port = 0;
+        std::thread worker;
+    };
+
+    struct Fill
+    {
+        int64_t timestamp;
+        std::string id;
+    };
+
+    int64_t numberAfter(const std::string &body, const std::string &key)
+    {
+        return std::strtoll(body.c_str() + body.find("\"" + key + "\":") + key.size() + 3, nullptr, 10);
+    }
+
+    // get_user_trades_by_currency_and_time over fills sorted by timestamp: count from start_timestamp on
+    std::string tradesPage(const std::vector<Fill> &fills, const std::string &request)
+    {
+        int64_t start = numberAfter(request, "start_timestamp");
+        size_t count = static_cast<size_t>(numberAfter(request, "count"));
+        size_t first = 0;
+        while (first < fills.size() && fills[first].timestamp < start)
+            ++first;
+        size_t last = std::min(fills.size(), first + count);
+        std::string page = "{\"jsonrpc\":\"2.0\",\"id\":7,\"result\":{\"trades\":[";
+        for (size_t i = first; i < last; ++i)
+        {
+            if (i > first)
+                page += ',';
+            page += "{\"timestamp\":" + std::to_string(fills[i].timestamp) + ",\"trade_seq\":" + std::to_string(i + 1) +
+                    ",\"trade_id\":\"" + fills[i].id + "\",\"order_id\":\"O-1\",\"instrument_name\":\"BTC-PERPETUAL\",\"direction\":\"buy\","
+                    "\"price\":64000.5,\"amount\":10,\"fee\":0.0001,\"fee_currency\":\"BTC\",\"index_price\":64001.0,\"liquidity\":\"T\"}";
+        }
+        page += "],\"has_more\":";
+        page += last < fills.size() ? "true" : "false";
+        return page + "}}";
+    }
+
+    std::vector<Fill> fillsAt(int64_t timestamp, size_t count, const std::string &prefix)
+    {
+        std::vector<Fill> fills;
+        for (size_t i = 0; i < count; ++i)
+            fills.push_back({timestamp, prefix + std::to_string(i)});
+        return fills;
+    }
+
+    const std::string TOO_MANY_REQUESTS = "{\"jsonrpc\":\"2.0\",\"id\":7,\"error\":{\"code\":10028,\"message\":\"too_many_requests\"}}";
+
+    std::vector<TradeExportResult> runExport(std::function<std::string(const std::string &)> handler, size_t pageSize, const std::string &name)
+    {
+        MockHttpServer server(std::move(handler));
+        SessionLoop loop(1);
+        SessionOptions sessionOptions;
+        sessionOptions.poolSize = 1;
+        sessionOptions.creditsPerSecond = 1e6;
+        sessionOptions.burstCredits = 1e6;
+        sessionOptions.baseUrl = server.url();
+        Session session(loop, "export-test", Credentials(), sessionOptions);
+
+        TradeExportOptions options;
+        options.currencies = {name};
+        options.startTimestamp = 0;
+        options.endTimestamp = 1000000;
+        options.pageSize = pageSize;
+        options.directory = testing::TempDir();
+        options.retryDelay = std::chrono::milliseconds(1);
+        std::vector<TradeExportResult> results = TradeExporter(session, options).run();
+        loop.stop();
+        return results;
+    }
+
+    std::vector<TradeExportResult> exportFills(const std::vector<Fill> &fills, size_t pageSize, const std::string &name)
+    {
+        return runExport([&fills](const std::string &request)
+                         { return tradesPage(fills, request); },
+                         pageSize, name);
+    }
+
+    // a writer whose file (or index, with ".idx") is /dev/full, so the bytes fail once they leave the buffer
+    std::unique_ptr<TradeWriter> fullDiskWriter(const std::string &name, const char *suffix)
+    {
+        std::string path = testing::TempDir() + name;
+        std::remove(path.c_str());
+        std::remove((path + ".idx").c_str());
+        if (symlink("/dev/full", (path + suffix).c_str()) != 0)
+            return nullptr;
+        return TradeWriter::create(TradeExportFormat::Csv, path, 1);
+    }
+
+    TradeRow exampleRow(int64_t timestamp)
+    {
+        TradeRow row;
+        row.timestamp = timestamp;
+        row.tradeId = "T-1";
+        row.direction = "buy";
+        return row;
+    }
+}
+
+// fills sharing a millisecond with a page boundary are written once each
+TEST(TradeExporter, ContinuesAcrossAMillisecondWithoutLosingFills)
+{
+    std::vector<Fill> fills = fillsAt(1000, 3, "a");
+    std::vector<Fill> more = fillsAt(1001, 2, "b");
+    fills.insert(fills.end(), more.begin(), more.end());
+    std::vector<TradeExportResult> results = exportFills(fills, 2, "TESTA");
+    ASSERT_EQ(results.size(), 1u);
+    EXPECT_EQ(results[0].error, "");
+    EXPECT_EQ(results[0].rows, fills.size());
+}
+
+// more fills in one millisecond than the page size: a larger page is asked for rather than skipping them
+TEST(TradeExporter, WidensThePageForACrowdedMillisecond)
+{
+    std::vector<Fill> fills = fillsAt(1000, 7, "a");
+    fills.push_back({1002, "b0"});
+    std::vector<TradeExportResult> results = exportFills(fills, 3, "TESTB");
+    ASSERT_EQ(results.size(), 1u);
+    EXPECT_EQ(results[0].error, "");
+    EXPECT_EQ(results[0].rows, fills.size());
+
+    std::ifstream csv(results[0].path);
+    std::string line;
+    size_t lines = 0;
+    while (std::getline(csv, line))
+        ++lines;
+    EXPECT_EQ(lines, fills.size() + 1); // and the header
+}
+
+TEST(TradeExporter, FailsWhenAMillisecondOutgrowsTheLargestPage)
+{
+    std::vector<Fill> fills = fillsAt(1000, TradeExportOptions::MAX_PAGE_SIZE + 1, "a");
+    fills.push_back({1001, "b0"});
+    std::vector<TradeExportResult> results = exportFills(fills, TradeExportOptions::MAX_PAGE_SIZE, "TESTC");
+    ASSERT_EQ(results.size(), 1u);
+    EXPECT_NE(results[0].error.find("fills at timestamp 1000"), std::string::npos) << results[0].error;
+    EXPECT_EQ(results[0].rows, TradeExportOptions::MAX_PAGE_SIZE);
+}
+
+// too_many_requests backs off and asks for the same page again
+TEST(TradeExporter, RetriesARateLimitedPage)
+{
+    std::vector<Fill> fills = fillsAt(1000, 3, "a");
+    std::atomic<int> requests{0};
+    std::vector<TradeExportResult> results = runExport([&](const std::string &request)
+                                                       { return ++requests <= 2 ? TOO_MANY_REQUESTS : tradesPage(fills, request); },
+                                                       10, "TESTD");
+    ASSERT_EQ(results.size(), 1u);
+    EXPECT_EQ(results[0].error, "");
+    EXPECT_EQ(results[0].rows, fills.size());
+    EXPECT_EQ(results[0].pages, 1u);
+    EXPECT_EQ(requests.load(), 3);
+}
+
+TEST(TradeExporter, GivesUpOnARateLimitThatOutlastsTheRetries)
+{
+    std::atomic<int> requests{0};
+    std::vector<TradeExportResult> results = runExport([&](const std::string &)
+                                                       {
+                                                           ++requests;
+                                                           return TOO_MANY_REQUESTS; },
+                                                       10, "TESTE");
+    ASSERT_EQ(results.size(), 1u);
+    EXPECT_EQ(results[0].error, "rate limited after retries at timestamp 0");
+    EXPECT_EQ(requests.load(), TradeExportOptions().maxRetries + 1);
+}
+
+// any other exchange error is not retried
+TEST(TradeExporter, StopsAtOtherExchangeErrors)
+{
+    std::atomic<int> requests{0};
+    std::vector<TradeExportResult> results = runExport([&](const std::string &)
+                                                       {
+                                                           ++requests;
+                                                           return std::string("{\"jsonrpc\":\"2.0\",\"id\":7,\"error\":{\"code\":13009,\"message\":\"unauthorized\"}}"); },
+                                                       10, "TESTF");
+    ASSERT_EQ(results.size(), 1u);
+    EXPECT_EQ(results[0].error.rfind("exchange error: ", 0), 0u) << results[0].error;
+    EXPECT_EQ(requests.load(), 1);
+}
+
+// index entries are buffered, so the failure shows when the buffer fills, or at the latest when the export closes
+TEST(TradeWriter, FailsWhenTheIndexCannotBeWritten)
+{
+    std::unique_ptr<TradeWriter> writer = fullDiskWriter("index_full.csv", ".idx");
+    ASSERT_TRUE(writer);
+    EXPECT_THROW(
+        {
+            for (int64_t i = 0; i < 100000; ++i)
+                writer->write(exampleRow(i));
+        },
+        std::runtime_error);
+
+    writer = fullDiskWriter("index_closed.csv", ".idx");
+    ASSERT_TRUE(writer);
+    writer->write(exampleRow(1));
+    EXPECT_THROW(writer->finish(), std::runtime_error);
+}
+
+TEST(TradeWriter, FailsWhenTheExportCannotBeFlushed)
+{
+    std::unique_ptr<TradeWriter> writer = fullDiskWriter("export_full.csv", "");
+    ASSERT_TRUE(writer);
+    writer->write(exampleRow(1));
+    EXPECT_THROW(writer->finish(), std::runtime_error);
+}